@@ -0,0 +1,239 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright © 2012 Red Hat, Inc
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2 of the licence or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:gasyncsocketservice
+ * @title: GAsyncSocketService
+ * @short_description: A GSocketService for asynchronous handlers
+ * @see_also: #GSocketService, #GThreadedSocketService.
+ *
+ * A #GAsyncSocketService is a subclass of #GSocketService that
+ * spreads incoming connections over a fixed number of threads, each
+ * running its own main loop, and emits the #GAsyncSocketService::run
+ * signal for each of them in one of those threads.
+ *
+ * Unlike with #GThreadedSocketService, the signal handler must not
+ * block. It starts asynchronous operations on the connection and
+ * returns; the operations then complete in the same thread, which
+ * handles any number of other connections in the meantime. This
+ * makes it possible to serve many thousands of mostly idle clients
+ * with a handful of threads.
+ *
+ * A connection counts as being handled for as long as it is
+ * referenced, so the handler keeps a reference while it is working
+ * with the connection and drops it when it is done. If the
+ * #GAsyncSocketService:max-connections limit is reached, the service
+ * stops accepting new connections until one of them is released.
+ *
+ * As with #GSocketService, you may connect to #GAsyncSocketService::run,
+ * or subclass and override the default handler.
+ */
+
+#include "config.h"
+#include "gsocketconnection.h"
+#include "gasyncsocketservice.h"
+#include "glibintl.h"
+
+
+static guint g_async_socket_service_run_signal;
+
+G_DEFINE_TYPE (GAsyncSocketService,
+	       g_async_socket_service,
+	       G_TYPE_SOCKET_SERVICE);
+
+enum
+{
+  PROP_0,
+  PROP_MAX_CONNECTIONS
+};
+
+
+G_LOCK_DEFINE_STATIC(connection_count);
+
+struct _GAsyncSocketServicePrivate
+{
+  int max_connections;
+  gint connection_count;
+};
+
+static void
+g_async_socket_service_connection_finalized (gpointer  user_data,
+					     GObject  *where_the_object_was)
+{
+  GAsyncSocketService *service = user_data;
+
+  G_LOCK (connection_count);
+  if (service->priv->connection_count-- == service->priv->max_connections)
+    g_socket_service_start (G_SOCKET_SERVICE (service));
+  G_UNLOCK (connection_count);
+
+  g_object_unref (service);
+}
+
+static gboolean
+g_async_socket_service_incoming (GSocketService    *service,
+				 GSocketConnection *connection,
+				 GObject           *source_object)
+{
+  GAsyncSocketService *async;
+  gboolean result;
+
+  async = G_ASYNC_SOCKET_SERVICE (service);
+
+  G_LOCK (connection_count);
+  if (++async->priv->connection_count == async->priv->max_connections)
+    g_socket_service_stop (service);
+  G_UNLOCK (connection_count);
+
+  g_object_weak_ref (G_OBJECT (connection),
+		     g_async_socket_service_connection_finalized,
+		     g_object_ref (service));
+
+  g_signal_emit (service, g_async_socket_service_run_signal,
+		 0, connection, source_object, &result);
+
+  return FALSE;
+}
+
+static void
+g_async_socket_service_init (GAsyncSocketService *service)
+{
+  service->priv = G_TYPE_INSTANCE_GET_PRIVATE (service,
+					       G_TYPE_ASYNC_SOCKET_SERVICE,
+					       GAsyncSocketServicePrivate);
+  service->priv->max_connections = -1;
+}
+
+static void
+g_async_socket_service_get_property (GObject    *object,
+				     guint       prop_id,
+				     GValue     *value,
+				     GParamSpec *pspec)
+{
+  GAsyncSocketService *service = G_ASYNC_SOCKET_SERVICE (object);
+
+  switch (prop_id)
+    {
+      case PROP_MAX_CONNECTIONS:
+	g_value_set_int (value, service->priv->max_connections);
+	break;
+
+      default:
+	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+g_async_socket_service_set_property (GObject      *object,
+				     guint         prop_id,
+				     const GValue *value,
+				     GParamSpec   *pspec)
+{
+  GAsyncSocketService *service = G_ASYNC_SOCKET_SERVICE (object);
+
+  switch (prop_id)
+    {
+      case PROP_MAX_CONNECTIONS:
+	service->priv->max_connections = g_value_get_int (value);
+	break;
+
+      default:
+	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+
+static void
+g_async_socket_service_class_init (GAsyncSocketServiceClass *class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+  GSocketServiceClass *ss_class = &class->parent_class;
+
+  g_type_class_add_private (class, sizeof (GAsyncSocketServicePrivate));
+
+  gobject_class->set_property = g_async_socket_service_set_property;
+  gobject_class->get_property = g_async_socket_service_get_property;
+
+  ss_class->incoming = g_async_socket_service_incoming;
+
+  /**
+   * GAsyncSocketService::run:
+   * @service: the #GAsyncSocketService.
+   * @connection: a new #GSocketConnection object.
+   * @source_object: the source_object passed to g_socket_listener_add_address().
+   *
+   * The ::run signal is emitted in one of the service's threads in
+   * response to an incoming connection, with the thread's main context
+   * as the thread-default context. The handler must not block; it
+   * should start asynchronous operations on @connection, holding a
+   * reference on it until it is done with it.
+   *
+   * Returns: %TRUE to stop further signal handlers from being called
+   *
+   * Since: 2.34
+   */
+  g_async_socket_service_run_signal =
+    g_signal_new ("run", G_TYPE_FROM_CLASS (class), G_SIGNAL_RUN_LAST,
+		  G_STRUCT_OFFSET (GAsyncSocketServiceClass, run),
+		  g_signal_accumulator_true_handled, NULL,
+		  NULL, G_TYPE_BOOLEAN,
+		  2, G_TYPE_SOCKET_CONNECTION, G_TYPE_OBJECT);
+
+  /**
+   * GAsyncSocketService:max-connections:
+   *
+   * The maximum number of connections being handled at the same
+   * time, or -1 for no limit.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_CONNECTIONS,
+				   g_param_spec_int ("max-connections",
+						     P_("Max connections"),
+						     P_("The max number of connections handled at once by this service"),
+						     -1,
+						     G_MAXINT,
+						     -1,
+						     G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+/**
+ * g_async_socket_service_new:
+ * @n_threads: the number of threads handling connections, or 0 to
+ *   handle them in the thread-default main context of the caller
+ * @max_connections: the maximal number of connections handled at the
+ *   same time, -1 means no limit
+ *
+ * Creates a new #GAsyncSocketService with no listeners. Listeners
+ * must be added with one of the #GSocketListener "add" methods.
+ *
+ * Returns: a new #GSocketService.
+ *
+ * Since: 2.34
+ */
+GSocketService *
+g_async_socket_service_new (guint n_threads,
+			    int   max_connections)
+{
+  return g_object_new (G_TYPE_ASYNC_SOCKET_SERVICE,
+		       "accept-threads", n_threads,
+		       "max-connections", max_connections,
+		       NULL);
+}
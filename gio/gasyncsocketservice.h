@@ -0,0 +1,78 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright © 2012 Red Hat, Inc
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2 of the licence or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined (__GIO_GIO_H_INSIDE__) && !defined (GIO_COMPILATION)
+#error "Only <gio/gio.h> can be included directly."
+#endif
+
+#ifndef __G_ASYNC_SOCKET_SERVICE_H__
+#define __G_ASYNC_SOCKET_SERVICE_H__
+
+#include <gio/gsocketservice.h>
+
+G_BEGIN_DECLS
+
+#define G_TYPE_ASYNC_SOCKET_SERVICE                         (g_async_socket_service_get_type ())
+#define G_ASYNC_SOCKET_SERVICE(inst)                        (G_TYPE_CHECK_INSTANCE_CAST ((inst),                     \
+                                                             G_TYPE_ASYNC_SOCKET_SERVICE,                            \
+                                                             GAsyncSocketService))
+#define G_ASYNC_SOCKET_SERVICE_CLASS(class)                 (G_TYPE_CHECK_CLASS_CAST ((class),                       \
+                                                             G_TYPE_ASYNC_SOCKET_SERVICE,                            \
+                                                             GAsyncSocketServiceClass))
+#define G_IS_ASYNC_SOCKET_SERVICE(inst)                     (G_TYPE_CHECK_INSTANCE_TYPE ((inst),                     \
+                                                             G_TYPE_ASYNC_SOCKET_SERVICE))
+#define G_IS_ASYNC_SOCKET_SERVICE_CLASS(class)              (G_TYPE_CHECK_CLASS_TYPE ((class),                       \
+                                                             G_TYPE_ASYNC_SOCKET_SERVICE))
+#define G_ASYNC_SOCKET_SERVICE_GET_CLASS(inst)              (G_TYPE_INSTANCE_GET_CLASS ((inst),                      \
+                                                             G_TYPE_ASYNC_SOCKET_SERVICE,                            \
+                                                             GAsyncSocketServiceClass))
+
+typedef struct _GAsyncSocketServicePrivate                  GAsyncSocketServicePrivate;
+typedef struct _GAsyncSocketServiceClass                    GAsyncSocketServiceClass;
+
+struct _GAsyncSocketServiceClass
+{
+  GSocketServiceClass parent_class;
+
+  gboolean (* run) (GAsyncSocketService *service,
+                    GSocketConnection   *connection,
+                    GObject             *source_object);
+
+  /* Padding for future expansion */
+  void (*_g_reserved1) (void);
+  void (*_g_reserved2) (void);
+  void (*_g_reserved3) (void);
+  void (*_g_reserved4) (void);
+  void (*_g_reserved5) (void);
+};
+
+struct _GAsyncSocketService
+{
+  GSocketService parent_instance;
+  GAsyncSocketServicePrivate *priv;
+};
+
+GType                   g_async_socket_service_get_type                 (void);
+GSocketService *        g_async_socket_service_new                      (guint n_threads,
+                                                                         int   max_connections);
+
+G_END_DECLS
+
+#endif /* __G_ASYNC_SOCKET_SERVICE_H__ */
@@ -0,0 +1,200 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+
+#include "gbufferpool.h"
+
+/* Receive buffers for g_socket_receive_bytes() and
+ * g_input_stream_read_bytes().
+ *
+ * Each thread carves its buffers out of a 64k slab, one after the
+ * other. Every buffer, and every #GBytes made from one, holds a
+ * reference on its slab; once the thread has moved on to a new slab
+ * and the last of those references is gone, the slab goes back to a
+ * small free list to be reused. The part of a buffer that was not
+ * filled is handed back to the slab if nothing has been reserved
+ * after it in the meantime, so that a stream of small reads ends up
+ * packed into the same slab.
+ *
+ * Buffers too large to share a slab are allocated on their own.
+ */
+
+#define SLAB_SIZE       (64 * 1024)
+#define MAX_SHARED_SIZE (SLAB_SIZE / 4)
+#define MAX_FREE_SLABS  16
+
+#define ALIGN(n)        (((n) + 7) & ~(gsize) 7)
+#define SLAB_DATA(slab) ((guint8 *) (slab) + ALIGN (sizeof (GBufferPoolSlab)))
+#define SLAB_END(slab)  ((guint8 *) (slab) + SLAB_SIZE)
+
+struct _GBufferPoolSlab
+{
+  volatile gint ref_count;
+  gpointer tail;
+  GBufferPoolSlab *next;
+};
+
+static void slab_unref (gpointer data);
+
+static GPrivate current_slab = G_PRIVATE_INIT (slab_unref);
+
+G_LOCK_DEFINE_STATIC (free_slabs);
+static GBufferPoolSlab *free_slabs;
+static guint n_free_slabs;
+
+static GBufferPoolSlab *
+slab_new (void)
+{
+  GBufferPoolSlab *slab;
+
+  G_LOCK (free_slabs);
+  slab = free_slabs;
+  if (slab)
+    {
+      free_slabs = slab->next;
+      n_free_slabs--;
+    }
+  G_UNLOCK (free_slabs);
+
+  if (slab == NULL)
+    slab = g_malloc (SLAB_SIZE);
+
+  slab->ref_count = 1;
+  slab->tail = SLAB_DATA (slab);
+  slab->next = NULL;
+
+  return slab;
+}
+
+static void
+slab_unref (gpointer data)
+{
+  GBufferPoolSlab *slab = data;
+
+  if (!g_atomic_int_dec_and_test (&slab->ref_count))
+    return;
+
+  G_LOCK (free_slabs);
+  if (n_free_slabs < MAX_FREE_SLABS)
+    {
+      slab->next = free_slabs;
+      free_slabs = slab;
+      n_free_slabs++;
+      slab = NULL;
+    }
+  G_UNLOCK (free_slabs);
+
+  g_free (slab);
+}
+
+/*
+ * _g_buffer_pool_reserve:
+ * @size: the number of bytes needed
+ * @slab: (out): return location for the slab the buffer belongs to
+ *
+ * Reserves a buffer of @size bytes. It must be passed to
+ * _g_buffer_pool_commit() once it has been filled.
+ *
+ * Returns: the buffer
+ */
+gpointer
+_g_buffer_pool_reserve (gsize             size,
+                        GBufferPoolSlab **slab)
+{
+  GBufferPoolSlab *current;
+  guint8 *tail;
+
+  if (size > MAX_SHARED_SIZE)
+    {
+      *slab = NULL;
+      return g_malloc (size);
+    }
+
+  size = ALIGN (size);
+  while (TRUE)
+    {
+      current = g_private_get (&current_slab);
+      if (current != NULL)
+        {
+          tail = g_atomic_pointer_get (&current->tail);
+          if ((gsize) (SLAB_END (current) - tail) >= size)
+            {
+              /* The tail may move back under us when a buffer
+               * reserved in this thread is committed elsewhere.
+               */
+              if (g_atomic_pointer_compare_and_exchange (&current->tail,
+                                                         tail, tail + size))
+                break;
+              continue;
+            }
+        }
+
+      g_private_replace (&current_slab, slab_new ());
+    }
+
+  g_atomic_int_inc (&current->ref_count);
+  *slab = current;
+
+  return tail;
+}
+
+/*
+ * _g_buffer_pool_commit:
+ * @slab: the slab returned by _g_buffer_pool_reserve()
+ * @buffer: the buffer returned by _g_buffer_pool_reserve()
+ * @size: the size passed to _g_buffer_pool_reserve()
+ * @used: the number of bytes written to @buffer, or -1 if the
+ *   operation filling it failed
+ *
+ * Releases a buffer reserved with _g_buffer_pool_reserve(), turning
+ * its first @used bytes into a #GBytes.
+ *
+ * Returns: a #GBytes of @used bytes (which may be empty), or %NULL if
+ *   @used is -1
+ */
+GBytes *
+_g_buffer_pool_commit (GBufferPoolSlab *slab,
+                       gpointer         buffer,
+                       gsize            size,
+                       gssize           used)
+{
+  if (slab == NULL)
+    {
+      if (used > 0)
+        return g_bytes_new_take (g_realloc (buffer, used), used);
+
+      g_free (buffer);
+    }
+  else
+    {
+      g_atomic_pointer_compare_and_exchange (&slab->tail,
+                                             (guint8 *) buffer + ALIGN (size),
+                                             (guint8 *) buffer + ALIGN (MAX (used, 0)));
+
+      if (used > 0)
+        return g_bytes_new_with_free_func (buffer, used, slab_unref, slab);
+
+      slab_unref (slab);
+    }
+
+  return used < 0 ? NULL : g_bytes_new (NULL, 0);
+}
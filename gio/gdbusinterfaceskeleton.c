@@ -52,6 +52,12 @@ struct _GDBusInterfaceSkeletonPrivate
   GSList                     *connections;   /* List of ConnectionData */
   gchar                      *object_path;   /* The object path for this skeleton */
   GDBusInterfaceVTable       *hooked_vtable;
+
+  /* Invocations waiting to be handled in the worker pool (DispatchData) and
+   * whether a worker is currently handling them
+   */
+  GQueue                      pool_invocations;
+  gboolean                    pool_dispatch_running;
 };
 
 typedef struct
@@ -234,6 +240,7 @@ g_dbus_interface_skeleton_class_init (GDBusInterfaceSkeletonClass *klass)
    * #GDBusObjectSkeleton, if any) and #GDBusInterfaceSkeleton:g-flags does
    * not have the
    * %G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD
+   * or %G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL
    * flags set, no dedicated thread is ever used and the call will be
    * handled in the same thread as the object that @interface belongs
    * to was exported in.
@@ -533,7 +540,8 @@ dispatch_in_thread_func (GIOSchedulerJob *job,
   if (authorized)
     {
       gboolean run_in_thread;
-      run_in_thread = (flags & G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
+      run_in_thread = (flags & (G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD |
+                                G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL));
       if (run_in_thread)
         {
           /* might as well just re-use the existing thread */
@@ -567,6 +575,63 @@ dispatch_in_thread_func (GIOSchedulerJob *job,
   return FALSE;
 }
 
+/* Maximum number of threads handling method invocations for skeletons
+ * with G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL
+ * set. The pool is separate from the GIOScheduler one so slow method
+ * handlers don't hold up unrelated asynchronous I/O.
+ */
+#define DISPATCH_POOL_MAX_THREADS 10
+
+static void dispatch_in_pool_func (gpointer data,
+                                   gpointer user_data);
+
+static gpointer
+init_dispatch_pool (gpointer arg)
+{
+  return g_thread_pool_new (dispatch_in_pool_func,
+                            NULL,
+                            DISPATCH_POOL_MAX_THREADS,
+                            FALSE,
+                            NULL);
+}
+
+static GThreadPool *
+get_dispatch_pool (void)
+{
+  static GOnce once_init = G_ONCE_INIT;
+  return g_once (&once_init, init_dispatch_pool, NULL);
+}
+
+/* Runs in a worker thread and handles all the queued invocations for one
+ * skeleton; the skeleton is only ever pushed to the pool once at a time, so
+ * its invocations are handled in order
+ */
+static void
+dispatch_in_pool_func (gpointer data,
+                       gpointer user_data)
+{
+  GDBusInterfaceSkeleton *interface = G_DBUS_INTERFACE_SKELETON (data);
+
+  while (TRUE)
+    {
+      DispatchData *dispatch;
+
+      g_mutex_lock (&interface->priv->lock);
+      dispatch = g_queue_pop_head (&interface->priv->pool_invocations);
+      if (dispatch == NULL)
+        interface->priv->pool_dispatch_running = FALSE;
+      g_mutex_unlock (&interface->priv->lock);
+
+      if (dispatch == NULL)
+        break;
+
+      dispatch_in_thread_func (NULL, NULL, dispatch);
+      dispatch_data_unref (dispatch);
+    }
+
+  g_object_unref (interface);
+}
+
 static void
 g_dbus_interface_method_dispatch_helper (GDBusInterfaceSkeleton       *interface,
                                          GDBusInterfaceMethodCallFunc  method_call_func,
@@ -609,7 +674,8 @@ g_dbus_interface_method_dispatch_helper (GDBusInterfaceSkeleton       *interface
         emit_authorized_signal = _g_dbus_object_skeleton_has_authorize_method_handlers (G_DBUS_OBJECT_SKELETON (object));
     }
 
-  run_in_thread = (flags & G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
+  run_in_thread = (flags & (G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD |
+                            G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL));
   if (!emit_authorized_signal && !run_in_thread)
     {
       method_call_func (g_dbus_method_invocation_get_connection (invocation),
@@ -630,11 +696,27 @@ g_dbus_interface_method_dispatch_helper (GDBusInterfaceSkeleton       *interface
       data->invocation = invocation;
       data->context = g_main_context_ref_thread_default ();
       data->ref_count = 1;
-      g_io_scheduler_push_job (dispatch_in_thread_func,
-                               data,
-                               (GDestroyNotify) dispatch_data_unref,
-                               G_PRIORITY_DEFAULT,
-                               NULL); /* GCancellable* */
+      if (flags & G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL)
+        {
+          gboolean push;
+
+          g_mutex_lock (&interface->priv->lock);
+          g_queue_push_tail (&interface->priv->pool_invocations, data);
+          push = !interface->priv->pool_dispatch_running;
+          interface->priv->pool_dispatch_running = TRUE;
+          g_mutex_unlock (&interface->priv->lock);
+
+          if (push)
+            g_thread_pool_push (get_dispatch_pool (), g_object_ref (interface), NULL);
+        }
+      else
+        {
+          g_io_scheduler_push_job (dispatch_in_thread_func,
+                                   data,
+                                   (GDestroyNotify) dispatch_data_unref,
+                                   G_PRIORITY_DEFAULT,
+                                   NULL); /* GCancellable* */
+        }
     }
 
   if (object != NULL)
@@ -1473,7 +1473,9 @@ add_interfaces (GDBusObjectManagerClient *manager,
         }
 
       /* this is fine - there is no blocking IO because we pass DO_NOT_LOAD_PROPERTIES and
-       * DO_NOT_CONNECT_SIGNALS and use a unique name
+       * DO_NOT_CONNECT_SIGNALS and use a unique name - in that case the proxy is
+       * initialized without any bus traffic and without iterating a main loop, so
+       * building thousands of proxies from a GetManagedObjects() reply is cheap
        */
       error = NULL;
       interface_proxy = g_initable_new (interface_proxy_type,
@@ -1497,25 +1499,11 @@ add_interfaces (GDBusObjectManagerClient *manager,
         }
       else
         {
-          GVariantIter property_iter;
-          const gchar *property_name;
-          GVariant *property_value;
-
           /* associate the interface proxy with the object */
           g_dbus_interface_set_object (G_DBUS_INTERFACE (interface_proxy),
                                        G_DBUS_OBJECT (op));
 
-          g_variant_iter_init (&property_iter, properties);
-          while (g_variant_iter_next (&property_iter,
-                                      "{&sv}",
-                                      &property_name,
-                                      &property_value))
-            {
-              g_dbus_proxy_set_cached_property (interface_proxy,
-                                                property_name,
-                                                property_value);
-              g_variant_unref (property_value);
-            }
+          _g_dbus_proxy_set_cached_properties (interface_proxy, properties);
 
           _g_dbus_object_proxy_add_interface (op, interface_proxy);
           if (!added)
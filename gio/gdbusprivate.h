@@ -143,6 +143,9 @@ void _g_dbus_object_proxy_add_interface (GDBusObjectProxy *proxy,
 void _g_dbus_object_proxy_remove_interface (GDBusObjectProxy *proxy,
                                             const gchar      *interface_name);
 
+void _g_dbus_proxy_set_cached_properties (GDBusProxy *proxy,
+                                          GVariant   *properties);
+
 G_END_DECLS
 
 #endif /* __G_DBUS_PRIVATE_H__ */
@@ -92,10 +92,16 @@
  */
 
 /* lock protecting the mutable properties: name_owner, timeout_msec,
- * expected_interface, and the properties hash table
+ * expected_interface, the properties hash table and the shared_proxies
+ * registry below
  */
 G_LOCK_DEFINE_STATIC (properties_lock);
 
+/* "connection name object-path interface" -> GList of GDBusProxy*, only
+ * containing proxies constructed with G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE
+ */
+static GHashTable *shared_proxies = NULL;
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 G_LOCK_DEFINE_STATIC (signal_subscription_lock);
@@ -157,6 +163,21 @@ struct _GDBusProxyPrivate
   GDBusObject *object;
 
   SignalSubscriptionData *signal_subscription_data;
+
+  /* key into shared_proxies, NULL if not registered */
+  gchar *shared_key;
+
+  /* property names invalidated while GET_INVALIDATED_PROPERTIES is set,
+   * waiting for a GetAll() call to be sent - and the names covered by the
+   * GetAll() call currently in flight, if any. Protected by properties_lock
+   */
+  GHashTable *invalidated_pending;
+  GHashTable *invalidated_in_flight;
+
+  /* TRUE if properties have been removed from the cache since they were
+   * loaded. Protected by properties_lock
+   */
+  gboolean properties_incomplete;
 };
 
 enum
@@ -215,6 +236,21 @@ g_dbus_proxy_finalize (GObject *object)
 
   g_warn_if_fail (proxy->priv->get_all_cancellable == NULL);
 
+  if (proxy->priv->shared_key != NULL)
+    {
+      GList *proxies;
+
+      G_LOCK (properties_lock);
+      proxies = g_hash_table_lookup (shared_proxies, proxy->priv->shared_key);
+      proxies = g_list_remove (proxies, proxy);
+      if (proxies != NULL)
+        g_hash_table_replace (shared_proxies, g_strdup (proxy->priv->shared_key), proxies);
+      else
+        g_hash_table_remove (shared_proxies, proxy->priv->shared_key);
+      G_UNLOCK (properties_lock);
+      g_free (proxy->priv->shared_key);
+    }
+
   if (proxy->priv->name_owner_changed_subscription_id > 0)
     g_dbus_connection_signal_unsubscribe (proxy->priv->connection,
                                           proxy->priv->name_owner_changed_subscription_id);
@@ -235,6 +271,10 @@ g_dbus_proxy_finalize (GObject *object)
   g_free (proxy->priv->interface_name);
   if (proxy->priv->properties != NULL)
     g_hash_table_unref (proxy->priv->properties);
+  if (proxy->priv->invalidated_pending != NULL)
+    g_hash_table_unref (proxy->priv->invalidated_pending);
+  if (proxy->priv->invalidated_in_flight != NULL)
+    g_hash_table_unref (proxy->priv->invalidated_in_flight);
 
   if (proxy->priv->expected_interface != NULL)
     {
@@ -975,61 +1015,152 @@ insert_property_checked (GDBusProxy  *proxy,
   g_free (property_name);
 }
 
-typedef struct
+/* Sets all the properties in @properties, a dictionary of type a{sv},
+ * at once - used by GDBusObjectManagerClient to fill in the properties it
+ * already got with GetManagedObjects() or InterfacesAdded().
+ */
+void
+_g_dbus_proxy_set_cached_properties (GDBusProxy *proxy,
+                                     GVariant   *properties)
 {
-  GDBusProxy *proxy;
-  gchar *prop_name;
-} InvalidatedPropGetData;
+  gsize n, num_properties;
+
+  g_return_if_fail (G_IS_DBUS_PROXY (proxy));
+  g_return_if_fail (g_variant_is_of_type (properties, G_VARIANT_TYPE ("a{sv}")));
+
+  /* this is called for every interface of every object, so take the
+   * entries apart by hand instead of parsing a format string for each
+   */
+  num_properties = g_variant_n_children (properties);
+
+  G_LOCK (properties_lock);
+  for (n = 0; n < num_properties; n++)
+    {
+      GVariant *entry;
+      GVariant *key;
+      GVariant *boxed;
+
+      entry = g_variant_get_child_value (properties, n);
+      key = g_variant_get_child_value (entry, 0);
+      boxed = g_variant_get_child_value (entry, 1);
+      insert_property_checked (proxy,
+                               g_variant_dup_string (key, NULL), /* adopts string */
+                               g_variant_get_variant (boxed));   /* adopts value */
+      g_variant_unref (boxed);
+      g_variant_unref (key);
+      g_variant_unref (entry);
+    }
+  G_UNLOCK (properties_lock);
+}
+
+static void invalidated_properties_get_all (GDBusProxy *proxy);
 
 static void
-invalidated_property_get_cb (GDBusConnection *connection,
-                             GAsyncResult    *res,
-                             gpointer         user_data)
+invalidated_properties_get_all_cb (GDBusConnection *connection,
+                                   GAsyncResult    *res,
+                                   gpointer         user_data)
 {
-  InvalidatedPropGetData *data = user_data;
+  GDBusProxy *proxy = G_DBUS_PROXY (user_data);
   const gchar *invalidated_properties[] = {NULL};
   GVariantBuilder builder;
-  GVariant *value = NULL;
-  GVariant *unpacked_value = NULL;
+  GVariant *result;
+  GVariantIter *iter;
+  gboolean emit_g_signal;
+  gchar *key;
+  GVariant *value;
+
+  emit_g_signal = FALSE;
+  iter = NULL;
 
   /* errors are fine, the other end could have disconnected */
-  value = g_dbus_connection_call_finish (connection, res, NULL);
-  if (value == NULL)
-    {
-      goto out;
-    }
+  result = g_dbus_connection_call_finish (connection, res, NULL);
+
+  /* synthesize the a{sv} in the PropertiesChanged signal */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  G_LOCK (properties_lock);
+
+  if (result != NULL)
+    g_variant_get (result, "(a{sv})", &iter);
 
-  if (!g_variant_is_of_type (value, G_VARIANT_TYPE ("(v)")))
+  /* only the properties that were invalidated are updated - the others
+   * are kept up to date by PropertiesChanged and must not be clobbered
+   * by a reply that may have crossed a signal on the wire
+   */
+  while (iter != NULL && g_variant_iter_next (iter, "{sv}", &key, &value))
     {
-      g_warning ("Expected type `(v)' for Get() reply, got `%s'", g_variant_get_type_string (value));
-      goto out;
+      if (g_hash_table_contains (proxy->priv->invalidated_in_flight, key))
+        {
+          g_variant_builder_add (&builder, "{sv}", key, value);
+          insert_property_checked (proxy,
+                                   key,    /* adopts string */
+                                   value); /* adopts value */
+          emit_g_signal = TRUE;
+        }
+      else
+        {
+          g_free (key);
+          g_variant_unref (value);
+        }
     }
 
-  g_variant_get (value, "(v)", &unpacked_value);
+  g_hash_table_unref (proxy->priv->invalidated_in_flight);
+  proxy->priv->invalidated_in_flight = NULL;
 
-  /* synthesize the a{sv} in the PropertiesChanged signal */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
-  g_variant_builder_add (&builder, "{sv}", data->prop_name, unpacked_value);
+  /* properties invalidated while the call was in flight */
+  if (proxy->priv->invalidated_pending != NULL)
+    invalidated_properties_get_all (proxy);
 
-  G_LOCK (properties_lock);
-  insert_property_checked (data->proxy,
-                           data->prop_name,  /* adopts string */
-                           unpacked_value);  /* adopts value */
-  data->prop_name = NULL;
   G_UNLOCK (properties_lock);
 
-  g_signal_emit (data->proxy,
-                 signals[PROPERTIES_CHANGED_SIGNAL], 0,
-                 g_variant_builder_end (&builder), /* consumed */
-                 invalidated_properties);
+  if (emit_g_signal)
+    g_signal_emit (proxy,
+                   signals[PROPERTIES_CHANGED_SIGNAL], 0,
+                   g_variant_builder_end (&builder), /* consumed */
+                   invalidated_properties);
+  else
+    g_variant_builder_clear (&builder);
 
+  if (iter != NULL)
+    g_variant_iter_free (iter);
+  if (result != NULL)
+    g_variant_unref (result);
+  g_object_unref (proxy);
+}
 
- out:
-  if (value != NULL)
-    g_variant_unref (value);
-  g_object_unref (data->proxy);
-  g_free (data->prop_name);
-  g_slice_free (InvalidatedPropGetData, data);
+/* Called with properties_lock held. Fetches all the pending invalidated
+ * properties with a single GetAll() call instead of one Get() call per
+ * property. At most one such call is in flight per proxy; properties
+ * invalidated in the meantime are collected and fetched once it returns.
+ */
+static void
+invalidated_properties_get_all (GDBusProxy *proxy)
+{
+  if (proxy->priv->invalidated_in_flight != NULL)
+    return;
+
+  if (proxy->priv->name_owner == NULL)
+    {
+      g_hash_table_unref (proxy->priv->invalidated_pending);
+      proxy->priv->invalidated_pending = NULL;
+      return;
+    }
+
+  proxy->priv->invalidated_in_flight = proxy->priv->invalidated_pending;
+  proxy->priv->invalidated_pending = NULL;
+
+  g_dbus_connection_call (proxy->priv->connection,
+                          proxy->priv->name_owner,
+                          proxy->priv->object_path,
+                          "org.freedesktop.DBus.Properties",
+                          "GetAll",
+                          g_variant_new ("(s)", proxy->priv->interface_name),
+                          G_VARIANT_TYPE ("(a{sv})"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,           /* timeout */
+                          NULL,         /* GCancellable */
+                          (GAsyncReadyCallback) invalidated_properties_get_all_cb,
+                          g_object_ref (proxy));
 }
 
 static void
@@ -1110,27 +1241,17 @@ on_properties_changed (GDBusConnection *connection,
 
   if (proxy->priv->flags & G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES)
     {
-      if (proxy->priv->name_owner != NULL)
+      if (proxy->priv->name_owner != NULL && invalidated_properties[0] != NULL)
         {
+          if (proxy->priv->invalidated_pending == NULL)
+            proxy->priv->invalidated_pending = g_hash_table_new_full (g_str_hash,
+                                                                      g_str_equal,
+                                                                      g_free,
+                                                                      NULL);
           for (n = 0; invalidated_properties[n] != NULL; n++)
-            {
-              InvalidatedPropGetData *data;
-              data = g_slice_new0 (InvalidatedPropGetData);
-              data->proxy = g_object_ref (proxy);
-              data->prop_name = g_strdup (invalidated_properties[n]);
-              g_dbus_connection_call (proxy->priv->connection,
-                                      proxy->priv->name_owner,
-                                      proxy->priv->object_path,
-                                      "org.freedesktop.DBus.Properties",
-                                      "Get",
-                                      g_variant_new ("(ss)", proxy->priv->interface_name, data->prop_name),
-                                      G_VARIANT_TYPE ("(v)"),
-                                      G_DBUS_CALL_FLAGS_NONE,
-                                      -1,           /* timeout */
-                                      NULL,         /* GCancellable */
-                                      (GAsyncReadyCallback) invalidated_property_get_cb,
-                                      data);
-            }
+            g_hash_table_add (proxy->priv->invalidated_pending,
+                              g_strdup (invalidated_properties[n]));
+          invalidated_properties_get_all (proxy);
         }
     }
   else
@@ -1138,7 +1259,8 @@ on_properties_changed (GDBusConnection *connection,
       emit_g_signal = TRUE;
       for (n = 0; invalidated_properties[n] != NULL; n++)
         {
-          g_hash_table_remove (proxy->priv->properties, invalidated_properties[n]);
+          if (g_hash_table_remove (proxy->priv->properties, invalidated_properties[n]))
+            proxy->priv->properties_incomplete = TRUE;
         }
     }
 
@@ -1261,6 +1383,7 @@ on_name_owner_changed_get_all_cb (GDBusConnection *connection,
       data->proxy->priv->name_owner = data->name_owner;
       data->name_owner = NULL; /* to avoid an extra copy, we steal the string */
       g_hash_table_remove_all (data->proxy->priv->properties);
+      data->proxy->priv->properties_incomplete = FALSE;
       G_UNLOCK (properties_lock);
       if (result != NULL)
         {
@@ -1477,10 +1600,59 @@ async_init_get_all_cb (GDBusConnection *connection,
   async_init_data_free (data);
 }
 
+/* Called with properties_lock held. Looks for another initialized proxy
+ * for the same object that is talking to @name_owner and whose property
+ * cache is complete, and returns its properties in the form of a GetAll()
+ * reply - or %NULL if there is no such proxy.
+ */
+static GVariant *
+lookup_shared_properties (GDBusProxy  *proxy,
+                          const gchar *name_owner)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  GDBusProxy *other;
+  GList *l;
+  gpointer key, value;
+
+  if (proxy->priv->shared_key == NULL)
+    return NULL;
+
+  other = NULL;
+  for (l = g_hash_table_lookup (shared_proxies, proxy->priv->shared_key); l != NULL; l = l->next)
+    {
+      GDBusProxy *p = l->data;
+
+      if (p != proxy &&
+          p->priv->initialized &&
+          !p->priv->properties_incomplete &&
+          p->priv->invalidated_pending == NULL &&
+          p->priv->invalidated_in_flight == NULL &&
+          g_strcmp0 (p->priv->name_owner, name_owner) == 0)
+        {
+          other = p;
+          break;
+        }
+    }
+
+  if (other == NULL)
+    return NULL;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("(a{sv})"));
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_hash_table_iter_init (&iter, other->priv->properties);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_variant_builder_add (&builder, "{sv}", key, value);
+  g_variant_builder_close (&builder);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
 static void
 async_init_data_set_name_owner (AsyncInitData *data,
                                 const gchar   *name_owner)
 {
+  GVariant *shared_properties;
   gboolean get_all;
 
 
@@ -1509,7 +1681,26 @@ async_init_data_set_name_owner (AsyncInitData *data,
         get_all = FALSE;
     }
 
+  shared_properties = NULL;
   if (get_all)
+    {
+      G_LOCK (properties_lock);
+      shared_properties = lookup_shared_properties (data->proxy, name_owner);
+      G_UNLOCK (properties_lock);
+    }
+
+  if (shared_properties != NULL)
+    {
+      /* another proxy already has the properties - reuse them as if
+       * they were the reply to our own GetAll() call
+       */
+      g_simple_async_result_set_op_res_gpointer (data->simple,
+                                                 shared_properties,
+                                                 (GDestroyNotify) g_variant_unref);
+      g_simple_async_result_complete_in_idle (data->simple);
+      async_init_data_free (data);
+    }
+  else if (get_all)
     {
       /* load all properties asynchronously */
       g_dbus_connection_call (data->proxy->priv->connection,
@@ -1773,6 +1964,26 @@ async_initable_init_first (GAsyncInitable *initable)
 {
   GDBusProxy *proxy = G_DBUS_PROXY (initable);
 
+  if ((proxy->priv->flags & G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE) &&
+      !(proxy->priv->flags & G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES))
+    {
+      GList *proxies;
+
+      proxy->priv->shared_key = g_strdup_printf ("%p %s %s %s",
+                                                 proxy->priv->connection,
+                                                 proxy->priv->name != NULL ? proxy->priv->name : "",
+                                                 proxy->priv->object_path,
+                                                 proxy->priv->interface_name);
+
+      G_LOCK (properties_lock);
+      if (shared_proxies == NULL)
+        shared_proxies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      proxies = g_hash_table_lookup (shared_proxies, proxy->priv->shared_key);
+      proxies = g_list_prepend (proxies, proxy);
+      g_hash_table_replace (shared_proxies, g_strdup (proxy->priv->shared_key), proxies);
+      G_UNLOCK (properties_lock);
+    }
+
   if (!(proxy->priv->flags & G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES))
     {
       /* subscribe to PropertiesChanged() */
@@ -1979,6 +2190,24 @@ initable_init (GInitable     *initable,
 
   async_initable_init_first (G_ASYNC_INITABLE (initable));
 
+  /* If there is neither a name owner to look up nor properties to load,
+   * there is nothing to wait for - skip the private main loop. This is
+   * the common case for proxies built by GDBusObjectManagerClient.
+   */
+  if ((proxy->priv->flags & G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES) &&
+      (proxy->priv->name == NULL || g_dbus_is_unique_name (proxy->priv->name)))
+    {
+      if (!g_cancellable_set_error_if_cancelled (cancellable, error))
+        {
+          G_LOCK (properties_lock);
+          proxy->priv->name_owner = g_strdup (proxy->priv->name);
+          G_UNLOCK (properties_lock);
+          ret = TRUE;
+        }
+      proxy->priv->initialized = TRUE;
+      goto out;
+    }
+
   data = g_new0 (InitableAsyncInitableData, 1);
   data->context = g_main_context_new ();
   data->loop = g_main_loop_new (data->context, FALSE);
@@ -0,0 +1,1876 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "glibintl.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "gdnsresolver.h"
+#include "gnetworkingprivate.h"
+
+#include "gcancellable.h"
+#include "ginetaddress.h"
+#include "ginetsocketaddress.h"
+#include "gioerror.h"
+#include "gsimpleasyncresult.h"
+#include "gsocket.h"
+#include "gsrvtarget.h"
+
+/* GDnsResolver is a stub resolver that talks to the name servers
+ * listed in resolv.conf itself, over UDP (falling back to TCP for
+ * truncated replies), instead of calling getaddrinfo() and
+ * res_query() in a thread. All of the I/O happens on the
+ * thread-default main context of the caller, so any number of
+ * lookups can be in flight without tying up a thread each.
+ * Synchronous lookups run the same code on a private main context.
+ *
+ * Names are looked up in the hosts file first. A and AAAA queries for
+ * a name are sent at the same time. Each query is tried against every
+ * name server in turn, "attempts" times over, waiting "timeout"
+ * seconds for each answer; "search", "domain" and "ndots" are honoured
+ * for g_resolver_lookup_by_name() like the libc resolver does. As an
+ * extension, a nameserver line can give a port as "address#port".
+ */
+
+#ifndef T_AAAA
+#define T_AAAA 28
+#endif
+
+#define DNS_PORT             53
+#define DNS_HEADER_SIZE      12
+#define DNS_MAX_NAME_LENGTH  255
+#define DNS_MAX_LABEL_LENGTH 63
+#define DNS_BUFFER_SIZE      4096
+
+#define DNS_FLAG_QR          0x8000
+#define DNS_FLAG_TC          0x0200
+#define DNS_FLAG_RD          0x0100
+#define DNS_RCODE_MASK       0x000f
+
+#define DNS_RCODE_NOERROR    0
+#define DNS_RCODE_SERVFAIL   2
+#define DNS_RCODE_NXDOMAIN   3
+
+#define DEFAULT_NDOTS        1
+#define DEFAULT_TIMEOUT      5
+#define DEFAULT_ATTEMPTS     2
+#define MAX_NDOTS            15
+#define MAX_TIMEOUT          30
+#define MAX_ATTEMPTS         5
+
+#define HOSTS_FILE           "/etc/hosts"
+
+enum {
+  PROP_0,
+  PROP_RESOLV_CONF,
+  PROP_HOSTS_FILE
+};
+
+G_DEFINE_TYPE (GDnsResolver, g_dns_resolver, G_TYPE_RESOLVER)
+
+/* The parsed contents of resolv.conf and the hosts file. A config is
+ * never modified once it has been read; lookups hold a ref on the one
+ * that was current when they started.
+ */
+struct _GDnsResolverConfig {
+  volatile gint ref_count;
+
+  time_t resolv_conf_mtime;
+  time_t hosts_mtime;
+
+  GPtrArray *servers;
+  gchar **search;
+  guint ndots;
+  guint timeout;
+  guint attempts;
+
+  GHashTable *hosts;
+  GHashTable *hosts_names;
+};
+
+static GDnsResolverConfig *
+config_ref (GDnsResolverConfig *config)
+{
+  g_atomic_int_inc (&config->ref_count);
+  return config;
+}
+
+static void
+config_unref (GDnsResolverConfig *config)
+{
+  if (!g_atomic_int_dec_and_test (&config->ref_count))
+    return;
+
+  g_ptr_array_unref (config->servers);
+  g_strfreev (config->search);
+  g_hash_table_unref (config->hosts);
+  g_hash_table_unref (config->hosts_names);
+  g_slice_free (GDnsResolverConfig, config);
+}
+
+static time_t
+file_mtime (const gchar *filename)
+{
+  struct stat st;
+
+  if (stat (filename, &st) != 0)
+    return 0;
+
+  return st.st_mtime;
+}
+
+/* Splits @line at whitespace, without empty elements */
+static gchar **
+split_line (const gchar *line)
+{
+  GPtrArray *tokens;
+  gchar **split;
+  gint i;
+
+  split = g_strsplit_set (line, " \t\r", -1);
+  tokens = g_ptr_array_new ();
+  for (i = 0; split[i]; i++)
+    {
+      if (split[i][0])
+        g_ptr_array_add (tokens, split[i]);
+      else
+        g_free (split[i]);
+    }
+  g_ptr_array_add (tokens, NULL);
+  g_free (split);
+
+  return (gchar **) g_ptr_array_free (tokens, FALSE);
+}
+
+static GSocketAddress *
+parse_nameserver (const gchar *str)
+{
+  GInetAddress *address;
+  GSocketAddress *sockaddr;
+  const gchar *hash;
+  gchar *host;
+  guint64 port = DNS_PORT;
+
+  hash = strchr (str, '#');
+  if (hash)
+    {
+      gchar *end;
+
+      port = g_ascii_strtoull (hash + 1, &end, 10);
+      if (*end || port == 0 || port > G_MAXUINT16)
+        return NULL;
+      host = g_strndup (str, hash - str);
+    }
+  else
+    host = g_strdup (str);
+
+  address = g_inet_address_new_from_string (host);
+  g_free (host);
+  if (address == NULL)
+    return NULL;
+
+  sockaddr = g_inet_socket_address_new (address, port);
+  g_object_unref (address);
+
+  return sockaddr;
+}
+
+static guint
+parse_option (const gchar *option,
+              const gchar *name,
+              guint        value,
+              guint        max)
+{
+  gsize len = strlen (name);
+
+  if (strncmp (option, name, len) != 0 || option[len] != ':')
+    return value;
+
+  return MIN (strtoul (option + len + 1, NULL, 10), max);
+}
+
+static void
+config_read_resolv_conf (GDnsResolverConfig *config,
+                         const gchar        *filename)
+{
+  gchar *contents;
+  gchar **lines;
+  gint i, j;
+
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    return;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar **tokens;
+
+      if (lines[i][0] == '#' || lines[i][0] == ';')
+        continue;
+
+      tokens = split_line (lines[i]);
+      if (tokens[0] == NULL || tokens[1] == NULL)
+        ;
+      else if (strcmp (tokens[0], "nameserver") == 0)
+        {
+          GSocketAddress *server;
+
+          server = parse_nameserver (tokens[1]);
+          if (server)
+            g_ptr_array_add (config->servers, server);
+        }
+      else if (strcmp (tokens[0], "search") == 0)
+        {
+          g_strfreev (config->search);
+          config->search = g_strdupv (tokens + 1);
+        }
+      else if (strcmp (tokens[0], "domain") == 0)
+        {
+          g_strfreev (config->search);
+          config->search = g_new0 (gchar *, 2);
+          config->search[0] = g_strdup (tokens[1]);
+        }
+      else if (strcmp (tokens[0], "options") == 0)
+        {
+          for (j = 1; tokens[j]; j++)
+            {
+              config->ndots = parse_option (tokens[j], "ndots", config->ndots, MAX_NDOTS);
+              config->timeout = parse_option (tokens[j], "timeout", config->timeout, MAX_TIMEOUT);
+              config->attempts = parse_option (tokens[j], "attempts", config->attempts, MAX_ATTEMPTS);
+            }
+        }
+      g_strfreev (tokens);
+    }
+
+  g_strfreev (lines);
+}
+
+static void
+config_read_hosts (GDnsResolverConfig *config,
+                   const gchar        *filename)
+{
+  gchar *contents;
+  gchar **lines;
+  gint i, j;
+
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    return;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      GInetAddress *address;
+      gchar **tokens;
+      gchar *comment, *phys;
+
+      comment = strchr (lines[i], '#');
+      if (comment)
+        *comment = '\0';
+
+      tokens = split_line (lines[i]);
+      if (tokens[0] == NULL || tokens[1] == NULL)
+        {
+          g_strfreev (tokens);
+          continue;
+        }
+
+      address = g_inet_address_new_from_string (tokens[0]);
+      if (address == NULL)
+        {
+          g_strfreev (tokens);
+          continue;
+        }
+
+      for (j = 1; tokens[j]; j++)
+        {
+          GList *addresses;
+          gchar *name;
+
+          name = g_ascii_strdown (tokens[j], -1);
+          addresses = g_hash_table_lookup (config->hosts, name);
+          if (addresses)
+            {
+              /* appending to a non-empty list keeps its head */
+              addresses = g_list_append (addresses, g_object_ref (address));
+              g_free (name);
+            }
+          else
+            g_hash_table_insert (config->hosts, name,
+                                 g_list_append (NULL, g_object_ref (address)));
+        }
+
+      /* keyed by the canonical form, so that the first line for an
+       * address wins however the later ones spell it
+       */
+      phys = g_inet_address_to_string (address);
+      if (!g_hash_table_lookup (config->hosts_names, phys))
+        g_hash_table_insert (config->hosts_names, phys, g_strdup (tokens[1]));
+      else
+        g_free (phys);
+
+      g_object_unref (address);
+      g_strfreev (tokens);
+    }
+
+  g_strfreev (lines);
+}
+
+static GDnsResolverConfig *
+config_new (const gchar *resolv_conf,
+            const gchar *hosts_file)
+{
+  GDnsResolverConfig *config;
+
+  config = g_slice_new0 (GDnsResolverConfig);
+  config->ref_count = 1;
+  config->servers = g_ptr_array_new_with_free_func (g_object_unref);
+  config->ndots = DEFAULT_NDOTS;
+  config->timeout = DEFAULT_TIMEOUT;
+  config->attempts = DEFAULT_ATTEMPTS;
+  config->hosts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         (GDestroyNotify) g_resolver_free_addresses);
+  config->hosts_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  config->resolv_conf_mtime = file_mtime (resolv_conf);
+  config_read_resolv_conf (config, resolv_conf);
+  config->hosts_mtime = file_mtime (hosts_file);
+  config_read_hosts (config, hosts_file);
+
+  /* Like the libc resolver, use the local name server if none is
+   * configured.
+   */
+  if (config->servers->len == 0)
+    g_ptr_array_add (config->servers, parse_nameserver ("127.0.0.1"));
+  if (config->timeout == 0)
+    config->timeout = 1;
+  if (config->attempts == 0)
+    config->attempts = 1;
+
+  return config;
+}
+
+/* Returns the current configuration, re-reading it if either file
+ * has changed since it was last read.
+ */
+static GDnsResolverConfig *
+g_dns_resolver_get_config (GDnsResolver *resolver)
+{
+  GDnsResolverConfig *config;
+  time_t resolv_conf_mtime, hosts_mtime;
+
+  resolv_conf_mtime = file_mtime (resolver->resolv_conf);
+  hosts_mtime = file_mtime (resolver->hosts_file);
+
+  g_mutex_lock (&resolver->lock);
+  if (resolver->config == NULL ||
+      resolver->config->resolv_conf_mtime != resolv_conf_mtime ||
+      resolver->config->hosts_mtime != hosts_mtime)
+    {
+      if (resolver->config)
+        config_unref (resolver->config);
+      resolver->config = config_new (resolver->resolv_conf, resolver->hosts_file);
+    }
+  config = config_ref (resolver->config);
+  g_mutex_unlock (&resolver->lock);
+
+  return config;
+}
+
+
+static inline void
+put_uint16 (GByteArray *array,
+            guint16     value)
+{
+  guint8 bytes[2];
+
+  bytes[0] = value >> 8;
+  bytes[1] = value & 0xff;
+  g_byte_array_append (array, bytes, 2);
+}
+
+static inline guint16
+get_uint16 (const guchar *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+/* Builds a recursive query for @name, or returns %NULL if @name is not
+ * a valid domain name.
+ */
+static GByteArray *
+dns_build_query (guint16      id,
+                 const gchar *name,
+                 guint16      qtype)
+{
+  GByteArray *query;
+  const gchar *label, *dot;
+
+  query = g_byte_array_sized_new (DNS_HEADER_SIZE + strlen (name) + 6);
+  put_uint16 (query, id);
+  put_uint16 (query, DNS_FLAG_RD);
+  put_uint16 (query, 1);
+  put_uint16 (query, 0);
+  put_uint16 (query, 0);
+  put_uint16 (query, 0);
+
+  for (label = name; *label; label = dot + 1)
+    {
+      guint8 len;
+
+      dot = strchr (label, '.');
+      if (dot == NULL)
+        dot = label + strlen (label);
+
+      if (dot == label || dot - label > DNS_MAX_LABEL_LENGTH)
+        {
+          g_byte_array_unref (query);
+          return NULL;
+        }
+
+      len = dot - label;
+      g_byte_array_append (query, &len, 1);
+      g_byte_array_append (query, (const guint8 *) label, len);
+
+      if (*dot == '\0')
+        break;
+    }
+  g_byte_array_append (query, (const guint8 *) "", 1);
+
+  if (query->len - DNS_HEADER_SIZE > DNS_MAX_NAME_LENGTH)
+    {
+      g_byte_array_unref (query);
+      return NULL;
+    }
+
+  put_uint16 (query, qtype);
+  put_uint16 (query, C_IN);
+
+  return query;
+}
+
+/* Reads the possibly compressed name at *@offset and moves @offset
+ * past it. Returns %NULL if the name is malformed.
+ */
+static gchar *
+dns_read_name (const guchar *packet,
+               gsize         len,
+               gsize        *offset)
+{
+  GString *name;
+  gsize pos = *offset;
+  gboolean jumped = FALSE;
+  guint jumps = 0;
+
+  name = g_string_new (NULL);
+  while (TRUE)
+    {
+      guint8 c;
+
+      if (pos >= len)
+        goto fail;
+
+      c = packet[pos];
+      if (c == 0)
+        {
+          pos++;
+          break;
+        }
+
+      if ((c & 0xc0) == 0xc0)
+        {
+          if (pos + 1 >= len || ++jumps > DNS_MAX_NAME_LENGTH / 2)
+            goto fail;
+          if (!jumped)
+            *offset = pos + 2;
+          jumped = TRUE;
+          pos = ((c & 0x3f) << 8) | packet[pos + 1];
+          continue;
+        }
+
+      if ((c & 0xc0) != 0 || pos + 1 + c > len ||
+          memchr (packet + pos + 1, '\0', c) != NULL)
+        goto fail;
+
+      if (name->len)
+        g_string_append_c (name, '.');
+      g_string_append_len (name, (const gchar *) packet + pos + 1, c);
+      if (name->len > DNS_MAX_NAME_LENGTH)
+        goto fail;
+
+      pos += 1 + c;
+    }
+
+  if (!jumped)
+    *offset = pos;
+
+  return g_string_free (name, FALSE);
+
+ fail:
+  g_string_free (name, TRUE);
+  return NULL;
+}
+
+/* Checks that @reply is an answer to @query */
+static gboolean
+dns_reply_matches (GByteArray   *query,
+                   const guchar *reply,
+                   gsize         len)
+{
+  gsize i;
+
+  if (len < query->len)
+    return FALSE;
+
+  if (get_uint16 (reply) != get_uint16 (query->data) ||
+      (get_uint16 (reply + 2) & DNS_FLAG_QR) == 0 ||
+      get_uint16 (reply + 4) != 1)
+    return FALSE;
+
+  /* The question comes first, so it cannot be compressed */
+  for (i = DNS_HEADER_SIZE; i < query->len; i++)
+    if (g_ascii_tolower (reply[i]) != g_ascii_tolower (query->data[i]))
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+dns_free_answers (GList   *answers,
+                  guint16  qtype)
+{
+  switch (qtype)
+    {
+    case T_A:
+    case T_AAAA:
+      g_list_free_full (answers, g_object_unref);
+      break;
+
+    case T_PTR:
+      g_list_free_full (answers, g_free);
+      break;
+
+    case T_SRV:
+      g_list_free_full (answers, (GDestroyNotify) g_srv_target_free);
+      break;
+    }
+}
+
+/* Reads the resource record at *@offset in @reply, leaving *@offset
+ * just past it and *@rdata at its data.
+ */
+static gboolean
+dns_read_record (const guchar  *reply,
+                 gsize          len,
+                 gsize         *offset,
+                 gchar        **name,
+                 guint16       *type,
+                 guint16       *qclass,
+                 gsize         *rdata,
+                 guint16       *rdlength)
+{
+  *name = dns_read_name (reply, len, offset);
+  if (*name == NULL)
+    return FALSE;
+
+  if (*offset + 10 > len)
+    goto fail;
+
+  *type = get_uint16 (reply + *offset);
+  *qclass = get_uint16 (reply + *offset + 2);
+  *rdlength = get_uint16 (reply + *offset + 8);
+  *rdata = *offset + 10;
+  *offset = *rdata + *rdlength;
+  if (*offset > len)
+    goto fail;
+
+  return TRUE;
+
+ fail:
+  g_free (*name);
+  *name = NULL;
+  return FALSE;
+}
+
+static gboolean
+dns_name_in (GPtrArray   *names,
+             const gchar *name)
+{
+  guint i;
+
+  for (i = 0; i < names->len; i++)
+    if (g_ascii_strcasecmp (names->pdata[i], name) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Returns the answer records of type @qtype in @reply, as
+ * #GInetAddress for A and AAAA, strings for PTR, and #GSrvTarget for
+ * SRV records. Only records owned by the name that was asked about,
+ * or by a name it is an alias of through the CNAMEs in the answer,
+ * are used; anything else in the answer section was not asked for
+ * and is ignored, as are records of other types.
+ */
+static GList *
+dns_parse_answers (const guchar *reply,
+                   gsize         len,
+                   guint16       qtype)
+{
+  GList *answers = NULL;
+  GPtrArray *owners;
+  gsize offset = DNS_HEADER_SIZE, answers_offset;
+  guint n_answers, count;
+  gboolean added;
+  gchar *name;
+
+  owners = g_ptr_array_new_with_free_func (g_free);
+
+  /* dns_reply_matches() checked that there is exactly one question */
+  name = dns_read_name (reply, len, &offset);
+  if (name == NULL || offset + 4 > len)
+    {
+      g_free (name);
+      goto out;
+    }
+  g_ptr_array_add (owners, name);
+  offset += 4;
+
+  answers_offset = offset;
+  n_answers = get_uint16 (reply + 6);
+
+  /* Collect the aliases: each pass adds the targets of the CNAMEs
+   * owned by a name already known, in whatever order the server put
+   * them, until a pass adds nothing (which a CNAME loop cannot stop,
+   * as a name is only added once).
+   */
+  do
+    {
+      added = FALSE;
+      offset = answers_offset;
+
+      for (count = n_answers; count; count--)
+        {
+          guint16 type, qclass, rdlength;
+          gsize rdata;
+          gchar *target;
+
+          if (!dns_read_record (reply, len, &offset, &name,
+                                &type, &qclass, &rdata, &rdlength))
+            goto out;
+
+          if (type == T_CNAME && qclass == C_IN && dns_name_in (owners, name))
+            {
+              target = dns_read_name (reply, len, &rdata);
+              if (target && !dns_name_in (owners, target))
+                {
+                  g_ptr_array_add (owners, target);
+                  added = TRUE;
+                }
+              else
+                g_free (target);
+            }
+
+          g_free (name);
+        }
+    }
+  while (added);
+
+  offset = answers_offset;
+  for (count = n_answers; count; count--)
+    {
+      guint16 type, qclass, rdlength, priority, weight, port;
+      gsize rdata;
+      gboolean owned;
+
+      if (!dns_read_record (reply, len, &offset, &name,
+                            &type, &qclass, &rdata, &rdlength))
+        goto out;
+
+      owned = dns_name_in (owners, name);
+      g_free (name);
+
+      if (type != qtype || qclass != C_IN || !owned)
+        continue;
+
+      switch (qtype)
+        {
+        case T_A:
+          if (rdlength == 4)
+            answers = g_list_prepend (answers,
+                                      g_inet_address_new_from_bytes (reply + rdata,
+                                                                     G_SOCKET_FAMILY_IPV4));
+          break;
+
+        case T_AAAA:
+          if (rdlength == 16)
+            answers = g_list_prepend (answers,
+                                      g_inet_address_new_from_bytes (reply + rdata,
+                                                                     G_SOCKET_FAMILY_IPV6));
+          break;
+
+        case T_PTR:
+          name = dns_read_name (reply, len, &rdata);
+          if (name)
+            answers = g_list_prepend (answers, name);
+          break;
+
+        case T_SRV:
+          if (rdlength < 7)
+            break;
+          priority = get_uint16 (reply + rdata);
+          weight = get_uint16 (reply + rdata + 2);
+          port = get_uint16 (reply + rdata + 4);
+          rdata += 6;
+          name = dns_read_name (reply, len, &rdata);
+          if (name)
+            {
+              answers = g_list_prepend (answers,
+                                        g_srv_target_new (name, port, priority, weight));
+              g_free (name);
+            }
+          break;
+        }
+    }
+
+ out:
+  g_ptr_array_unref (owners);
+  return g_list_reverse (answers);
+}
+
+
+/* A DnsTransaction sends one question to the configured name servers
+ * until one of them gives a usable answer or they have all been tried
+ * "attempts" times. Replies that come back truncated are asked again
+ * over TCP.
+ */
+typedef struct _DnsTransaction DnsTransaction;
+typedef void (*DnsTransactionCallback) (DnsTransaction *trans,
+                                        gpointer        user_data);
+
+typedef enum {
+  DNS_TRANSACTION_UDP,
+  DNS_TRANSACTION_TCP_CONNECT,
+  DNS_TRANSACTION_TCP_SEND,
+  DNS_TRANSACTION_TCP_RECEIVE
+} DnsTransactionState;
+
+struct _DnsTransaction {
+  GDnsResolverConfig *config;
+  GMainContext *context;
+  guint16 qtype;
+  GByteArray *query;
+
+  guint tries;
+  GSocketAddress *server;
+  DnsTransactionState state;
+  GSocket *socket;
+  GSource *socket_source;
+  GSource *timeout_source;
+  GByteArray *buffer;
+  gsize buffer_pos;
+
+  gboolean done;
+  gint rcode;
+  GList *answers;
+
+  DnsTransactionCallback callback;
+  gpointer user_data;
+};
+
+static void dns_transaction_try (DnsTransaction *trans);
+static gboolean dns_transaction_socket_ready (GSocket      *socket,
+                                              GIOCondition  condition,
+                                              gpointer      user_data);
+
+static void
+dns_transaction_stop (DnsTransaction *trans)
+{
+  if (trans->socket_source)
+    {
+      g_source_destroy (trans->socket_source);
+      g_source_unref (trans->socket_source);
+      trans->socket_source = NULL;
+    }
+  if (trans->timeout_source)
+    {
+      g_source_destroy (trans->timeout_source);
+      g_source_unref (trans->timeout_source);
+      trans->timeout_source = NULL;
+    }
+  if (trans->socket)
+    {
+      g_socket_close (trans->socket, NULL);
+      g_object_unref (trans->socket);
+      trans->socket = NULL;
+    }
+}
+
+static void
+dns_transaction_free (DnsTransaction *trans)
+{
+  dns_transaction_stop (trans);
+
+  if (trans->server)
+    g_object_unref (trans->server);
+  if (trans->buffer)
+    g_byte_array_unref (trans->buffer);
+  dns_free_answers (trans->answers, trans->qtype);
+  g_byte_array_unref (trans->query);
+  g_main_context_unref (trans->context);
+  config_unref (trans->config);
+  g_slice_free (DnsTransaction, trans);
+}
+
+static void
+dns_transaction_finish (DnsTransaction *trans)
+{
+  dns_transaction_stop (trans);
+  trans->done = TRUE;
+  trans->callback (trans, trans->user_data);
+}
+
+static void
+dns_transaction_watch (DnsTransaction *trans,
+                       GIOCondition    condition)
+{
+  if (trans->socket_source)
+    {
+      g_source_destroy (trans->socket_source);
+      g_source_unref (trans->socket_source);
+    }
+
+  trans->socket_source = g_socket_create_source (trans->socket, condition, NULL);
+  g_source_set_callback (trans->socket_source,
+                         (GSourceFunc) dns_transaction_socket_ready,
+                         trans, NULL);
+  g_source_attach (trans->socket_source, trans->context);
+}
+
+static gboolean
+dns_transaction_timeout (gpointer user_data)
+{
+  dns_transaction_try (user_data);
+  return FALSE;
+}
+
+static void
+dns_transaction_start_timeout (DnsTransaction *trans,
+                               GSourceFunc     func,
+                               guint           msec)
+{
+  trans->timeout_source = msec ? g_timeout_source_new (msec) : g_idle_source_new ();
+  g_source_set_callback (trans->timeout_source, func, trans, NULL);
+  g_source_attach (trans->timeout_source, trans->context);
+}
+
+static GSocket *
+dns_transaction_open_socket (DnsTransaction  *trans,
+                             GSocketType      type,
+                             GSocketProtocol  protocol)
+{
+  GSocket *socket;
+
+  socket = g_socket_new (g_socket_address_get_family (trans->server),
+                         type, protocol, NULL);
+  if (socket)
+    g_socket_set_blocking (socket, FALSE);
+
+  return socket;
+}
+
+/* Sends the query to the next server in line, or finishes @trans
+ * with the last error if there are no more tries left.
+ */
+static void
+dns_transaction_try (DnsTransaction *trans)
+{
+  GPtrArray *servers = trans->config->servers;
+
+  dns_transaction_stop (trans);
+
+  while (trans->tries < servers->len * trans->config->attempts)
+    {
+      if (trans->server)
+        g_object_unref (trans->server);
+      trans->server = g_object_ref (servers->pdata[trans->tries % servers->len]);
+      trans->tries++;
+
+      trans->state = DNS_TRANSACTION_UDP;
+      trans->socket = dns_transaction_open_socket (trans, G_SOCKET_TYPE_DATAGRAM,
+                                                   G_SOCKET_PROTOCOL_UDP);
+      if (trans->socket &&
+          g_socket_connect (trans->socket, trans->server, NULL, NULL) &&
+          g_socket_send (trans->socket, (const gchar *) trans->query->data,
+                         trans->query->len, NULL, NULL) == trans->query->len)
+        {
+          dns_transaction_watch (trans, G_IO_IN);
+          dns_transaction_start_timeout (trans, dns_transaction_timeout,
+                                         trans->config->timeout * 1000);
+          return;
+        }
+
+      dns_transaction_stop (trans);
+    }
+
+  dns_transaction_finish (trans);
+}
+
+static gboolean
+dns_transaction_start_cb (gpointer user_data)
+{
+  DnsTransaction *trans = user_data;
+
+  /* the source is about to be destroyed by returning FALSE */
+  g_source_unref (trans->timeout_source);
+  trans->timeout_source = NULL;
+
+  dns_transaction_try (trans);
+  return FALSE;
+}
+
+/* The query ID is all that stops an off-path attacker from getting a
+ * forged reply accepted, so it has to be unpredictable: it comes from
+ * the kernel's random number generator rather than from GRand, which
+ * can be recovered from a handful of outputs.
+ */
+static guint16
+dns_random_id (void)
+{
+  static gsize urandom_initialized;
+  static gint urandom_fd = -1;
+  guint16 id;
+
+#if defined (__linux__) && defined (SYS_getrandom)
+  if (syscall (SYS_getrandom, &id, sizeof id, 0) == sizeof id)
+    return id;
+#endif
+
+  if (g_once_init_enter (&urandom_initialized))
+    {
+      do
+        urandom_fd = open ("/dev/urandom", O_RDONLY);
+      while (urandom_fd < 0 && errno == EINTR);
+      if (urandom_fd >= 0)
+        fcntl (urandom_fd, F_SETFD, FD_CLOEXEC);
+      g_once_init_leave (&urandom_initialized, 1);
+    }
+
+  if (urandom_fd >= 0)
+    {
+      gssize r;
+
+      do
+        r = read (urandom_fd, &id, sizeof id);
+      while (r < 0 && errno == EINTR);
+
+      if (r == sizeof id)
+        return id;
+    }
+
+  /* nothing better is available */
+  return g_random_int_range (0, G_MAXUINT16 + 1);
+}
+
+static DnsTransaction *
+dns_transaction_new (GDnsResolverConfig     *config,
+                     GMainContext           *context,
+                     const gchar            *name,
+                     guint16                 qtype,
+                     DnsTransactionCallback  callback,
+                     gpointer                user_data)
+{
+  DnsTransaction *trans;
+  GByteArray *query;
+
+  query = dns_build_query (dns_random_id (), name, qtype);
+  if (query == NULL)
+    return NULL;
+
+  trans = g_slice_new0 (DnsTransaction);
+  trans->config = config_ref (config);
+  trans->context = g_main_context_ref (context);
+  trans->qtype = qtype;
+  trans->query = query;
+  trans->rcode = DNS_RCODE_SERVFAIL;
+  trans->callback = callback;
+  trans->user_data = user_data;
+
+  /* The first query goes out from an idle, so that the callback is
+   * never called before dns_transaction_new() has returned.
+   */
+  dns_transaction_start_timeout (trans, dns_transaction_start_cb, 0);
+
+  return trans;
+}
+
+/* Handles a reply that matches the query */
+static void
+dns_transaction_reply (DnsTransaction *trans,
+                       const guchar   *reply,
+                       gsize           len)
+{
+  trans->rcode = get_uint16 (reply + 2) & DNS_RCODE_MASK;
+
+  if (trans->rcode == DNS_RCODE_NOERROR)
+    {
+      trans->answers = dns_parse_answers (reply, len, trans->qtype);
+      dns_transaction_finish (trans);
+    }
+  else if (trans->rcode == DNS_RCODE_NXDOMAIN)
+    dns_transaction_finish (trans);
+  else
+    {
+      /* SERVFAIL, REFUSED and friends; another server may do better */
+      dns_transaction_try (trans);
+    }
+}
+
+static void
+dns_transaction_start_tcp (DnsTransaction *trans)
+{
+  GError *error = NULL;
+
+  dns_transaction_stop (trans);
+
+  trans->socket = dns_transaction_open_socket (trans, G_SOCKET_TYPE_STREAM,
+                                               G_SOCKET_PROTOCOL_TCP);
+  if (trans->socket == NULL)
+    {
+      dns_transaction_try (trans);
+      return;
+    }
+
+  if (trans->buffer == NULL)
+    trans->buffer = g_byte_array_new ();
+  g_byte_array_set_size (trans->buffer, 0);
+  put_uint16 (trans->buffer, trans->query->len);
+  g_byte_array_append (trans->buffer, trans->query->data, trans->query->len);
+  trans->buffer_pos = 0;
+
+  if (g_socket_connect (trans->socket, trans->server, NULL, &error))
+    trans->state = DNS_TRANSACTION_TCP_SEND;
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PENDING))
+    {
+      trans->state = DNS_TRANSACTION_TCP_CONNECT;
+      g_error_free (error);
+    }
+  else
+    {
+      g_error_free (error);
+      dns_transaction_try (trans);
+      return;
+    }
+
+  dns_transaction_watch (trans, G_IO_OUT);
+  dns_transaction_start_timeout (trans, dns_transaction_timeout,
+                                 trans->config->timeout * 1000);
+}
+
+static gboolean
+dns_transaction_receive_udp (DnsTransaction *trans)
+{
+  guchar reply[DNS_BUFFER_SIZE];
+  GError *error = NULL;
+  gssize len;
+
+  len = g_socket_receive (trans->socket, (gchar *) reply, sizeof (reply), NULL, &error);
+  if (len < 0)
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+        {
+          g_error_free (error);
+          return TRUE;
+        }
+
+      /* eg, an ICMP port unreachable for the previous query */
+      g_error_free (error);
+      dns_transaction_try (trans);
+      return FALSE;
+    }
+
+  if (!dns_reply_matches (trans->query, reply, len))
+    return TRUE;
+
+  if (get_uint16 (reply + 2) & DNS_FLAG_TC)
+    dns_transaction_start_tcp (trans);
+  else
+    dns_transaction_reply (trans, reply, len);
+
+  return FALSE;
+}
+
+static gboolean
+dns_transaction_tcp_ready (DnsTransaction *trans)
+{
+  GError *error = NULL;
+  gssize len;
+
+  switch (trans->state)
+    {
+    case DNS_TRANSACTION_TCP_CONNECT:
+      if (!g_socket_check_connect_result (trans->socket, &error))
+        goto fail;
+      trans->state = DNS_TRANSACTION_TCP_SEND;
+      /* fall through */
+
+    case DNS_TRANSACTION_TCP_SEND:
+      len = g_socket_send (trans->socket,
+                           (const gchar *) trans->buffer->data + trans->buffer_pos,
+                           trans->buffer->len - trans->buffer_pos, NULL, &error);
+      if (len < 0)
+        goto fail;
+
+      trans->buffer_pos += len;
+      if (trans->buffer_pos < trans->buffer->len)
+        return TRUE;
+
+      trans->state = DNS_TRANSACTION_TCP_RECEIVE;
+      g_byte_array_set_size (trans->buffer, 0);
+      dns_transaction_watch (trans, G_IO_IN);
+      return FALSE;
+
+    case DNS_TRANSACTION_TCP_RECEIVE:
+      {
+        guchar data[DNS_BUFFER_SIZE];
+        gsize reply_len;
+
+        len = g_socket_receive (trans->socket, (gchar *) data, sizeof (data), NULL, &error);
+        if (len <= 0)
+          goto fail;
+
+        g_byte_array_append (trans->buffer, data, len);
+        if (trans->buffer->len < 2)
+          return TRUE;
+
+        reply_len = get_uint16 (trans->buffer->data);
+        if (trans->buffer->len < 2 + reply_len)
+          return TRUE;
+
+        if (dns_reply_matches (trans->query, trans->buffer->data + 2, reply_len))
+          dns_transaction_reply (trans, trans->buffer->data + 2, reply_len);
+        else
+          dns_transaction_try (trans);
+        return FALSE;
+      }
+
+    default:
+      g_assert_not_reached ();
+    }
+
+ fail:
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+    {
+      g_error_free (error);
+      return TRUE;
+    }
+
+  /* error is unset when the server closed the connection early */
+  g_clear_error (&error);
+  dns_transaction_try (trans);
+  return FALSE;
+}
+
+/* Returns FALSE whenever the transaction may have moved on, in which
+ * case the source that called us has already been replaced or
+ * destroyed and @trans may have been freed.
+ */
+static gboolean
+dns_transaction_socket_ready (GSocket      *socket,
+                              GIOCondition  condition,
+                              gpointer      user_data)
+{
+  DnsTransaction *trans = user_data;
+
+  if (trans->state == DNS_TRANSACTION_UDP)
+    return dns_transaction_receive_udp (trans);
+  else
+    return dns_transaction_tcp_ready (trans);
+}
+
+
+/* A DnsLookup is one call to a lookup method. It looks at the hosts
+ * file first, then queries each candidate name in turn (these differ
+ * only when the search list is used) until one has answers. A and
+ * AAAA lookups run as two parallel transactions.
+ */
+typedef enum {
+  DNS_LOOKUP_BY_NAME,
+  DNS_LOOKUP_BY_ADDRESS,
+  DNS_LOOKUP_SERVICE
+} DnsLookupType;
+
+typedef struct {
+  GDnsResolverConfig *config;
+  GSimpleAsyncResult *result;
+  GMainContext *context;
+  GSource *cancellable_source;
+
+  DnsLookupType type;
+  gchar *name;
+  gchar **qnames;
+  guint next_qname;
+  DnsTransaction *transactions[2];
+  gboolean temporary_failure;
+} DnsLookup;
+
+static void
+dns_lookup_free (DnsLookup *lookup)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (lookup->transactions); i++)
+    {
+      if (lookup->transactions[i])
+        dns_transaction_free (lookup->transactions[i]);
+    }
+
+  if (lookup->cancellable_source)
+    {
+      g_source_destroy (lookup->cancellable_source);
+      g_source_unref (lookup->cancellable_source);
+    }
+
+  g_strfreev (lookup->qnames);
+  g_free (lookup->name);
+  g_main_context_unref (lookup->context);
+  g_object_unref (lookup->result);
+  config_unref (lookup->config);
+  g_slice_free (DnsLookup, lookup);
+}
+
+/* Completes and frees @lookup; @answers is consumed */
+static void
+dns_lookup_complete (DnsLookup *lookup,
+                     GList     *answers,
+                     GError    *error)
+{
+  if (error)
+    {
+      g_simple_async_result_take_error (lookup->result, error);
+    }
+  else if (lookup->type == DNS_LOOKUP_BY_NAME)
+    {
+      g_simple_async_result_set_op_res_gpointer (lookup->result, answers,
+                                                 (GDestroyNotify) g_resolver_free_addresses);
+    }
+  else if (lookup->type == DNS_LOOKUP_BY_ADDRESS)
+    {
+      g_simple_async_result_set_op_res_gpointer (lookup->result, g_strdup (answers->data), g_free);
+      g_list_free_full (answers, g_free);
+    }
+  else
+    {
+      g_simple_async_result_set_op_res_gpointer (lookup->result,
+                                                 g_srv_target_list_sort (answers),
+                                                 (GDestroyNotify) g_resolver_free_targets);
+    }
+
+  g_simple_async_result_complete_in_idle (lookup->result);
+  dns_lookup_free (lookup);
+}
+
+static void
+dns_lookup_fail (DnsLookup *lookup)
+{
+  GResolverError code;
+  GError *error;
+
+  code = lookup->temporary_failure ? G_RESOLVER_ERROR_TEMPORARY_FAILURE
+                                   : G_RESOLVER_ERROR_NOT_FOUND;
+
+  switch (lookup->type)
+    {
+    case DNS_LOOKUP_BY_NAME:
+      error = g_error_new (G_RESOLVER_ERROR, code, _("Error resolving '%s': %s"),
+                           lookup->name,
+                           gai_strerror (lookup->temporary_failure ? EAI_AGAIN : EAI_NONAME));
+      break;
+
+    case DNS_LOOKUP_BY_ADDRESS:
+      error = g_error_new (G_RESOLVER_ERROR, code, _("Error reverse-resolving '%s': %s"),
+                           lookup->name,
+                           gai_strerror (lookup->temporary_failure ? EAI_AGAIN : EAI_NONAME));
+      break;
+
+    default:
+      if (lookup->temporary_failure)
+        error = g_error_new (G_RESOLVER_ERROR, code,
+                             _("Temporarily unable to resolve '%s'"), lookup->name);
+      else
+        error = g_error_new (G_RESOLVER_ERROR, code,
+                             _("No service record for '%s'"), lookup->name);
+      break;
+    }
+
+  dns_lookup_complete (lookup, NULL, error);
+}
+
+static void dns_lookup_transaction_done (DnsTransaction *trans,
+                                         gpointer        user_data);
+
+/* Starts querying the next candidate name */
+static void
+dns_lookup_next (DnsLookup *lookup)
+{
+  const gchar *qname;
+
+  while ((qname = lookup->qnames[lookup->next_qname]) != NULL)
+    {
+      lookup->next_qname++;
+
+      switch (lookup->type)
+        {
+        case DNS_LOOKUP_BY_NAME:
+          lookup->transactions[0] = dns_transaction_new (lookup->config, lookup->context,
+                                                         qname, T_AAAA,
+                                                         dns_lookup_transaction_done, lookup);
+          if (lookup->transactions[0])
+            lookup->transactions[1] = dns_transaction_new (lookup->config, lookup->context,
+                                                           qname, T_A,
+                                                           dns_lookup_transaction_done, lookup);
+          break;
+
+        case DNS_LOOKUP_BY_ADDRESS:
+          lookup->transactions[0] = dns_transaction_new (lookup->config, lookup->context,
+                                                         qname, T_PTR,
+                                                         dns_lookup_transaction_done, lookup);
+          break;
+
+        case DNS_LOOKUP_SERVICE:
+          lookup->transactions[0] = dns_transaction_new (lookup->config, lookup->context,
+                                                         qname, T_SRV,
+                                                         dns_lookup_transaction_done, lookup);
+          break;
+        }
+
+      /* otherwise it was not a valid name, which cannot exist */
+      if (lookup->transactions[0])
+        return;
+    }
+
+  dns_lookup_fail (lookup);
+}
+
+static void
+dns_lookup_transaction_done (DnsTransaction *trans,
+                             gpointer        user_data)
+{
+  DnsLookup *lookup = user_data;
+  GList *answers = NULL;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (lookup->transactions); i++)
+    {
+      if (lookup->transactions[i] && !lookup->transactions[i]->done)
+        return;
+    }
+
+  /* For addresses, this puts the AAAA answers before the A ones */
+  for (i = 0; i < G_N_ELEMENTS (lookup->transactions); i++)
+    {
+      trans = lookup->transactions[i];
+      if (trans == NULL)
+        continue;
+
+      if (trans->rcode != DNS_RCODE_NOERROR && trans->rcode != DNS_RCODE_NXDOMAIN)
+        lookup->temporary_failure = TRUE;
+
+      answers = g_list_concat (answers, trans->answers);
+      trans->answers = NULL;
+      dns_transaction_free (trans);
+      lookup->transactions[i] = NULL;
+    }
+
+  if (answers)
+    dns_lookup_complete (lookup, answers, NULL);
+  else
+    dns_lookup_next (lookup);
+}
+
+static gboolean
+dns_lookup_cancelled (GCancellable *cancellable,
+                      gpointer      user_data)
+{
+  DnsLookup *lookup = user_data;
+  GError *error = NULL;
+
+  g_cancellable_set_error_if_cancelled (cancellable, &error);
+  dns_lookup_complete (lookup, NULL, error);
+
+  return FALSE;
+}
+
+/* Starts a lookup of @qnames (which is consumed), or completes it
+ * with @hosts_answers, if that is non-%NULL.
+ */
+static void
+dns_lookup_start (GDnsResolver        *resolver,
+                  GDnsResolverConfig  *config,
+                  DnsLookupType        type,
+                  const gchar         *name,
+                  gchar              **qnames,
+                  GList               *hosts_answers,
+                  GCancellable        *cancellable,
+                  GAsyncReadyCallback  callback,
+                  gpointer             user_data,
+                  gpointer             tag)
+{
+  DnsLookup *lookup;
+
+  lookup = g_slice_new0 (DnsLookup);
+  lookup->config = config_ref (config);
+  lookup->result = g_simple_async_result_new (G_OBJECT (resolver),
+                                              callback, user_data, tag);
+  lookup->context = g_main_context_ref_thread_default ();
+  lookup->type = type;
+  lookup->name = g_strdup (name);
+  lookup->qnames = qnames;
+
+  if (hosts_answers)
+    {
+      dns_lookup_complete (lookup, hosts_answers, NULL);
+      return;
+    }
+
+  if (cancellable)
+    {
+      lookup->cancellable_source = g_cancellable_source_new (cancellable);
+      g_source_set_callback (lookup->cancellable_source,
+                             (GSourceFunc) dns_lookup_cancelled, lookup, NULL);
+      g_source_attach (lookup->cancellable_source, lookup->context);
+    }
+
+  dns_lookup_next (lookup);
+}
+
+static void
+sync_ready (GObject      *source,
+            GAsyncResult *result,
+            gpointer      user_data)
+{
+  GAsyncResult **ret = user_data;
+
+  *ret = g_object_ref (result);
+}
+
+/* Runs an async lookup method to completion on a private main
+ * context, and returns its result.
+ */
+#define RUN_SYNC(call)                                          \
+  G_STMT_START {                                                \
+    GMainContext *context = g_main_context_new ();              \
+                                                                \
+    g_main_context_push_thread_default (context);               \
+    call;                                                       \
+    while (result == NULL)                                      \
+      g_main_context_iteration (context, TRUE);                 \
+    g_main_context_pop_thread_default (context);                \
+    g_main_context_unref (context);                             \
+  } G_STMT_END
+
+
+static void
+g_dns_resolver_init (GDnsResolver *resolver)
+{
+  g_mutex_init (&resolver->lock);
+}
+
+static void
+g_dns_resolver_finalize (GObject *object)
+{
+  GDnsResolver *resolver = G_DNS_RESOLVER (object);
+
+  if (resolver->config)
+    config_unref (resolver->config);
+  g_mutex_clear (&resolver->lock);
+  g_free (resolver->resolv_conf);
+  g_free (resolver->hosts_file);
+
+  G_OBJECT_CLASS (g_dns_resolver_parent_class)->finalize (object);
+}
+
+static void
+g_dns_resolver_set_property (GObject      *object,
+                             guint         prop_id,
+                             const GValue *value,
+                             GParamSpec   *pspec)
+{
+  GDnsResolver *resolver = G_DNS_RESOLVER (object);
+
+  switch (prop_id)
+    {
+    case PROP_RESOLV_CONF:
+      resolver->resolv_conf = g_value_dup_string (value);
+      if (resolver->resolv_conf == NULL)
+        resolver->resolv_conf = g_strdup (_PATH_RESCONF);
+      break;
+
+    case PROP_HOSTS_FILE:
+      resolver->hosts_file = g_value_dup_string (value);
+      if (resolver->hosts_file == NULL)
+        resolver->hosts_file = g_strdup (HOSTS_FILE);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+g_dns_resolver_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *pspec)
+{
+  GDnsResolver *resolver = G_DNS_RESOLVER (object);
+
+  switch (prop_id)
+    {
+    case PROP_RESOLV_CONF:
+      g_value_set_string (value, resolver->resolv_conf);
+      break;
+
+    case PROP_HOSTS_FILE:
+      g_value_set_string (value, resolver->hosts_file);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+reload (GResolver *resolver)
+{
+  GDnsResolver *dns = G_DNS_RESOLVER (resolver);
+
+  g_mutex_lock (&dns->lock);
+  if (dns->config)
+    {
+      config_unref (dns->config);
+      dns->config = NULL;
+    }
+  g_mutex_unlock (&dns->lock);
+}
+
+/* Returns the names to query for @hostname, in the order that the
+ * libc resolver would try them.
+ */
+static gchar **
+get_search_names (GDnsResolverConfig *config,
+                  const gchar        *hostname)
+{
+  GPtrArray *names;
+  gsize len = strlen (hostname);
+  guint dots = 0;
+  const gchar *p;
+  gint i;
+
+  names = g_ptr_array_new ();
+
+  if (len > 0 && hostname[len - 1] == '.')
+    g_ptr_array_add (names, g_strndup (hostname, len - 1));
+  else
+    {
+      for (p = hostname; *p; p++)
+        if (*p == '.')
+          dots++;
+
+      if (dots >= config->ndots)
+        g_ptr_array_add (names, g_strdup (hostname));
+      for (i = 0; config->search && config->search[i]; i++)
+        g_ptr_array_add (names, g_strconcat (hostname, ".", config->search[i], NULL));
+      if (dots < config->ndots)
+        g_ptr_array_add (names, g_strdup (hostname));
+    }
+
+  g_ptr_array_add (names, NULL);
+  return (gchar **) g_ptr_array_free (names, FALSE);
+}
+
+static GList *
+copy_addresses (GList *addresses)
+{
+  GList *copy = NULL;
+  GList *l;
+
+  for (l = addresses; l != NULL; l = l->next)
+    copy = g_list_prepend (copy, g_object_ref (l->data));
+
+  return g_list_reverse (copy);
+}
+
+static void
+lookup_by_name_async (GResolver           *resolver,
+                      const gchar         *hostname,
+                      GCancellable        *cancellable,
+                      GAsyncReadyCallback  callback,
+                      gpointer             user_data)
+{
+  GDnsResolverConfig *config;
+  GList *hosts_answers;
+  gchar *key;
+  gsize len;
+
+  config = g_dns_resolver_get_config (G_DNS_RESOLVER (resolver));
+
+  key = g_ascii_strdown (hostname, -1);
+  len = strlen (key);
+  if (len > 0 && key[len - 1] == '.')
+    key[len - 1] = '\0';
+  hosts_answers = copy_addresses (g_hash_table_lookup (config->hosts, key));
+  g_free (key);
+
+  dns_lookup_start (G_DNS_RESOLVER (resolver), config, DNS_LOOKUP_BY_NAME, hostname,
+                    get_search_names (config, hostname), hosts_answers,
+                    cancellable, callback, user_data, lookup_by_name_async);
+  config_unref (config);
+}
+
+static GList *
+lookup_by_name_finish (GResolver     *resolver,
+                       GAsyncResult  *result,
+                       GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (resolver),
+                                                        lookup_by_name_async), NULL);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  return copy_addresses (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+static GList *
+lookup_by_name (GResolver     *resolver,
+                const gchar   *hostname,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+  GAsyncResult *result = NULL;
+  GList *addresses;
+
+  RUN_SYNC (lookup_by_name_async (resolver, hostname, cancellable, sync_ready, &result));
+
+  addresses = lookup_by_name_finish (resolver, result, error);
+  g_object_unref (result);
+  return addresses;
+}
+
+static gchar *
+get_reverse_name (GInetAddress *address)
+{
+  const guint8 *bytes;
+  GString *name;
+  gint i;
+
+  bytes = g_inet_address_to_bytes (address);
+  name = g_string_new (NULL);
+
+  if (g_inet_address_get_family (address) == G_SOCKET_FAMILY_IPV4)
+    g_string_printf (name, "%u.%u.%u.%u.in-addr.arpa",
+                     bytes[3], bytes[2], bytes[1], bytes[0]);
+  else
+    {
+      for (i = 15; i >= 0; i--)
+        g_string_append_printf (name, "%x.%x.", bytes[i] & 0xf, bytes[i] >> 4);
+      g_string_append (name, "ip6.arpa");
+    }
+
+  return g_string_free (name, FALSE);
+}
+
+static void
+lookup_by_address_async (GResolver           *resolver,
+                         GInetAddress        *address,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+  GDnsResolverConfig *config;
+  GList *hosts_answers = NULL;
+  const gchar *hosts_name;
+  gchar **qnames;
+  gchar *phys;
+
+  config = g_dns_resolver_get_config (G_DNS_RESOLVER (resolver));
+
+  phys = g_inet_address_to_string (address);
+  hosts_name = g_hash_table_lookup (config->hosts_names, phys);
+  if (hosts_name)
+    hosts_answers = g_list_prepend (NULL, g_strdup (hosts_name));
+
+  qnames = g_new0 (gchar *, 2);
+  qnames[0] = get_reverse_name (address);
+
+  dns_lookup_start (G_DNS_RESOLVER (resolver), config, DNS_LOOKUP_BY_ADDRESS, phys,
+                    qnames, hosts_answers,
+                    cancellable, callback, user_data, lookup_by_address_async);
+  g_free (phys);
+  config_unref (config);
+}
+
+static gchar *
+lookup_by_address_finish (GResolver     *resolver,
+                          GAsyncResult  *result,
+                          GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (resolver),
+                                                        lookup_by_address_async), NULL);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  return g_strdup (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+static gchar *
+lookup_by_address (GResolver     *resolver,
+                   GInetAddress  *address,
+                   GCancellable  *cancellable,
+                   GError       **error)
+{
+  GAsyncResult *result = NULL;
+  gchar *name;
+
+  RUN_SYNC (lookup_by_address_async (resolver, address, cancellable, sync_ready, &result));
+
+  name = lookup_by_address_finish (resolver, result, error);
+  g_object_unref (result);
+  return name;
+}
+
+static void
+lookup_service_async (GResolver           *resolver,
+                      const gchar         *rrname,
+                      GCancellable        *cancellable,
+                      GAsyncReadyCallback  callback,
+                      gpointer             user_data)
+{
+  GDnsResolverConfig *config;
+  gchar **qnames;
+
+  config = g_dns_resolver_get_config (G_DNS_RESOLVER (resolver));
+
+  qnames = g_new0 (gchar *, 2);
+  qnames[0] = g_strdup (rrname);
+
+  dns_lookup_start (G_DNS_RESOLVER (resolver), config, DNS_LOOKUP_SERVICE, rrname,
+                    qnames, NULL,
+                    cancellable, callback, user_data, lookup_service_async);
+  config_unref (config);
+}
+
+static GList *
+lookup_service_finish (GResolver     *resolver,
+                       GAsyncResult  *result,
+                       GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+  GList *targets = NULL;
+  GList *l;
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (resolver),
+                                                        lookup_service_async), NULL);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  for (l = g_simple_async_result_get_op_res_gpointer (simple); l != NULL; l = l->next)
+    targets = g_list_prepend (targets, g_srv_target_copy (l->data));
+
+  return g_list_reverse (targets);
+}
+
+static GList *
+lookup_service (GResolver     *resolver,
+                const gchar   *rrname,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+  GAsyncResult *result = NULL;
+  GList *targets;
+
+  RUN_SYNC (lookup_service_async (resolver, rrname, cancellable, sync_ready, &result));
+
+  targets = lookup_service_finish (resolver, result, error);
+  g_object_unref (result);
+  return targets;
+}
+
+static void
+g_dns_resolver_class_init (GDnsResolverClass *dns_class)
+{
+  GResolverClass *resolver_class = G_RESOLVER_CLASS (dns_class);
+  GObjectClass *object_class = G_OBJECT_CLASS (dns_class);
+
+  resolver_class->lookup_by_name           = lookup_by_name;
+  resolver_class->lookup_by_name_async     = lookup_by_name_async;
+  resolver_class->lookup_by_name_finish    = lookup_by_name_finish;
+  resolver_class->lookup_by_address        = lookup_by_address;
+  resolver_class->lookup_by_address_async  = lookup_by_address_async;
+  resolver_class->lookup_by_address_finish = lookup_by_address_finish;
+  resolver_class->lookup_service           = lookup_service;
+  resolver_class->lookup_service_async     = lookup_service_async;
+  resolver_class->lookup_service_finish    = lookup_service_finish;
+  resolver_class->reload                   = reload;
+
+  object_class->finalize = g_dns_resolver_finalize;
+  object_class->set_property = g_dns_resolver_set_property;
+  object_class->get_property = g_dns_resolver_get_property;
+
+  g_object_class_install_property (object_class, PROP_RESOLV_CONF,
+                                   g_param_spec_string ("resolv-conf",
+                                                        P_("Resolver configuration"),
+                                                        P_("The resolv.conf file to read name servers and options from"),
+                                                        _PATH_RESCONF,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_HOSTS_FILE,
+                                   g_param_spec_string ("hosts-file",
+                                                        P_("Hosts file"),
+                                                        P_("The file of static host names to look at before querying DNS"),
+                                                        HOSTS_FILE,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_STATIC_STRINGS));
+}
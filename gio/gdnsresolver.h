@@ -0,0 +1,56 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_DNS_RESOLVER_H__
+#define __G_DNS_RESOLVER_H__
+
+#include <gio/gresolver.h>
+
+G_BEGIN_DECLS
+
+#define G_TYPE_DNS_RESOLVER         (g_dns_resolver_get_type ())
+#define G_DNS_RESOLVER(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), G_TYPE_DNS_RESOLVER, GDnsResolver))
+#define G_DNS_RESOLVER_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), G_TYPE_DNS_RESOLVER, GDnsResolverClass))
+#define G_IS_DNS_RESOLVER(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), G_TYPE_DNS_RESOLVER))
+#define G_IS_DNS_RESOLVER_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), G_TYPE_DNS_RESOLVER))
+#define G_DNS_RESOLVER_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), G_TYPE_DNS_RESOLVER, GDnsResolverClass))
+
+typedef struct _GDnsResolverConfig GDnsResolverConfig;
+
+typedef struct {
+  GResolver parent_instance;
+
+  gchar *resolv_conf;
+  gchar *hosts_file;
+
+  GMutex lock;
+  GDnsResolverConfig *config;
+} GDnsResolver;
+
+typedef struct {
+  GResolverClass parent_class;
+
+} GDnsResolverClass;
+
+GType g_dns_resolver_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif /* __G_DNS_RESOLVER_H__ */
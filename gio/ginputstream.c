@@ -30,6 +30,7 @@
 #include "gasyncresult.h"
 #include "gsimpleasyncresult.h"
 #include "gioerror.h"
+#include "gbufferpool.h"
 
 
 /**
@@ -273,6 +274,58 @@ g_input_stream_read_all (GInputStream  *stream,
   return TRUE;
 }
 
+/**
+ * g_input_stream_read_bytes:
+ * @stream: a #GInputStream.
+ * @count: maximum number of bytes that will be read from the stream. Common
+ * values include 4096 and 8192.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @error: location to store the error occurring, or %NULL to ignore
+ *
+ * Like g_input_stream_read(), this tries to read @count bytes from
+ * the stream in a blocking fashion. However, rather than reading into
+ * a user-supplied buffer, this will return a new #GBytes containing
+ * the data that was read.
+ *
+ * The data is read directly into memory taken from a pool of
+ * recycled buffers shared by the thread, so the returned #GBytes, or
+ * slices of it made with g_bytes_new_from_bytes(), can be kept
+ * around without copying. Note that as long as it is alive it keeps
+ * a larger block of memory in use; copy the data if it is going to
+ * be kept for a long time.
+ *
+ * On error %NULL is returned and @error is set accordingly. On end
+ * of stream, an empty #GBytes is returned.
+ *
+ * Return value: (transfer full): a new #GBytes, or %NULL on error
+ *
+ * Since: 2.34
+ **/
+GBytes *
+g_input_stream_read_bytes (GInputStream  *stream,
+			   gsize          count,
+			   GCancellable  *cancellable,
+			   GError       **error)
+{
+  GBufferPoolSlab *slab;
+  gpointer buffer;
+  gssize res;
+
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+
+  if (((gssize) count) < 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		   _("Too large count value passed to %s"), G_STRFUNC);
+      return NULL;
+    }
+
+  buffer = _g_buffer_pool_reserve (count, &slab);
+  res = g_input_stream_read (stream, buffer, count, cancellable, error);
+
+  return _g_buffer_pool_commit (slab, buffer, count, res);
+}
+
 /**
  * g_input_stream_skip:
  * @stream: a #GInputStream.
@@ -611,6 +664,124 @@ g_input_stream_read_finish (GInputStream  *stream,
   return class->read_finish (stream, result, error);
 }
 
+typedef struct
+{
+  GSimpleAsyncResult *simple;
+  GBufferPoolSlab *slab;
+  gpointer buffer;
+  gsize count;
+} ReadBytesData;
+
+static void
+read_bytes_callback (GObject      *stream,
+		     GAsyncResult *result,
+		     gpointer      user_data)
+{
+  ReadBytesData *data = user_data;
+  GSimpleAsyncResult *simple = data->simple;
+  GError *error = NULL;
+  GBytes *bytes;
+  gssize res;
+
+  res = g_input_stream_read_finish (G_INPUT_STREAM (stream), result, &error);
+  bytes = _g_buffer_pool_commit (data->slab, data->buffer, data->count, res);
+  g_slice_free (ReadBytesData, data);
+
+  if (bytes == NULL)
+    g_simple_async_result_take_error (simple, error);
+  else
+    g_simple_async_result_set_op_res_gpointer (simple, bytes,
+					       (GDestroyNotify) g_bytes_unref);
+
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+/**
+ * g_input_stream_read_bytes_async:
+ * @stream: A #GInputStream.
+ * @count: the number of bytes that will be read from the stream
+ * @io_priority: the <link linkend="io-priority">I/O priority</link>
+ *   of the request.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied
+ * @user_data: (closure): the data to pass to callback function
+ *
+ * Request an asynchronous read of @count bytes from the stream into a
+ * new #GBytes. When the operation is finished @callback will be
+ * called. You can then call g_input_stream_read_bytes_finish() to get
+ * the result of the operation.
+ *
+ * See g_input_stream_read_bytes() and g_input_stream_read_async()
+ * for more details.
+ *
+ * Since: 2.34
+ **/
+void
+g_input_stream_read_bytes_async (GInputStream        *stream,
+				 gsize                count,
+				 int                  io_priority,
+				 GCancellable        *cancellable,
+				 GAsyncReadyCallback  callback,
+				 gpointer             user_data)
+{
+  ReadBytesData *data;
+
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+
+  if (((gssize) count) < 0)
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (stream),
+					   callback,
+					   user_data,
+					   G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+					   _("Too large count value passed to %s"),
+					   G_STRFUNC);
+      return;
+    }
+
+  data = g_slice_new (ReadBytesData);
+  data->simple = g_simple_async_result_new (G_OBJECT (stream),
+					    callback, user_data,
+					    g_input_stream_read_bytes_async);
+  data->buffer = _g_buffer_pool_reserve (count, &data->slab);
+  data->count = count;
+
+  g_input_stream_read_async (stream, data->buffer, count,
+			     io_priority, cancellable,
+			     read_bytes_callback, data);
+}
+
+/**
+ * g_input_stream_read_bytes_finish:
+ * @stream: a #GInputStream.
+ * @result: a #GAsyncResult.
+ * @error: a #GError location to store the error occurring, or %NULL to
+ *   ignore.
+ *
+ * Finishes an asynchronous stream read-into-#GBytes operation.
+ *
+ * Returns: (transfer full): the newly-allocated #GBytes, or %NULL on error
+ *
+ * Since: 2.34
+ **/
+GBytes *
+g_input_stream_read_bytes_finish (GInputStream  *stream,
+				  GAsyncResult  *result,
+				  GError       **error)
+{
+  GSimpleAsyncResult *simple;
+
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+  g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (stream), g_input_stream_read_bytes_async), NULL);
+
+  simple = G_SIMPLE_ASYNC_RESULT (result);
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  return g_bytes_ref (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
 /**
  * g_input_stream_skip_async:
  * @stream: A #GInputStream.
@@ -36,6 +36,7 @@
 #include <gio/gapplicationcommandline.h>
 #include <gio/gasyncinitable.h>
 #include <gio/gasyncresult.h>
+#include <gio/gasyncsocketservice.h>
 #include <gio/gbufferedinputstream.h>
 #include <gio/gbufferedoutputstream.h>
 #include <gio/gcancellable.h>
@@ -134,6 +135,7 @@
 #include <gio/gtlsinteraction.h>
 #include <gio/gtlsserverconnection.h>
 #include <gio/gtlspassword.h>
+#include <gio/gtlssessioncache.h>
 #include <gio/gvfs.h>
 #include <gio/gvolume.h>
 #include <gio/gvolumemonitor.h>
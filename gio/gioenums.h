@@ -879,6 +879,7 @@ typedef enum
  * then request the bus to launch an owner for the name if no-one owns the name. This flag can
  * only be used in proxies for well-known names.
  * @G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES: If set, the property value for any <emphasis>invalidated property</emphasis> will be (asynchronously) retrieved upon receiving the <ulink url="http://dbus.freedesktop.org/doc/dbus-specification.html#standard-interfaces-properties">PropertiesChanged</ulink> D-Bus signal and the property will not cause emission of the #GDBusProxy::g-properties-changed signal. When the value is received the #GDBusProxy::g-properties-changed signal is emitted for the property along with the retrieved value. Since 2.32.
+ * @G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE: If set, and another proxy with this flag already exists for the same connection, name owner, object path and interface, the initial property values are copied from that proxy instead of being loaded with a <literal>GetAll()</literal> call. Since 2.34.
  *
  * Flags used when constructing an instance of a #GDBusProxy derived class.
  *
@@ -890,7 +891,8 @@ typedef enum
   G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES = (1<<0),
   G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS = (1<<1),
   G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START = (1<<2),
-  G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES = (1<<3)
+  G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES = (1<<3),
+  G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE = (1<<4)
 } GDBusProxyFlags;
 
 /**
@@ -1486,6 +1488,11 @@ typedef enum {
  *   a thread dedicated to the invocation. This means that the method implementation can use blocking IO
  *   without blocking any other part of the process. It also means that the method implementation must
  *   use locking to access data structures used by other threads.
+ * @G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL: Method invocations are handled
+ *   in a bounded pool of worker threads shared by all #GDBusInterfaceSkeleton instances. Invocations on
+ *   the same #GDBusInterfaceSkeleton are handled one after the other, in the order they were received,
+ *   while invocations on different instances can be handled in parallel. Takes precedence over
+ *   %G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD. Since 2.34.
  *
  * Flags describing the behavior of a #GDBusInterfaceSkeleton instance.
  *
@@ -1494,7 +1501,8 @@ typedef enum {
 typedef enum
 {
   G_DBUS_INTERFACE_SKELETON_FLAGS_NONE = 0,
-  G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD = (1<<0)
+  G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD = (1<<0),
+  G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL = (1<<1)
 } GDBusInterfaceSkeletonFlags;
 
 /**
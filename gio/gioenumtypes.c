@@ -903,6 +903,7 @@ g_dbus_proxy_flags_get_type (void)
         { G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS, "G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS", "do-not-connect-signals" },
         { G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START, "G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START", "do-not-auto-start" },
         { G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES, "G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES", "get-invalidated-properties" },
+        { G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE, "G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE", "share-property-cache" },
         { 0, NULL, NULL }
       };
       GType g_define_type_id =
@@ -1423,6 +1424,7 @@ g_dbus_interface_skeleton_flags_get_type (void)
       static const GFlagsValue values[] = {
         { G_DBUS_INTERFACE_SKELETON_FLAGS_NONE, "G_DBUS_INTERFACE_SKELETON_FLAGS_NONE", "none" },
         { G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD, "G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD", "handle-method-invocations-in-thread" },
+        { G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL, "G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL", "handle-method-invocations-in-worker-pool" },
         { 0, NULL, NULL }
       };
       GType g_define_type_id =
@@ -929,6 +929,7 @@ _g_io_modules_ensure_loaded (void)
 #endif
 #ifdef G_OS_UNIX
       _g_unix_volume_monitor_get_type ();
+      g_gvdb_settings_backend_get_type ();
 #endif
 #ifdef G_OS_WIN32
       _g_winhttp_vfs_get_type ();
@@ -217,6 +217,15 @@ typedef struct _GTcpWrapperConnection                       GTcpWrapperConnectio
  * Since: 2.22
  **/
 typedef struct _GThreadedSocketService                      GThreadedSocketService;
+/**
+ * GAsyncSocketService:
+ *
+ * A helper class for accepting incoming connections and handling them
+ * asynchronously in a fixed set of threads.
+ *
+ * Since: 2.34
+ **/
+typedef struct _GAsyncSocketService                         GAsyncSocketService;
 typedef struct _GThemedIcon                   GThemedIcon;
 typedef struct _GTlsCertificate               GTlsCertificate;
 typedef struct _GTlsClientConnection          GTlsClientConnection; /* Dummy typedef */
@@ -226,6 +235,7 @@ typedef struct _GTlsFileDatabase              GTlsFileDatabase;
 typedef struct _GTlsInteraction               GTlsInteraction;
 typedef struct _GTlsPassword                  GTlsPassword;
 typedef struct _GTlsServerConnection          GTlsServerConnection; /* Dummy typedef */
+typedef struct _GTlsSessionCache              GTlsSessionCache;
 typedef struct _GVfs                          GVfs; /* Dummy typedef */
 
 /**
@@ -369,59 +369,104 @@ g_keyfile_settings_backend_get_permission (GSettingsBackend *backend,
   return g_object_ref (kfsb->permission);
 }
 
+static gboolean
+group_is_valid (GKeyfileSettingsBackend *kfsb,
+                const gchar             *group)
+{
+  /* reject group names that will form invalid key names */
+  return g_strcmp0 (kfsb->root_group, group) == 0 ||
+         (!g_str_has_prefix (group, "/") &&
+          !g_str_has_suffix (group, "/") && !strstr (group, "//"));
+}
+
 static void
-keyfile_to_tree (GKeyfileSettingsBackend *kfsb,
+add_changed_key (GKeyfileSettingsBackend *kfsb,
                  GTree                   *tree,
-                 GKeyFile                *keyfile,
-                 gboolean                 dup_check)
+                 const gchar             *group,
+                 const gchar             *key)
 {
-  gchar **groups;
-  gint i;
-
-  groups = g_key_file_get_groups (keyfile, NULL);
-  for (i = 0; groups[i]; i++)
-    {
-      gboolean is_root_group;
-      gchar **keys;
-      gint j;
+  gchar *path;
 
-      is_root_group = g_strcmp0 (kfsb->root_group, groups[i]) == 0;
+  /* reject key names with slashes in them */
+  if (strchr (key, '/'))
+    return;
 
-      /* reject group names that will form invalid key names */
-      if (!is_root_group &&
-          (g_str_has_prefix (groups[i], "/") ||
-           g_str_has_suffix (groups[i], "/") || strstr (groups[i], "//")))
-        continue;
+  if (g_strcmp0 (kfsb->root_group, group) == 0)
+    path = g_strdup_printf ("%s%s", kfsb->prefix, key);
+  else
+    path = g_strdup_printf ("%s%s/%s", kfsb->prefix, group, key);
 
-      keys = g_key_file_get_keys (keyfile, groups[i], NULL, NULL);
+  g_tree_insert (tree, path, NULL);
+}
 
-      for (j = 0; keys[j]; j++)
-        {
-          gchar *path, *value;
+/* Adds to @tree the keys of @group that differ between @keyfile_a and
+ * @keyfile_b.  The group is first checked key-by-key against the other
+ * keyfile; if every key of @keyfile_a is present with the same value in
+ * @keyfile_b and the two have the same number of keys, the group is
+ * unchanged and nothing more needs to be done.
+ */
+static void
+diff_group (GKeyfileSettingsBackend *kfsb,
+            GTree                   *tree,
+            GKeyFile                *keyfile_a,
+            GKeyFile                *keyfile_b,
+            const gchar             *group)
+{
+  gchar **keys_a, **keys_b;
+  gsize n_keys_a = 0, n_keys_b = 0;
+  gsize n_same = 0;
+  gsize i;
 
-          /* reject key names with slashes in them */
-          if (strchr (keys[j], '/'))
-            continue;
+  keys_a = g_key_file_get_keys (keyfile_a, group, &n_keys_a, NULL);
+  keys_b = g_key_file_get_keys (keyfile_b, group, &n_keys_b, NULL);
 
-          if (is_root_group)
-            path = g_strdup_printf ("%s%s", kfsb->prefix, keys[j]);
-          else
-            path = g_strdup_printf ("%s%s/%s", kfsb->prefix, groups[i], keys[j]);
+  for (i = 0; i < n_keys_a; i++)
+    {
+      gchar *value_a, *value_b;
 
-          value = g_key_file_get_value (keyfile, groups[i], keys[j], NULL);
+      value_a = g_key_file_get_value (keyfile_a, group, keys_a[i], NULL);
+      value_b = g_key_file_get_value (keyfile_b, group, keys_a[i], NULL);
 
-          if (dup_check && g_strcmp0 (g_tree_lookup (tree, path), value) == 0)
-            {
-              g_tree_remove (tree, path);
-              g_free (value);
-              g_free (path);
-            }
-          else
-            g_tree_insert (tree, path, value);
-        }
+      if (g_strcmp0 (value_a, value_b) == 0)
+        n_same++;
+      else
+        add_changed_key (kfsb, tree, group, keys_a[i]);
 
-      g_strfreev (keys);
+      g_free (value_a);
+      g_free (value_b);
     }
+
+  /* only keys that are missing from keyfile_a are left to find */
+  if (n_same != n_keys_b)
+    for (i = 0; i < n_keys_b; i++)
+      if (!g_key_file_has_key (keyfile_a, group, keys_b[i], NULL))
+        add_changed_key (kfsb, tree, group, keys_b[i]);
+
+  g_strfreev (keys_a);
+  g_strfreev (keys_b);
+}
+
+static void
+diff_keyfiles (GKeyfileSettingsBackend *kfsb,
+               GTree                   *tree,
+               GKeyFile                *old_keyfile,
+               GKeyFile                *new_keyfile)
+{
+  gchar **groups;
+  gint i;
+
+  groups = g_key_file_get_groups (new_keyfile, NULL);
+  for (i = 0; groups[i]; i++)
+    if (group_is_valid (kfsb, groups[i]))
+      diff_group (kfsb, tree, new_keyfile, old_keyfile, groups[i]);
+  g_strfreev (groups);
+
+  /* groups that were removed entirely */
+  groups = g_key_file_get_groups (old_keyfile, NULL);
+  for (i = 0; groups[i]; i++)
+    if (!g_key_file_has_group (new_keyfile, groups[i]) &&
+        group_is_valid (kfsb, groups[i]))
+      diff_group (kfsb, tree, old_keyfile, new_keyfile, groups[i]);
   g_strfreev (groups);
 }
 
@@ -440,24 +485,22 @@ g_keyfile_settings_backend_keyfile_reload (GKeyfileSettingsBackend *kfsb)
 
   if (memcmp (kfsb->digest, digest, sizeof digest) != 0)
     {
-      GKeyFile *keyfiles[2];
+      GKeyFile *keyfile;
       GTree *tree;
 
       tree = g_tree_new_full ((GCompareDataFunc) strcmp, NULL,
                               g_free, g_free);
 
-      keyfiles[0] = kfsb->keyfile;
-      keyfiles[1] = g_key_file_new ();
+      keyfile = g_key_file_new ();
 
       if (length > 0)
-        g_key_file_load_from_data (keyfiles[1], contents, length,
+        g_key_file_load_from_data (keyfile, contents, length,
                                    G_KEY_FILE_KEEP_COMMENTS |
                                    G_KEY_FILE_KEEP_TRANSLATIONS, NULL);
 
-      keyfile_to_tree (kfsb, tree, keyfiles[0], FALSE);
-      keyfile_to_tree (kfsb, tree, keyfiles[1], TRUE);
-      g_key_file_free (keyfiles[0]);
-      kfsb->keyfile = keyfiles[1];
+      diff_keyfiles (kfsb, tree, kfsb->keyfile, keyfile);
+      g_key_file_free (kfsb->keyfile);
+      kfsb->keyfile = keyfile;
 
       if (g_tree_nnodes (tree) > 0)
         g_settings_backend_changed_tree (&kfsb->parent_instance, tree, NULL);
@@ -550,6 +593,11 @@ file_changed (GFileMonitor      *monitor,
 {
   GKeyfileSettingsBackend *kfsb = user_data;
 
+  /* Ignore events that can't have changed the contents */
+  if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED ||
+      event_type == G_FILE_MONITOR_EVENT_PRE_UNMOUNT)
+    return;
+
   g_keyfile_settings_backend_keyfile_reload (kfsb);
 }
 
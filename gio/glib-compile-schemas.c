@@ -28,6 +28,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <locale.h>
+#include <time.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -1976,6 +1977,225 @@ set_overrides (GHashTable  *schema_table,
   return TRUE;
 }
 
+/* Incremental compilation {{{1 */
+/* Next to gschemas.compiled we keep a stamp file recording the
+ * checksum of each input file, the options that influence the output
+ * and the size and modification time of the output itself.  If a
+ * freshly built stamp matches the one on disk, the output is known to
+ * be up to date and compiling it again can be skipped.
+ *
+ * The size and modification time of each input are recorded as well,
+ * and checksums are only computed for inputs where those differ from
+ * the old stamp, so that an unchanged directory is checked without
+ * reading any of its files.  Just touching a file does not force a
+ * rebuild, since only the checksums are compared.
+ *
+ * The schema files can not be parsed independently of each other (they
+ * refer to enums and schemas from other files), so anything other than
+ * "nothing changed" results in a full rebuild.
+ */
+static gboolean
+stamp_add_file (GKeyFile    *stamp,
+                GKeyFile    *old_stamp,
+                const gchar *group,
+                const gchar *filename,
+                gboolean     checksum)
+{
+  GStatBuf buf;
+  gchar *sum = NULL;
+  gint64 size;
+  gint64 mtime;
+
+  if (g_stat (filename, &buf) != 0)
+    return FALSE;
+
+  size = buf.st_size;
+  mtime = buf.st_mtime;
+
+  g_key_file_set_int64 (stamp, group, "size", size);
+  g_key_file_set_int64 (stamp, group, "mtime", mtime);
+
+  if (!checksum)
+    return TRUE;
+
+  /* A file modified in the same second that the old stamp was made
+   * could have been changed again after it was checksummed without its
+   * modification time changing, so we can't trust the old checksum.
+   */
+  if (old_stamp &&
+      g_key_file_get_int64 (old_stamp, group, "size", NULL) == size &&
+      g_key_file_get_int64 (old_stamp, group, "mtime", NULL) == mtime &&
+      g_key_file_get_int64 (old_stamp, "stamp", "time", NULL) > mtime)
+    sum = g_key_file_get_string (old_stamp, group, "checksum", NULL);
+
+  if (sum == NULL)
+    {
+      gchar *contents;
+      gsize length;
+
+      if (!g_file_get_contents (filename, &contents, &length, NULL))
+        return FALSE;
+
+      sum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+                                         (const guchar *) contents, length);
+      g_free (contents);
+    }
+
+  g_key_file_set_string (stamp, group, "checksum", sum);
+  g_free (sum);
+
+  return TRUE;
+}
+
+/* Builds a stamp describing the current inputs, options and @target,
+ * reusing the checksums of unchanged files from @old_stamp.  Returns
+ * %NULL if any of the input files could not be examined.
+ */
+static GKeyFile *
+stamp_new (GKeyFile     *old_stamp,
+           gchar       **schema_files,
+           gchar       **override_files,
+           const gchar  *target,
+           gboolean      strict)
+{
+  GKeyFile *stamp;
+  gchar **file;
+
+  stamp = g_key_file_new ();
+
+  g_key_file_set_int64 (stamp, "stamp", "time", time (NULL));
+  g_key_file_set_boolean (stamp, "options", "strict", strict);
+  g_key_file_set_boolean (stamp, "options", "allow-any-name", allow_any_name);
+
+  for (file = schema_files; *file; file++)
+    {
+      gchar *group = g_strconcat ("input ", *file, NULL);
+      gboolean ok;
+
+      ok = stamp_add_file (stamp, old_stamp, group, *file, TRUE);
+      g_free (group);
+
+      if (!ok)
+        goto fail;
+    }
+
+  for (file = override_files; *file; file++)
+    {
+      gchar *group = g_strconcat ("override ", *file, NULL);
+      gboolean ok;
+
+      ok = stamp_add_file (stamp, old_stamp, group, *file, TRUE);
+      g_free (group);
+
+      if (!ok)
+        goto fail;
+    }
+
+  /* a missing output simply won't match */
+  stamp_add_file (stamp, NULL, "output", target, FALSE);
+
+  return stamp;
+
+fail:
+  g_key_file_free (stamp);
+  return NULL;
+}
+
+static gboolean
+stamp_equal (GKeyFile *a,
+             GKeyFile *b)
+{
+  gchar **groups_a, **groups_b;
+  gboolean equal;
+  gint i;
+
+  if (a == NULL || b == NULL)
+    return FALSE;
+
+  groups_a = g_key_file_get_groups (a, NULL);
+  groups_b = g_key_file_get_groups (b, NULL);
+  equal = g_strv_length (groups_a) == g_strv_length (groups_b);
+
+  for (i = 0; equal && groups_a[i]; i++)
+    {
+      const gchar *group = groups_a[i];
+      gsize n_keys_a, n_keys_b;
+      gchar **keys;
+      gint j;
+
+      if (strcmp (group, groups_b[i]) != 0)
+        {
+          equal = FALSE;
+          break;
+        }
+
+      if (strcmp (group, "stamp") == 0)
+        continue;
+
+      /* inputs are identified by their contents only */
+      if (g_str_has_prefix (group, "input ") ||
+          g_str_has_prefix (group, "override "))
+        {
+          gchar *sum_a, *sum_b;
+
+          sum_a = g_key_file_get_string (a, group, "checksum", NULL);
+          sum_b = g_key_file_get_string (b, group, "checksum", NULL);
+          equal = sum_a != NULL && g_strcmp0 (sum_a, sum_b) == 0;
+          g_free (sum_a);
+          g_free (sum_b);
+          continue;
+        }
+
+      keys = g_key_file_get_keys (a, group, &n_keys_a, NULL);
+      g_strfreev (g_key_file_get_keys (b, group, &n_keys_b, NULL));
+      equal = n_keys_a == n_keys_b;
+
+      for (j = 0; equal && keys[j]; j++)
+        {
+          gchar *value_a, *value_b;
+
+          value_a = g_key_file_get_value (a, group, keys[j], NULL);
+          value_b = g_key_file_get_value (b, group, keys[j], NULL);
+          equal = g_strcmp0 (value_a, value_b) == 0;
+          g_free (value_a);
+          g_free (value_b);
+        }
+      g_strfreev (keys);
+    }
+
+  g_strfreev (groups_a);
+  g_strfreev (groups_b);
+
+  return equal;
+}
+
+static GKeyFile *
+stamp_load (const gchar *filename)
+{
+  GKeyFile *stamp;
+
+  stamp = g_key_file_new ();
+  if (!g_key_file_load_from_file (stamp, filename, 0, NULL))
+    {
+      g_key_file_free (stamp);
+      return NULL;
+    }
+
+  return stamp;
+}
+
+static void
+stamp_save (GKeyFile    *stamp,
+            const gchar *filename)
+{
+  gchar *contents;
+  gsize length;
+
+  contents = g_key_file_to_data (stamp, &length, NULL);
+  g_file_set_contents (filename, contents, length, NULL);
+  g_free (contents);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1987,7 +2207,11 @@ main (int argc, char **argv)
   gchar *targetdir = NULL;
   gchar *target;
   gboolean dry_run = FALSE;
+  gboolean verify_only = FALSE;
   gboolean strict = FALSE;
+  GKeyFile *old_stamp = NULL;
+  GKeyFile *stamp = NULL;
+  gchar *stamp_file = NULL;
   gchar **schema_files = NULL;
   gchar **override_files = NULL;
   GOptionContext *context;
@@ -1995,6 +2219,7 @@ main (int argc, char **argv)
     { "targetdir", 0, 0, G_OPTION_ARG_FILENAME, &targetdir, N_("where to store the gschemas.compiled file"), N_("DIRECTORY") },
     { "strict", 0, 0, G_OPTION_ARG_NONE, &strict, N_("Abort on any errors in schemas"), NULL },
     { "dry-run", 0, 0, G_OPTION_ARG_NONE, &dry_run, N_("Do not write the gschema.compiled file"), NULL },
+    { "verify-only", 0, 0, G_OPTION_ARG_NONE, &verify_only, N_("Only check whether the gschema.compiled file is up to date"), NULL },
     { "allow-any-name", 0, 0, G_OPTION_ARG_NONE, &allow_any_name, N_("Do not enforce key name restrictions") },
 
     /* These options are only for use in the gschema-compile tests */
@@ -2045,6 +2270,13 @@ main (int argc, char **argv)
       return 1;
     }
 
+  /* only a directory has a stamp to check the output against */
+  if (schema_files && verify_only)
+    {
+      fprintf (stderr, _("--verify-only cannot be used with --schema-file\n"));
+      return 1;
+    }
+
   srcdir = argv[1];
 
   if (targetdir == NULL)
@@ -2080,8 +2312,25 @@ main (int argc, char **argv)
 
       if (files->len == 0)
         {
+          /* The output is up to date only if there is none */
+          if (verify_only)
+            {
+              gboolean exists;
+
+              exists = g_file_test (target, G_FILE_TEST_EXISTS);
+              if (exists)
+                fprintf (stderr, _("%s is out of date\n"), target);
+              g_free (target);
+
+              return exists ? 1 : 0;
+            }
+
           fprintf (stdout, _("No schema files found: "));
 
+          stamp_file = g_strconcat (target, ".stamp", NULL);
+          g_unlink (stamp_file);
+          g_free (stamp_file);
+
           if (g_unlink (target))
             fprintf (stdout, _("doing nothing.\n"));
 
@@ -2098,6 +2347,33 @@ main (int argc, char **argv)
 
       schema_files = (char **) g_ptr_array_free (files, FALSE);
       override_files = (gchar **) g_ptr_array_free (overrides, FALSE);
+
+      if (!dry_run || verify_only)
+        {
+          stamp_file = g_strconcat (target, ".stamp", NULL);
+          old_stamp = stamp_load (stamp_file);
+          stamp = stamp_new (old_stamp, schema_files, override_files,
+                             target, strict);
+
+          if (stamp_equal (old_stamp, stamp))
+            {
+              /* nothing to do, but remember any new modification times
+               * so that the next check doesn't checksum the files again
+               */
+              if (!verify_only)
+                stamp_save (stamp, stamp_file);
+
+              g_free (target);
+              return 0;
+            }
+        }
+    }
+
+  if (verify_only)
+    {
+      fprintf (stderr, _("%s is out of date\n"), target);
+      g_free (target);
+      return 1;
     }
 
   if ((table = parse_gschema_files (schema_files, strict)) == NULL)
@@ -2120,6 +2396,21 @@ main (int argc, char **argv)
       return 1;
     }
 
+  if (stamp_file != NULL)
+    {
+      /* the inputs are as they were before we read them; only the
+       * output has changed since
+       */
+      if (stamp != NULL)
+        {
+          g_key_file_remove_group (stamp, "output", NULL);
+          stamp_add_file (stamp, NULL, "output", target, FALSE);
+          stamp_save (stamp, stamp_file);
+        }
+      else
+        g_unlink (stamp_file);
+    }
+
   g_free (target);
 
   return 0;
@@ -54,6 +54,19 @@ struct _GOutputStreamPrivate {
   GAsyncReadyCallback outstanding_callback;
 };
 
+static gssize   g_output_stream_real_write_bytes   (GOutputStream             *stream,
+						    GBytes                    *bytes,
+						    GCancellable              *cancellable,
+						    GError                   **error);
+static void     g_output_stream_real_write_bytes_async  (GOutputStream        *stream,
+							 GBytes               *bytes,
+							 int                   io_priority,
+							 GCancellable         *cancellable,
+							 GAsyncReadyCallback   callback,
+							 gpointer              data);
+static gssize   g_output_stream_real_write_bytes_finish (GOutputStream        *stream,
+							 GAsyncResult         *result,
+							 GError              **error);
 static gssize   g_output_stream_real_splice        (GOutputStream             *stream,
 						    GInputStream              *source,
 						    GOutputStreamSpliceFlags   flags,
@@ -128,6 +141,7 @@ g_output_stream_class_init (GOutputStreamClass *klass)
   gobject_class->finalize = g_output_stream_finalize;
   gobject_class->dispose = g_output_stream_dispose;
 
+  klass->write_bytes_fn = g_output_stream_real_write_bytes;
   klass->splice = g_output_stream_real_splice;
   
   klass->write_async = g_output_stream_real_write_async;
@@ -138,6 +152,8 @@ g_output_stream_class_init (GOutputStreamClass *klass)
   klass->flush_finish = g_output_stream_real_flush_finish;
   klass->close_async = g_output_stream_real_close_async;
   klass->close_finish = g_output_stream_real_close_finish;
+  klass->write_bytes_async = g_output_stream_real_write_bytes_async;
+  klass->write_bytes_finish = g_output_stream_real_write_bytes_finish;
 }
 
 static void
@@ -292,6 +308,91 @@ g_output_stream_write_all (GOutputStream  *stream,
   return TRUE;
 }
 
+/**
+ * g_output_stream_write_bytes:
+ * @stream: a #GOutputStream.
+ * @bytes: the #GBytes to write
+ * @cancellable: (allow-none): optional cancellable object
+ * @error: location to store the error occurring, or %NULL to ignore
+ *
+ * Tries to write the data from @bytes into the stream. Will block
+ * during the operation.
+ *
+ * This function is similar to g_output_stream_write(), except that
+ * streams that can make use of it, such as those of a
+ * #GSocketConnection with #GSocket:zerocopy enabled, may hold on to
+ * @bytes and write its memory directly instead of copying it.
+ *
+ * Like g_output_stream_write(), this may write fewer bytes than the
+ * size of @bytes; use g_bytes_new_from_bytes() to write the rest.
+ *
+ * Virtual: write_bytes_fn
+ *
+ * Return value: Number of bytes written, or -1 on error
+ *
+ * Since: 2.34
+ **/
+gssize
+g_output_stream_write_bytes (GOutputStream  *stream,
+			     GBytes         *bytes,
+			     GCancellable   *cancellable,
+			     GError        **error)
+{
+  GOutputStreamClass *class;
+  gssize res;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), -1);
+  g_return_val_if_fail (bytes != NULL, -1);
+
+  if (g_bytes_get_size (bytes) == 0)
+    return 0;
+
+  if (((gssize) g_bytes_get_size (bytes)) < 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		   _("Too large count value passed to %s"), G_STRFUNC);
+      return -1;
+    }
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  if (!g_output_stream_set_pending (stream, error))
+    return -1;
+
+  if (cancellable)
+    g_cancellable_push_current (cancellable);
+
+  res = class->write_bytes_fn (stream, bytes, cancellable, error);
+
+  if (cancellable)
+    g_cancellable_pop_current (cancellable);
+
+  g_output_stream_clear_pending (stream);
+
+  return res;
+}
+
+static gssize
+g_output_stream_real_write_bytes (GOutputStream  *stream,
+				  GBytes         *bytes,
+				  GCancellable   *cancellable,
+				  GError        **error)
+{
+  GOutputStreamClass *class;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  if (class->write_fn == NULL)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Output stream doesn't implement write"));
+      return -1;
+    }
+
+  return class->write_fn (stream, g_bytes_get_data (bytes, NULL),
+			  g_bytes_get_size (bytes), cancellable, error);
+}
+
 /**
  * g_output_stream_flush:
  * @stream: a #GOutputStream.
@@ -809,6 +910,118 @@ g_output_stream_write_finish (GOutputStream  *stream,
   return class->write_finish (stream, result, error);
 }
 
+/**
+ * g_output_stream_write_bytes_async:
+ * @stream: A #GOutputStream.
+ * @bytes: the #GBytes to write
+ * @io_priority: the io priority of the request.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @callback: (scope async): callback to call when the request is satisfied
+ * @user_data: (closure): the data to pass to callback function
+ *
+ * Request an asynchronous write of the data in @bytes to the stream.
+ * When the operation is finished @callback will be called. You can
+ * then call g_output_stream_write_bytes_finish() to get the result of
+ * the operation.
+ *
+ * See g_output_stream_write_async() and g_output_stream_write_bytes()
+ * for more details.
+ *
+ * Since: 2.34
+ **/
+void
+g_output_stream_write_bytes_async (GOutputStream       *stream,
+				   GBytes              *bytes,
+				   int                  io_priority,
+				   GCancellable        *cancellable,
+				   GAsyncReadyCallback  callback,
+				   gpointer             user_data)
+{
+  GOutputStreamClass *class;
+  GSimpleAsyncResult *simple;
+  GError *error = NULL;
+
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+  g_return_if_fail (bytes != NULL);
+
+  if (g_bytes_get_size (bytes) == 0)
+    {
+      simple = g_simple_async_result_new (G_OBJECT (stream),
+					  callback,
+					  user_data,
+					  g_output_stream_write_bytes_async);
+      g_simple_async_result_complete_in_idle (simple);
+      g_object_unref (simple);
+      return;
+    }
+
+  if (((gssize) g_bytes_get_size (bytes)) < 0)
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (stream),
+					   callback,
+					   user_data,
+					   G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+					   _("Too large count value passed to %s"),
+					   G_STRFUNC);
+      return;
+    }
+
+  if (!g_output_stream_set_pending (stream, &error))
+    {
+      g_simple_async_report_take_gerror_in_idle (G_OBJECT (stream),
+					    callback,
+					    user_data,
+					    error);
+      return;
+    }
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+
+  stream->priv->outstanding_callback = callback;
+  g_object_ref (stream);
+  class->write_bytes_async (stream, bytes, io_priority, cancellable,
+			    async_ready_callback_wrapper, user_data);
+}
+
+/**
+ * g_output_stream_write_bytes_finish:
+ * @stream: a #GOutputStream.
+ * @result: a #GAsyncResult.
+ * @error: a #GError location to store the error occurring, or %NULL to
+ * ignore.
+ *
+ * Finishes a stream write-from-#GBytes operation.
+ *
+ * Returns: a #gssize containing the number of bytes written to the stream.
+ *
+ * Since: 2.34
+ **/
+gssize
+g_output_stream_write_bytes_finish (GOutputStream  *stream,
+				    GAsyncResult   *result,
+				    GError        **error)
+{
+  GSimpleAsyncResult *simple;
+  GOutputStreamClass *class;
+
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), -1);
+  g_return_val_if_fail (G_IS_ASYNC_RESULT (result), -1);
+
+  if (G_IS_SIMPLE_ASYNC_RESULT (result))
+    {
+      simple = G_SIMPLE_ASYNC_RESULT (result);
+      if (g_simple_async_result_propagate_error (simple, error))
+	return -1;
+
+      /* Special case writes of 0 bytes */
+      if (g_simple_async_result_get_source_tag (simple) == g_output_stream_write_bytes_async)
+	return 0;
+    }
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+  return class->write_bytes_finish (stream, result, error);
+}
+
 typedef struct {
   GInputStream *source;
   gpointer user_data;
@@ -1320,6 +1533,60 @@ g_output_stream_real_write_finish (GOutputStream  *stream,
   return op->count_written;
 }
 
+typedef struct {
+  GBytes *bytes;
+  GAsyncReadyCallback callback;
+  gpointer user_data;
+} WriteBytesData;
+
+static void
+write_bytes_callback (GObject      *source_object,
+		      GAsyncResult *res,
+		      gpointer      user_data)
+{
+  WriteBytesData *data = user_data;
+
+  data->callback (source_object, res, data->user_data);
+
+  g_bytes_unref (data->bytes);
+  g_slice_free (WriteBytesData, data);
+}
+
+static void
+g_output_stream_real_write_bytes_async (GOutputStream       *stream,
+					GBytes              *bytes,
+					int                  io_priority,
+					GCancellable        *cancellable,
+					GAsyncReadyCallback  callback,
+					gpointer             user_data)
+{
+  GOutputStreamClass *class;
+  WriteBytesData *data;
+
+  /* Keep @bytes alive until the plain write is done with its data */
+  data = g_slice_new (WriteBytesData);
+  data->bytes = g_bytes_ref (bytes);
+  data->callback = callback;
+  data->user_data = user_data;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+  class->write_async (stream,
+		      g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes),
+		      io_priority, cancellable,
+		      write_bytes_callback, data);
+}
+
+static gssize
+g_output_stream_real_write_bytes_finish (GOutputStream  *stream,
+					 GAsyncResult   *result,
+					 GError        **error)
+{
+  GOutputStreamClass *class;
+
+  class = G_OUTPUT_STREAM_GET_CLASS (stream);
+  return class->write_finish (stream, result, error);
+}
+
 typedef struct {
   GInputStream *source;
   GOutputStreamSpliceFlags flags;
@@ -121,11 +121,24 @@ struct _GOutputStreamClass
                                  GAsyncResult             *result,
                                  GError                  **error);
 
+  /* GBytes ops: (optional, default to the plain write ops) */
+
+  gssize      (* write_bytes_fn)     (GOutputStream       *stream,
+                                      GBytes              *bytes,
+                                      GCancellable        *cancellable,
+                                      GError             **error);
+  void        (* write_bytes_async)  (GOutputStream       *stream,
+                                      GBytes              *bytes,
+                                      int                  io_priority,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+  gssize      (* write_bytes_finish) (GOutputStream       *stream,
+                                      GAsyncResult        *result,
+                                      GError             **error);
+
   /*< private >*/
   /* Padding for future expansion */
-  void (*_g_reserved1) (void);
-  void (*_g_reserved2) (void);
-  void (*_g_reserved3) (void);
   void (*_g_reserved4) (void);
   void (*_g_reserved5) (void);
   void (*_g_reserved6) (void);
@@ -146,6 +159,10 @@ gboolean g_output_stream_write_all     (GOutputStream             *stream,
 					gsize                     *bytes_written,
 					GCancellable              *cancellable,
 					GError                   **error);
+gssize   g_output_stream_write_bytes   (GOutputStream             *stream,
+					GBytes                    *bytes,
+					GCancellable              *cancellable,
+					GError                   **error);
 gssize   g_output_stream_splice        (GOutputStream             *stream,
 					GInputStream              *source,
 					GOutputStreamSpliceFlags   flags,
@@ -167,6 +184,15 @@ void     g_output_stream_write_async   (GOutputStream             *stream,
 gssize   g_output_stream_write_finish  (GOutputStream             *stream,
 					GAsyncResult              *result,
 					GError                   **error);
+void     g_output_stream_write_bytes_async  (GOutputStream       *stream,
+					     GBytes              *bytes,
+					     int                  io_priority,
+					     GCancellable        *cancellable,
+					     GAsyncReadyCallback  callback,
+					     gpointer             user_data);
+gssize   g_output_stream_write_bytes_finish (GOutputStream       *stream,
+					     GAsyncResult        *result,
+					     GError             **error);
 void     g_output_stream_splice_async  (GOutputStream             *stream,
 					GInputStream              *source,
 					GOutputStreamSpliceFlags   flags,
@@ -32,6 +32,9 @@
 #include "gsimpleasyncresult.h"
 #include "gsrvtarget.h"
 #include "gthreadedresolver.h"
+#ifdef G_OS_UNIX
+#include "gdnsresolver.h"
+#endif
 
 #ifdef G_OS_UNIX
 #include <sys/stat.h>
@@ -149,7 +152,14 @@ GResolver *
 g_resolver_get_default (void)
 {
   if (!default_resolver)
-    default_resolver = g_object_new (G_TYPE_THREADED_RESOLVER, NULL);
+    {
+#ifdef G_OS_UNIX
+      if (g_strcmp0 (g_getenv ("GIO_USE_RESOLVER"), "dns") == 0)
+        default_resolver = g_object_new (G_TYPE_DNS_RESOLVER, NULL);
+      else
+#endif
+        default_resolver = g_object_new (G_TYPE_THREADED_RESOLVER, NULL);
+    }
 
   return g_object_ref (default_resolver);
 }
@@ -36,9 +36,11 @@ struct _GResource
   int ref_count;
 
   GvdbTable *table;
+  gboolean has_cached_data;
 };
 
 static void register_lazy_static_resources ();
+static void g_resource_cache_purge (GResource *resource);
 
 G_DEFINE_BOXED_TYPE (GResource, g_resource, g_resource_ref, g_resource_unref)
 
@@ -178,6 +180,8 @@ g_resource_unref (GResource *resource)
 {
   if (g_atomic_int_dec_and_test (&resource->ref_count))
     {
+      if (resource->has_cached_data)
+        g_resource_cache_purge (resource);
       gvdb_table_unref (resource->table);
       g_free (resource);
     }
@@ -197,6 +201,7 @@ g_resource_new_from_table (GvdbTable *table)
   resource = g_new (GResource, 1);
   resource->ref_count = 1;
   resource->table = table;
+  resource->has_cached_data = FALSE;
 
   return resource;
 }
@@ -265,6 +270,182 @@ g_resource_load (const gchar  *filename,
   return g_resource_new_from_table (table);
 }
 
+/* Decompressed data cache
+ *
+ * Inflating a compressed resource is comparatively expensive, and the same
+ * resources (ui files, css, etc) tend to be looked up over and over again.
+ * We keep the most recently used decompressed contents around, keyed by
+ * (resource, path), up to a total size given by G_RESOURCE_CACHE_SIZE.
+ *
+ * Entries don't hold a reference on their resource; instead they are
+ * purged when the resource is finalized.
+ */
+#define G_RESOURCE_CACHE_DEFAULT_SIZE (2 * 1024 * 1024)
+
+typedef struct
+{
+  GResource *resource;
+  gchar     *path;
+  GBytes    *data;
+  GList      lru_link;
+} GResourceCacheEntry;
+
+static GMutex      resource_cache_lock;
+static GHashTable *resource_cache;
+static GQueue      resource_cache_lru = G_QUEUE_INIT; /* most recently used first */
+static gsize       resource_cache_size;
+
+static gsize
+g_resource_cache_get_max_size (void)
+{
+  static gsize max_size_plus_one;
+
+  if (g_once_init_enter (&max_size_plus_one))
+    {
+      const gchar *env;
+      gsize max_size;
+
+      env = g_getenv ("G_RESOURCE_CACHE_SIZE");
+      if (env != NULL)
+        max_size = g_ascii_strtoull (env, NULL, 10);
+      else
+        max_size = G_RESOURCE_CACHE_DEFAULT_SIZE;
+
+      g_once_init_leave (&max_size_plus_one, max_size + 1);
+    }
+
+  return max_size_plus_one - 1;
+}
+
+static guint
+g_resource_cache_entry_hash (gconstpointer key)
+{
+  const GResourceCacheEntry *entry = key;
+
+  return g_str_hash (entry->path) ^ g_direct_hash (entry->resource);
+}
+
+static gboolean
+g_resource_cache_entry_equal (gconstpointer a,
+                              gconstpointer b)
+{
+  const GResourceCacheEntry *entry_a = a;
+  const GResourceCacheEntry *entry_b = b;
+
+  return entry_a->resource == entry_b->resource &&
+         strcmp (entry_a->path, entry_b->path) == 0;
+}
+
+static void
+g_resource_cache_entry_free (gpointer data)
+{
+  GResourceCacheEntry *entry = data;
+
+  g_queue_unlink (&resource_cache_lru, &entry->lru_link);
+  resource_cache_size -= g_bytes_get_size (entry->data);
+  g_bytes_unref (entry->data);
+  g_free (entry->path);
+  g_slice_free (GResourceCacheEntry, entry);
+}
+
+static GBytes *
+g_resource_cache_lookup (GResource   *resource,
+                         const gchar *path)
+{
+  GResourceCacheEntry key, *entry;
+  GBytes *data = NULL;
+
+  if (g_resource_cache_get_max_size () == 0)
+    return NULL;
+
+  key.resource = resource;
+  key.path = (gchar *) path;
+
+  g_mutex_lock (&resource_cache_lock);
+
+  if (resource_cache != NULL &&
+      (entry = g_hash_table_lookup (resource_cache, &key)) != NULL)
+    {
+      g_queue_unlink (&resource_cache_lru, &entry->lru_link);
+      g_queue_push_head_link (&resource_cache_lru, &entry->lru_link);
+      data = g_bytes_ref (entry->data);
+    }
+
+  g_mutex_unlock (&resource_cache_lock);
+
+  return data;
+}
+
+static void
+g_resource_cache_insert (GResource   *resource,
+                         const gchar *path,
+                         GBytes      *data)
+{
+  GResourceCacheEntry *entry;
+  gsize max_size, size;
+
+  max_size = g_resource_cache_get_max_size ();
+  size = g_bytes_get_size (data);
+
+  /* Don't let a single large resource flush everything else */
+  if (max_size == 0 || size > max_size / 4)
+    return;
+
+  entry = g_slice_new (GResourceCacheEntry);
+  entry->resource = resource;
+  entry->path = g_strdup (path);
+  entry->data = g_bytes_ref (data);
+  entry->lru_link.data = entry;
+  entry->lru_link.prev = entry->lru_link.next = NULL;
+
+  g_mutex_lock (&resource_cache_lock);
+
+  if (resource_cache == NULL)
+    resource_cache = g_hash_table_new_full (g_resource_cache_entry_hash,
+                                            g_resource_cache_entry_equal,
+                                            NULL, g_resource_cache_entry_free);
+
+  /* Another thread may have decompressed the same file concurrently */
+  if (g_hash_table_lookup (resource_cache, entry) != NULL)
+    {
+      g_mutex_unlock (&resource_cache_lock);
+      g_bytes_unref (entry->data);
+      g_free (entry->path);
+      g_slice_free (GResourceCacheEntry, entry);
+      return;
+    }
+
+  while (resource_cache_size + size > max_size)
+    g_hash_table_remove (resource_cache, g_queue_peek_tail (&resource_cache_lru));
+
+  g_queue_push_head_link (&resource_cache_lru, &entry->lru_link);
+  resource_cache_size += size;
+  g_hash_table_insert (resource_cache, entry, entry);
+  resource->has_cached_data = TRUE;
+
+  g_mutex_unlock (&resource_cache_lock);
+}
+
+static gboolean
+g_resource_cache_entry_matches_resource (gpointer key,
+                                         gpointer value,
+                                         gpointer user_data)
+{
+  GResourceCacheEntry *entry = key;
+
+  return entry->resource == user_data;
+}
+
+static void
+g_resource_cache_purge (GResource *resource)
+{
+  g_mutex_lock (&resource_cache_lock);
+  g_hash_table_foreach_remove (resource_cache,
+                               g_resource_cache_entry_matches_resource,
+                               resource);
+  g_mutex_unlock (&resource_cache_lock);
+}
+
 static
 gboolean do_lookup (GResource             *resource,
                     const gchar           *path,
@@ -363,6 +544,22 @@ g_resource_open_stream (GResource             *resource,
   if (!do_lookup (resource, path, lookup_flags, NULL, &flags, &data, &data_size, error))
     return NULL;
 
+  if (flags & G_RESOURCE_FLAGS_COMPRESSED)
+    {
+      GBytes *cached;
+
+      cached = g_resource_cache_lookup (resource, path);
+      if (cached != NULL)
+        {
+          stream = g_memory_input_stream_new_from_data (g_bytes_get_data (cached, NULL),
+                                                        g_bytes_get_size (cached),
+                                                        NULL);
+          g_object_set_data_full (G_OBJECT (stream), "g-resource-data",
+                                  cached, (GDestroyNotify)g_bytes_unref);
+          return stream;
+        }
+    }
+
   stream = g_memory_input_stream_new_from_data (data, data_size, NULL);
   g_object_set_data_full (G_OBJECT (stream), "g-resource",
                           g_resource_ref (resource),
@@ -400,7 +597,12 @@ g_resource_open_stream (GResource             *resource,
  * For uncompressed resource files this is a pointer directly into
  * the resource bundle, which is typically in some readonly data section
  * in the program binary. For compressed files we allocate memory on
- * the heap and automatically uncompress the data.
+ * the heap and automatically uncompress the data. Recently used
+ * uncompressed data is kept in a cache that is shared between all
+ * resources, so repeated lookups of the same compressed file are cheap.
+ * The size of this cache can be set in bytes with the
+ * <envar>G_RESOURCE_CACHE_SIZE</envar> environment variable; a value of
+ * 0 disables it.
  *
  * @lookup_flags controls the behaviour of the lookup.
  *
@@ -430,7 +632,11 @@ g_resource_lookup_data (GResource             *resource,
       GConverterResult res;
       gsize d_size, s_size;
       gsize bytes_read, bytes_written;
+      GBytes *bytes;
 
+      bytes = g_resource_cache_lookup (resource, path);
+      if (bytes != NULL)
+        return bytes;
 
       GZlibDecompressor *decompressor =
         g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB);
@@ -473,7 +679,10 @@ g_resource_lookup_data (GResource             *resource,
 
       g_object_unref (decompressor);
 
-      return g_bytes_new_take (uncompressed, size);
+      bytes = g_bytes_new_take (uncompressed, size);
+      g_resource_cache_insert (resource, path, bytes);
+
+      return bytes;
     }
   else
     return g_bytes_new_with_free_func (data, data_size, (GDestroyNotify)g_resource_unref, g_resource_ref (resource));
@@ -568,14 +777,85 @@ g_resource_enumerate_children (GResource             *resource,
 static GRWLock resources_lock;
 static GList *registered_resources;
 
+/* Maps the path of every file in the registered resources to the resource
+ * that owns it, so that global lookups don't have to try each registered
+ * resource in turn. Protected by resources_lock, like registered_resources. */
+static GHashTable *resources_index;
+
 /* This is updated atomically, so we can append to it and check for NULL outside the
    lock, but all other accesses are done under the write lock */
 static GStaticResource *lazy_register_resources;
 
+static void
+g_resources_index_add_unlocked (GResource *resource)
+{
+  gchar **names;
+  gint n_names, i;
+
+  if (resources_index == NULL)
+    resources_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* Later registrations shadow earlier ones, so replace existing entries */
+  names = gvdb_table_get_names (resource->table, &n_names);
+  for (i = 0; i < n_names; i++)
+    {
+      if (gvdb_table_has_value (resource->table, names[i]))
+        g_hash_table_insert (resources_index, names[i], resource);
+      else
+        g_free (names[i]);
+    }
+  g_free (names);
+}
+
+static void
+g_resources_index_rebuild_unlocked (void)
+{
+  GList *l;
+
+  if (resources_index != NULL)
+    g_hash_table_remove_all (resources_index);
+
+  for (l = g_list_last (registered_resources); l != NULL; l = l->prev)
+    g_resources_index_add_unlocked (l->data);
+}
+
+/* Returns a new reference to the registered resource owning @path, or NULL */
+static GResource *
+g_resources_find (const gchar *path)
+{
+  GResource *resource = NULL;
+  gsize path_len;
+
+  g_rw_lock_reader_lock (&resources_lock);
+
+  path_len = strlen (path);
+  if (resources_index != NULL && path_len > 0)
+    {
+      if (path[path_len-1] == '/')
+        {
+          gchar *stripped_path;
+
+          stripped_path = g_strndup (path, path_len - 1);
+          resource = g_hash_table_lookup (resources_index, stripped_path);
+          g_free (stripped_path);
+        }
+      else
+        resource = g_hash_table_lookup (resources_index, path);
+    }
+
+  if (resource != NULL)
+    g_resource_ref (resource);
+
+  g_rw_lock_reader_unlock (&resources_lock);
+
+  return resource;
+}
+
 static void
 g_resources_register_unlocked (GResource *resource)
 {
   registered_resources = g_list_prepend (registered_resources, g_resource_ref (resource));
+  g_resources_index_add_unlocked (resource);
 }
 
 static void
@@ -588,6 +868,7 @@ g_resources_unregister_unlocked (GResource *resource)
   else
     {
       registered_resources = g_list_remove (registered_resources, resource);
+      g_resources_index_rebuild_unlocked ();
       g_resource_unref (resource);
     }
 }
@@ -649,40 +930,21 @@ g_resources_open_stream (const gchar           *path,
                          GError               **error)
 {
   GInputStream *res = NULL;
-  GList *l;
-  GInputStream *stream;
+  GResource *r;
 
   register_lazy_static_resources ();
 
-  g_rw_lock_reader_lock (&resources_lock);
-
-  for (l = registered_resources; l != NULL; l = l->next)
+  r = g_resources_find (path);
+  if (r != NULL)
     {
-      GResource *r = l->data;
-      GError *my_error = NULL;
-
-      stream = g_resource_open_stream (r, path, lookup_flags, &my_error);
-      if (stream == NULL &&
-          g_error_matches (my_error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND))
-        {
-          g_clear_error (&my_error);
-        }
-      else
-        {
-          if (stream == NULL)
-            g_propagate_error (error, my_error);
-          res = stream;
-          break;
-        }
+      res = g_resource_open_stream (r, path, lookup_flags, error);
+      g_resource_unref (r);
     }
-
-  if (l == NULL)
+  else
     g_set_error (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND,
                  _("The resource at '%s' does not exist"),
                  path);
 
-  g_rw_lock_reader_unlock (&resources_lock);
-
   return res;
 }
 
@@ -718,40 +980,21 @@ g_resources_lookup_data (const gchar           *path,
                          GError               **error)
 {
   GBytes *res = NULL;
-  GList *l;
-  GBytes *data;
+  GResource *r;
 
   register_lazy_static_resources ();
 
-  g_rw_lock_reader_lock (&resources_lock);
-
-  for (l = registered_resources; l != NULL; l = l->next)
+  r = g_resources_find (path);
+  if (r != NULL)
     {
-      GResource *r = l->data;
-      GError *my_error = NULL;
-
-      data = g_resource_lookup_data (r, path, lookup_flags, &my_error);
-      if (data == NULL &&
-          g_error_matches (my_error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND))
-        {
-          g_clear_error (&my_error);
-        }
-      else
-        {
-          if (data == NULL)
-            g_propagate_error (error, my_error);
-          res = data;
-          break;
-        }
+      res = g_resource_lookup_data (r, path, lookup_flags, error);
+      g_resource_unref (r);
     }
-
-  if (l == NULL)
+  else
     g_set_error (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND,
                  _("The resource at '%s' does not exist"),
                  path);
 
-  g_rw_lock_reader_unlock (&resources_lock);
-
   return res;
 }
 
@@ -859,40 +1102,21 @@ g_resources_get_info (const gchar           *path,
                       GError               **error)
 {
   gboolean res = FALSE;
-  GList *l;
-  gboolean r_res;
+  GResource *r;
 
   register_lazy_static_resources ();
 
-  g_rw_lock_reader_lock (&resources_lock);
-
-  for (l = registered_resources; l != NULL; l = l->next)
+  r = g_resources_find (path);
+  if (r != NULL)
     {
-      GResource *r = l->data;
-      GError *my_error = NULL;
-
-      r_res = g_resource_get_info (r, path, lookup_flags, size, flags, &my_error);
-      if (!r_res &&
-          g_error_matches (my_error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND))
-        {
-          g_clear_error (&my_error);
-        }
-      else
-        {
-          if (!r_res)
-            g_propagate_error (error, my_error);
-          res = r_res;
-          break;
-        }
+      res = g_resource_get_info (r, path, lookup_flags, size, flags, error);
+      g_resource_unref (r);
     }
-
-  if (l == NULL)
+  else
     g_set_error (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND,
                  _("The resource at '%s' does not exist"),
                  path);
 
-  g_rw_lock_reader_unlock (&resources_lock);
-
   return res;
 }
 
@@ -241,6 +241,12 @@ struct _GSettingsPrivate
   gchar *path;
 
   GDelayedSettingsBackend *delayed;
+
+  /* values that have been read, by key name */
+  GMutex cache_lock;
+  GHashTable *cache;
+  guint cache_serial;
+  gint cache_backend_serial;
 };
 
 enum
@@ -436,6 +442,187 @@ settings_backend_path_writable_changed (GObject          *target,
                    0, (GQuark) 0, &ignore_this);
 }
 
+/* Value cache {{{1 */
+/* Values are cached per key until the backend reports a change that
+ * could affect them.  The cache listens to the backend with a second
+ * watch that has no main context, so it is invalidated in the thread
+ * that reports the change (normally: the one that did the write) before
+ * any further read can happen there.  The cache is not used in
+ * delay-apply mode, where changes are relayed through the main context.
+ *
+ * The serial guards against a read that raced with an invalidation
+ * putting a stale value into the cache.
+ *
+ * Backends that can be changed by other processes (like the gvdb one)
+ * may only signal those changes later, from their main context, but
+ * they keep a serial that changes right away.  The cache is dropped
+ * whenever that differs from what it was when the cache was filled.
+ */
+static void
+g_settings_cache_check_backend (GSettings *settings)
+{
+  gint backend_serial;
+
+  backend_serial = g_settings_backend_get_serial (settings->priv->backend);
+  if (backend_serial != settings->priv->cache_backend_serial)
+    {
+      settings->priv->cache_backend_serial = backend_serial;
+      settings->priv->cache_serial++;
+      g_hash_table_remove_all (settings->priv->cache);
+    }
+}
+
+static GVariant *
+g_settings_cache_lookup (GSettings   *settings,
+                         const gchar *key)
+{
+  GVariant *value;
+
+  g_mutex_lock (&settings->priv->cache_lock);
+  g_settings_cache_check_backend (settings);
+  value = g_hash_table_lookup (settings->priv->cache, key);
+  if (value)
+    g_variant_ref (value);
+  g_mutex_unlock (&settings->priv->cache_lock);
+
+  return value;
+}
+
+/* Copies a cached fixed-size value of type @type into @result, without
+ * taking a reference on the GVariant
+ */
+static gboolean
+g_settings_cache_get_scalar (GSettings          *settings,
+                             const gchar        *key,
+                             const GVariantType *type,
+                             gpointer            result,
+                             gsize               size)
+{
+  GVariant *value;
+
+  g_mutex_lock (&settings->priv->cache_lock);
+  g_settings_cache_check_backend (settings);
+  value = g_hash_table_lookup (settings->priv->cache, key);
+  if (value && g_variant_is_of_type (value, type) &&
+      g_variant_get_size (value) == size)
+    memcpy (result, g_variant_get_data (value), size);
+  else
+    value = NULL;
+  g_mutex_unlock (&settings->priv->cache_lock);
+
+  return value != NULL;
+}
+
+static guint
+g_settings_cache_get_serial (GSettings *settings)
+{
+  guint serial;
+
+  g_mutex_lock (&settings->priv->cache_lock);
+  serial = settings->priv->cache_serial;
+  g_mutex_unlock (&settings->priv->cache_lock);
+
+  return serial;
+}
+
+static void
+g_settings_cache_insert (GSettings          *settings,
+                         GSettingsSchemaKey *key,
+                         GVariant           *value,
+                         guint               serial)
+{
+  if (settings->priv->delayed)
+    return;
+
+  g_mutex_lock (&settings->priv->cache_lock);
+  if (serial == settings->priv->cache_serial)
+    g_hash_table_insert (settings->priv->cache, (gpointer) key->name, g_variant_ref (value));
+  g_mutex_unlock (&settings->priv->cache_lock);
+}
+
+static void
+g_settings_cache_invalidate (GSettings   *settings,
+                             const gchar *key)
+{
+  g_mutex_lock (&settings->priv->cache_lock);
+  settings->priv->cache_serial++;
+  if (key)
+    g_hash_table_remove (settings->priv->cache, key);
+  else
+    g_hash_table_remove_all (settings->priv->cache);
+  g_mutex_unlock (&settings->priv->cache_lock);
+}
+
+static void
+cache_backend_changed (GObject          *target,
+                       GSettingsBackend *backend,
+                       const gchar      *key,
+                       gpointer          origin_tag)
+{
+  GSettings *settings = G_SETTINGS (target);
+  gint i;
+
+  for (i = 0; key[i] == settings->priv->path[i]; i++);
+
+  if (settings->priv->path[i] == '\0')
+    g_settings_cache_invalidate (settings, key + i);
+}
+
+static void
+cache_backend_path_changed (GObject          *target,
+                            GSettingsBackend *backend,
+                            const gchar      *path,
+                            gpointer          origin_tag)
+{
+  GSettings *settings = G_SETTINGS (target);
+
+  if (g_str_has_prefix (settings->priv->path, path))
+    g_settings_cache_invalidate (settings, NULL);
+}
+
+static void
+cache_backend_keys_changed (GObject             *target,
+                            GSettingsBackend    *backend,
+                            const gchar         *path,
+                            const gchar * const *items,
+                            gpointer             origin_tag)
+{
+  GSettings *settings = G_SETTINGS (target);
+  gint i, j;
+
+  for (i = 0; settings->priv->path[i] &&
+              settings->priv->path[i] == path[i]; i++);
+
+  if (path[i] != '\0')
+    return;
+
+  for (j = 0; items[j]; j++)
+    {
+      const gchar *item = items[j];
+      gint k;
+
+      for (k = 0; item[k] == settings->priv->path[i + k]; k++);
+
+      if (settings->priv->path[i + k] == '\0')
+        g_settings_cache_invalidate (settings, item + k);
+    }
+}
+
+static void
+cache_backend_writable_changed (GObject          *target,
+                                GSettingsBackend *backend,
+                                const gchar      *key)
+{
+}
+
+static const GSettingsListenerVTable cache_vtable = {
+  cache_backend_changed,
+  cache_backend_path_changed,
+  cache_backend_keys_changed,
+  cache_backend_writable_changed,
+  cache_backend_writable_changed
+};
+
 /* Properties, Construction, Destruction {{{1 */
 static void
 g_settings_set_property (GObject      *object,
@@ -581,6 +768,8 @@ g_settings_constructed (GObject *object)
   g_settings_backend_watch (settings->priv->backend,
                             &listener_vtable, G_OBJECT (settings),
                             settings->priv->main_context);
+  g_settings_backend_watch (settings->priv->backend,
+                            &cache_vtable, G_OBJECT (settings), NULL);
   g_settings_backend_subscribe (settings->priv->backend,
                                 settings->priv->path);
 }
@@ -597,6 +786,9 @@ g_settings_finalize (GObject *object)
   g_settings_schema_unref (settings->priv->schema);
   g_free (settings->priv->path);
 
+  g_hash_table_unref (settings->priv->cache);
+  g_mutex_clear (&settings->priv->cache_lock);
+
   G_OBJECT_CLASS (g_settings_parent_class)->finalize (object);
 }
 
@@ -608,6 +800,10 @@ g_settings_init (GSettings *settings)
                                                 GSettingsPrivate);
 
   settings->priv->main_context = g_main_context_ref_thread_default ();
+
+  g_mutex_init (&settings->priv->cache_lock);
+  settings->priv->cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                 (GDestroyNotify) g_variant_unref);
 }
 
 static void
@@ -1072,10 +1268,17 @@ g_settings_get_value (GSettings   *settings,
 {
   GSettingsSchemaKey skey;
   GVariant *value;
+  guint serial;
 
   g_return_val_if_fail (G_IS_SETTINGS (settings), NULL);
   g_return_val_if_fail (key != NULL, NULL);
 
+  value = g_settings_cache_lookup (settings, key);
+  if (value != NULL)
+    return value;
+
+  serial = g_settings_cache_get_serial (settings);
+
   g_settings_schema_key_init (&skey, settings->priv->schema, key);
   value = g_settings_read_from_backend (settings, &skey);
 
@@ -1085,6 +1288,7 @@ g_settings_get_value (GSettings   *settings,
   if (value == NULL)
     value = g_variant_ref (skey.default_value);
 
+  g_settings_cache_insert (settings, &skey, value, serial);
   g_settings_schema_key_clear (&skey);
 
   return value;
@@ -1612,6 +1816,10 @@ g_settings_get_int (GSettings   *settings,
   GVariant *value;
   gint result;
 
+  if (g_settings_cache_get_scalar (settings, key, G_VARIANT_TYPE_INT32,
+                                   &result, sizeof result))
+    return result;
+
   value = g_settings_get_value (settings, key);
   result = g_variant_get_int32 (value);
   g_variant_unref (value);
@@ -1669,6 +1877,10 @@ g_settings_get_uint (GSettings   *settings,
   GVariant *value;
   guint result;
 
+  if (g_settings_cache_get_scalar (settings, key, G_VARIANT_TYPE_UINT32,
+                                   &result, sizeof result))
+    return result;
+
   value = g_settings_get_value (settings, key);
   result = g_variant_get_uint32 (value);
   g_variant_unref (value);
@@ -1726,6 +1938,10 @@ g_settings_get_double (GSettings   *settings,
   GVariant *value;
   gdouble result;
 
+  if (g_settings_cache_get_scalar (settings, key, G_VARIANT_TYPE_DOUBLE,
+                                   &result, sizeof result))
+    return result;
+
   value = g_settings_get_value (settings, key);
   result = g_variant_get_double (value);
   g_variant_unref (value);
@@ -1781,6 +1997,12 @@ g_settings_get_boolean (GSettings  *settings,
 {
   GVariant *value;
   gboolean result;
+  guint8 cached;
+
+  /* booleans are serialised as a single byte */
+  if (g_settings_cache_get_scalar (settings, key, G_VARIANT_TYPE_BOOLEAN,
+                                   &cached, sizeof cached))
+    return cached;
 
   value = g_settings_get_value (settings, key);
   result = g_variant_get_boolean (value);
@@ -1902,8 +2124,11 @@ g_settings_delay (GSettings *settings)
     g_delayed_settings_backend_new (settings->priv->backend,
                                     settings,
                                     settings->priv->main_context);
+  /* drops both the listener and the cache watch */
+  g_settings_backend_unwatch (settings->priv->backend, G_OBJECT (settings));
   g_settings_backend_unwatch (settings->priv->backend, G_OBJECT (settings));
   g_object_unref (settings->priv->backend);
+  g_settings_cache_invalidate (settings, NULL);
 
   settings->priv->backend = G_SETTINGS_BACKEND (settings->priv->delayed);
   g_settings_backend_watch (settings->priv->backend,
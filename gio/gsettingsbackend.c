@@ -42,6 +42,8 @@ struct _GSettingsBackendPrivate
 {
   GSettingsBackendWatch *watches;
   GMutex lock;
+
+  const volatile gint *serial;
 };
 
 /* For g_settings_backend_sync_default(), we only want to actually do
@@ -886,6 +888,42 @@ g_settings_backend_subscribe (GSettingsBackend *backend,
     ->subscribe (backend, name);
 }
 
+/*< private >
+ * g_settings_backend_set_serial_location:
+ * @backend: a #GSettingsBackend
+ * @location: a counter that changes whenever the values of @backend do
+ *
+ * Lets readers find out cheaply whether the values of @backend may have
+ * changed, including through changes made elsewhere (say, in another
+ * process) that have not been signalled yet.  @location must stay valid
+ * for the lifetime of @backend.
+ */
+void
+g_settings_backend_set_serial_location (GSettingsBackend    *backend,
+                                        const volatile gint *location)
+{
+  backend->priv->serial = location;
+}
+
+/*< private >
+ * g_settings_backend_get_serial:
+ * @backend: a #GSettingsBackend
+ *
+ * Returns the counter set with g_settings_backend_set_serial_location().
+ * For backends that have none it is always 0, and only the change
+ * signals tell about changes.
+ *
+ * Returns: the current value of the counter
+ */
+gint
+g_settings_backend_get_serial (GSettingsBackend *backend)
+{
+  if (backend->priv->serial == NULL)
+    return 0;
+
+  return g_atomic_int_get (backend->priv->serial);
+}
+
 static void
 g_settings_backend_finalize (GObject *object)
 {
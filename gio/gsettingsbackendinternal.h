@@ -93,6 +93,11 @@ GPermission *           g_settings_backend_get_permission               (GSettin
                                                                          const gchar                    *path);
 G_GNUC_INTERNAL
 void                    g_settings_backend_sync_default                 (void);
+G_GNUC_INTERNAL
+void                    g_settings_backend_set_serial_location          (GSettingsBackend               *backend,
+                                                                         const volatile gint            *location);
+G_GNUC_INTERNAL
+gint                    g_settings_backend_get_serial                   (GSettingsBackend               *backend);
 
 G_GNUC_INTERNAL
 GType                   g_null_settings_backend_get_type                (void);
@@ -100,6 +105,11 @@ GType                   g_null_settings_backend_get_type                (void);
 G_GNUC_INTERNAL
 GType                   g_memory_settings_backend_get_type              (void);
 
+#ifdef G_OS_UNIX
+G_GNUC_INTERNAL
+GType                   g_gvdb_settings_backend_get_type                (void);
+#endif
+
 #ifdef HAVE_COCOA
 G_GNUC_INTERNAL
 GType                   g_nextstep_settings_backend_get_type            (void);
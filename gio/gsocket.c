@@ -48,6 +48,10 @@
 #include <sys/uio.h>
 #endif
 
+#ifdef HAVE_LINUX_ERRQUEUE_H
+#include <linux/errqueue.h>
+#endif
+
 #include "gcancellable.h"
 #include "gioenumtypes.h"
 #include "ginetaddress.h"
@@ -59,6 +63,8 @@
 #include "gsocketaddress.h"
 #include "gsocketcontrolmessage.h"
 #include "gcredentials.h"
+#include "gbufferpool.h"
+#include "gsocketprivate.h"
 #include "glibintl.h"
 
 /**
@@ -142,9 +148,35 @@ enum
   PROP_TTL,
   PROP_BROADCAST,
   PROP_MULTICAST_LOOPBACK,
-  PROP_MULTICAST_TTL
+  PROP_MULTICAST_TTL,
+  PROP_ZEROCOPY,
+  PROP_RECEIVE_BUFFER_SIZE,
+  PROP_SEND_BUFFER_SIZE,
+  PROP_BUSY_POLL,
+  PROP_NOTSENT_LOWAT,
+  PROP_FAST_OPEN
 };
 
+#if defined (HAVE_LINUX_ERRQUEUE_H) && defined (SO_ZEROCOPY) && defined (MSG_ZEROCOPY)
+#define USE_ZEROCOPY 1
+
+/* Below this, copying the data is cheaper than pinning its pages and
+ * collecting the completion from the error queue afterwards.
+ */
+#define ZEROCOPY_MIN_SIZE (16 * 1024)
+
+/* How long g_socket_close() waits, in seconds, for the kernel to be
+ * done with the zero-copy sends in flight if the socket has no
+ * timeout of its own.
+ */
+#define ZEROCOPY_CLOSE_TIMEOUT 10
+
+typedef struct {
+  guint32  id;
+  GBytes  *bytes;
+} ZerocopyBuffer;
+#endif
+
 struct _GSocketPrivate
 {
   GSocketFamily   family;
@@ -163,6 +195,15 @@ struct _GSocketPrivate
   guint           listening : 1;
   guint           timed_out : 1;
   guint           connect_pending : 1;
+  guint           zerocopy : 1;
+  guint           zerocopy_copied : 1;
+  guint           fast_open : 1;
+  guint           cork_count;
+#ifdef USE_ZEROCOPY
+  GMutex          zerocopy_lock;
+  GQueue          zerocopy_pending; /* of ZerocopyBuffer, in send order */
+  guint32         zerocopy_next_id;
+#endif
 #ifdef G_OS_WIN32
   WSAEVENT        event;
   int             current_events;
@@ -309,6 +350,152 @@ check_socket (GSocket *socket,
   return TRUE;
 }
 
+#ifdef USE_ZEROCOPY
+/* Drops the buffers of the zero-copy sends numbered @lo to @hi
+ * (inclusive, modulo 2^32), which the kernel is done with.
+ */
+static void
+zerocopy_release (GSocket *socket,
+		  guint32  lo,
+		  guint32  hi)
+{
+  ZerocopyBuffer *buffer;
+  GList *l, *next;
+
+  g_mutex_lock (&socket->priv->zerocopy_lock);
+  for (l = socket->priv->zerocopy_pending.head; l; l = next)
+    {
+      next = l->next;
+      buffer = l->data;
+
+      if ((guint32) (buffer->id - lo) <= (guint32) (hi - lo))
+	{
+	  g_queue_delete_link (&socket->priv->zerocopy_pending, l);
+	  g_bytes_unref (buffer->bytes);
+	  g_slice_free (ZerocopyBuffer, buffer);
+	}
+    }
+  g_mutex_unlock (&socket->priv->zerocopy_lock);
+}
+
+/* Collects the completion notifications of zero-copy sends from the
+ * socket's error queue. These show up as %G_IO_ERR on the socket, so
+ * callers waiting on it use the return value to tell them apart from
+ * real errors.
+ */
+static gboolean
+zerocopy_reap (GSocket *socket)
+{
+  char control[CMSG_SPACE (sizeof (struct sock_extended_err) +
+			   sizeof (struct sockaddr_in6))];
+  struct sock_extended_err *serr;
+  struct cmsghdr *cmsg;
+  struct msghdr msg;
+  gboolean reaped = FALSE;
+
+  g_mutex_lock (&socket->priv->zerocopy_lock);
+  if (g_queue_is_empty (&socket->priv->zerocopy_pending))
+    {
+      g_mutex_unlock (&socket->priv->zerocopy_lock);
+      return FALSE;
+    }
+  g_mutex_unlock (&socket->priv->zerocopy_lock);
+
+  while (TRUE)
+    {
+      memset (&msg, 0, sizeof (msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof (control);
+
+      if (recvmsg (socket->priv->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+	break;
+
+      for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+	{
+	  if (!(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR) &&
+	      !(cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+	    continue;
+
+	  serr = (struct sock_extended_err *) CMSG_DATA (cmsg);
+	  if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+	    continue;
+
+#ifdef SO_EE_CODE_ZEROCOPY_COPIED
+	  /* The device could not send straight from our pages (as
+	   * on loopback), so pinning them only costs us.
+	   */
+	  if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+	    socket->priv->zerocopy_copied = TRUE;
+#endif
+
+	  zerocopy_release (socket, serr->ee_info, serr->ee_data);
+	  reaped = TRUE;
+	}
+    }
+
+  return reaped;
+}
+
+static void
+zerocopy_buffer_abandon (ZerocopyBuffer *buffer)
+{
+  /* deliberately keeps its reference on buffer->bytes */
+  g_slice_free (ZerocopyBuffer, buffer);
+}
+
+/* Forgets the zero-copy sends that were never reported complete.
+ * Their completions can no longer be collected once the socket is
+ * closed, and the kernel may still be sending from their pages, so
+ * the buffers are leaked rather than released: that is better than
+ * putting garbage on the wire.
+ */
+static void
+zerocopy_abandon (GSocket *socket)
+{
+  g_mutex_lock (&socket->priv->zerocopy_lock);
+  g_queue_foreach (&socket->priv->zerocopy_pending, (GFunc) zerocopy_buffer_abandon, NULL);
+  g_queue_clear (&socket->priv->zerocopy_pending);
+  g_mutex_unlock (&socket->priv->zerocopy_lock);
+}
+
+/* The kernel goes on sending from the pages of zero-copy sends after
+ * close(), so before closing, this waits (up to the socket's timeout)
+ * for it to report the ones in flight complete.
+ */
+static void
+zerocopy_drain (GSocket *socket)
+{
+  GPollFD poll_fd;
+  gint64 deadline, now;
+  gboolean pending;
+  gint result;
+
+  deadline = g_get_monotonic_time () +
+    (socket->priv->timeout ? socket->priv->timeout : ZEROCOPY_CLOSE_TIMEOUT) * G_USEC_PER_SEC;
+
+  while (TRUE)
+    {
+      g_mutex_lock (&socket->priv->zerocopy_lock);
+      pending = !g_queue_is_empty (&socket->priv->zerocopy_pending);
+      g_mutex_unlock (&socket->priv->zerocopy_lock);
+
+      now = g_get_monotonic_time ();
+      if (!pending || now >= deadline)
+	break;
+
+      /* Completions show up as G_IO_ERR, which poll() always reports */
+      poll_fd.fd = socket->priv->fd;
+      poll_fd.events = 0;
+      poll_fd.revents = 0;
+      result = g_poll (&poll_fd, 1, (deadline - now + 999) / 1000);
+      if (result < 0 && errno == EINTR)
+	continue;
+      if (result <= 0 || !zerocopy_reap (socket))
+	break;
+    }
+}
+#endif
+
 static void
 g_socket_details_from_fd (GSocket *socket)
 {
@@ -642,6 +829,30 @@ g_socket_get_property (GObject    *object,
 	g_value_set_uint (value, g_socket_get_multicast_ttl (socket));
 	break;
 
+      case PROP_ZEROCOPY:
+	g_value_set_boolean (value, socket->priv->zerocopy);
+	break;
+
+      case PROP_RECEIVE_BUFFER_SIZE:
+	g_value_set_uint (value, g_socket_get_receive_buffer_size (socket));
+	break;
+
+      case PROP_SEND_BUFFER_SIZE:
+	g_value_set_uint (value, g_socket_get_send_buffer_size (socket));
+	break;
+
+      case PROP_BUSY_POLL:
+	g_value_set_uint (value, g_socket_get_busy_poll (socket));
+	break;
+
+      case PROP_NOTSENT_LOWAT:
+	g_value_set_uint (value, g_socket_get_notsent_lowat (socket));
+	break;
+
+      case PROP_FAST_OPEN:
+	g_value_set_boolean (value, socket->priv->fast_open);
+	break;
+
       default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -705,6 +916,30 @@ g_socket_set_property (GObject      *object,
 	g_socket_set_multicast_ttl (socket, g_value_get_uint (value));
 	break;
 
+      case PROP_ZEROCOPY:
+	g_socket_set_zerocopy (socket, g_value_get_boolean (value));
+	break;
+
+      case PROP_RECEIVE_BUFFER_SIZE:
+	g_socket_set_receive_buffer_size (socket, g_value_get_uint (value));
+	break;
+
+      case PROP_SEND_BUFFER_SIZE:
+	g_socket_set_send_buffer_size (socket, g_value_get_uint (value));
+	break;
+
+      case PROP_BUSY_POLL:
+	g_socket_set_busy_poll (socket, g_value_get_uint (value));
+	break;
+
+      case PROP_NOTSENT_LOWAT:
+	g_socket_set_notsent_lowat (socket, g_value_get_uint (value));
+	break;
+
+      case PROP_FAST_OPEN:
+	g_socket_set_fast_open (socket, g_value_get_boolean (value));
+	break;
+
       default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -724,6 +959,11 @@ g_socket_finalize (GObject *object)
   if (socket->priv->remote_address)
     g_object_unref (socket->priv->remote_address);
 
+#ifdef USE_ZEROCOPY
+  zerocopy_abandon (socket);
+  g_mutex_clear (&socket->priv->zerocopy_lock);
+#endif
+
 #ifdef G_OS_WIN32
   if (socket->priv->event != WSA_INVALID_EVENT)
     {
@@ -922,6 +1162,100 @@ g_socket_class_init (GSocketClass *klass)
 						      0, G_MAXUINT, 1,
 						      G_PARAM_READWRITE |
 						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:zerocopy:
+   *
+   * Whether large buffers passed to g_socket_send_bytes() are sent
+   * without copying them. See g_socket_set_zerocopy().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_ZEROCOPY,
+				   g_param_spec_boolean ("zerocopy",
+							 P_("Zero-copy"),
+							 P_("Whether to send large buffers without copying them"),
+							 FALSE,
+							 G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:receive-buffer-size:
+   *
+   * The size of the kernel's receive buffer for the socket, in bytes.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_RECEIVE_BUFFER_SIZE,
+				   g_param_spec_uint ("receive-buffer-size",
+						      P_("Receive buffer size"),
+						      P_("Size of the kernel receive buffer in bytes"),
+						      0, G_MAXINT, 0,
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:send-buffer-size:
+   *
+   * The size of the kernel's send buffer for the socket, in bytes.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_SEND_BUFFER_SIZE,
+				   g_param_spec_uint ("send-buffer-size",
+						      P_("Send buffer size"),
+						      P_("Size of the kernel send buffer in bytes"),
+						      0, G_MAXINT, 0,
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:busy-poll:
+   *
+   * How long a blocking receive busy-waits for packets before
+   * sleeping, in microseconds. See g_socket_set_busy_poll().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_BUSY_POLL,
+				   g_param_spec_uint ("busy-poll",
+						      P_("Busy poll"),
+						      P_("Microseconds to busy-wait for packets on receive"),
+						      0, G_MAXINT, 0,
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:notsent-lowat:
+   *
+   * The amount of unsent data above which the socket stops being
+   * writable, in bytes. See g_socket_set_notsent_lowat().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_NOTSENT_LOWAT,
+				   g_param_spec_uint ("notsent-lowat",
+						      P_("Not sent low water mark"),
+						      P_("Unsent bytes above which the socket is not writable"),
+						      0, G_MAXUINT, G_MAXUINT,
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocket:fast-open:
+   *
+   * Whether the socket uses TCP Fast Open when connecting or
+   * listening. See g_socket_set_fast_open().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_FAST_OPEN,
+				   g_param_spec_boolean ("fast-open",
+							 P_("Fast open"),
+							 P_("Whether to use TCP Fast Open"),
+							 FALSE,
+							 G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -1160,6 +1494,138 @@ g_socket_get_keepalive (GSocket *socket)
   return socket->priv->keepalive;
 }
 
+/**
+ * g_socket_set_zerocopy:
+ * @socket: a #GSocket.
+ * @zerocopy: whether to send large buffers without copying them
+ *
+ * Sets whether g_socket_send_bytes() should hand large buffers to the
+ * kernel without copying them (%SO_ZEROCOPY on Linux). This saves
+ * memory bandwidth on large transfers, but costs more than copying
+ * for small ones, so smaller buffers are still copied.
+ *
+ * This is only supported on some systems and kinds of sockets
+ * (notably TCP sockets on Linux 4.14 and later); elsewhere the socket
+ * keeps copying the data, and g_socket_get_zerocopy() returns %FALSE.
+ *
+ * As the kernel goes on sending from those buffers after the socket is
+ * closed, g_socket_close() waits for it to be done with them, for up
+ * to the socket's #GSocket:timeout (or ten seconds if it has none).
+ * Buffers it still has not released by then are never freed.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_set_zerocopy (GSocket  *socket,
+		       gboolean  zerocopy)
+{
+#ifdef USE_ZEROCOPY
+  int value;
+#endif
+
+  g_return_if_fail (G_IS_SOCKET (socket));
+
+  zerocopy = !!zerocopy;
+  if (socket->priv->zerocopy == zerocopy)
+    return;
+
+#ifdef USE_ZEROCOPY
+  value = (gint) zerocopy;
+  if (setsockopt (socket->priv->fd, SOL_SOCKET, SO_ZEROCOPY,
+		  (gpointer) &value, sizeof (value)) < 0)
+    return;
+
+  socket->priv->zerocopy = zerocopy;
+  g_object_notify (G_OBJECT (socket), "zerocopy");
+#endif
+}
+
+/**
+ * g_socket_get_zerocopy:
+ * @socket: a #GSocket.
+ *
+ * Gets whether large buffers passed to g_socket_send_bytes() are sent
+ * without copying them. For details, see g_socket_set_zerocopy().
+ *
+ * Returns: %TRUE if zero-copy sending is enabled, %FALSE otherwise.
+ *
+ * Since: 2.34
+ */
+gboolean
+g_socket_get_zerocopy (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+
+  return socket->priv->zerocopy;
+}
+
+static void
+socket_set_cork (GSocket  *socket,
+		 gboolean  cork)
+{
+#if defined (TCP_CORK) || defined (TCP_NOPUSH)
+  int value = (gint) cork;
+
+  if (socket->priv->type != G_SOCKET_TYPE_STREAM ||
+      (socket->priv->family != G_SOCKET_FAMILY_IPV4 &&
+       socket->priv->family != G_SOCKET_FAMILY_IPV6))
+    return;
+
+#ifdef TCP_CORK
+  setsockopt (socket->priv->fd, IPPROTO_TCP, TCP_CORK,
+	      (gpointer) &value, sizeof (value));
+#else
+  setsockopt (socket->priv->fd, IPPROTO_TCP, TCP_NOPUSH,
+	      (gpointer) &value, sizeof (value));
+#endif
+#endif
+}
+
+/**
+ * g_socket_cork:
+ * @socket: a #GSocket.
+ *
+ * Holds back partial packets on a TCP socket until g_socket_uncork()
+ * is called, so that a protocol writer can send a message as several
+ * small pieces (say, a header and a body) without each of them going
+ * out in a packet of its own. Full packets are still sent right away.
+ *
+ * Calls to g_socket_cork() and g_socket_uncork() can be nested; the
+ * data is flushed when the last g_socket_uncork() is called.
+ *
+ * This uses %TCP_CORK or %TCP_NOPUSH where available, and does
+ * nothing on other systems and kinds of sockets.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_cork (GSocket *socket)
+{
+  g_return_if_fail (G_IS_SOCKET (socket));
+
+  if (socket->priv->cork_count++ == 0)
+    socket_set_cork (socket, TRUE);
+}
+
+/**
+ * g_socket_uncork:
+ * @socket: a #GSocket.
+ *
+ * Undoes the effect of a previous call to g_socket_cork(), sending
+ * any data held back once the last one is undone.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_uncork (GSocket *socket)
+{
+  g_return_if_fail (G_IS_SOCKET (socket));
+  g_return_if_fail (socket->priv->cork_count > 0);
+
+  if (--socket->priv->cork_count == 0)
+    socket_set_cork (socket, FALSE);
+}
+
 /**
  * g_socket_get_listen_backlog:
  * @socket: a #GSocket.
@@ -1529,88 +1995,546 @@ g_socket_set_multicast_loopback (GSocket    *socket,
  * Gets the multicast time-to-live setting on @socket; see
  * g_socket_set_multicast_ttl() for more details.
  *
- * Returns: the multicast time-to-live setting on @socket
+ * Returns: the multicast time-to-live setting on @socket
+ *
+ * Since: 2.32
+ */
+guint
+g_socket_get_multicast_ttl (GSocket *socket)
+{
+  int result;
+  guint value, optlen;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+
+  if (socket->priv->family == G_SOCKET_FAMILY_IPV4)
+    {
+      guchar optval;
+
+      optlen = sizeof (optval);
+      result = getsockopt (socket->priv->fd, IPPROTO_IP, IP_MULTICAST_TTL,
+			   &optval, &optlen);
+      value = optval;
+    }
+  else if (socket->priv->family == G_SOCKET_FAMILY_IPV6)
+    {
+      optlen = sizeof (value);
+      result = getsockopt (socket->priv->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
+			   &value, &optlen);
+    }
+  else
+    g_return_val_if_reached (FALSE);
+
+  if (result < 0)
+    {
+      int errsv = get_socket_errno ();
+      g_warning ("error getting multicast ttl: %s", socket_strerror (errsv));
+      return FALSE;
+    }
+
+  return value;
+}
+
+/**
+ * g_socket_set_multicast_ttl:
+ * @socket: a #GSocket.
+ * @ttl: the time-to-live value for all multicast datagrams on @socket
+ *
+ * Sets the time-to-live for outgoing multicast datagrams on @socket.
+ * By default, this is 1, meaning that multicast packets will not leave
+ * the local network.
+ *
+ * Since: 2.32
+ */
+void
+g_socket_set_multicast_ttl (GSocket  *socket,
+                            guint     ttl)
+{
+  int result;
+
+  g_return_if_fail (G_IS_SOCKET (socket));
+
+  if (socket->priv->family == G_SOCKET_FAMILY_IPV4)
+    {
+      guchar optval = (guchar)ttl;
+
+      result = setsockopt (socket->priv->fd, IPPROTO_IP, IP_MULTICAST_TTL,
+			   &optval, sizeof (optval));
+    }
+  else if (socket->priv->family == G_SOCKET_FAMILY_IPV6)
+    {
+      result = setsockopt (socket->priv->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
+			   &ttl, sizeof (ttl));
+    }
+  else
+    g_return_if_reached ();
+
+  if (result < 0)
+    {
+      int errsv = get_socket_errno ();
+      g_warning ("error setting multicast ttl: %s", socket_strerror (errsv));
+      return;
+    }
+
+  g_object_notify (G_OBJECT (socket), "multicast-ttl");
+}
+
+/**
+ * g_socket_get_option:
+ * @socket: a #GSocket
+ * @level: the "API level" of the option (eg, <literal>SOL_SOCKET</literal>)
+ * @optname: the "name" of the option (eg, <literal>SO_RCVBUF</literal>)
+ * @value: (out): return location for the option value
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Gets the value of an integer-valued option on @socket, as with
+ * <literal>getsockopt ()</literal>. (If you need to fetch a
+ * non-integer-valued option, you will need to call
+ * <literal>getsockopt ()</literal> directly.)
+ *
+ * The options are defined by the system headers, such as
+ * <literal>&lt;sys/socket.h&gt;</literal> and
+ * <literal>&lt;netinet/tcp.h&gt;</literal> on UNIX, which you need
+ * to include yourself.
+ *
+ * Returns: success or failure. On failure, @error will be set, and
+ *   the system error value (<literal>errno</literal> or
+ *   <literal>WSAGetLastError ()</literal>) will still be set to the
+ *   result of the <literal>getsockopt ()</literal> call.
+ *
+ * Since: 2.34
+ */
+gboolean
+g_socket_get_option (GSocket  *socket,
+		     gint      level,
+		     gint      optname,
+		     gint     *value,
+		     GError  **error)
+{
+  guint size;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+
+  *value = 0;
+  size = sizeof (gint);
+  if (getsockopt (socket->priv->fd, level, optname, value, &size) != 0)
+    {
+      int errsv = get_socket_errno ();
+
+      g_set_error_literal (error,
+			   G_IO_ERROR,
+			   socket_io_error_from_errno (errsv),
+			   socket_strerror (errsv));
+#ifndef G_OS_WIN32
+      /* Reset errno in case the caller wants to look at it */
+      errno = errsv;
+#endif
+      return FALSE;
+    }
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+  /* If the returned value is smaller than an int then we need to
+   * slide it over into the low-order bytes of *value.
+   */
+  if (size != sizeof (gint))
+    *value = *value >> (8 * (sizeof (gint) - size));
+#endif
+
+  return TRUE;
+}
+
+/**
+ * g_socket_set_option:
+ * @socket: a #GSocket
+ * @level: the "API level" of the option (eg, <literal>SOL_SOCKET</literal>)
+ * @optname: the "name" of the option (eg, <literal>SO_SNDBUF</literal>)
+ * @value: the value to set the option to
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Sets the value of an integer-valued option on @socket, as with
+ * <literal>setsockopt ()</literal>. (If you need to set a
+ * non-integer-valued option, you will need to call
+ * <literal>setsockopt ()</literal> directly.)
+ *
+ * See g_socket_get_option() for the headers defining the options.
+ *
+ * Returns: success or failure. On failure, @error will be set, and
+ *   the system error value (<literal>errno</literal> or
+ *   <literal>WSAGetLastError ()</literal>) will still be set to the
+ *   result of the <literal>setsockopt ()</literal> call.
+ *
+ * Since: 2.34
+ */
+gboolean
+g_socket_set_option (GSocket  *socket,
+		     gint      level,
+		     gint      optname,
+		     gint      value,
+		     GError  **error)
+{
+  gint errsv;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+
+  if (setsockopt (socket->priv->fd, level, optname, &value, sizeof (gint)) == 0)
+    return TRUE;
+
+#if !defined (__linux__) && !defined (G_OS_WIN32)
+  /* Linux and Windows let you set a single-byte value from an int,
+   * but most other platforms don't.
+   */
+  if (errno == EINVAL && value >= SCHAR_MIN && value <= CHAR_MAX)
+    {
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+      value = value << (8 * (sizeof (gint) - 1));
+#endif
+      if (setsockopt (socket->priv->fd, level, optname, &value, 1) == 0)
+        return TRUE;
+    }
+#endif
+
+  errsv = get_socket_errno ();
+
+  g_set_error_literal (error,
+                       G_IO_ERROR,
+                       socket_io_error_from_errno (errsv),
+                       socket_strerror (errsv));
+#ifndef G_OS_WIN32
+  errno = errsv;
+#endif
+  return FALSE;
+}
+
+/* Backends for the typed option properties; like the TTL and
+ * multicast ones above, they warn rather than fail.
+ */
+static guint
+get_uint_option (GSocket     *socket,
+		 gint         level,
+		 gint         optname,
+		 const gchar *what)
+{
+  GError *error = NULL;
+  gint value;
+
+  if (!g_socket_get_option (socket, level, optname, &value, &error))
+    {
+      g_warning ("error getting %s: %s", what, error->message);
+      g_error_free (error);
+      return 0;
+    }
+
+  return value;
+}
+
+static gboolean
+set_uint_option (GSocket     *socket,
+		 gint         level,
+		 gint         optname,
+		 guint        value,
+		 const gchar *what)
+{
+  GError *error = NULL;
+
+  if (!g_socket_set_option (socket, level, optname, (gint) value, &error))
+    {
+      g_warning ("error setting %s: %s", what, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * g_socket_get_receive_buffer_size:
+ * @socket: a #GSocket.
+ *
+ * Gets the size of the kernel's receive buffer for @socket; see
+ * g_socket_set_receive_buffer_size().
+ *
+ * Returns: the receive buffer size in bytes
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_get_receive_buffer_size (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), 0);
+
+  return get_uint_option (socket, SOL_SOCKET, SO_RCVBUF,
+			  "receive buffer size");
+}
+
+/**
+ * g_socket_set_receive_buffer_size:
+ * @socket: a #GSocket.
+ * @size: the receive buffer size in bytes
+ *
+ * Sets the size of the kernel's receive buffer for @socket
+ * (<literal>SO_RCVBUF</literal>). By default the platform adjusts it
+ * automatically; setting it turns that off. The platform may round
+ * @size, and Linux doubles it to leave room for bookkeeping, so
+ * g_socket_get_receive_buffer_size() may return a different value.
+ *
+ * For TCP, the receive buffer bounds the window the peer may send
+ * into, so it should be set before connecting or listening.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_set_receive_buffer_size (GSocket *socket,
+				  guint    size)
+{
+  g_return_if_fail (G_IS_SOCKET (socket));
+  g_return_if_fail (size <= G_MAXINT);
+
+  if (set_uint_option (socket, SOL_SOCKET, SO_RCVBUF, size,
+		       "receive buffer size"))
+    g_object_notify (G_OBJECT (socket), "receive-buffer-size");
+}
+
+/**
+ * g_socket_get_send_buffer_size:
+ * @socket: a #GSocket.
+ *
+ * Gets the size of the kernel's send buffer for @socket; see
+ * g_socket_set_send_buffer_size().
+ *
+ * Returns: the send buffer size in bytes
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_get_send_buffer_size (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), 0);
+
+  return get_uint_option (socket, SOL_SOCKET, SO_SNDBUF,
+			  "send buffer size");
+}
+
+/**
+ * g_socket_set_send_buffer_size:
+ * @socket: a #GSocket.
+ * @size: the send buffer size in bytes
+ *
+ * Sets the size of the kernel's send buffer for @socket
+ * (<literal>SO_SNDBUF</literal>). As with
+ * g_socket_set_receive_buffer_size(), this turns off the platform's
+ * automatic tuning and the value actually used may differ from @size.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_set_send_buffer_size (GSocket *socket,
+			       guint    size)
+{
+  g_return_if_fail (G_IS_SOCKET (socket));
+  g_return_if_fail (size <= G_MAXINT);
+
+  if (set_uint_option (socket, SOL_SOCKET, SO_SNDBUF, size,
+		       "send buffer size"))
+    g_object_notify (G_OBJECT (socket), "send-buffer-size");
+}
+
+/**
+ * g_socket_get_busy_poll:
+ * @socket: a #GSocket.
+ *
+ * Gets the busy-polling time of @socket; see g_socket_set_busy_poll().
+ *
+ * Returns: the busy-polling time in microseconds, or 0 if disabled
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_get_busy_poll (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), 0);
+
+#ifdef SO_BUSY_POLL
+  return get_uint_option (socket, SOL_SOCKET, SO_BUSY_POLL, "busy poll");
+#else
+  return 0;
+#endif
+}
+
+/**
+ * g_socket_set_busy_poll:
+ * @socket: a #GSocket.
+ * @usecs: the busy-polling time in microseconds, or 0 to disable
+ *
+ * Sets how long a receive on @socket may busy-wait on the network
+ * device for new packets when there is no data queued
+ * (<literal>SO_BUSY_POLL</literal>). This lowers latency at the cost
+ * of CPU time; values around 50 microseconds are typical. Raising the
+ * value above the system-wide default may require privileges.
+ *
+ * This is only supported on Linux, and does nothing elsewhere.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_set_busy_poll (GSocket *socket,
+			guint    usecs)
+{
+  g_return_if_fail (G_IS_SOCKET (socket));
+  g_return_if_fail (usecs <= G_MAXINT);
+
+#ifdef SO_BUSY_POLL
+  if (set_uint_option (socket, SOL_SOCKET, SO_BUSY_POLL, usecs, "busy poll"))
+    g_object_notify (G_OBJECT (socket), "busy-poll");
+#endif
+}
+
+/**
+ * g_socket_get_notsent_lowat:
+ * @socket: a #GSocket.
+ *
+ * Gets the unsent data low water mark of @socket; see
+ * g_socket_set_notsent_lowat().
+ *
+ * Returns: the low water mark in bytes
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_get_notsent_lowat (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), 0);
+
+#ifdef TCP_NOTSENT_LOWAT
+  return get_uint_option (socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+			  "notsent lowat");
+#else
+  return G_MAXUINT;
+#endif
+}
+
+/**
+ * g_socket_set_notsent_lowat:
+ * @socket: a #GSocket.
+ * @lowat: the low water mark in bytes
+ *
+ * Sets the amount of data in @socket's send buffer that has not been
+ * sent yet above which the socket stops polling as writable
+ * (<literal>TCP_NOTSENT_LOWAT</literal>). Keeping this low keeps data
+ * in the application, where it can still be reordered or replaced,
+ * rather than queued behind a large send buffer, which helps
+ * latency-sensitive senders such as HTTP/2 multiplexers.
  *
- * Since: 2.32
+ * This is only supported for TCP sockets on Linux and Darwin, and does
+ * nothing elsewhere.
+ *
+ * Since: 2.34
  */
-guint
-g_socket_get_multicast_ttl (GSocket *socket)
+void
+g_socket_set_notsent_lowat (GSocket *socket,
+			    guint    lowat)
 {
-  int result;
-  guint value, optlen;
+  g_return_if_fail (G_IS_SOCKET (socket));
 
-  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+#ifdef TCP_NOTSENT_LOWAT
+  if (set_uint_option (socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, lowat,
+		       "notsent lowat"))
+    g_object_notify (G_OBJECT (socket), "notsent-lowat");
+#endif
+}
 
-  if (socket->priv->family == G_SOCKET_FAMILY_IPV4)
-    {
-      guchar optval;
+/* Applies the fast-open setting of a TCP socket that is about to
+ * connect, or that is listening or about to. Failures are ignored:
+ * the socket then just does a regular handshake.
+ */
+static void
+socket_apply_fast_open (GSocket  *socket,
+			gboolean  listening)
+{
+  int value;
 
-      optlen = sizeof (optval);
-      result = getsockopt (socket->priv->fd, IPPROTO_IP, IP_MULTICAST_TTL,
-			   &optval, &optlen);
-      value = optval;
-    }
-  else if (socket->priv->family == G_SOCKET_FAMILY_IPV6)
+  if (socket->priv->type != G_SOCKET_TYPE_STREAM ||
+      (socket->priv->family != G_SOCKET_FAMILY_IPV4 &&
+       socket->priv->family != G_SOCKET_FAMILY_IPV6))
+    return;
+
+  if (listening)
     {
-      optlen = sizeof (value);
-      result = getsockopt (socket->priv->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
-			   &value, &optlen);
+#ifdef TCP_FASTOPEN
+      /* The value is the number of pending fast-open requests */
+      value = socket->priv->fast_open ? MAX (socket->priv->listen_backlog, 1) : 0;
+      setsockopt (socket->priv->fd, IPPROTO_TCP, TCP_FASTOPEN,
+		  (gpointer) &value, sizeof (value));
+#endif
     }
   else
-    g_return_val_if_reached (FALSE);
-
-  if (result < 0)
     {
-      int errsv = get_socket_errno ();
-      g_warning ("error getting multicast ttl: %s", socket_strerror (errsv));
-      return FALSE;
+#ifdef TCP_FASTOPEN_CONNECT
+      value = socket->priv->fast_open;
+      setsockopt (socket->priv->fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+		  (gpointer) &value, sizeof (value));
+#endif
     }
-
-  return value;
 }
 
 /**
- * g_socket_set_multicast_ttl:
+ * g_socket_set_fast_open:
  * @socket: a #GSocket.
- * @ttl: the time-to-live value for all multicast datagrams on @socket
- *
- * Sets the time-to-live for outgoing multicast datagrams on @socket.
- * By default, this is 1, meaning that multicast packets will not leave
- * the local network.
- *
- * Since: 2.32
+ * @fast_open: whether to use TCP Fast Open
+ *
+ * Sets whether @socket uses TCP Fast Open (RFC 7413), which saves a
+ * round trip when connecting to a server that was contacted before.
+ *
+ * On a listening socket, this lets clients send data along with their
+ * SYN, which is handed to the application right away. On a socket that
+ * connects, g_socket_connect() returns immediately without doing the
+ * handshake, and the handshake is only started by the first
+ * g_socket_send(), whose data goes out with the SYN if the server is
+ * known to support it. This means that connection errors are only
+ * reported by that first send, and that it only makes sense for
+ * protocols where the client speaks first: a client that waits for the
+ * server to talk would never connect.
+ *
+ * This must be set before connecting. It is only supported for TCP
+ * sockets on Linux, and needs to be enabled system-wide through the
+ * <literal>net.ipv4.tcp_fastopen</literal> sysctl; otherwise sockets
+ * silently use a regular handshake.
+ *
+ * Since: 2.34
  */
 void
-g_socket_set_multicast_ttl (GSocket  *socket,
-                            guint     ttl)
+g_socket_set_fast_open (GSocket  *socket,
+			gboolean  fast_open)
 {
-  int result;
-
   g_return_if_fail (G_IS_SOCKET (socket));
 
-  if (socket->priv->family == G_SOCKET_FAMILY_IPV4)
-    {
-      guchar optval = (guchar)ttl;
+  fast_open = !!fast_open;
+  if (socket->priv->fast_open == fast_open)
+    return;
 
-      result = setsockopt (socket->priv->fd, IPPROTO_IP, IP_MULTICAST_TTL,
-			   &optval, sizeof (optval));
-    }
-  else if (socket->priv->family == G_SOCKET_FAMILY_IPV6)
-    {
-      result = setsockopt (socket->priv->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS,
-			   &ttl, sizeof (ttl));
-    }
-  else
-    g_return_if_reached ();
+  socket->priv->fast_open = fast_open;
+  if (socket->priv->listening)
+    socket_apply_fast_open (socket, TRUE);
 
-  if (result < 0)
-    {
-      int errsv = get_socket_errno ();
-      g_warning ("error setting multicast ttl: %s", socket_strerror (errsv));
-      return;
-    }
+  g_object_notify (G_OBJECT (socket), "fast-open");
+}
 
-  g_object_notify (G_OBJECT (socket), "multicast-ttl");
+/**
+ * g_socket_get_fast_open:
+ * @socket: a #GSocket.
+ *
+ * Gets whether @socket uses TCP Fast Open. For details, see
+ * g_socket_set_fast_open().
+ *
+ * Returns: %TRUE if fast open is enabled, %FALSE otherwise.
+ *
+ * Since: 2.34
+ */
+gboolean
+g_socket_get_fast_open (GSocket *socket)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+
+  return socket->priv->fast_open;
 }
 
 /**
@@ -1816,6 +2740,9 @@ g_socket_listen (GSocket  *socket,
   if (!check_socket (socket, error))
     return FALSE;
 
+  if (socket->priv->fast_open)
+    socket_apply_fast_open (socket, TRUE);
+
   if (listen (socket->priv->fd, socket->priv->listen_backlog) < 0)
     {
       int errsv = get_socket_errno ();
@@ -2104,6 +3031,11 @@ g_socket_speaks_ipv4 (GSocket *socket)
     }
 }
 
+#ifdef HAVE_ACCEPT4
+/* Set when the kernel turns out not to implement accept4() */
+static gboolean accept4_unsupported;
+#endif
+
 /**
  * g_socket_accept:
  * @socket: a #GSocket.
@@ -2132,6 +3064,7 @@ g_socket_accept (GSocket       *socket,
 		 GError       **error)
 {
   GSocket *new_socket;
+  gboolean flags_set = FALSE;
   gint ret;
 
   g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
@@ -2146,7 +3079,27 @@ g_socket_accept (GSocket       *socket,
 				    G_IO_IN, cancellable, error))
 	return NULL;
 
-      if ((ret = accept (socket->priv->fd, NULL, 0)) < 0)
+#ifdef HAVE_ACCEPT4
+      /* Get the new socket close-on-exec (and non-blocking) atomically,
+       * so it can't leak into a child spawned by another thread, and
+       * without the extra fcntl() calls below.
+       */
+      if (!accept4_unsupported)
+	{
+	  ret = accept4 (socket->priv->fd, NULL, 0,
+			 SOCK_NONBLOCK | SOCK_CLOEXEC);
+	  if (ret < 0 && errno == ENOSYS)
+	    {
+	      accept4_unsupported = TRUE;
+	      continue;
+	    }
+	  flags_set = ret >= 0;
+	}
+      else
+#endif
+	ret = accept (socket->priv->fd, NULL, 0);
+
+      if (ret < 0)
 	{
 	  int errsv = get_socket_errno ();
 
@@ -2190,12 +3143,15 @@ g_socket_accept (GSocket       *socket,
     /* We always want to set close-on-exec to protect users. If you
        need to so some weird inheritance to exec you can re-enable this
        using lower level hacks with g_socket_get_fd(). */
-    flags = fcntl (ret, F_GETFD, 0);
-    if (flags != -1 &&
-	(flags & FD_CLOEXEC) == 0)
+    if (!flags_set)
       {
-	flags |= FD_CLOEXEC;
-	fcntl (ret, F_SETFD, flags);
+	flags = fcntl (ret, F_GETFD, 0);
+	if (flags != -1 &&
+	    (flags & FD_CLOEXEC) == 0)
+	  {
+	    flags |= FD_CLOEXEC;
+	    fcntl (ret, F_SETFD, flags);
+	  }
       }
   }
 #endif
@@ -2263,6 +3219,9 @@ g_socket_connect (GSocket         *socket,
     g_object_unref (socket->priv->remote_address);
   socket->priv->remote_address = g_object_ref (address);
 
+  if (socket->priv->fast_open)
+    socket_apply_fast_open (socket, FALSE);
+
   while (1)
     {
       if (connect (socket->priv->fd, (struct sockaddr *) &buffer,
@@ -2445,6 +3404,49 @@ g_socket_receive (GSocket       *socket,
 					 cancellable, error);
 }
 
+/**
+ * g_socket_receive_bytes:
+ * @socket: a #GSocket
+ * @size: the maximum number of bytes to receive
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Receives up to @size bytes from @socket like g_socket_receive(),
+ * but returns them as a #GBytes rather than copying them into a
+ * caller-supplied buffer.
+ *
+ * The data is received directly into memory taken from a pool of
+ * recycled buffers shared by the thread, so the returned #GBytes, or
+ * slices of it made with g_bytes_new_from_bytes(), can be kept
+ * around without copying. Note that as long as it is alive it keeps
+ * a larger block of memory in use; copy the data if it is going to
+ * be kept for a long time.
+ *
+ * Returns: (transfer full): a new #GBytes, which is empty if the
+ *   connection was closed by the peer, or %NULL on error
+ *
+ * Since: 2.34
+ */
+GBytes *
+g_socket_receive_bytes (GSocket       *socket,
+			gsize          size,
+			GCancellable  *cancellable,
+			GError       **error)
+{
+  GBufferPoolSlab *slab;
+  gpointer buffer;
+  gssize ret;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
+
+  buffer = _g_buffer_pool_reserve (size, &slab);
+  ret = g_socket_receive_with_blocking (socket, buffer, size,
+					socket->priv->blocking,
+					cancellable, error);
+
+  return _g_buffer_pool_commit (slab, buffer, size, ret);
+}
+
 /**
  * g_socket_receive_with_blocking:
  * @socket: a #GSocket
@@ -2579,6 +3581,88 @@ g_socket_receive_from (GSocket         *socket,
 #define G_SOCKET_DEFAULT_SEND_FLAGS 0
 #endif
 
+/* If @flags contains MSG_ZEROCOPY and the kernel runs out of memory
+ * for tracking the pinned pages, it is removed and the data is copied
+ * instead.
+ */
+static gssize
+socket_send (GSocket       *socket,
+	     const gchar   *buffer,
+	     gsize          size,
+	     gint          *flags,
+	     gboolean       blocking,
+	     GCancellable  *cancellable,
+	     GError       **error)
+{
+  gssize ret;
+
+  if (!check_socket (socket, error))
+    return -1;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  while (1)
+    {
+      if (blocking &&
+	  !g_socket_condition_wait (socket,
+				    G_IO_OUT, cancellable, error))
+	return -1;
+
+      if ((ret = send (socket->priv->fd, buffer, size, *flags)) < 0)
+	{
+	  int errsv = get_socket_errno ();
+
+	  if (errsv == EINTR)
+	    continue;
+
+#ifdef USE_ZEROCOPY
+	  /* Out of memory for pinning pages: copy from now on */
+	  if (errsv == ENOBUFS && (*flags & MSG_ZEROCOPY))
+	    {
+	      socket->priv->zerocopy_copied = TRUE;
+	      *flags &= ~MSG_ZEROCOPY;
+	      continue;
+	    }
+#endif
+
+#ifdef TCP_FASTOPEN_CONNECT
+	  /* The first send on a fast-open socket starts the handshake;
+	   * if the data could not go out with the SYN, wait for the
+	   * connection as for a full buffer.
+	   */
+	  if (errsv == EINPROGRESS && socket->priv->fast_open)
+	    errsv = EWOULDBLOCK;
+#endif
+
+#ifdef WSAEWOULDBLOCK
+	  if (errsv == WSAEWOULDBLOCK)
+	    win32_unset_event_mask (socket, FD_WRITE);
+#endif
+
+	  if (blocking)
+	    {
+#ifdef WSAEWOULDBLOCK
+	      if (errsv == WSAEWOULDBLOCK)
+		continue;
+#else
+	      if (errsv == EWOULDBLOCK ||
+		  errsv == EAGAIN)
+		continue;
+#endif
+	    }
+
+	  g_set_error (error, G_IO_ERROR,
+		       socket_io_error_from_errno (errsv),
+		       _("Error sending data: %s"), socket_strerror (errsv));
+	  return -1;
+	}
+      break;
+    }
+
+  return ret;
+}
+
 /**
  * g_socket_send:
  * @socket: a #GSocket
@@ -2647,56 +3731,110 @@ g_socket_send_with_blocking (GSocket       *socket,
 			     GCancellable  *cancellable,
 			     GError       **error)
 {
-  gssize ret;
+  gint flags = G_SOCKET_DEFAULT_SEND_FLAGS;
 
   g_return_val_if_fail (G_IS_SOCKET (socket) && buffer != NULL, -1);
 
-  if (!check_socket (socket, error))
-    return -1;
+  return socket_send (socket, buffer, size, &flags,
+		      blocking, cancellable, error);
+}
 
-  if (g_cancellable_set_error_if_cancelled (cancellable, error))
-    return -1;
+/**
+ * g_socket_send_bytes:
+ * @socket: a #GSocket
+ * @bytes: the data to send
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Tries to send the contents of @bytes on the socket, like
+ * g_socket_send().
+ *
+ * If #GSocket:zerocopy is enabled and @bytes is large enough for it
+ * to pay off, the kernel sends the data straight from the memory of
+ * @bytes instead of copying it first. The socket then keeps a
+ * reference on @bytes until the kernel reports that it is done with
+ * it, so @bytes must not be modified afterwards; #GBytes are
+ * immutable, so this only matters for memory that is shared with
+ * something else.
+ *
+ * Returns: Number of bytes written (which may be less than the size
+ * of @bytes), or -1 on error
+ *
+ * Since: 2.34
+ */
+gssize
+g_socket_send_bytes (GSocket       *socket,
+		     GBytes        *bytes,
+		     GCancellable  *cancellable,
+		     GError       **error)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+  g_return_val_if_fail (bytes != NULL, -1);
 
-  while (1)
-    {
-      if (blocking &&
-	  !g_socket_condition_wait (socket,
-				    G_IO_OUT, cancellable, error))
-	return -1;
+  return _g_socket_send_bytes_with_blocking (socket, bytes,
+					     socket->priv->blocking,
+					     cancellable, error);
+}
 
-      if ((ret = send (socket->priv->fd, buffer, size, G_SOCKET_DEFAULT_SEND_FLAGS)) < 0)
-	{
-	  int errsv = get_socket_errno ();
+gssize
+_g_socket_send_bytes_with_blocking (GSocket       *socket,
+				    GBytes        *bytes,
+				    gboolean       blocking,
+				    GCancellable  *cancellable,
+				    GError       **error)
+{
+  gconstpointer data;
+  gsize size;
+  gint flags = G_SOCKET_DEFAULT_SEND_FLAGS;
+#ifdef USE_ZEROCOPY
+  ZerocopyBuffer *buffer;
+  gssize ret;
+#endif
 
-	  if (errsv == EINTR)
-	    continue;
+  data = g_bytes_get_data (bytes, &size);
+  if (data == NULL)
+    data = "";
 
-#ifdef WSAEWOULDBLOCK
-	  if (errsv == WSAEWOULDBLOCK)
-	    win32_unset_event_mask (socket, FD_WRITE);
-#endif
+#ifdef USE_ZEROCOPY
+  if (socket->priv->zerocopy && !socket->priv->zerocopy_copied &&
+      size >= ZEROCOPY_MIN_SIZE)
+    {
+      /* Queue the buffer before sending, since its completion may be
+       * reaped by another thread as soon as send() returns.
+       */
+      buffer = g_slice_new (ZerocopyBuffer);
+      buffer->id = socket->priv->zerocopy_next_id;
+      buffer->bytes = g_bytes_ref (bytes);
 
-	  if (blocking)
-	    {
-#ifdef WSAEWOULDBLOCK
-	      if (errsv == WSAEWOULDBLOCK)
-		continue;
-#else
-	      if (errsv == EWOULDBLOCK ||
-		  errsv == EAGAIN)
-		continue;
-#endif
-	    }
+      g_mutex_lock (&socket->priv->zerocopy_lock);
+      g_queue_push_tail (&socket->priv->zerocopy_pending, buffer);
+      g_mutex_unlock (&socket->priv->zerocopy_lock);
 
-	  g_set_error (error, G_IO_ERROR,
-		       socket_io_error_from_errno (errsv),
-		       _("Error sending data: %s"), socket_strerror (errsv));
-	  return -1;
+      flags |= MSG_ZEROCOPY;
+      ret = socket_send (socket, data, size, &flags,
+			 blocking, cancellable, error);
+
+      if (ret >= 0 && (flags & MSG_ZEROCOPY))
+	socket->priv->zerocopy_next_id++;
+      else
+	{
+	  g_mutex_lock (&socket->priv->zerocopy_lock);
+	  g_queue_remove (&socket->priv->zerocopy_pending, buffer);
+	  g_mutex_unlock (&socket->priv->zerocopy_lock);
+
+	  g_bytes_unref (buffer->bytes);
+	  g_slice_free (ZerocopyBuffer, buffer);
 	}
-      break;
+
+      /* Don't let completions pile up on sockets nobody waits on */
+      zerocopy_reap (socket);
+
+      return ret;
     }
+#endif
 
-  return ret;
+  return socket_send (socket, data, size, &flags,
+		      blocking, cancellable, error);
 }
 
 /**
@@ -2867,6 +4005,10 @@ g_socket_close (GSocket  *socket,
   if (!check_socket (socket, error))
     return FALSE;
 
+#ifdef USE_ZEROCOPY
+  zerocopy_drain (socket);
+#endif
+
   while (1)
     {
 #ifdef G_OS_WIN32
@@ -2898,6 +4040,10 @@ g_socket_close (GSocket  *socket,
       socket->priv->remote_address = NULL;
     }
 
+#ifdef USE_ZEROCOPY
+  zerocopy_abandon (socket);
+#endif
+
   return TRUE;
 }
 
@@ -3165,6 +4311,15 @@ socket_source_dispatch (GSource     *source,
   if (socket_source->socket->priv->timed_out)
     socket_source->pollfd.revents |= socket_source->condition & (G_IO_IN | G_IO_OUT);
 
+#ifdef USE_ZEROCOPY
+  if ((socket_source->pollfd.revents & G_IO_ERR) && zerocopy_reap (socket))
+    {
+      socket_source->pollfd.revents &= ~G_IO_ERR;
+      if ((socket_source->pollfd.revents & socket_source->condition) == 0)
+	return TRUE;
+    }
+#endif
+
   ret = (*func) (socket,
 		 socket_source->pollfd.revents & socket_source->condition,
 		 user_data);
@@ -3389,7 +4544,15 @@ g_socket_condition_check (GSocket      *socket,
 
     do
       result = g_poll (&poll_fd, 1, 0);
-    while (result == -1 && get_socket_errno () == EINTR);
+    while ((result == -1 && get_socket_errno () == EINTR)
+#ifdef USE_ZEROCOPY
+	   /* Completions of zero-copy sends show up as G_IO_ERR; look
+	    * again once they are collected, in case that was all it was.
+	    */
+	   || (result > 0 && (poll_fd.revents & G_IO_ERR) &&
+	       zerocopy_reap (socket))
+#endif
+	   );
 
     return poll_fd.revents;
   }
@@ -3535,7 +4698,10 @@ g_socket_condition_timed_wait (GSocket       *socket,
 
 	if (timeout != WSA_INFINITE)
 	  {
-	    timeout -= (g_get_monotonic_time () - start_time) * 1000;
+	    gint64 now = g_get_monotonic_time ();
+
+	    timeout -= (now - start_time) / 1000;
+	    start_time = now;
 	    if (timeout < 0)
 	      timeout = 0;
 	  }
@@ -3562,12 +4728,27 @@ g_socket_condition_timed_wait (GSocket       *socket,
     while (TRUE)
       {
 	result = g_poll (poll_fd, num, timeout);
+
+#ifdef USE_ZEROCOPY
+	/* Completions of zero-copy sends show up as G_IO_ERR; keep
+	 * waiting if that is all that happened.
+	 */
+	if (result > 0 && (poll_fd[0].revents & G_IO_ERR) &&
+	    !(poll_fd[0].revents & condition & ~G_IO_ERR) &&
+	    (num == 1 || !poll_fd[1].revents) &&
+	    zerocopy_reap (socket))
+	  result = -1;
+	else
+#endif
 	if (result != -1 || errno != EINTR)
 	  break;
 
 	if (timeout != -1)
 	  {
-	    timeout -= (g_get_monotonic_time () - start_time) * 1000;
+	    gint64 now = g_get_monotonic_time ();
+
+	    timeout -= (now - start_time) / 1000;
+	    start_time = now;
 	    if (timeout < 0)
 	      timeout = 0;
 	  }
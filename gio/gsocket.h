@@ -94,6 +94,11 @@ gboolean               g_socket_get_blocking            (GSocket
 void                   g_socket_set_keepalive           (GSocket                 *socket,
 							 gboolean                 keepalive);
 gboolean               g_socket_get_keepalive           (GSocket                 *socket);
+void                   g_socket_set_zerocopy            (GSocket                 *socket,
+							 gboolean                 zerocopy);
+gboolean               g_socket_get_zerocopy            (GSocket                 *socket);
+void                   g_socket_cork                    (GSocket                 *socket);
+void                   g_socket_uncork                  (GSocket                 *socket);
 gint                   g_socket_get_listen_backlog      (GSocket                 *socket);
 void                   g_socket_set_listen_backlog      (GSocket                 *socket,
 							 gint                     backlog);
@@ -123,6 +128,32 @@ guint                  g_socket_get_multicast_ttl       (GSocket
 GLIB_AVAILABLE_IN_2_32
 void                   g_socket_set_multicast_ttl       (GSocket                 *socket,
                                                          guint                    ttl);
+
+gboolean               g_socket_get_option              (GSocket                 *socket,
+							 gint                     level,
+							 gint                     optname,
+							 gint                    *value,
+							 GError                 **error);
+gboolean               g_socket_set_option              (GSocket                 *socket,
+							 gint                     level,
+							 gint                     optname,
+							 gint                     value,
+							 GError                 **error);
+guint                  g_socket_get_receive_buffer_size (GSocket                 *socket);
+void                   g_socket_set_receive_buffer_size (GSocket                 *socket,
+							 guint                    size);
+guint                  g_socket_get_send_buffer_size    (GSocket                 *socket);
+void                   g_socket_set_send_buffer_size    (GSocket                 *socket,
+							 guint                    size);
+guint                  g_socket_get_busy_poll           (GSocket                 *socket);
+void                   g_socket_set_busy_poll           (GSocket                 *socket,
+							 guint                    usecs);
+guint                  g_socket_get_notsent_lowat       (GSocket                 *socket);
+void                   g_socket_set_notsent_lowat       (GSocket                 *socket,
+							 guint                    lowat);
+gboolean               g_socket_get_fast_open           (GSocket                 *socket);
+void                   g_socket_set_fast_open           (GSocket                 *socket,
+							 gboolean                 fast_open);
 gboolean               g_socket_is_connected            (GSocket                 *socket);
 gboolean               g_socket_bind                    (GSocket                 *socket,
 							 GSocketAddress          *address,
@@ -171,6 +202,10 @@ gssize                 g_socket_receive                 (GSocket
 							 gsize                    size,
 							 GCancellable            *cancellable,
 							 GError                 **error);
+GBytes *               g_socket_receive_bytes           (GSocket                 *socket,
+							 gsize                    size,
+							 GCancellable            *cancellable,
+							 GError                 **error);
 gssize                 g_socket_receive_from            (GSocket                 *socket,
 							 GSocketAddress         **address,
 							 gchar                   *buffer,
@@ -182,6 +217,10 @@ gssize                 g_socket_send                    (GSocket
 							 gsize                    size,
 							 GCancellable            *cancellable,
 							 GError                 **error);
+gssize                 g_socket_send_bytes              (GSocket                 *socket,
+							 GBytes                  *bytes,
+							 GCancellable            *cancellable,
+							 GError                 **error);
 gssize                 g_socket_send_to                 (GSocket                 *socket,
 							 GSocketAddress          *address,
 							 const gchar             *buffer,
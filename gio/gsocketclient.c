@@ -69,6 +69,9 @@
  *
  * As #GSocketClient is a lightweight object, you don't need to cache it. You
  * can just create a new one any time you need one.
+ * The exception is when you want connections to be reused (see
+ * g_socket_client_set_pool_max_connections()), as each client keeps
+ * its own pool of idle connections.
  *
  * Since: 2.22
  */
@@ -94,9 +97,16 @@ enum
   PROP_TIMEOUT,
   PROP_ENABLE_PROXY,
   PROP_TLS,
-  PROP_TLS_VALIDATION_FLAGS
+  PROP_TLS_VALIDATION_FLAGS,
+  PROP_CONNECTION_ATTEMPT_DELAY,
+  PROP_POOL_MAX_CONNECTIONS,
+  PROP_POOL_IDLE_TIMEOUT,
+  PROP_FAST_OPEN
 };
 
+/* The "Connection Attempt Delay" recommended by RFC 8305 */
+#define DEFAULT_CONNECTION_ATTEMPT_DELAY 250
+
 struct _GSocketClientPrivate
 {
   GSocketFamily family;
@@ -108,6 +118,14 @@ struct _GSocketClientPrivate
   GHashTable *app_proxies;
   gboolean tls;
   GTlsCertificateFlags tls_validation_flags;
+  guint connection_attempt_delay;
+  gboolean fast_open;
+
+  /* Idle connections, by pool_key_for_connectable() */
+  guint pool_max_connections;
+  guint pool_idle_timeout;
+  GMutex pool_lock;
+  GHashTable *pool;
 };
 
 static GSocket *
@@ -147,6 +165,9 @@ create_socket (GSocketClient  *client,
   if (client->priv->timeout)
     g_socket_set_timeout (socket, client->priv->timeout);
 
+  if (client->priv->fast_open)
+    g_socket_set_fast_open (socket, TRUE);
+
   return socket;
 }
 
@@ -193,6 +214,177 @@ clarify_connect_error (GError             *error,
   g_free (tmp_name);
 }
 
+typedef struct
+{
+  GSocketConnection *connection;
+  gint64 idle_since;
+} PooledConnection;
+
+static GQuark pool_key_quark;
+
+static void
+pooled_connection_free (gpointer data)
+{
+  PooledConnection *pooled = data;
+
+  g_io_stream_close (G_IO_STREAM (pooled->connection), NULL, NULL);
+  g_object_unref (pooled->connection);
+  g_slice_free (PooledConnection, pooled);
+}
+
+static void
+pool_queue_free (gpointer data)
+{
+  g_queue_free_full (data, pooled_connection_free);
+}
+
+/* Returns the key under which connections made by @client to
+ * @connectable are pooled, or %NULL if they can't be pooled.
+ */
+static gchar *
+pool_key_for_connectable (GSocketClient      *client,
+			  GSocketConnectable *connectable)
+{
+  GSocketClientPrivate *priv = client->priv;
+  gchar *destination, *key;
+
+  if (priv->pool_max_connections == 0 || priv->local_address != NULL)
+    return NULL;
+
+  if (G_IS_NETWORK_ADDRESS (connectable))
+    {
+      GNetworkAddress *addr = G_NETWORK_ADDRESS (connectable);
+
+      destination = g_strdup_printf ("%s:%u",
+				     g_network_address_get_hostname (addr),
+				     g_network_address_get_port (addr));
+    }
+  else if (G_IS_NETWORK_SERVICE (connectable))
+    {
+      GNetworkService *srv = G_NETWORK_SERVICE (connectable);
+
+      destination = g_strdup_printf ("_%s._%s.%s",
+				     g_network_service_get_service (srv),
+				     g_network_service_get_protocol (srv),
+				     g_network_service_get_domain (srv));
+    }
+  else if (G_IS_INET_SOCKET_ADDRESS (connectable) &&
+	   !G_IS_PROXY_ADDRESS (connectable))
+    {
+      GInetSocketAddress *isaddr = G_INET_SOCKET_ADDRESS (connectable);
+      gchar *address;
+
+      address = g_inet_address_to_string (g_inet_socket_address_get_address (isaddr));
+      destination = g_strdup_printf ("[%s]:%u", address,
+				     g_inet_socket_address_get_port (isaddr));
+      g_free (address);
+    }
+  else
+    return NULL;
+
+  key = g_strdup_printf ("%d/%d/%d %s tls=%d/%u proxy=%d",
+			 priv->family, priv->type, priv->protocol,
+			 destination, priv->tls, priv->tls_validation_flags,
+			 priv->enable_proxy);
+  g_free (destination);
+
+  return key;
+}
+
+/* Checks that an idle connection is still good for another request:
+ * nothing should be readable on it, so if it polls readable the peer
+ * has closed it (or sent data nobody is going to read).
+ */
+static gboolean
+pooled_connection_is_usable (GSocketConnection *connection)
+{
+  GSocket *socket;
+
+  if (g_io_stream_is_closed (G_IO_STREAM (connection)) ||
+      g_io_stream_has_pending (G_IO_STREAM (connection)))
+    return FALSE;
+
+  socket = g_socket_connection_get_socket (connection);
+  if (!g_socket_is_connected (socket))
+    return FALSE;
+
+  return g_socket_condition_check (socket, G_IO_IN | G_IO_ERR | G_IO_HUP) == 0;
+}
+
+static gboolean
+pooled_connection_is_expired (GSocketClient    *client,
+			      PooledConnection *pooled,
+			      gint64            now)
+{
+  guint timeout = client->priv->pool_idle_timeout;
+
+  return timeout != 0 && now - pooled->idle_since > timeout * G_TIME_SPAN_SECOND;
+}
+
+/* Takes the most recently released usable connection for @key out
+ * of the pool, dropping any stale ones found on the way.
+ */
+static GSocketConnection *
+g_socket_client_pool_take (GSocketClient *client,
+			   const gchar   *key)
+{
+  GSocketClientPrivate *priv = client->priv;
+  GSocketConnection *connection = NULL;
+  PooledConnection *pooled;
+  GSList *stale = NULL;
+  GQueue *idle;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&priv->pool_lock);
+  idle = g_hash_table_lookup (priv->pool, key);
+  while (idle != NULL && (pooled = g_queue_pop_head (idle)) != NULL)
+    {
+      if (pooled_connection_is_expired (client, pooled, now) ||
+	  !pooled_connection_is_usable (pooled->connection))
+	{
+	  stale = g_slist_prepend (stale, pooled);
+	  continue;
+	}
+
+      connection = pooled->connection;
+      g_slice_free (PooledConnection, pooled);
+      break;
+    }
+  if (idle != NULL && g_queue_is_empty (idle))
+    g_hash_table_remove (priv->pool, key);
+  g_mutex_unlock (&priv->pool_lock);
+
+  g_slist_free_full (stale, pooled_connection_free);
+
+  return connection;
+}
+
+/* Marks @connection as poolable under @key */
+static void
+g_socket_client_pool_tag (GSocketConnection *connection,
+			  const gchar       *key)
+{
+  g_object_set_qdata_full (G_OBJECT (connection), pool_key_quark,
+			   g_strdup (key), g_free);
+}
+
+static void
+g_socket_client_pool_clear (GSocketClient *client)
+{
+  GSocketClientPrivate *priv = client->priv;
+  GHashTable *pool;
+
+  g_mutex_lock (&priv->pool_lock);
+  pool = priv->pool;
+  priv->pool = g_hash_table_new_full (g_str_hash, g_str_equal,
+				      g_free, pool_queue_free);
+  g_mutex_unlock (&priv->pool_lock);
+
+  g_hash_table_unref (pool);
+}
+
 static void
 g_socket_client_init (GSocketClient *client)
 {
@@ -204,6 +396,9 @@ g_socket_client_init (GSocketClient *client)
 						     g_str_equal,
 						     g_free,
 						     NULL);
+  g_mutex_init (&client->priv->pool_lock);
+  client->priv->pool = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, pool_queue_free);
 }
 
 /**
@@ -234,6 +429,8 @@ g_socket_client_finalize (GObject *object)
     (*G_OBJECT_CLASS (g_socket_client_parent_class)->finalize) (object);
 
   g_hash_table_unref (client->priv->app_proxies);
+  g_hash_table_unref (client->priv->pool);
+  g_mutex_clear (&client->priv->pool_lock);
 }
 
 static void
@@ -278,6 +475,22 @@ g_socket_client_get_property (GObject    *object,
 	g_value_set_flags (value, g_socket_client_get_tls_validation_flags (client));
 	break;
 
+      case PROP_CONNECTION_ATTEMPT_DELAY:
+	g_value_set_uint (value, client->priv->connection_attempt_delay);
+	break;
+
+      case PROP_POOL_MAX_CONNECTIONS:
+	g_value_set_uint (value, client->priv->pool_max_connections);
+	break;
+
+      case PROP_POOL_IDLE_TIMEOUT:
+	g_value_set_uint (value, client->priv->pool_idle_timeout);
+	break;
+
+      case PROP_FAST_OPEN:
+	g_value_set_boolean (value, client->priv->fast_open);
+	break;
+
       default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -325,6 +538,22 @@ g_socket_client_set_property (GObject      *object,
       g_socket_client_set_tls_validation_flags (client, g_value_get_flags (value));
       break;
 
+    case PROP_CONNECTION_ATTEMPT_DELAY:
+      g_socket_client_set_connection_attempt_delay (client, g_value_get_uint (value));
+      break;
+
+    case PROP_POOL_MAX_CONNECTIONS:
+      g_socket_client_set_pool_max_connections (client, g_value_get_uint (value));
+      break;
+
+    case PROP_POOL_IDLE_TIMEOUT:
+      g_socket_client_set_pool_idle_timeout (client, g_value_get_uint (value));
+      break;
+
+    case PROP_FAST_OPEN:
+      g_socket_client_set_fast_open (client, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -686,11 +915,274 @@ g_socket_client_set_tls_validation_flags (GSocketClient        *client,
     }
 }
 
+/**
+ * g_socket_client_get_connection_attempt_delay:
+ * @client: a #GSocketClient.
+ *
+ * Gets the delay between staggered connection attempts made by
+ * @client. See g_socket_client_set_connection_attempt_delay() for
+ * details.
+ *
+ * Returns: the delay in milliseconds, or 0 if connection attempts
+ *     are made one at a time
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_client_get_connection_attempt_delay (GSocketClient *client)
+{
+  return client->priv->connection_attempt_delay;
+}
+
+/**
+ * g_socket_client_set_connection_attempt_delay:
+ * @client: a #GSocketClient.
+ * @delay: the delay in milliseconds, or 0
+ *
+ * Sets how long @client waits for a connection attempt to succeed
+ * before starting a parallel attempt to the next address, as
+ * described in RFC 8305 ("Happy Eyeballs"). Addresses are tried
+ * alternating between address families, the first attempt to
+ * connect wins, and all the others are cancelled. An attempt that
+ * fails causes the next one to be started immediately.
+ *
+ * If @delay is 0, each address is only tried once the previous
+ * attempt has failed, in the order the #GSocketConnectable returned
+ * them. The default is 250 milliseconds.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_client_set_connection_attempt_delay (GSocketClient *client,
+					      guint          delay)
+{
+  if (client->priv->connection_attempt_delay == delay)
+    return;
+
+  client->priv->connection_attempt_delay = delay;
+  g_object_notify (G_OBJECT (client), "connection-attempt-delay");
+}
+
+/**
+ * g_socket_client_get_pool_max_connections:
+ * @client: a #GSocketClient.
+ *
+ * Gets the maximum number of idle connections @client keeps for
+ * each destination. See g_socket_client_set_pool_max_connections()
+ * for details.
+ *
+ * Returns: the maximum number of idle connections per destination,
+ *     or 0 if connections are not pooled
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_client_get_pool_max_connections (GSocketClient *client)
+{
+  return client->priv->pool_max_connections;
+}
+
+/**
+ * g_socket_client_set_pool_max_connections:
+ * @client: a #GSocketClient.
+ * @max_connections: the maximum number of idle connections per
+ *     destination, or 0
+ *
+ * Enables pooling of idle connections. Once @max_connections is
+ * non-zero, connections that are handed back with
+ * g_socket_client_release_connection() are kept open, and a later
+ * g_socket_client_connect() (or any of its variants) to the same
+ * destination with the same socket, TLS and proxy settings returns
+ * one of them instead of resolving the destination and connecting
+ * (and doing the TLS handshake) again.
+ *
+ * At most @max_connections idle connections are kept for each
+ * destination; the oldest ones are closed to make room. Connections
+ * are not pooled when a local address is set with
+ * g_socket_client_set_local_address().
+ *
+ * Setting @max_connections to 0 (the default) closes all the pooled
+ * connections and disables pooling.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_client_set_pool_max_connections (GSocketClient *client,
+					  guint          max_connections)
+{
+  if (client->priv->pool_max_connections == max_connections)
+    return;
+
+  client->priv->pool_max_connections = max_connections;
+  if (max_connections == 0)
+    g_socket_client_pool_clear (client);
+  g_object_notify (G_OBJECT (client), "pool-max-connections");
+}
+
+/**
+ * g_socket_client_get_pool_idle_timeout:
+ * @client: a #GSocketClient.
+ *
+ * Gets how long pooled connections are kept idle. See
+ * g_socket_client_set_pool_idle_timeout() for details.
+ *
+ * Returns: the timeout in seconds, or 0 for none
+ *
+ * Since: 2.34
+ */
+guint
+g_socket_client_get_pool_idle_timeout (GSocketClient *client)
+{
+  return client->priv->pool_idle_timeout;
+}
+
+/**
+ * g_socket_client_set_pool_idle_timeout:
+ * @client: a #GSocketClient.
+ * @timeout: the timeout in seconds, or 0
+ *
+ * Sets how long a connection may sit idle in @client's pool (see
+ * g_socket_client_set_pool_max_connections()) before it is no longer
+ * reused. Servers usually close idle connections after a while, so
+ * this should be somewhat shorter than the server's keep-alive
+ * timeout. If @timeout is 0, idle connections are reused for as long
+ * as they stay open. The default is 60 seconds.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_client_set_pool_idle_timeout (GSocketClient *client,
+				       guint          timeout)
+{
+  if (client->priv->pool_idle_timeout == timeout)
+    return;
+
+  client->priv->pool_idle_timeout = timeout;
+  g_object_notify (G_OBJECT (client), "pool-idle-timeout");
+}
+
+/**
+ * g_socket_client_get_fast_open:
+ * @client: a #GSocketClient.
+ *
+ * Gets whether @client connects with TCP Fast Open. See
+ * g_socket_client_set_fast_open() for details.
+ *
+ * Returns: whether fast open is used
+ *
+ * Since: 2.34
+ */
+gboolean
+g_socket_client_get_fast_open (GSocketClient *client)
+{
+  return client->priv->fast_open;
+}
+
+/**
+ * g_socket_client_set_fast_open:
+ * @client: a #GSocketClient.
+ * @fast_open: whether to use fast open
+ *
+ * Sets whether @client connects TCP sockets with TCP Fast Open (see
+ * g_socket_set_fast_open()). The connect then completes without
+ * waiting for the handshake, which is done along with the first write
+ * on the returned connection, and that write is sent in the SYN if
+ * @client connected to the server before. This saves a round trip
+ * per connection on protocols where the client talks first, including
+ * TLS and proxied connections.
+ *
+ * Because the connection is only really established by that first
+ * write, errors such as %G_IO_ERROR_CONNECTION_REFUSED are reported
+ * by it rather than by the connect, and staggered connection attempts
+ * (see g_socket_client_set_connection_attempt_delay()) always pick
+ * the first address. It must not be used with protocols where the
+ * server talks first. The default is %FALSE.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_client_set_fast_open (GSocketClient *client,
+			       gboolean       fast_open)
+{
+  fast_open = !!fast_open;
+  if (client->priv->fast_open == fast_open)
+    return;
+
+  client->priv->fast_open = fast_open;
+  g_object_notify (G_OBJECT (client), "fast-open");
+}
+
+/**
+ * g_socket_client_release_connection:
+ * @client: a #GSocketClient.
+ * @connection: a #GSocketConnection returned by @client
+ *
+ * Hands @connection back to @client once the caller is done with a
+ * request on it, so that it can be reused by a later connect to the
+ * same destination. The caller must not use @connection afterwards,
+ * other than dropping its reference to it.
+ *
+ * @connection must be idle: there must be no outstanding operations
+ * on it, and no data left to read. If pooling is disabled (see
+ * g_socket_client_set_pool_max_connections()), or @connection can't
+ * be reused, it is closed instead.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_client_release_connection (GSocketClient     *client,
+				    GSocketConnection *connection)
+{
+  GSocketClientPrivate *priv;
+  PooledConnection *pooled;
+  GSList *stale = NULL;
+  const gchar *key;
+  GQueue *idle;
+  gint64 now;
+
+  g_return_if_fail (G_IS_SOCKET_CLIENT (client));
+  g_return_if_fail (G_IS_SOCKET_CONNECTION (connection));
+
+  priv = client->priv;
+  key = g_object_get_qdata (G_OBJECT (connection), pool_key_quark);
+  if (key == NULL || priv->pool_max_connections == 0 ||
+      !pooled_connection_is_usable (connection))
+    {
+      g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+      return;
+    }
+
+  now = g_get_monotonic_time ();
+  pooled = g_slice_new (PooledConnection);
+  pooled->connection = g_object_ref (connection);
+  pooled->idle_since = now;
+
+  g_mutex_lock (&priv->pool_lock);
+  idle = g_hash_table_lookup (priv->pool, key);
+  if (idle == NULL)
+    {
+      idle = g_queue_new ();
+      g_hash_table_insert (priv->pool, g_strdup (key), idle);
+    }
+
+  /* The oldest connections are at the tail */
+  while (!g_queue_is_empty (idle) &&
+	 (g_queue_get_length (idle) >= priv->pool_max_connections ||
+	  pooled_connection_is_expired (client, g_queue_peek_tail (idle), now)))
+    stale = g_slist_prepend (stale, g_queue_pop_tail (idle));
+  g_queue_push_head (idle, pooled);
+  g_mutex_unlock (&priv->pool_lock);
+
+  g_slist_free_full (stale, pooled_connection_free);
+}
+
 static void
 g_socket_client_class_init (GSocketClientClass *class)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (class);
 
+  pool_key_quark = g_quark_from_static_string ("gio-socket-client-pool-key");
+
   g_type_class_add_private (class, sizeof (GSocketClientPrivate));
 
   gobject_class->finalize = g_socket_client_finalize;
@@ -788,7 +1280,11 @@ g_socket_client_class_init (GSocketClientClass *class)
    * particular, if @client ends up attempting to connect to more than
    * one address). However, if @client emits the #GSocketClient::event
    * signal at all for a given connectable, that it will always emit
-   * it with %G_SOCKET_CLIENT_COMPLETE when it is done.
+   * it with %G_SOCKET_CLIENT_COMPLETE when it is done. When
+   * #GSocketClient:connection-attempt-delay is non-zero,
+   * %G_SOCKET_CLIENT_CONNECTING may be emitted for several
+   * connections before one of them is reported as
+   * %G_SOCKET_CLIENT_CONNECTED.
    *
    * Note that there may be additional #GSocketClientEvent values in
    * the future; unrecognized @event values should be ignored.
@@ -881,8 +1377,85 @@ g_socket_client_class_init (GSocketClientClass *class)
 						       G_PARAM_CONSTRUCT |
 						       G_PARAM_READWRITE |
 						       G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocketClient:connection-attempt-delay:
+   *
+   * The delay in milliseconds between staggered connection attempts,
+   * or 0 to try one address at a time. See
+   * g_socket_client_set_connection_attempt_delay().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_CONNECTION_ATTEMPT_DELAY,
+				   g_param_spec_uint ("connection-attempt-delay",
+						      P_("Connection attempt delay"),
+						      P_("The delay in milliseconds before starting a parallel connection attempt, or 0 for none"),
+						      0, G_MAXUINT, DEFAULT_CONNECTION_ATTEMPT_DELAY,
+						      G_PARAM_CONSTRUCT |
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocketClient:pool-max-connections:
+   *
+   * The maximum number of idle connections kept for reuse for each
+   * destination, or 0 to not pool connections. See
+   * g_socket_client_set_pool_max_connections().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_POOL_MAX_CONNECTIONS,
+				   g_param_spec_uint ("pool-max-connections",
+						      P_("Pool maximum connections"),
+						      P_("The maximum number of idle connections kept per destination, or 0 for no pooling"),
+						      0, G_MAXUINT, 0,
+						      G_PARAM_CONSTRUCT |
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocketClient:pool-idle-timeout:
+   *
+   * How long in seconds pooled connections are kept idle, or 0 for
+   * no limit. See g_socket_client_set_pool_idle_timeout().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_POOL_IDLE_TIMEOUT,
+				   g_param_spec_uint ("pool-idle-timeout",
+						      P_("Pool idle timeout"),
+						      P_("How long pooled connections are kept idle in seconds, or 0 for no limit"),
+						      0, G_MAXUINT, 60,
+						      G_PARAM_CONSTRUCT |
+						      G_PARAM_READWRITE |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GSocketClient:fast-open:
+   *
+   * Whether to connect with TCP Fast Open. See
+   * g_socket_client_set_fast_open().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_FAST_OPEN,
+				   g_param_spec_boolean ("fast-open",
+							 P_("Fast open"),
+							 P_("Whether to connect with TCP Fast Open"),
+							 FALSE,
+							 G_PARAM_CONSTRUCT |
+							 G_PARAM_READWRITE |
+							 G_PARAM_STATIC_STRINGS));
 }
 
+static GSocketConnection *
+g_socket_client_connect_racing (GSocketClient       *client,
+				GSocketConnectable  *connectable,
+				gchar               *pool_key,
+				GCancellable        *cancellable,
+				GError             **error);
+
 static void
 g_socket_client_emit_event (GSocketClient       *client,
 			    GSocketClientEvent  event,
@@ -919,6 +1492,9 @@ g_socket_client_emit_event (GSocketClient       *client,
  * If a local address is specified with g_socket_client_set_local_address() the
  * socket will be bound to this address before connecting.
  *
+ * If @connectable resolves to several addresses, connection attempts
+ * are staggered as described in g_socket_client_set_connection_attempt_delay().
+ *
  * Returns: (transfer full): a #GSocketConnection on success, %NULL on error.
  *
  * Since: 2.22
@@ -932,6 +1508,23 @@ g_socket_client_connect (GSocketClient       *client,
   GIOStream *connection = NULL;
   GSocketAddressEnumerator *enumerator = NULL;
   GError *last_error, *tmp_error;
+  gchar *pool_key;
+
+  pool_key = pool_key_for_connectable (client, connectable);
+  if (pool_key != NULL)
+    {
+      connection = (GIOStream *) g_socket_client_pool_take (client, pool_key);
+      if (connection != NULL)
+	{
+	  g_free (pool_key);
+	  g_socket_client_emit_event (client, G_SOCKET_CLIENT_COMPLETE, connectable, connection);
+	  return G_SOCKET_CONNECTION (connection);
+	}
+    }
+
+  if (client->priv->connection_attempt_delay > 0)
+    return g_socket_client_connect_racing (client, connectable, pool_key,
+					   cancellable, error);
 
   last_error = NULL;
 
@@ -1098,10 +1691,14 @@ g_socket_client_connect (GSocketClient       *client,
 	  connection = (GIOStream *)wrapper_connection;
 	}
 
+      if (connection && pool_key && !application_proxy)
+	g_socket_client_pool_tag (G_SOCKET_CONNECTION (connection), pool_key);
+
       g_object_unref (socket);
       g_object_unref (address);
     }
   g_object_unref (enumerator);
+  g_free (pool_key);
 
   g_socket_client_emit_event (client, G_SOCKET_CLIENT_COMPLETE, connectable, connection);
   return G_SOCKET_CONNECTION (connection);
@@ -1135,8 +1732,10 @@ g_socket_client_connect (GSocketClient       *client,
  *
  * In the case that an IP address is given, a single connection
  * attempt is made.  In the case that a name is given, multiple
- * connection attempts may be made, in turn and according to the
- * number of address records in DNS, until a connection succeeds.
+ * connection attempts may be made, according to the number of
+ * address records in DNS, until a connection succeeds. See
+ * g_socket_client_set_connection_attempt_delay() for how these
+ * attempts overlap.
  *
  * Upon a successful connection, a new #GSocketConnection is constructed
  * and returned.  The caller owns this new object and must drop their
@@ -1276,23 +1875,160 @@ typedef struct
   GSocketClient *client;
 
   GSocketConnectable *connectable;
+  gchar *pool_key;
   GSocketAddressEnumerator *enumerator;
+  GCancellable *enumerator_cancellable;
+  gulong enumerator_cancelled_id;
   GProxyAddress *proxy_addr;
   GSocketAddress *current_addr;
   GSocket *current_socket;
   GIOStream *connection;
 
+  /* Racing connection attempts and the addresses not tried yet */
+  GSList *connection_attempts;
+  GList *pending_addresses;
+  GSocketFamily last_family;
+  GSource *attempt_timer;
+
+  guint enumerating : 1;
+  guint enumerated : 1;
+  guint completed : 1;
+  guint application_proxy : 1;
+
   GError *last_error;
+  volatile gint ref_count;
 } GSocketClientAsyncConnectData;
 
+typedef struct
+{
+  GSocketClientAsyncConnectData *data;
+  GSocketAddress *address;
+  GSocket *socket;
+  GIOStream *connection;
+  GCancellable *cancellable;
+  gulong cancelled_id;
+} ConnectionAttempt;
+
+static GSocketClientAsyncConnectData *
+async_connect_data_ref (GSocketClientAsyncConnectData *data)
+{
+  g_atomic_int_inc (&data->ref_count);
+  return data;
+}
+
+static void
+async_connect_data_unref (GSocketClientAsyncConnectData *data)
+{
+  if (!g_atomic_int_dec_and_test (&data->ref_count))
+    return;
+
+  g_object_unref (data->result);
+  g_object_unref (data->connectable);
+  g_free (data->pool_key);
+  g_object_unref (data->enumerator);
+  if (data->cancellable)
+    {
+      g_cancellable_disconnect (data->cancellable, data->enumerator_cancelled_id);
+      g_object_unref (data->cancellable);
+    }
+  g_object_unref (data->enumerator_cancellable);
+  if (data->current_addr)
+    g_object_unref (data->current_addr);
+  if (data->current_socket)
+    g_object_unref (data->current_socket);
+  if (data->proxy_addr)
+    g_object_unref (data->proxy_addr);
+  if (data->connection)
+    g_object_unref (data->connection);
+  g_list_free_full (data->pending_addresses, g_object_unref);
+  g_clear_error (&data->last_error);
+  g_slice_free (GSocketClientAsyncConnectData, data);
+}
+
+static void
+on_connection_cancelled (GCancellable *cancellable,
+			 gpointer      user_data)
+{
+  GCancellable *linked_cancellable = G_CANCELLABLE (user_data);
+
+  g_cancellable_cancel (linked_cancellable);
+}
+
+static ConnectionAttempt *
+connection_attempt_new (GSocketClientAsyncConnectData *data,
+			GSocketAddress                *address,
+			GSocket                       *socket)
+{
+  ConnectionAttempt *attempt;
+
+  attempt = g_slice_new0 (ConnectionAttempt);
+  attempt->data = async_connect_data_ref (data);
+  attempt->address = address;
+  attempt->socket = socket;
+  attempt->connection = (GIOStream *) g_socket_connection_factory_create_connection (socket);
+
+  /* Each attempt can be cancelled on its own when it loses the race */
+  attempt->cancellable = g_cancellable_new ();
+  if (data->cancellable)
+    attempt->cancelled_id = g_cancellable_connect (data->cancellable,
+						   G_CALLBACK (on_connection_cancelled),
+						   attempt->cancellable, NULL);
+
+  return attempt;
+}
+
+static void
+connection_attempt_free (ConnectionAttempt *attempt)
+{
+  if (attempt->data->cancellable)
+    g_cancellable_disconnect (attempt->data->cancellable, attempt->cancelled_id);
+  g_object_unref (attempt->cancellable);
+  g_object_unref (attempt->connection);
+  g_object_unref (attempt->socket);
+  g_object_unref (attempt->address);
+  async_connect_data_unref (attempt->data);
+  g_slice_free (ConnectionAttempt, attempt);
+}
+
+static void
+connection_attempts_cancel (GSocketClientAsyncConnectData *data)
+{
+  GSList *attempts, *l;
+
+  /* An attempt which is no longer in the list frees itself once
+   * its connect call returns.
+   */
+  attempts = data->connection_attempts;
+  data->connection_attempts = NULL;
+  for (l = attempts; l; l = l->next)
+    {
+      ConnectionAttempt *attempt = l->data;
+
+      g_cancellable_cancel (attempt->cancellable);
+    }
+  g_slist_free (attempts);
+
+  if (data->attempt_timer)
+    {
+      g_source_destroy (data->attempt_timer);
+      g_source_unref (data->attempt_timer);
+      data->attempt_timer = NULL;
+    }
+}
+
 static void
 g_socket_client_async_connect_complete (GSocketClientAsyncConnectData *data)
 {
+  connection_attempts_cancel (data);
+  g_cancellable_cancel (data->enumerator_cancellable);
+  data->completed = TRUE;
+
   g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_COMPLETE, data->connectable, data->connection);
 
   if (data->last_error)
     {
       g_simple_async_result_take_error (data->result, data->last_error);
+      data->last_error = NULL;
     }
   else
     {
@@ -1308,24 +2044,18 @@ g_socket_client_async_connect_complete (GSocketClientAsyncConnectData *data)
 	  data->connection = (GIOStream *)wrapper_connection;
 	}
 
+      if (data->pool_key && !data->application_proxy)
+	g_socket_client_pool_tag (G_SOCKET_CONNECTION (data->connection),
+				  data->pool_key);
+
       g_simple_async_result_set_op_res_gpointer (data->result,
 						 data->connection,
 						 g_object_unref);
+      data->connection = NULL;
     }
 
   g_simple_async_result_complete (data->result);
-  g_object_unref (data->result);
-  g_object_unref (data->connectable);
-  g_object_unref (data->enumerator);
-  if (data->cancellable)
-    g_object_unref (data->cancellable);
-  if (data->current_addr)
-    g_object_unref (data->current_addr);
-  if (data->current_socket)
-    g_object_unref (data->current_socket);
-  if (data->proxy_addr)
-    g_object_unref (data->proxy_addr);
-  g_slice_free (GSocketClientAsyncConnectData, data);
+  async_connect_data_unref (data);
 }
 
 
@@ -1333,6 +2063,12 @@ static void
 g_socket_client_enumerator_callback (GObject      *object,
 				     GAsyncResult *result,
 				     gpointer      user_data);
+static void
+g_socket_client_connected_callback (GObject      *source,
+				    GAsyncResult *result,
+				    gpointer      user_data);
+static void
+try_next_connection_or_finish (GSocketClientAsyncConnectData *data);
 
 static void
 set_last_error (GSocketClientAsyncConnectData *data,
@@ -1344,6 +2080,18 @@ set_last_error (GSocketClientAsyncConnectData *data,
 
 static void
 enumerator_next_async (GSocketClientAsyncConnectData *data)
+{
+  data->enumerating = TRUE;
+
+  g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_RESOLVING, data->connectable, NULL);
+  g_socket_address_enumerator_next_async (data->enumerator,
+					  data->enumerator_cancellable,
+					  g_socket_client_enumerator_callback,
+					  async_connect_data_ref (data));
+}
+
+static void
+try_next_address (GSocketClientAsyncConnectData *data)
 {
   /* We need to cleanup the state */
   g_clear_object (&data->current_socket);
@@ -1351,11 +2099,147 @@ enumerator_next_async (GSocketClientAsyncConnectData *data)
   g_clear_object (&data->proxy_addr);
   g_clear_object (&data->connection);
 
-  g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_RESOLVING, data->connectable, NULL);
-  g_socket_address_enumerator_next_async (data->enumerator,
-					  data->cancellable,
-					  g_socket_client_enumerator_callback,
-					  data);
+  try_next_connection_or_finish (data);
+}
+
+static gboolean
+connection_attempt_delay_reached (gpointer user_data)
+{
+  GSocketClientAsyncConnectData *data = user_data;
+
+  g_source_unref (data->attempt_timer);
+  data->attempt_timer = NULL;
+
+  try_next_connection_or_finish (data);
+
+  return FALSE;
+}
+
+static void
+connection_attempt_start (GSocketClientAsyncConnectData *data,
+			  GSocketAddress                *address,
+			  GSocket                       *socket)
+{
+  ConnectionAttempt *attempt;
+  guint delay;
+
+  attempt = connection_attempt_new (data, address, socket);
+  data->connection_attempts = g_slist_append (data->connection_attempts, attempt);
+  data->last_family = g_socket_address_get_family (address);
+
+  g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_CONNECTING, data->connectable, attempt->connection);
+  g_socket_connection_connect_async (G_SOCKET_CONNECTION (attempt->connection),
+				     address, attempt->cancellable,
+				     g_socket_client_connected_callback, attempt);
+
+  /* If this attempt is still going when the delay is up, start
+   * another one alongside it.
+   */
+  delay = data->client->priv->connection_attempt_delay;
+  if (delay > 0)
+    {
+      if (data->attempt_timer)
+	{
+	  g_source_destroy (data->attempt_timer);
+	  g_source_unref (data->attempt_timer);
+	}
+
+      data->attempt_timer = g_timeout_source_new (delay);
+      g_source_set_callback (data->attempt_timer,
+			     connection_attempt_delay_reached,
+			     async_connect_data_ref (data),
+			     (GDestroyNotify) async_connect_data_unref);
+      g_source_attach (data->attempt_timer, g_main_context_get_thread_default ());
+    }
+}
+
+static GSocketAddress *
+take_pending_address (GSocketClientAsyncConnectData *data)
+{
+  GSocketAddress *address;
+  GList *l;
+
+  l = data->pending_addresses;
+  if (l == NULL)
+    return NULL;
+
+  /* When racing, alternate between address families so that a broken
+   * route for one family doesn't hold up the other (RFC 8305, section
+   * 4). As long as only addresses of the family of the last attempt
+   * have turned up, keep reading ahead in the enumerator.
+   */
+  if (data->client->priv->connection_attempt_delay > 0)
+    {
+      while (l && g_socket_address_get_family (l->data) == data->last_family)
+	l = l->next;
+
+      if (l == NULL)
+	{
+	  if (!data->enumerated)
+	    return NULL;
+	  l = data->pending_addresses;
+	}
+    }
+
+  address = l->data;
+  data->pending_addresses = g_list_delete_link (data->pending_addresses, l);
+
+  return address;
+}
+
+static void
+try_next_connection_or_finish (GSocketClientAsyncConnectData *data)
+{
+  GSocketAddress *address;
+  GSocket *socket;
+  GError *error = NULL;
+
+  /* A connection has already been made and is being set up */
+  if (data->connection)
+    return;
+
+  if (g_cancellable_is_cancelled (data->cancellable))
+    {
+      g_clear_error (&data->last_error);
+      g_cancellable_set_error_if_cancelled (data->cancellable, &data->last_error);
+      g_socket_client_async_connect_complete (data);
+      return;
+    }
+
+  if (data->client->priv->connection_attempt_delay == 0 &&
+      data->connection_attempts != NULL)
+    return;
+
+  while ((address = take_pending_address (data)) != NULL)
+    {
+      socket = create_socket (data->client, address, &error);
+      if (socket != NULL)
+	{
+	  connection_attempt_start (data, address, socket);
+	  return;
+	}
+
+      set_last_error (data, error);
+      error = NULL;
+      g_object_unref (address);
+    }
+
+  if (!data->enumerated)
+    {
+      if (!data->enumerating)
+	enumerator_next_async (data);
+      return;
+    }
+
+  /* Nothing left to try; wait for the attempts still running */
+  if (data->connection_attempts != NULL)
+    return;
+
+  if (data->last_error == NULL)
+    g_set_error_literal (&data->last_error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			 _("Unknown error on connect"));
+
+  g_socket_client_async_connect_complete (data);
 }
 
 static void
@@ -1378,7 +2262,7 @@ g_socket_client_tls_handshake_callback (GObject      *object,
   else
     {
       g_object_unref (object);
-      enumerator_next_async (data);
+      try_next_address (data);
     }
 }
 
@@ -1409,7 +2293,7 @@ g_socket_client_tls_handshake (GSocketClientAsyncConnectData *data)
     }
   else
     {
-      enumerator_next_async (data);
+      try_next_address (data);
     }
 }
 
@@ -1430,7 +2314,7 @@ g_socket_client_proxy_connect_callback (GObject      *object,
     }
   else
     {
-      enumerator_next_async (data);
+      try_next_address (data);
       return;
     }
 
@@ -1442,23 +2326,46 @@ g_socket_client_connected_callback (GObject      *source,
 				    GAsyncResult *result,
 				    gpointer      user_data)
 {
-  GSocketClientAsyncConnectData *data = user_data;
+  ConnectionAttempt *attempt = user_data;
+  GSocketClientAsyncConnectData *data = attempt->data;
   GError *error = NULL;
   GProxy *proxy;
   const gchar *protocol;
 
+  if (!g_slist_find (data->connection_attempts, attempt))
+    {
+      /* Another attempt won the race, or the operation is over */
+      connection_attempt_free (attempt);
+      return;
+    }
+
+  data->connection_attempts = g_slist_remove (data->connection_attempts, attempt);
+
   if (!g_socket_connection_connect_finish (G_SOCKET_CONNECTION (source),
 					   result, &error))
     {
       clarify_connect_error (error, data->connectable,
-			     data->current_addr);
+			     attempt->address);
       set_last_error (data, error);
+      connection_attempt_free (attempt);
 
       /* try next one */
-      enumerator_next_async (data);
+      try_next_connection_or_finish (data);
       return;
     }
 
+  /* This attempt won the race; the others are no longer needed */
+  connection_attempts_cancel (data);
+  g_clear_error (&data->last_error);
+
+  data->current_addr = g_object_ref (attempt->address);
+  data->current_socket = g_object_ref (attempt->socket);
+  data->connection = g_object_ref (attempt->connection);
+  if (G_IS_PROXY_ADDRESS (attempt->address) &&
+      data->client->priv->enable_proxy)
+    data->proxy_addr = g_object_ref (attempt->address);
+  connection_attempt_free (attempt);
+
   g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_CONNECTED, data->connectable, data->connection);
 
   /* wrong, but backward compatible */
@@ -1485,7 +2392,7 @@ g_socket_client_connected_callback (GObject      *source,
           G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
           _("Trying to proxy over non-TCP connection is not supported."));
 
-      enumerator_next_async (data);
+      try_next_address (data);
     }
   else if (proxy)
     {
@@ -1507,12 +2414,13 @@ g_socket_client_connected_callback (GObject      *source,
           _("Proxy protocol '%s' is not supported."),
           protocol);
 
-      enumerator_next_async (data);
+      try_next_address (data);
     }
   else
     {
       /* Simply complete the connection, we don't want to do TLS handshake
        * as the application proxy handling may need proxy handshake first */
+      data->application_proxy = TRUE;
       g_socket_client_async_connect_complete (data);
     }
 }
@@ -1524,57 +2432,132 @@ g_socket_client_enumerator_callback (GObject      *object,
 {
   GSocketClientAsyncConnectData *data = user_data;
   GSocketAddress *address = NULL;
-  GSocket *socket;
   GError *tmp_error = NULL;
 
-  if (g_cancellable_is_cancelled (data->cancellable))
+  data->enumerating = FALSE;
+  address = g_socket_address_enumerator_next_finish (data->enumerator,
+						     result, &tmp_error);
+
+  if (data->completed)
     {
-      g_clear_error (&data->last_error);
-      g_cancellable_set_error_if_cancelled (data->cancellable, &data->last_error);
-      g_socket_client_async_connect_complete (data);
+      if (address)
+	g_object_unref (address);
+      g_clear_error (&tmp_error);
+      async_connect_data_unref (data);
       return;
     }
 
-  address = g_socket_address_enumerator_next_finish (data->enumerator,
-						     result, &tmp_error);
-
   if (address == NULL)
     {
+      data->enumerated = TRUE;
       if (tmp_error)
 	set_last_error (data, tmp_error);
-      else if (data->last_error == NULL)
-        g_set_error_literal (&data->last_error, G_IO_ERROR, G_IO_ERROR_FAILED,
-                             _("Unknown error on connect"));
-
-      g_socket_client_async_connect_complete (data);
-      return;
+    }
+  else
+    {
+      g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_RESOLVED,
+				  data->connectable, NULL);
+      data->pending_addresses = g_list_append (data->pending_addresses, address);
     }
 
-  g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_RESOLVED,
-			      data->connectable, NULL);
+  try_next_connection_or_finish (data);
+  async_connect_data_unref (data);
+}
 
-  if (G_IS_PROXY_ADDRESS (address) &&
-      data->client->priv->enable_proxy)
-    data->proxy_addr = g_object_ref (G_PROXY_ADDRESS (address));
+static GSocketClientAsyncConnectData *
+g_socket_client_async_connect_start (GSocketClient       *client,
+				     GSocketConnectable  *connectable,
+				     gchar               *pool_key,
+				     GCancellable        *cancellable,
+				     GAsyncReadyCallback  callback,
+				     gpointer             user_data)
+{
+  GSocketClientAsyncConnectData *data;
 
-  g_clear_error (&data->last_error);
+  data = g_slice_new0 (GSocketClientAsyncConnectData);
+  data->ref_count = 1;
 
-  socket = create_socket (data->client, address, &data->last_error);
-  if (socket == NULL)
+  data->result = g_simple_async_result_new (G_OBJECT (client),
+					    callback, user_data,
+					    g_socket_client_connect_async);
+  data->client = client;
+  data->enumerator_cancellable = g_cancellable_new ();
+  if (cancellable)
     {
-      g_object_unref (address);
-      enumerator_next_async (data);
-      return;
+      data->cancellable = g_object_ref (cancellable);
+      data->enumerator_cancelled_id =
+	g_cancellable_connect (cancellable,
+			       G_CALLBACK (on_connection_cancelled),
+			       data->enumerator_cancellable, NULL);
     }
+  else
+    data->cancellable = NULL;
+  data->last_error = NULL;
+  data->last_family = G_SOCKET_FAMILY_INVALID;
+  data->connectable = g_object_ref (connectable);
+  data->pool_key = pool_key;
 
-  data->current_socket = socket;
-  data->current_addr = address;
-  data->connection = (GIOStream *) g_socket_connection_factory_create_connection (socket);
+  if (can_use_proxy (client))
+      data->enumerator = g_socket_connectable_proxy_enumerate (connectable);
+  else
+      data->enumerator = g_socket_connectable_enumerate (connectable);
 
-  g_socket_client_emit_event (data->client, G_SOCKET_CLIENT_CONNECTING, data->connectable, data->connection);
-  g_socket_connection_connect_async (G_SOCKET_CONNECTION (data->connection),
-				     address, data->cancellable,
-				     g_socket_client_connected_callback, data);
+  enumerator_next_async (data);
+
+  return data;
+}
+
+static void
+g_socket_client_connect_racing_callback (GObject      *source,
+					 GAsyncResult *result,
+					 gpointer      user_data)
+{
+  GAsyncResult **result_out = user_data;
+
+  *result_out = g_object_ref (result);
+}
+
+/* Runs the asynchronous implementation, which knows how to race
+ * several connection attempts, on a private main context.
+ */
+static GSocketConnection *
+g_socket_client_connect_racing (GSocketClient       *client,
+				GSocketConnectable  *connectable,
+				gchar               *pool_key,
+				GCancellable        *cancellable,
+				GError             **error)
+{
+  GSocketClientAsyncConnectData *data;
+  GSocketConnection *connection;
+  GAsyncResult *result = NULL;
+  GMainContext *context;
+
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+
+  data = g_socket_client_async_connect_start (client, connectable, pool_key,
+					      cancellable,
+					      g_socket_client_connect_racing_callback,
+					      &result);
+  async_connect_data_ref (data);
+
+  while (result == NULL)
+    g_main_context_iteration (context, TRUE);
+
+  /* Let the losing attempts see that they were cancelled, so that
+   * nothing is left behind in @context.
+   */
+  while (g_atomic_int_get (&data->ref_count) > 1)
+    g_main_context_iteration (context, TRUE);
+  async_connect_data_unref (data);
+
+  g_main_context_pop_thread_default (context);
+  g_main_context_unref (context);
+
+  connection = g_socket_client_connect_finish (client, result, error);
+  g_object_unref (result);
+
+  return connection;
 }
 
 /**
@@ -1600,29 +2583,35 @@ g_socket_client_connect_async (GSocketClient       *client,
 			       GAsyncReadyCallback  callback,
 			       gpointer             user_data)
 {
-  GSocketClientAsyncConnectData *data;
+  GSocketConnection *connection;
+  gchar *pool_key;
 
   g_return_if_fail (G_IS_SOCKET_CLIENT (client));
 
-  data = g_slice_new0 (GSocketClientAsyncConnectData);
-
-  data->result = g_simple_async_result_new (G_OBJECT (client),
-					    callback, user_data,
-					    g_socket_client_connect_async);
-  data->client = client;
-  if (cancellable)
-    data->cancellable = g_object_ref (cancellable);
-  else
-    data->cancellable = NULL;
-  data->last_error = NULL;
-  data->connectable = g_object_ref (connectable);
-
-  if (can_use_proxy (client))
-      data->enumerator = g_socket_connectable_proxy_enumerate (connectable);
-  else
-      data->enumerator = g_socket_connectable_enumerate (connectable);
+  pool_key = pool_key_for_connectable (client, connectable);
+  if (pool_key != NULL)
+    {
+      connection = g_socket_client_pool_take (client, pool_key);
+      if (connection != NULL)
+	{
+	  GSimpleAsyncResult *simple;
+
+	  g_free (pool_key);
+	  g_socket_client_emit_event (client, G_SOCKET_CLIENT_COMPLETE, connectable, G_IO_STREAM (connection));
+
+	  simple = g_simple_async_result_new (G_OBJECT (client),
+					      callback, user_data,
+					      g_socket_client_connect_async);
+	  g_simple_async_result_set_op_res_gpointer (simple, connection,
+						     g_object_unref);
+	  g_simple_async_result_complete_in_idle (simple);
+	  g_object_unref (simple);
+	  return;
+	}
+    }
 
-  enumerator_next_async (data);
+  g_socket_client_async_connect_start (client, connectable, pool_key,
+				       cancellable, callback, user_data);
 }
 
 /**
@@ -99,6 +99,18 @@ void                    g_socket_client_set_tls                         (GSocket
 GTlsCertificateFlags    g_socket_client_get_tls_validation_flags        (GSocketClient        *client);
 void                    g_socket_client_set_tls_validation_flags        (GSocketClient        *client,
 									 GTlsCertificateFlags  flags);
+guint                   g_socket_client_get_connection_attempt_delay    (GSocketClient        *client);
+void                    g_socket_client_set_connection_attempt_delay    (GSocketClient        *client,
+									 guint                 delay);
+guint                   g_socket_client_get_pool_max_connections        (GSocketClient        *client);
+void                    g_socket_client_set_pool_max_connections        (GSocketClient        *client,
+									 guint                 max_connections);
+guint                   g_socket_client_get_pool_idle_timeout           (GSocketClient        *client);
+void                    g_socket_client_set_pool_idle_timeout           (GSocketClient        *client,
+									 guint                 timeout);
+gboolean                g_socket_client_get_fast_open                   (GSocketClient        *client);
+void                    g_socket_client_set_fast_open                   (GSocketClient        *client,
+									 gboolean              fast_open);
 
 GSocketConnection *     g_socket_client_connect                         (GSocketClient        *client,
                                                                          GSocketConnectable   *connectable,
@@ -157,6 +169,8 @@ GSocketConnection *     g_socket_client_connect_to_uri_finish           (GSocket
                                                                          GError              **error);
 void			g_socket_client_add_application_proxy		(GSocketClient        *client,
 									 const gchar          *protocol);
+void                    g_socket_client_release_connection              (GSocketClient        *client,
+									 GSocketConnection    *connection);
 
 G_END_DECLS
 
@@ -193,6 +193,7 @@ g_socket_connection_connect_async (GSocketConnection   *connection,
   simple = g_simple_async_result_new (G_OBJECT (connection),
 				      callback, user_data,
 				      g_socket_connection_connect_async);
+  g_simple_async_result_set_check_cancellable (simple, cancellable);
 
   g_socket_set_blocking (connection->priv->socket, FALSE);
 
@@ -36,6 +36,8 @@
 #include <gio/gsocket.h>
 #include <gio/gsocketconnection.h>
 #include <gio/ginetsocketaddress.h>
+#include "gnetworkingprivate.h"
+#include "gsocketlistenerprivate.h"
 #include "glibintl.h"
 
 
@@ -61,17 +63,21 @@ G_DEFINE_TYPE (GSocketListener, g_socket_listener, G_TYPE_OBJECT);
 enum
 {
   PROP_0,
-  PROP_LISTEN_BACKLOG
+  PROP_LISTEN_BACKLOG,
+  PROP_FAST_OPEN
 };
 
 
 static GQuark source_quark = 0;
+static GQuark shards_quark = 0;
 
 struct _GSocketListenerPrivate
 {
   GPtrArray           *sockets;
   GMainContext        *main_context;
   int                 listen_backlog;
+  guint               n_shards;
+  guint               fast_open : 1;
   guint               closed : 1;
 };
 
@@ -106,6 +112,10 @@ g_socket_listener_get_property (GObject    *object,
         g_value_set_int (value, listener->priv->listen_backlog);
         break;
 
+      case PROP_FAST_OPEN:
+        g_value_set_boolean (value, listener->priv->fast_open);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -125,6 +135,10 @@ g_socket_listener_set_property (GObject      *object,
 	g_socket_listener_set_backlog (listener, g_value_get_int (value));
 	break;
 
+      case PROP_FAST_OPEN:
+	g_socket_listener_set_fast_open (listener, g_value_get_boolean (value));
+	break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -150,7 +164,23 @@ g_socket_listener_class_init (GSocketListenerClass *klass)
                                                      10,
                                                      G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GSocketListener:fast-open:
+   *
+   * Whether the listener's sockets accept TCP Fast Open connections.
+   * See g_socket_listener_set_fast_open().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_FAST_OPEN,
+                                   g_param_spec_boolean ("fast-open",
+                                                         P_("Fast open"),
+                                                         P_("Whether to accept TCP Fast Open connections"),
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   source_quark = g_quark_from_static_string ("g-socket-listener-source");
+  shards_quark = g_quark_from_static_string ("g-socket-listener-shards");
 }
 
 static void
@@ -195,6 +225,117 @@ check_listener (GSocketListener *listener,
   return TRUE;
 }
 
+static GSocket *
+listener_socket_new (GSocketListener  *listener,
+		     GSocketFamily     family,
+		     GSocketType       type,
+		     GSocketProtocol   protocol,
+		     GError          **error)
+{
+  GSocket *socket;
+
+  socket = g_socket_new (family, type, protocol, error);
+
+  if (socket != NULL && listener->priv->fast_open)
+    g_socket_set_fast_open (socket, TRUE);
+
+  return socket;
+}
+
+#ifdef SO_REUSEPORT
+static gboolean
+set_reuseport (GSocket *socket)
+{
+  int value = 1;
+
+  return setsockopt (g_socket_get_fd (socket), SOL_SOCKET, SO_REUSEPORT,
+		     (gpointer) &value, sizeof (value)) == 0;
+}
+#endif
+
+/* Opens one more socket listening on the address @socket is bound to,
+ * for each additional shard.  The kernel then spreads the incoming
+ * connections over all of them.  Failures are not fatal; shards
+ * without a socket of their own share @socket.
+ *
+ * @socket itself is bound without SO_REUSEPORT, so that the bind
+ * still fails when the port is taken (add_any_inet_port() and the
+ * IPv4 fallback in add_inet_port() rely on that), and only gets it
+ * here, once it owns the port.
+ */
+static void
+add_shards (GSocketListener *listener,
+	    GSocket         *socket)
+{
+#ifdef SO_REUSEPORT
+  GSocketAddress *address;
+  GPtrArray *shards;
+  GObject *source_object;
+  guint i;
+
+  if (listener->priv->n_shards < 2)
+    return;
+
+  if (g_socket_get_family (socket) != G_SOCKET_FAMILY_IPV4 &&
+      g_socket_get_family (socket) != G_SOCKET_FAMILY_IPV6)
+    return;
+
+  if (!set_reuseport (socket))
+    return;
+
+  address = g_socket_get_local_address (socket, NULL);
+  if (address == NULL)
+    return;
+
+  source_object = g_object_get_qdata (G_OBJECT (socket), source_quark);
+
+  shards = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  for (i = 1; i < listener->priv->n_shards; i++)
+    {
+      GSocket *shard;
+
+      shard = listener_socket_new (listener,
+				   g_socket_get_family (socket),
+				   g_socket_get_socket_type (socket),
+				   g_socket_get_protocol (socket),
+				   NULL);
+      if (shard == NULL)
+	break;
+
+      if (!set_reuseport (shard))
+	{
+	  g_object_unref (shard);
+	  break;
+	}
+
+      g_socket_set_listen_backlog (shard,
+				   g_socket_get_listen_backlog (socket));
+
+      if (!g_socket_bind (shard, address, TRUE, NULL) ||
+	  !g_socket_listen (shard, NULL))
+	{
+	  g_object_unref (shard);
+	  break;
+	}
+
+      if (source_object)
+	g_object_set_qdata_full (G_OBJECT (shard), source_quark,
+				 g_object_ref (source_object),
+				 g_object_unref);
+
+      g_ptr_array_add (shards, shard);
+    }
+
+  g_object_unref (address);
+
+  if (shards->len > 0)
+    g_object_set_qdata_full (G_OBJECT (socket), shards_quark, shards,
+			     (GDestroyNotify) g_ptr_array_unref);
+  else
+    g_ptr_array_unref (shards);
+#endif
+}
+
 /**
  * g_socket_listener_add_socket:
  * @listener: a #GSocketListener
@@ -233,13 +374,14 @@ g_socket_listener_add_socket (GSocketListener  *listener,
       return FALSE;
     }
 
-  g_object_ref (socket);
-  g_ptr_array_add (listener->priv->sockets, socket);
-
   if (source_object)
     g_object_set_qdata_full (G_OBJECT (socket), source_quark,
 			     g_object_ref (source_object), g_object_unref);
 
+  add_shards (listener, socket);
+
+  g_object_ref (socket);
+  g_ptr_array_add (listener->priv->sockets, socket);
 
   if (G_SOCKET_LISTENER_GET_CLASS (listener)->changed)
     G_SOCKET_LISTENER_GET_CLASS (listener)->changed (listener);
@@ -298,7 +440,7 @@ g_socket_listener_add_address (GSocketListener  *listener,
     return FALSE;
 
   family = g_socket_address_get_family (address);
-  socket = g_socket_new (family, type, protocol, error);
+  socket = listener_socket_new (listener, family, type, protocol, error);
   if (socket == NULL)
     return FALSE;
 
@@ -377,10 +519,10 @@ g_socket_listener_add_inet_port (GSocketListener  *listener,
     return FALSE;
 
   /* first try to create an IPv6 socket */
-  socket6 = g_socket_new (G_SOCKET_FAMILY_IPV6,
-                          G_SOCKET_TYPE_STREAM,
-                          G_SOCKET_PROTOCOL_DEFAULT,
-                          NULL);
+  socket6 = listener_socket_new (listener, G_SOCKET_FAMILY_IPV6,
+                                 G_SOCKET_TYPE_STREAM,
+                                 G_SOCKET_PROTOCOL_DEFAULT,
+                                 NULL);
 
   if (socket6 != NULL)
     /* IPv6 is supported on this platform, so if we fail now it is
@@ -430,10 +572,10 @@ g_socket_listener_add_inet_port (GSocketListener  *listener,
      * and fail the call if we can't bind to it.
      */
     {
-      socket4 = g_socket_new (G_SOCKET_FAMILY_IPV4,
-                              G_SOCKET_TYPE_STREAM,
-                              G_SOCKET_PROTOCOL_DEFAULT,
-                              error);
+      socket4 = listener_socket_new (listener, G_SOCKET_FAMILY_IPV4,
+                                     G_SOCKET_TYPE_STREAM,
+                                     G_SOCKET_PROTOCOL_DEFAULT,
+                                     error);
 
       if (socket4 != NULL)
         /* IPv4 is supported on this platform, so if we fail now it is
@@ -488,10 +630,16 @@ g_socket_listener_add_inet_port (GSocketListener  *listener,
   g_assert (socket6 != NULL || socket4 != NULL);
 
   if (socket6 != NULL)
-    g_ptr_array_add (listener->priv->sockets, socket6);
+    {
+      add_shards (listener, socket6);
+      g_ptr_array_add (listener->priv->sockets, socket6);
+    }
 
   if (socket4 != NULL)
-    g_ptr_array_add (listener->priv->sockets, socket4);
+    {
+      add_shards (listener, socket4);
+      g_ptr_array_add (listener->priv->sockets, socket4);
+    }
 
   if (G_SOCKET_LISTENER_GET_CLASS (listener)->changed)
     G_SOCKET_LISTENER_GET_CLASS (listener)->changed (listener);
@@ -897,6 +1045,52 @@ g_socket_listener_set_backlog (GSocketListener *listener,
     }
 }
 
+/**
+ * g_socket_listener_set_fast_open:
+ * @listener: a #GSocketListener
+ * @fast_open: whether to accept fast open connections
+ *
+ * Sets whether the sockets in @listener accept TCP Fast Open
+ * connections, whose first data arrives with the SYN and can be
+ * answered without waiting for the handshake to complete. This
+ * applies to the sockets already in @listener and to the ones it
+ * creates later; sockets added afterwards with
+ * g_socket_listener_add_socket() keep their own setting.
+ *
+ * See g_socket_set_fast_open() for details.
+ *
+ * Since: 2.34
+ */
+void
+g_socket_listener_set_fast_open (GSocketListener *listener,
+				 gboolean         fast_open)
+{
+  int i, j;
+
+  if (listener->priv->closed)
+    return;
+
+  fast_open = !!fast_open;
+  if (listener->priv->fast_open == fast_open)
+    return;
+
+  listener->priv->fast_open = fast_open;
+
+  for (i = 0; i < listener->priv->sockets->len; i++)
+    {
+      GSocket *socket = listener->priv->sockets->pdata[i];
+      GPtrArray *shards;
+
+      g_socket_set_fast_open (socket, fast_open);
+
+      shards = g_object_get_qdata (G_OBJECT (socket), shards_quark);
+      for (j = 0; shards != NULL && j < shards->len; j++)
+	g_socket_set_fast_open (shards->pdata[j], fast_open);
+    }
+
+  g_object_notify (G_OBJECT (listener), "fast-open");
+}
+
 /**
  * g_socket_listener_close:
  * @listener: a #GSocketListener
@@ -918,10 +1112,21 @@ g_socket_listener_close (GSocketListener *listener)
 
   for (i = 0; i < listener->priv->sockets->len; i++)
     {
+      GPtrArray *shards;
+
       socket = listener->priv->sockets->pdata[i];
       g_socket_close (socket, NULL);
+
+      shards = g_object_get_qdata (G_OBJECT (socket), shards_quark);
+      if (shards != NULL)
+	g_ptr_array_foreach (shards, (GFunc) g_socket_close, NULL);
     }
   listener->priv->closed = TRUE;
+
+  /* Let a sharded service stop polling the closed sockets */
+  if (listener->priv->n_shards > 0 &&
+      G_SOCKET_LISTENER_GET_CLASS (listener)->changed)
+    G_SOCKET_LISTENER_GET_CLASS (listener)->changed (listener);
 }
 
 /**
@@ -977,10 +1182,10 @@ g_socket_listener_add_any_inet_port (GSocketListener  *listener,
       gboolean result;
 
       g_assert (socket6 == NULL);
-      socket6 = g_socket_new (G_SOCKET_FAMILY_IPV6,
-                              G_SOCKET_TYPE_STREAM,
-                              G_SOCKET_PROTOCOL_DEFAULT,
-                              NULL);
+      socket6 = listener_socket_new (listener, G_SOCKET_FAMILY_IPV6,
+                                     G_SOCKET_TYPE_STREAM,
+                                     G_SOCKET_PROTOCOL_DEFAULT,
+                                     NULL);
 
       if (socket6 != NULL)
         {
@@ -1009,10 +1214,10 @@ g_socket_listener_add_any_inet_port (GSocketListener  *listener,
         }
 
       g_assert (socket4 == NULL);
-      socket4 = g_socket_new (G_SOCKET_FAMILY_IPV4,
-                              G_SOCKET_TYPE_STREAM,
-                              G_SOCKET_PROTOCOL_DEFAULT,
-                              socket6 ? NULL : error);
+      socket4 = listener_socket_new (listener, G_SOCKET_FAMILY_IPV4,
+                                     G_SOCKET_TYPE_STREAM,
+                                     G_SOCKET_PROTOCOL_DEFAULT,
+                                     socket6 ? NULL : error);
 
       if (socket4 == NULL)
         /* IPv4 not supported.
@@ -1119,6 +1324,7 @@ g_socket_listener_add_any_inet_port (GSocketListener  *listener,
                                  g_object_ref (source_object),
                                  g_object_unref);
 
+      add_shards (listener, socket6);
       g_ptr_array_add (listener->priv->sockets, socket6);
     }
 
@@ -1139,6 +1345,7 @@ g_socket_listener_add_any_inet_port (GSocketListener  *listener,
                                  g_object_ref (source_object),
                                  g_object_unref);
 
+      add_shards (listener, socket4);
       g_ptr_array_add (listener->priv->sockets, socket4);
     }
 
@@ -1148,3 +1355,45 @@ g_socket_listener_add_any_inet_port (GSocketListener  *listener,
 
   return candidate_port;
 }
+
+/* Sets the number of sockets to open for each address added from now
+ * on, see add_shards().
+ */
+void
+_g_socket_listener_set_n_shards (GSocketListener *listener,
+				 guint            n_shards)
+{
+  listener->priv->n_shards = n_shards;
+}
+
+/* Returns a new array of the sockets accepting connections for
+ * @shard, one for each socket in the listener.
+ */
+GPtrArray *
+_g_socket_listener_get_shard (GSocketListener *listener,
+			      guint            shard)
+{
+  GPtrArray *sockets;
+  int i;
+
+  sockets = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+  for (i = 0; i < listener->priv->sockets->len; i++)
+    {
+      GSocket *socket = listener->priv->sockets->pdata[i];
+      GPtrArray *shards;
+
+      shards = g_object_get_qdata (G_OBJECT (socket), shards_quark);
+      if (shard > 0 && shards != NULL && shard <= shards->len)
+	socket = shards->pdata[shard - 1];
+
+      g_ptr_array_add (sockets, g_object_ref (socket));
+    }
+
+  return sockets;
+}
+
+GObject *
+_g_socket_listener_get_source_object (GSocket *socket)
+{
+  return g_object_get_qdata (G_OBJECT (socket), source_quark);
+}
@@ -82,6 +82,8 @@ GSocketListener *       g_socket_listener_new                           (void);
 
 void                    g_socket_listener_set_backlog                   (GSocketListener     *listener,
 									 int                  listen_backlog);
+void                    g_socket_listener_set_fast_open                 (GSocketListener     *listener,
+									 gboolean             fast_open);
 
 gboolean                g_socket_listener_add_socket                    (GSocketListener     *listener,
                                                                          GSocket             *socket,
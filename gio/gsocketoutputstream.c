@@ -36,6 +36,7 @@
 #include "gioerror.h"
 #include "glibintl.h"
 #include "gfiledescriptorbased.h"
+#include "gsocketprivate.h"
 
 static void g_socket_output_stream_pollable_iface_init (GPollableOutputStreamInterface *iface);
 #ifdef G_OS_UNIX
@@ -70,6 +71,7 @@ struct _GSocketOutputStreamPrivate
   GCancellable *cancellable;
   gconstpointer buffer;
   gsize count;
+  GBytes *bytes;
 };
 
 static void
@@ -136,6 +138,19 @@ g_socket_output_stream_write (GOutputStream  *stream,
 				      cancellable, error);
 }
 
+static gssize
+g_socket_output_stream_write_bytes (GOutputStream  *stream,
+				    GBytes         *bytes,
+				    GCancellable   *cancellable,
+				    GError        **error)
+{
+  GSocketOutputStream *output_stream = G_SOCKET_OUTPUT_STREAM (stream);
+
+  return _g_socket_send_bytes_with_blocking (output_stream->priv->socket,
+					     bytes, TRUE,
+					     cancellable, error);
+}
+
 static gboolean
 g_socket_output_stream_write_ready (GSocket *socket,
                                     GIOCondition condition,
@@ -145,12 +160,19 @@ g_socket_output_stream_write_ready (GSocket *socket,
   GError *error = NULL;
   gssize result;
 
-  result = g_socket_send_with_blocking (stream->priv->socket,
-					stream->priv->buffer,
-					stream->priv->count,
-					FALSE,
-					stream->priv->cancellable,
-					&error);
+  if (stream->priv->bytes)
+    result = _g_socket_send_bytes_with_blocking (stream->priv->socket,
+						 stream->priv->bytes,
+						 FALSE,
+						 stream->priv->cancellable,
+						 &error);
+  else
+    result = g_socket_send_with_blocking (stream->priv->socket,
+					  stream->priv->buffer,
+					  stream->priv->count,
+					  FALSE,
+					  stream->priv->cancellable,
+					  &error);
 
   if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
     return TRUE;
@@ -167,6 +189,12 @@ g_socket_output_stream_write_ready (GSocket *socket,
   if (stream->priv->cancellable)
     g_object_unref (stream->priv->cancellable);
 
+  if (stream->priv->bytes)
+    {
+      g_bytes_unref (stream->priv->bytes);
+      stream->priv->bytes = NULL;
+    }
+
   g_simple_async_result_complete (simple);
   g_object_unref (simple);
 
@@ -206,6 +234,21 @@ g_socket_output_stream_write_async (GOutputStream        *stream,
   g_source_unref (source);
 }
 
+static void
+g_socket_output_stream_write_bytes_async (GOutputStream        *stream,
+                                          GBytes               *bytes,
+                                          gint                  io_priority,
+                                          GCancellable         *cancellable,
+                                          GAsyncReadyCallback   callback,
+                                          gpointer              user_data)
+{
+  GSocketOutputStream *output_stream = G_SOCKET_OUTPUT_STREAM (stream);
+
+  output_stream->priv->bytes = g_bytes_ref (bytes);
+  g_socket_output_stream_write_async (stream, NULL, 0, io_priority,
+				      cancellable, callback, user_data);
+}
+
 static gssize
 g_socket_output_stream_write_finish (GOutputStream  *stream,
                                      GAsyncResult   *result,
@@ -288,6 +331,9 @@ g_socket_output_stream_class_init (GSocketOutputStreamClass *klass)
   goutputstream_class->write_fn = g_socket_output_stream_write;
   goutputstream_class->write_async = g_socket_output_stream_write_async;
   goutputstream_class->write_finish = g_socket_output_stream_write_finish;
+  goutputstream_class->write_bytes_fn = g_socket_output_stream_write_bytes;
+  goutputstream_class->write_bytes_async = g_socket_output_stream_write_bytes_async;
+  goutputstream_class->write_bytes_finish = g_socket_output_stream_write_finish;
 
   g_object_class_install_property (gobject_class, PROP_SOCKET,
 				   g_param_spec_object ("socket",
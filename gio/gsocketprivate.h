@@ -0,0 +1,37 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __G_SOCKET_PRIVATE_H__
+#define __G_SOCKET_PRIVATE_H__
+
+#include <gio/gsocket.h>
+
+G_BEGIN_DECLS
+
+gssize _g_socket_send_bytes_with_blocking (GSocket       *socket,
+                                           GBytes        *bytes,
+                                           gboolean       blocking,
+                                           GCancellable  *cancellable,
+                                           GError       **error);
+
+G_END_DECLS
+
+#endif /* __G_SOCKET_PRIVATE_H__ */
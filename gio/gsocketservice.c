@@ -55,6 +55,16 @@
  * service are thread-safe so these can be used from threads that
  * handle incoming clients.
  *
+ * Alternatively, the #GSocketService:accept-threads property can be
+ * set when creating the service to spread the incoming connections
+ * over several threads, each running its own main context. In that
+ * case #GSocketService::incoming is emitted in one of those threads,
+ * with its context as the thread-default context, so that the
+ * asynchronous operations started by the handler also complete in
+ * that thread. Where supported, each thread then accepts from a
+ * socket of its own (bound with %SO_REUSEPORT), rather than all of
+ * them waking up for every new connection.
+ *
  * Since: 2.22
  */
 
@@ -63,25 +73,62 @@
 
 #include <gio/gio.h>
 #include "gsocketlistener.h"
+#include "gsocketlistenerprivate.h"
 #include "gsocketconnection.h"
+#include "glibintl.h"
 
 
 static guint g_socket_service_incoming_signal;
 
 G_DEFINE_TYPE (GSocketService, g_socket_service, G_TYPE_SOCKET_LISTENER);
 
+enum
+{
+  PROP_0,
+  PROP_ACCEPT_THREADS
+};
+
 G_LOCK_DEFINE_STATIC(active);
 
+/* Connections accepted in one go before returning to the main loop */
+#define MAX_ACCEPTS_PER_DISPATCH 64
+
+typedef struct _GSocketServiceShard GSocketServiceShard;
+
 struct _GSocketServicePrivate
 {
   GCancellable *cancellable;
+  guint accept_threads;
+  GSocketServiceShard **shards;
   guint active : 1;
   guint outstanding_accept : 1;
 };
 
+/* One of the accept-threads, with the sources accepting from its
+ * shard of the listener's sockets.  The sources are protected by the
+ * active lock.
+ */
+struct _GSocketServiceShard
+{
+  volatile gint ref_count;
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GList *sources;
+};
+
+typedef struct
+{
+  GSocketService *service;
+  GObject *source_object;
+} GSocketServiceShardSource;
+
 static void g_socket_service_ready (GObject      *object,
 				    GAsyncResult *result,
 				    gpointer      user_data);
+static gboolean g_socket_service_incoming (GSocketService    *service,
+                                           GSocketConnection *connection,
+                                           GObject           *source_object);
 
 static gboolean
 g_socket_service_real_incoming (GSocketService    *service,
@@ -101,10 +148,127 @@ g_socket_service_init (GSocketService *service)
   service->priv->active = TRUE;
 }
 
+static GSocketServiceShard *
+shard_ref (GSocketServiceShard *shard)
+{
+  g_atomic_int_inc (&shard->ref_count);
+  return shard;
+}
+
+static void
+shard_unref (GSocketServiceShard *shard)
+{
+  if (!g_atomic_int_dec_and_test (&shard->ref_count))
+    return;
+
+  g_main_loop_unref (shard->loop);
+  g_main_context_unref (shard->context);
+  g_slice_free (GSocketServiceShard, shard);
+}
+
+static gpointer
+shard_thread_func (gpointer user_data)
+{
+  GSocketServiceShard *shard = user_data;
+
+  g_main_context_push_thread_default (shard->context);
+  g_main_loop_run (shard->loop);
+  g_main_context_pop_thread_default (shard->context);
+
+  shard_unref (shard);
+
+  return NULL;
+}
+
+static GSocketServiceShard *
+shard_new (void)
+{
+  GSocketServiceShard *shard;
+
+  shard = g_slice_new0 (GSocketServiceShard);
+  shard->ref_count = 1;
+  shard->context = g_main_context_new ();
+  shard->loop = g_main_loop_new (shard->context, FALSE);
+  shard->thread = g_thread_new ("gsocketservice", shard_thread_func,
+				shard_ref (shard));
+
+  return shard;
+}
+
+static void
+shard_source_free (gpointer data)
+{
+  GSocketServiceShardSource *shard_source = data;
+
+  g_object_unref (shard_source->service);
+  if (shard_source->source_object)
+    g_object_unref (shard_source->source_object);
+  g_slice_free (GSocketServiceShardSource, shard_source);
+}
+
+static void
+shard_remove_sources (GSocketServiceShard *shard)
+{
+  GList *l;
+
+  for (l = shard->sources; l != NULL; l = l->next)
+    {
+      g_source_destroy (l->data);
+      g_source_unref (l->data);
+    }
+  g_list_free (shard->sources);
+  shard->sources = NULL;
+}
+
+static gboolean
+shard_quit (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+  return FALSE;
+}
+
+static void
+shard_free (GSocketServiceShard *shard)
+{
+  GSource *source;
+
+  shard_remove_sources (shard);
+
+  /* Quit from inside the loop, as it may not be running yet */
+  source = g_idle_source_new ();
+  g_source_set_callback (source, shard_quit,
+			 g_main_loop_ref (shard->loop),
+			 (GDestroyNotify) g_main_loop_unref);
+  g_source_attach (source, shard->context);
+  g_source_unref (source);
+
+  /* The service may be finalized by one of its own threads if a
+   * handler drops the last reference.
+   */
+  if (shard->thread == g_thread_self ())
+    g_thread_unref (shard->thread);
+  else
+    g_thread_join (shard->thread);
+
+  shard_unref (shard);
+}
+
 static void
 g_socket_service_finalize (GObject *object)
 {
   GSocketService *service = G_SOCKET_SERVICE (object);
+  guint i;
+
+  if (service->priv->shards)
+    {
+      /* Don't start them again when closing the listener */
+      service->priv->active = FALSE;
+
+      for (i = 0; i < service->priv->accept_threads; i++)
+	shard_free (service->priv->shards[i]);
+      g_free (service->priv->shards);
+      service->priv->shards = NULL;
+    }
 
   g_object_unref (service->priv->cancellable);
 
@@ -112,6 +276,146 @@ g_socket_service_finalize (GObject *object)
     ->finalize (object);
 }
 
+static void
+g_socket_service_get_property (GObject    *object,
+			       guint       prop_id,
+			       GValue     *value,
+			       GParamSpec *pspec)
+{
+  GSocketService *service = G_SOCKET_SERVICE (object);
+
+  switch (prop_id)
+    {
+      case PROP_ACCEPT_THREADS:
+	g_value_set_uint (value, service->priv->accept_threads);
+	break;
+
+      default:
+	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+g_socket_service_set_property (GObject      *object,
+			       guint         prop_id,
+			       const GValue *value,
+			       GParamSpec   *pspec)
+{
+  GSocketService *service = G_SOCKET_SERVICE (object);
+
+  switch (prop_id)
+    {
+      case PROP_ACCEPT_THREADS:
+	service->priv->accept_threads = g_value_get_uint (value);
+	_g_socket_listener_set_n_shards (G_SOCKET_LISTENER (service),
+					 service->priv->accept_threads);
+	break;
+
+      default:
+	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static gboolean
+shard_accept (GSocket      *socket,
+	      GIOCondition  condition,
+	      gpointer      user_data)
+{
+  GSocketServiceShardSource *shard_source = user_data;
+  int i;
+
+  for (i = 0; i < MAX_ACCEPTS_PER_DISPATCH; i++)
+    {
+      GSocketConnection *connection;
+      GSocket *client;
+      GError *error = NULL;
+
+      client = g_socket_accept (socket, NULL, &error);
+      if (client == NULL)
+	{
+	  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+	    g_warning ("fail: %s", error->message);
+	  g_error_free (error);
+	  break;
+	}
+
+      connection = g_socket_connection_factory_create_connection (client);
+      g_object_unref (client);
+
+      g_socket_service_incoming (shard_source->service, connection,
+				 shard_source->source_object);
+      g_object_unref (connection);
+
+      /* The handler may have stopped the service */
+      if (g_source_is_destroyed (g_main_current_source ()))
+	break;
+    }
+
+  return TRUE;
+}
+
+/* Called with the active lock held whenever the sockets or the
+ * active state change in accept-threads mode.
+ */
+static void
+update_shards (GSocketService *service)
+{
+  GSocketListener *listener = G_SOCKET_LISTENER (service);
+  guint i, j;
+
+  if (service->priv->shards == NULL)
+    {
+      if (!service->priv->active)
+	return;
+
+      service->priv->shards = g_new (GSocketServiceShard *,
+				     service->priv->accept_threads);
+      for (i = 0; i < service->priv->accept_threads; i++)
+	service->priv->shards[i] = shard_new ();
+    }
+
+  for (i = 0; i < service->priv->accept_threads; i++)
+    {
+      GSocketServiceShard *shard = service->priv->shards[i];
+      GPtrArray *sockets;
+
+      shard_remove_sources (shard);
+
+      if (!service->priv->active)
+	continue;
+
+      sockets = _g_socket_listener_get_shard (listener, i);
+      for (j = 0; j < sockets->len; j++)
+	{
+	  GSocket *socket = sockets->pdata[j];
+	  GSocketServiceShardSource *shard_source;
+	  GObject *source_object;
+	  GSource *source;
+
+	  if (g_socket_is_closed (socket))
+	    continue;
+
+	  /* Several threads may wake up for the same connection if they
+	   * share a socket, so the losers must not block in accept().
+	   */
+	  g_socket_set_blocking (socket, FALSE);
+
+	  shard_source = g_slice_new (GSocketServiceShardSource);
+	  shard_source->service = g_object_ref (service);
+	  source_object = _g_socket_listener_get_source_object (socket);
+	  shard_source->source_object = source_object ?
+	    g_object_ref (source_object) : NULL;
+
+	  source = g_socket_create_source (socket, G_IO_IN, NULL);
+	  g_source_set_callback (source, (GSourceFunc) shard_accept,
+				 shard_source, shard_source_free);
+	  g_source_attach (source, shard->context);
+	  shard->sources = g_list_prepend (shard->sources, source);
+	}
+      g_ptr_array_unref (sockets);
+    }
+}
+
 static void
 do_accept (GSocketService  *service)
 {
@@ -128,7 +432,9 @@ g_socket_service_changed (GSocketListener *listener)
 
   G_LOCK (active);
 
-  if (service->priv->active)
+  if (service->priv->accept_threads > 0)
+    update_shards (service);
+  else if (service->priv->active)
     {
       if (service->priv->outstanding_accept)
 	g_cancellable_cancel (service->priv->cancellable);
@@ -188,7 +494,9 @@ g_socket_service_start (GSocketService *service)
     {
       service->priv->active = TRUE;
 
-      if (service->priv->outstanding_accept)
+      if (service->priv->accept_threads > 0)
+	update_shards (service);
+      else if (service->priv->outstanding_accept)
 	g_cancellable_cancel (service->priv->cancellable);
       else
 	do_accept (service);
@@ -218,7 +526,9 @@ g_socket_service_stop (GSocketService *service)
     {
       service->priv->active = FALSE;
 
-      if (service->priv->outstanding_accept)
+      if (service->priv->accept_threads > 0)
+	update_shards (service);
+      else if (service->priv->outstanding_accept)
 	g_cancellable_cancel (service->priv->cancellable);
     }
 
@@ -247,9 +557,28 @@ g_socket_service_class_init (GSocketServiceClass *class)
   g_type_class_add_private (class, sizeof (GSocketServicePrivate));
 
   gobject_class->finalize = g_socket_service_finalize;
+  gobject_class->set_property = g_socket_service_set_property;
+  gobject_class->get_property = g_socket_service_get_property;
   listener_class->changed = g_socket_service_changed;
   class->incoming = g_socket_service_real_incoming;
 
+  /**
+   * GSocketService:accept-threads:
+   *
+   * The number of threads accepting and handling the incoming
+   * connections, each running its own main context, or 0 to accept
+   * them in the thread-default context of the thread the service was
+   * created in.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_ACCEPT_THREADS,
+				   g_param_spec_uint ("accept-threads",
+						      P_("Accept threads"),
+						      P_("The number of threads accepting connections, or 0 to use the main context"),
+						      0, G_MAXINT, 0,
+						      G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GSocketService::incoming:
    * @service: the #GSocketService
@@ -262,6 +591,10 @@ g_socket_service_class_init (GSocketServiceClass *class)
    * handling of @connection, but may not block; in essence,
    * asynchronous operations must be used.
    *
+   * If #GSocketService:accept-threads is non-zero, the signal is
+   * emitted in one of the service's threads, so handlers must be
+   * thread-safe.
+   *
    * @connection will be unreffed once the signal handler returns,
    * so you need to ref it yourself if you are planning to use it.
    *
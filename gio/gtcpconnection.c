@@ -27,6 +27,7 @@
 #include "gasyncresult.h"
 #include "gsimpleasyncresult.h"
 #include "giostream.h"
+#include "gnetworkingprivate.h"
 #include "glibintl.h"
 
 
@@ -68,7 +69,8 @@ struct _GTcpConnectionPrivate
 enum
 {
   PROP_0,
-  PROP_GRACEFUL_DISCONNECT
+  PROP_GRACEFUL_DISCONNECT,
+  PROP_NO_DELAY
 };
 
 static void
@@ -94,6 +96,10 @@ g_tcp_connection_get_property (GObject    *object,
 	g_value_set_boolean (value, connection->priv->graceful_disconnect);
 	break;
 
+      case PROP_NO_DELAY:
+	g_value_set_boolean (value, g_tcp_connection_get_no_delay (connection));
+	break;
+
       default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -114,6 +120,10 @@ g_tcp_connection_set_property (GObject      *object,
 						  g_value_get_boolean (value));
 	break;
 
+      case PROP_NO_DELAY:
+	g_tcp_connection_set_no_delay (connection, g_value_get_boolean (value));
+	break;
+
       default:
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -140,6 +150,21 @@ g_tcp_connection_class_init (GTcpConnectionClass *class)
 							 FALSE,
 							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GTcpConnection:no-delay:
+   *
+   * Whether small writes are sent right away rather than coalesced.
+   * See g_tcp_connection_set_no_delay().
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_NO_DELAY,
+				   g_param_spec_boolean ("no-delay",
+							 P_("No delay"),
+							 P_("Whether or not small writes are sent without delay"),
+							 FALSE,
+							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
 }
 
 static gboolean
@@ -365,3 +390,66 @@ g_tcp_connection_get_graceful_disconnect (GTcpConnection *connection)
 {
   return connection->priv->graceful_disconnect;
 }
+
+/**
+ * g_tcp_connection_set_no_delay:
+ * @connection: a #GTcpConnection
+ * @no_delay: Whether to send small writes without delay
+ *
+ * Sets whether small writes on @connection are sent right away. By
+ * default, TCP holds back a small segment while earlier data is still
+ * unacknowledged, to coalesce it with what follows (Nagle's
+ * algorithm). For request/response protocols where each message is
+ * written in one go this adds a round trip of latency, and it can be
+ * disabled by setting this to %TRUE (<literal>TCP_NODELAY</literal>).
+ *
+ * To still coalesce a message written in several pieces, wrap the
+ * writes in g_socket_cork() and g_socket_uncork().
+ *
+ * Since: 2.34
+ */
+void
+g_tcp_connection_set_no_delay (GTcpConnection *connection,
+			       gboolean        no_delay)
+{
+  GSocket *socket;
+  GError *error = NULL;
+
+  g_return_if_fail (G_IS_TCP_CONNECTION (connection));
+
+  socket = g_socket_connection_get_socket (G_SOCKET_CONNECTION (connection));
+  if (!g_socket_set_option (socket, IPPROTO_TCP, TCP_NODELAY, !!no_delay, &error))
+    {
+      g_warning ("error setting no delay: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  g_object_notify (G_OBJECT (connection), "no-delay");
+}
+
+/**
+ * g_tcp_connection_get_no_delay:
+ * @connection: a #GTcpConnection
+ *
+ * Checks if small writes are sent without delay. See
+ * g_tcp_connection_set_no_delay().
+ *
+ * Returns: %TRUE if small writes are sent without delay, %FALSE otherwise
+ *
+ * Since: 2.34
+ */
+gboolean
+g_tcp_connection_get_no_delay (GTcpConnection *connection)
+{
+  GSocket *socket;
+  gint value;
+
+  g_return_val_if_fail (G_IS_TCP_CONNECTION (connection), FALSE);
+
+  socket = g_socket_connection_get_socket (G_SOCKET_CONNECTION (connection));
+  if (!g_socket_get_option (socket, IPPROTO_TCP, TCP_NODELAY, &value, NULL))
+    return FALSE;
+
+  return value != 0;
+}
@@ -62,6 +62,9 @@ GType    g_tcp_connection_get_type                (void) G_GNUC_CONST;
 void     g_tcp_connection_set_graceful_disconnect (GTcpConnection *connection,
 						   gboolean        graceful_disconnect);
 gboolean g_tcp_connection_get_graceful_disconnect (GTcpConnection *connection);
+void     g_tcp_connection_set_no_delay            (GTcpConnection *connection,
+						   gboolean        no_delay);
+gboolean g_tcp_connection_get_no_delay            (GTcpConnection *connection);
 
 G_END_DECLS
 
@@ -37,6 +37,173 @@
 
 G_DEFINE_TYPE (GThreadedResolver, g_threaded_resolver, G_TYPE_RESOLVER)
 
+/* The cache of lookup_by_name() results. An entry is added as soon as
+ * a lookup for a hostname starts; lookups for the same hostname that
+ * come in while it is running wait for it instead of starting a query
+ * of their own. Once resolved, the entry is kept until its TTL runs
+ * out: getaddrinfo() doesn't tell us the TTL of the records, so the
+ * time given in G_RESOLVER_CACHE_TTL (in seconds, by default 0, meaning
+ * that results are only shared by concurrent lookups) is used for
+ * both addresses and "not found" errors. Other errors are never kept.
+ *
+ * The cache is refcounted separately from the resolver since a
+ * cancelled lookup can still be running in the thread pool after the
+ * resolver has been finalized.
+ *
+ * The table holds at most CACHE_MAX_ENTRIES entries. When it is full
+ * of lookups that are still running, a new lookup is done without an
+ * entry, so it is neither shared nor cached.
+ */
+#define CACHE_MAX_ENTRIES 256
+
+struct _GThreadedResolverCache {
+  volatile gint ref_count;
+
+  GMutex lock;
+  GCond cond;
+  GHashTable *entries;
+  gint64 ttl;
+};
+
+typedef struct {
+  guint ref_count;
+  gboolean resolved;
+  gint64 expiry;
+  GList *addresses;
+  GError *error;
+} GThreadedResolverCacheEntry;
+
+static void
+cache_entry_unref (GThreadedResolverCacheEntry *entry)
+{
+  /* called with the cache lock held */
+  if (--entry->ref_count > 0)
+    return;
+
+  g_resolver_free_addresses (entry->addresses);
+  g_clear_error (&entry->error);
+  g_slice_free (GThreadedResolverCacheEntry, entry);
+}
+
+static gint64
+cache_get_ttl (void)
+{
+  const gchar *env;
+
+  env = g_getenv ("G_RESOLVER_CACHE_TTL");
+  if (env != NULL)
+    return g_ascii_strtoull (env, NULL, 10) * G_USEC_PER_SEC;
+
+  return 0;
+}
+
+static GThreadedResolverCache *
+cache_new (void)
+{
+  GThreadedResolverCache *cache;
+
+  cache = g_slice_new0 (GThreadedResolverCache);
+  cache->ref_count = 1;
+  g_mutex_init (&cache->lock);
+  g_cond_init (&cache->cond);
+  cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) cache_entry_unref);
+  cache->ttl = cache_get_ttl ();
+
+  return cache;
+}
+
+static GThreadedResolverCache *
+cache_ref (GThreadedResolverCache *cache)
+{
+  g_atomic_int_inc (&cache->ref_count);
+  return cache;
+}
+
+static void
+cache_unref (GThreadedResolverCache *cache)
+{
+  if (!g_atomic_int_dec_and_test (&cache->ref_count))
+    return;
+
+  g_hash_table_unref (cache->entries);
+  g_mutex_clear (&cache->lock);
+  g_cond_clear (&cache->cond);
+  g_slice_free (GThreadedResolverCache, cache);
+}
+
+static GList *
+copy_addresses (GList *addresses)
+{
+  GList *copy = NULL;
+  GList *l;
+
+  for (l = addresses; l != NULL; l = l->next)
+    copy = g_list_prepend (copy, g_object_ref (l->data));
+
+  return g_list_reverse (copy);
+}
+
+static gboolean
+remove_resolved_entry (gpointer key,
+                       gpointer value,
+                       gpointer user_data)
+{
+  GThreadedResolverCacheEntry *entry = value;
+  gint64 *now = user_data;
+
+  /* @now is NULL when removing all resolved entries */
+  return entry->resolved && (now == NULL || entry->expiry <= *now);
+}
+
+/* Looks up @hostname in the cache, called with the cache lock held.
+ * Returns %TRUE and sets either @addresses or @error if there is an
+ * unexpired result.
+ */
+static gboolean
+cache_lookup_locked (GThreadedResolverCache  *cache,
+                     const gchar             *hostname,
+                     GList                  **addresses,
+                     GError                 **error)
+{
+  GThreadedResolverCacheEntry *entry;
+
+  entry = g_hash_table_lookup (cache->entries, hostname);
+  if (entry == NULL || !entry->resolved)
+    return FALSE;
+
+  if (entry->expiry <= g_get_monotonic_time ())
+    {
+      g_hash_table_remove (cache->entries, hostname);
+      return FALSE;
+    }
+
+  if (entry->error)
+    g_propagate_error (error, g_error_copy (entry->error));
+  else
+    *addresses = copy_addresses (entry->addresses);
+
+  return TRUE;
+}
+
+static gboolean
+cache_lookup (GThreadedResolverCache  *cache,
+              const gchar             *hostname,
+              GList                  **addresses,
+              GError                 **error)
+{
+  gboolean found;
+
+  if (cache->ttl == 0)
+    return FALSE;
+
+  g_mutex_lock (&cache->lock);
+  found = cache_lookup_locked (cache, hostname, addresses, error);
+  g_mutex_unlock (&cache->lock);
+
+  return found;
+}
+
 static void threaded_resolver_thread (gpointer thread_data, gpointer pool_data);
 
 static void
@@ -44,6 +211,7 @@ g_threaded_resolver_init (GThreadedResolver *gtr)
 {
   gtr->thread_pool = g_thread_pool_new (threaded_resolver_thread, gtr,
                                         -1, FALSE, NULL);
+  gtr->cache = cache_new ();
 }
 
 static void
@@ -52,10 +220,24 @@ finalize (GObject *object)
   GThreadedResolver *gtr = G_THREADED_RESOLVER (object);
 
   g_thread_pool_free (gtr->thread_pool, FALSE, FALSE);
+  cache_unref (gtr->cache);
 
   G_OBJECT_CLASS (g_threaded_resolver_parent_class)->finalize (object);
 }
 
+static void
+reload (GResolver *resolver)
+{
+  GThreadedResolver *gtr = G_THREADED_RESOLVER (resolver);
+
+  /* the configuration changed; lookups that are already running are
+   * left alone
+   */
+  g_mutex_lock (&gtr->cache->lock);
+  g_hash_table_foreach_remove (gtr->cache->entries, remove_resolved_entry, NULL);
+  g_mutex_unlock (&gtr->cache->lock);
+}
+
 /* A GThreadedResolverRequest represents a request in progress
  * (usually, but see case 1). It is refcounted, to make sure that it
  * doesn't get freed too soon. In particular, it can't be freed until
@@ -144,6 +326,8 @@ struct _GThreadedResolverRequest {
     struct {
       gchar *hostname;
       GList *addresses;
+      GThreadedResolverCache *cache;
+      GList * (* resolve_name) (const gchar *, GError **);
     } name;
     struct {
       GInetAddress *address;
@@ -367,16 +551,115 @@ resolve_finish (GResolver     *resolver,
 static void
 do_lookup_by_name (GThreadedResolverRequest  *req,
                    GError                   **error)
+{
+  GThreadedResolverCache *cache = req->u.name.cache;
+  GThreadedResolverCacheEntry *entry;
+  GError *lookup_error = NULL;
+  gint64 ttl, now;
+
+  g_mutex_lock (&cache->lock);
+
+  if (cache_lookup_locked (cache, req->u.name.hostname, &req->u.name.addresses, error))
+    {
+      g_mutex_unlock (&cache->lock);
+      return;
+    }
+
+  entry = g_hash_table_lookup (cache->entries, req->u.name.hostname);
+  if (entry != NULL)
+    {
+      /* Another thread is resolving this hostname right now; share its
+       * result rather than sending the same query again.
+       */
+      entry->ref_count++;
+      while (!entry->resolved)
+        g_cond_wait (&cache->cond, &cache->lock);
+
+      if (entry->error)
+        g_propagate_error (error, g_error_copy (entry->error));
+      else
+        req->u.name.addresses = copy_addresses (entry->addresses);
+
+      cache_entry_unref (entry);
+      g_mutex_unlock (&cache->lock);
+      return;
+    }
+
+  now = g_get_monotonic_time ();
+  if (g_hash_table_size (cache->entries) >= CACHE_MAX_ENTRIES)
+    {
+      g_hash_table_foreach_remove (cache->entries, remove_resolved_entry, &now);
+      if (g_hash_table_size (cache->entries) >= CACHE_MAX_ENTRIES)
+        g_hash_table_foreach_remove (cache->entries, remove_resolved_entry, NULL);
+
+      /* Only running lookups are left; don't add to them */
+      if (g_hash_table_size (cache->entries) >= CACHE_MAX_ENTRIES)
+        {
+          g_mutex_unlock (&cache->lock);
+          req->u.name.addresses = req->u.name.resolve_name (req->u.name.hostname, error);
+          return;
+        }
+    }
+
+  entry = g_slice_new0 (GThreadedResolverCacheEntry);
+  entry->ref_count = 2; /* one for the table, one for us */
+  g_hash_table_insert (cache->entries, g_strdup (req->u.name.hostname), entry);
+
+  g_mutex_unlock (&cache->lock);
+
+  req->u.name.addresses = req->u.name.resolve_name (req->u.name.hostname, &lookup_error);
+
+  g_mutex_lock (&cache->lock);
+
+  entry->resolved = TRUE;
+  if (lookup_error)
+    entry->error = g_error_copy (lookup_error);
+  else
+    entry->addresses = copy_addresses (req->u.name.addresses);
+
+  ttl = cache->ttl;
+  if (lookup_error && !g_error_matches (lookup_error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND))
+    ttl = 0;
+  entry->expiry = g_get_monotonic_time () + ttl;
+
+  /* Unless the entry got dropped by a reload in the meantime, it
+   * stays in the table until it expires.
+   */
+  if (ttl == 0 && g_hash_table_lookup (cache->entries, req->u.name.hostname) == entry)
+    g_hash_table_remove (cache->entries, req->u.name.hostname);
+
+  g_cond_broadcast (&cache->cond);
+  cache_entry_unref (entry);
+
+  g_mutex_unlock (&cache->lock);
+
+  if (lookup_error)
+    g_propagate_error (error, lookup_error);
+}
+
+static GList *
+resolve_name (const gchar  *hostname,
+              GError      **error)
 {
   struct addrinfo *res = NULL;
+  GList *addresses;
   gint retval;
 
-  retval = getaddrinfo (req->u.name.hostname, NULL,
-                        &_g_resolver_addrinfo_hints, &res);
-  req->u.name.addresses =
-    _g_resolver_addresses_from_addrinfo (req->u.name.hostname, res, retval, error);
+  retval = getaddrinfo (hostname, NULL, &_g_resolver_addrinfo_hints, &res);
+  addresses = _g_resolver_addresses_from_addrinfo (hostname, res, retval, error);
   if (res)
     freeaddrinfo (res);
+
+  return addresses;
+}
+
+static void
+free_lookup_by_name (GThreadedResolverRequest *req)
+{
+  g_free (req->u.name.hostname);
+  if (req->u.name.addresses)
+    g_resolver_free_addresses (req->u.name.addresses);
+  cache_unref (req->u.name.cache);
 }
 
 static GList *
@@ -387,25 +670,24 @@ lookup_by_name (GResolver     *resolver,
 {
   GThreadedResolver *gtr = G_THREADED_RESOLVER (resolver);
   GThreadedResolverRequest *req;
-  GList *addresses;
+  GList *addresses = NULL;
+
+  if (cache_lookup (gtr->cache, hostname, &addresses, error))
+    return addresses;
 
-  req = g_threaded_resolver_request_new (do_lookup_by_name, NULL, cancellable);
-  req->u.name.hostname = (gchar *)hostname;
+  req = g_threaded_resolver_request_new (do_lookup_by_name, free_lookup_by_name,
+                                         cancellable);
+  req->u.name.hostname = g_strdup (hostname);
+  req->u.name.cache = cache_ref (gtr->cache);
+  req->u.name.resolve_name = G_THREADED_RESOLVER_GET_CLASS (gtr)->resolve_name;
   resolve_sync (gtr, req, error);
 
   addresses = req->u.name.addresses;
+  req->u.name.addresses = NULL;
   g_threaded_resolver_request_unref (req);
   return addresses;
 }
 
-static void
-free_lookup_by_name (GThreadedResolverRequest *req)
-{
-  g_free (req->u.name.hostname);
-  if (req->u.name.addresses)
-    g_resolver_free_addresses (req->u.name.addresses);
-}
-
 static void
 lookup_by_name_async (GResolver           *resolver,
                       const gchar         *hostname,
@@ -415,10 +697,32 @@ lookup_by_name_async (GResolver           *resolver,
 {
   GThreadedResolver *gtr = G_THREADED_RESOLVER (resolver);
   GThreadedResolverRequest *req;
+  GList *addresses = NULL;
+  GError *error = NULL;
+
+  if (cache_lookup (gtr->cache, hostname, &addresses, &error))
+    {
+      /* Answer straight away, without a trip through the thread pool */
+      req = g_threaded_resolver_request_new (NULL, free_lookup_by_name, NULL);
+      req->u.name.hostname = g_strdup (hostname);
+      req->u.name.addresses = addresses;
+      req->u.name.cache = cache_ref (gtr->cache);
+      req->async_result = g_simple_async_result_new (G_OBJECT (gtr), callback, user_data,
+                                                     lookup_by_name_async);
+      g_simple_async_result_set_op_res_gpointer (req->async_result, req,
+                                                 (GDestroyNotify)g_threaded_resolver_request_unref);
+      g_mutex_unlock (&req->mutex);
+
+      g_threaded_resolver_request_complete (req, error);
+      g_threaded_resolver_request_unref (req);
+      return;
+    }
 
   req = g_threaded_resolver_request_new (do_lookup_by_name, free_lookup_by_name,
                                          cancellable);
   req->u.name.hostname = g_strdup (hostname);
+  req->u.name.cache = cache_ref (gtr->cache);
+  req->u.name.resolve_name = G_THREADED_RESOLVER_GET_CLASS (gtr)->resolve_name;
   resolve_async (gtr, req, callback, user_data, lookup_by_name_async);
 }
 
@@ -612,6 +916,9 @@ g_threaded_resolver_class_init (GThreadedResolverClass *threaded_class)
   resolver_class->lookup_service           = lookup_service;
   resolver_class->lookup_service_async     = lookup_service_async;
   resolver_class->lookup_service_finish    = lookup_service_finish;
+  resolver_class->reload                   = reload;
+
+  threaded_class->resolve_name = resolve_name;
 
   object_class->finalize = finalize;
 }
@@ -32,15 +32,23 @@ G_BEGIN_DECLS
 #define G_IS_THREADED_RESOLVER_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), G_TYPE_THREADED_RESOLVER))
 #define G_THREADED_RESOLVER_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), G_TYPE_THREADED_RESOLVER, GThreadedResolverClass))
 
+typedef struct _GThreadedResolverCache GThreadedResolverCache;
+
 typedef struct {
   GResolver parent_instance;
 
   GThreadPool *thread_pool;
+  GThreadedResolverCache *cache;
 } GThreadedResolver;
 
 typedef struct {
   GResolverClass parent_class;
 
+  /* Resolves @hostname without going through the cache; called in a
+   * worker thread, possibly after the resolver has been finalized.
+   */
+  GList * (* resolve_name) (const gchar  *hostname,
+                            GError      **error);
 } GThreadedResolverClass;
 
 GType g_threaded_resolver_get_type (void) G_GNUC_CONST;
@@ -22,6 +22,7 @@
 #include "glib.h"
 
 #include "gtlsbackend.h"
+#include "gtlssessioncache.h"
 #include "gdummytlsbackend.h"
 #include "gioenumtypes.h"
 #include "giomodule-priv.h"
@@ -142,6 +143,51 @@ g_tls_backend_get_default_database (GTlsBackend *backend)
   return G_TLS_BACKEND_GET_INTERFACE (backend)->get_default_database (backend);
 }
 
+/**
+ * g_tls_backend_get_default_session_cache:
+ * @backend: the #GTlsBackend
+ *
+ * Gets the #GTlsSessionCache that @backend's client connections use
+ * to resume earlier sessions, unless they were given a different one
+ * with g_tls_client_connection_set_session_cache(). The cache lives
+ * as long as @backend, so it is shared by all connections in the
+ * process.
+ *
+ * If the backend does not provide a cache of its own, GIO creates
+ * one with the default size and no lifetime limit.
+ *
+ * Return value: (transfer none): the default session cache
+ *
+ * Since: 2.34
+ */
+GTlsSessionCache *
+g_tls_backend_get_default_session_cache (GTlsBackend *backend)
+{
+  static GQuark session_cache_quark;
+  G_LOCK_DEFINE_STATIC (session_cache);
+  GTlsSessionCache *cache;
+
+  g_return_val_if_fail (G_IS_TLS_BACKEND (backend), NULL);
+
+  if (G_TLS_BACKEND_GET_INTERFACE (backend)->get_default_session_cache)
+    return G_TLS_BACKEND_GET_INTERFACE (backend)->get_default_session_cache (backend);
+
+  if (!session_cache_quark)
+    session_cache_quark = g_quark_from_static_string ("g-tls-backend-session-cache");
+
+  G_LOCK (session_cache);
+  cache = g_object_get_qdata (G_OBJECT (backend), session_cache_quark);
+  if (cache == NULL)
+    {
+      cache = g_object_new (G_TYPE_TLS_SESSION_CACHE, NULL);
+      g_object_set_qdata_full (G_OBJECT (backend), session_cache_quark,
+			       cache, g_object_unref);
+    }
+  G_UNLOCK (session_cache);
+
+  return cache;
+}
+
 /**
  * g_tls_backend_get_certificate_type:
  * @backend: the #GTlsBackend
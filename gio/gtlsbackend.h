@@ -54,6 +54,8 @@ typedef struct _GTlsBackendInterface GTlsBackendInterface;
  * @get_client_connection_type: returns the #GTlsClientConnection implementation type
  * @get_server_connection_type: returns the #GTlsServerConnection implementation type
  * @get_file_database_type: returns the #GTlsFileDatabase implementation type.
+ * @get_default_session_cache: returns the #GTlsSessionCache shared by
+ *   client connections that have not been given one (Since: 2.34)
  *
  * Provides an interface for describing TLS-related types.
  *
@@ -70,6 +72,7 @@ struct _GTlsBackendInterface
   GType          ( *get_server_connection_type) (void);
   GType          ( *get_file_database_type)     (void);
   GTlsDatabase * ( *get_default_database)       (GTlsBackend *backend);
+  GTlsSessionCache * ( *get_default_session_cache) (GTlsBackend *backend);
 };
 
 GType          g_tls_backend_get_type                   (void) G_GNUC_CONST;
@@ -78,6 +81,8 @@ GTlsBackend *  g_tls_backend_get_default                (void);
 
 GTlsDatabase * g_tls_backend_get_default_database       (GTlsBackend *backend);
 
+GTlsSessionCache * g_tls_backend_get_default_session_cache (GTlsBackend *backend);
+
 gboolean       g_tls_backend_supports_tls               (GTlsBackend *backend);
 
 GType          g_tls_backend_get_certificate_type       (GTlsBackend *backend);
@@ -28,6 +28,7 @@
 #include "gsocketconnectable.h"
 #include "gtlsbackend.h"
 #include "gtlscertificate.h"
+#include "gtlssessioncache.h"
 #include "glibintl.h"
 
 /**
@@ -37,6 +38,14 @@
  *
  * #GTlsClientConnection is the client-side subclass of
  * #GTlsConnection, representing a client-side TLS connection.
+ *
+ * A client connection tries to resume the last session it had with
+ * the same #GTlsClientConnection:server-identity, which saves the
+ * public key operations and a round trip of a full handshake. The
+ * sessions are kept in a #GTlsSessionCache; by default this is the
+ * one returned by g_tls_backend_get_default_session_cache(), but
+ * g_tls_client_connection_set_session_cache() can give a connection
+ * a private cache or turn resumption off.
  */
 
 /**
@@ -335,3 +344,88 @@ g_tls_client_connection_get_accepted_cas (GTlsClientConnection *conn)
   g_object_get (G_OBJECT (conn), "accepted-cas", &accepted_cas, NULL);
   return accepted_cas;
 }
+
+typedef struct {
+  GTlsSessionCache *cache;
+} SessionCacheData;
+
+static GQuark
+session_cache_quark (void)
+{
+  static GQuark quark;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("g-tls-client-connection-session-cache");
+  return quark;
+}
+
+static void
+session_cache_data_free (gpointer data)
+{
+  SessionCacheData *scd = data;
+
+  if (scd->cache)
+    g_object_unref (scd->cache);
+  g_slice_free (SessionCacheData, scd);
+}
+
+/**
+ * g_tls_client_connection_get_session_cache:
+ * @conn: the #GTlsClientConnection
+ *
+ * Gets the #GTlsSessionCache that @conn uses to resume an earlier
+ * session with its #GTlsClientConnection:server-identity, and to
+ * store the session it negotiates; see
+ * g_tls_client_connection_set_session_cache().
+ *
+ * Backends call this before the handshake, look up the session with
+ * g_tls_session_cache_lookup() and, once the handshake is done, store
+ * the (possibly new) session with g_tls_session_cache_store().
+ *
+ * Return value: (transfer none): the session cache, or %NULL if
+ * session resumption was turned off for @conn.
+ *
+ * Since: 2.34
+ */
+GTlsSessionCache *
+g_tls_client_connection_get_session_cache (GTlsClientConnection *conn)
+{
+  SessionCacheData *scd;
+
+  g_return_val_if_fail (G_IS_TLS_CLIENT_CONNECTION (conn), NULL);
+
+  scd = g_object_get_qdata (G_OBJECT (conn), session_cache_quark ());
+  if (scd)
+    return scd->cache;
+
+  return g_tls_backend_get_default_session_cache (g_tls_backend_get_default ());
+}
+
+/**
+ * g_tls_client_connection_set_session_cache:
+ * @conn: the #GTlsClientConnection
+ * @cache: (allow-none): a #GTlsSessionCache, or %NULL
+ *
+ * Sets the #GTlsSessionCache used by @conn, in place of the backend's
+ * default one. Passing %NULL turns session resumption off, so that
+ * @conn always does a full handshake and does not remember the
+ * session afterwards.
+ *
+ * This must be called before the handshake starts.
+ *
+ * Since: 2.34
+ */
+void
+g_tls_client_connection_set_session_cache (GTlsClientConnection *conn,
+					   GTlsSessionCache     *cache)
+{
+  SessionCacheData *scd;
+
+  g_return_if_fail (G_IS_TLS_CLIENT_CONNECTION (conn));
+  g_return_if_fail (cache == NULL || G_IS_TLS_SESSION_CACHE (cache));
+
+  scd = g_slice_new (SessionCacheData);
+  scd->cache = cache ? g_object_ref (cache) : NULL;
+  g_object_set_qdata_full (G_OBJECT (conn), session_cache_quark (),
+			   scd, session_cache_data_free);
+}
@@ -59,6 +59,10 @@ void                  g_tls_client_connection_set_use_ssl3         (GTlsClientCo
 								    gboolean                 use_ssl3);
 GList *               g_tls_client_connection_get_accepted_cas     (GTlsClientConnection    *conn);
 
+GTlsSessionCache *    g_tls_client_connection_get_session_cache    (GTlsClientConnection    *conn);
+void                  g_tls_client_connection_set_session_cache    (GTlsClientConnection    *conn,
+								    GTlsSessionCache        *cache);
+
 G_END_DECLS
 
 #endif /* __G_TLS_CLIENT_CONNECTION_H__ */
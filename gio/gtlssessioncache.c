@@ -0,0 +1,492 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright © 2012 Red Hat, Inc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "glib.h"
+#include "glibintl.h"
+
+#include "gtlssessioncache.h"
+#include "ginetaddress.h"
+#include "ginetsocketaddress.h"
+#include "gnetworkaddress.h"
+#include "gnetworkservice.h"
+#include "gproxyaddress.h"
+#include "gsocketconnectable.h"
+
+/**
+ * SECTION:gtlssessioncache
+ * @title: GTlsSessionCache
+ * @short_description: TLS session resumption cache
+ * @include: gio/gio.h
+ * @see_also: #GTlsClientConnection, #GTlsBackend
+ *
+ * #GTlsSessionCache holds the data TLS client connections need to
+ * resume an earlier session with a server (a session ID or ticket and
+ * the associated secrets), so that the next connection to the same
+ * server can do an abbreviated handshake instead of a full one. This
+ * saves a round trip with TLS 1.2 and below, and the public-key
+ * operations of a full handshake with every version.
+ *
+ * The session data is opaque and only meaningful to the #GTlsBackend
+ * that stored it. Entries are keyed by the server identity of the
+ * connection (see #GTlsClientConnection:server-identity): host name
+ * and port for a #GNetworkAddress, domain and service for a
+ * #GNetworkService, and IP address and port for a
+ * #GInetSocketAddress. Connections without a server identity are not
+ * cached.
+ *
+ * Client connections share the default cache of their backend (see
+ * g_tls_backend_get_default_session_cache()) unless they are given a
+ * different one with g_tls_client_connection_set_session_cache().
+ * The cache is thread-safe.
+ */
+
+/**
+ * GTlsSessionCache:
+ *
+ * A cache of TLS sessions that can be resumed.
+ *
+ * Since: 2.34
+ */
+
+enum
+{
+  PROP_0,
+  PROP_MAX_ENTRIES,
+  PROP_LIFETIME
+};
+
+typedef struct
+{
+  gchar *key;
+  GBytes *session_data;
+  gint64 expires;
+  GList *link;
+} GTlsSessionCacheEntry;
+
+struct _GTlsSessionCachePrivate
+{
+  guint max_entries;
+  guint lifetime;
+
+  GMutex lock;
+  GHashTable *entries;
+  GQueue lru; /* of GTlsSessionCacheEntry, most recently used first */
+};
+
+G_DEFINE_TYPE (GTlsSessionCache, g_tls_session_cache, G_TYPE_OBJECT);
+
+static void
+entry_free (gpointer data)
+{
+  GTlsSessionCacheEntry *entry = data;
+
+  g_free (entry->key);
+  g_bytes_unref (entry->session_data);
+  g_slice_free (GTlsSessionCacheEntry, entry);
+}
+
+/* Called with the lock held */
+static void
+remove_entry (GTlsSessionCache      *cache,
+	      GTlsSessionCacheEntry *entry)
+{
+  g_queue_delete_link (&cache->priv->lru, entry->link);
+  g_hash_table_remove (cache->priv->entries, entry->key);
+}
+
+static gchar *
+key_for_identity (GSocketConnectable *server_identity)
+{
+  if (G_IS_PROXY_ADDRESS (server_identity))
+    {
+      GProxyAddress *proxy = G_PROXY_ADDRESS (server_identity);
+
+      return g_strdup_printf ("%s:%u",
+			      g_proxy_address_get_destination_hostname (proxy),
+			      g_proxy_address_get_destination_port (proxy));
+    }
+  else if (G_IS_INET_SOCKET_ADDRESS (server_identity))
+    {
+      GInetSocketAddress *isaddr = G_INET_SOCKET_ADDRESS (server_identity);
+      gchar *address, *key;
+
+      address = g_inet_address_to_string (g_inet_socket_address_get_address (isaddr));
+      key = g_strdup_printf ("[%s]:%u", address,
+			     g_inet_socket_address_get_port (isaddr));
+      g_free (address);
+      return key;
+    }
+  else if (G_IS_NETWORK_ADDRESS (server_identity))
+    {
+      GNetworkAddress *naddr = G_NETWORK_ADDRESS (server_identity);
+
+      return g_strdup_printf ("%s:%u",
+			      g_network_address_get_hostname (naddr),
+			      g_network_address_get_port (naddr));
+    }
+  else if (G_IS_NETWORK_SERVICE (server_identity))
+    {
+      GNetworkService *srv = G_NETWORK_SERVICE (server_identity);
+
+      return g_strdup_printf ("%s/%s",
+			      g_network_service_get_domain (srv),
+			      g_network_service_get_service (srv));
+    }
+
+  return NULL;
+}
+
+static void
+g_tls_session_cache_init (GTlsSessionCache *cache)
+{
+  cache->priv = G_TYPE_INSTANCE_GET_PRIVATE (cache, G_TYPE_TLS_SESSION_CACHE,
+					     GTlsSessionCachePrivate);
+
+  g_mutex_init (&cache->priv->lock);
+  cache->priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+						NULL, entry_free);
+}
+
+static void
+g_tls_session_cache_finalize (GObject *object)
+{
+  GTlsSessionCache *cache = G_TLS_SESSION_CACHE (object);
+
+  g_queue_clear (&cache->priv->lru);
+  g_hash_table_unref (cache->priv->entries);
+  g_mutex_clear (&cache->priv->lock);
+
+  G_OBJECT_CLASS (g_tls_session_cache_parent_class)->finalize (object);
+}
+
+static void
+g_tls_session_cache_get_property (GObject    *object,
+				  guint       prop_id,
+				  GValue     *value,
+				  GParamSpec *pspec)
+{
+  GTlsSessionCache *cache = G_TLS_SESSION_CACHE (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_ENTRIES:
+      g_value_set_uint (value, cache->priv->max_entries);
+      break;
+    case PROP_LIFETIME:
+      g_value_set_uint (value, cache->priv->lifetime);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+g_tls_session_cache_set_property (GObject      *object,
+				  guint         prop_id,
+				  const GValue *value,
+				  GParamSpec   *pspec)
+{
+  GTlsSessionCache *cache = G_TLS_SESSION_CACHE (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_ENTRIES:
+      cache->priv->max_entries = g_value_get_uint (value);
+      break;
+    case PROP_LIFETIME:
+      cache->priv->lifetime = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+g_tls_session_cache_class_init (GTlsSessionCacheClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (GTlsSessionCachePrivate));
+
+  gobject_class->finalize = g_tls_session_cache_finalize;
+  gobject_class->get_property = g_tls_session_cache_get_property;
+  gobject_class->set_property = g_tls_session_cache_set_property;
+
+  /**
+   * GTlsSessionCache:max-entries:
+   *
+   * The maximum number of servers sessions are kept for. When the
+   * cache is full, the least recently used entry is dropped.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_ENTRIES,
+				   g_param_spec_uint ("max-entries",
+						      P_("Maximum entries"),
+						      P_("The maximum number of servers sessions are kept for"),
+						      1, G_MAXUINT, 256,
+						      G_PARAM_READWRITE |
+						      G_PARAM_CONSTRUCT_ONLY |
+						      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GTlsSessionCache:lifetime:
+   *
+   * How long a session is kept after it was stored, in seconds, or
+   * 0 to keep it until it is replaced or dropped to make room.
+   *
+   * Since: 2.34
+   */
+  g_object_class_install_property (gobject_class, PROP_LIFETIME,
+				   g_param_spec_uint ("lifetime",
+						      P_("Lifetime"),
+						      P_("How long sessions are kept in seconds, or 0 for no limit"),
+						      0, G_MAXUINT, 0,
+						      G_PARAM_READWRITE |
+						      G_PARAM_CONSTRUCT_ONLY |
+						      G_PARAM_STATIC_STRINGS));
+}
+
+/**
+ * g_tls_session_cache_new:
+ * @max_entries: the maximum number of servers to keep sessions for
+ * @lifetime: how long to keep sessions in seconds, or 0 for no limit
+ *
+ * Creates a new, empty #GTlsSessionCache. A session stored in the
+ * cache is dropped once @lifetime seconds have passed, or earlier if
+ * sessions for @max_entries other servers were used more recently.
+ *
+ * Servers usually stop accepting sessions after a while, so @lifetime
+ * should not be longer than they do; otherwise a resumption attempt
+ * with a stale session just falls back to a full handshake.
+ *
+ * Returns: (transfer full): a new #GTlsSessionCache
+ *
+ * Since: 2.34
+ */
+GTlsSessionCache *
+g_tls_session_cache_new (guint max_entries,
+			 guint lifetime)
+{
+  g_return_val_if_fail (max_entries > 0, NULL);
+
+  return g_object_new (G_TYPE_TLS_SESSION_CACHE,
+		       "max-entries", max_entries,
+		       "lifetime", lifetime,
+		       NULL);
+}
+
+/**
+ * g_tls_session_cache_lookup:
+ * @cache: a #GTlsSessionCache
+ * @server_identity: the server to look for
+ *
+ * Looks up the session stored for @server_identity, for a #GTlsBackend
+ * to try to resume it.
+ *
+ * This does not remove the session from @cache. If a session may only
+ * be used once, as with TLS 1.3 tickets, the backend should call
+ * g_tls_session_cache_remove() or store the new session it gets.
+ *
+ * Returns: (transfer full): the session data, or %NULL if there is
+ *     no session stored for @server_identity. Free with g_bytes_unref().
+ *
+ * Since: 2.34
+ */
+GBytes *
+g_tls_session_cache_lookup (GTlsSessionCache   *cache,
+			    GSocketConnectable *server_identity)
+{
+  GTlsSessionCacheEntry *entry;
+  GBytes *session_data = NULL;
+  gchar *key;
+
+  g_return_val_if_fail (G_IS_TLS_SESSION_CACHE (cache), NULL);
+  g_return_val_if_fail (G_IS_SOCKET_CONNECTABLE (server_identity), NULL);
+
+  key = key_for_identity (server_identity);
+  if (key == NULL)
+    return NULL;
+
+  g_mutex_lock (&cache->priv->lock);
+
+  entry = g_hash_table_lookup (cache->priv->entries, key);
+  if (entry && entry->expires && entry->expires <= g_get_monotonic_time ())
+    {
+      remove_entry (cache, entry);
+      entry = NULL;
+    }
+
+  if (entry)
+    {
+      g_queue_unlink (&cache->priv->lru, entry->link);
+      g_queue_push_head_link (&cache->priv->lru, entry->link);
+      session_data = g_bytes_ref (entry->session_data);
+    }
+
+  g_mutex_unlock (&cache->priv->lock);
+
+  g_free (key);
+  return session_data;
+}
+
+/**
+ * g_tls_session_cache_store:
+ * @cache: a #GTlsSessionCache
+ * @server_identity: the server the session was established with
+ * @session_data: the backend's data for resuming the session
+ *
+ * Stores a session established with @server_identity so that later
+ * connections to it can resume it, replacing any session already
+ * stored for it. This is called by #GTlsBackend implementations after
+ * a handshake, or when the server sends a new ticket.
+ *
+ * Since: 2.34
+ */
+void
+g_tls_session_cache_store (GTlsSessionCache   *cache,
+			   GSocketConnectable *server_identity,
+			   GBytes             *session_data)
+{
+  GTlsSessionCachePrivate *priv;
+  GTlsSessionCacheEntry *entry, *old;
+  gchar *key;
+
+  g_return_if_fail (G_IS_TLS_SESSION_CACHE (cache));
+  g_return_if_fail (G_IS_SOCKET_CONNECTABLE (server_identity));
+  g_return_if_fail (session_data != NULL);
+
+  key = key_for_identity (server_identity);
+  if (key == NULL)
+    return;
+
+  priv = cache->priv;
+  entry = g_slice_new (GTlsSessionCacheEntry);
+  entry->key = key;
+  entry->session_data = g_bytes_ref (session_data);
+  entry->expires = priv->lifetime ?
+    g_get_monotonic_time () + priv->lifetime * G_TIME_SPAN_SECOND : 0;
+
+  g_mutex_lock (&priv->lock);
+
+  old = g_hash_table_lookup (priv->entries, key);
+  if (old)
+    remove_entry (cache, old);
+
+  g_hash_table_insert (priv->entries, entry->key, entry);
+  g_queue_push_head (&priv->lru, entry);
+  entry->link = priv->lru.head;
+
+  while (priv->lru.length > priv->max_entries)
+    remove_entry (cache, priv->lru.tail->data);
+
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * g_tls_session_cache_remove:
+ * @cache: a #GTlsSessionCache
+ * @server_identity: the server to drop the session of
+ *
+ * Removes the session stored for @server_identity, if any. Backends
+ * call this when a server refuses to resume a session, or once a
+ * single-use ticket has been used.
+ *
+ * Since: 2.34
+ */
+void
+g_tls_session_cache_remove (GTlsSessionCache   *cache,
+			    GSocketConnectable *server_identity)
+{
+  GTlsSessionCacheEntry *entry;
+  gchar *key;
+
+  g_return_if_fail (G_IS_TLS_SESSION_CACHE (cache));
+  g_return_if_fail (G_IS_SOCKET_CONNECTABLE (server_identity));
+
+  key = key_for_identity (server_identity);
+  if (key == NULL)
+    return;
+
+  g_mutex_lock (&cache->priv->lock);
+  entry = g_hash_table_lookup (cache->priv->entries, key);
+  if (entry)
+    remove_entry (cache, entry);
+  g_mutex_unlock (&cache->priv->lock);
+
+  g_free (key);
+}
+
+/**
+ * g_tls_session_cache_clear:
+ * @cache: a #GTlsSessionCache
+ *
+ * Removes all the sessions from @cache, for instance because the
+ * client certificate used with them is no longer valid.
+ *
+ * Since: 2.34
+ */
+void
+g_tls_session_cache_clear (GTlsSessionCache *cache)
+{
+  g_return_if_fail (G_IS_TLS_SESSION_CACHE (cache));
+
+  g_mutex_lock (&cache->priv->lock);
+  g_queue_clear (&cache->priv->lru);
+  g_hash_table_remove_all (cache->priv->entries);
+  g_mutex_unlock (&cache->priv->lock);
+}
+
+/**
+ * g_tls_session_cache_get_max_entries:
+ * @cache: a #GTlsSessionCache
+ *
+ * Gets the maximum number of servers @cache keeps sessions for.
+ *
+ * Returns: the maximum number of entries
+ *
+ * Since: 2.34
+ */
+guint
+g_tls_session_cache_get_max_entries (GTlsSessionCache *cache)
+{
+  g_return_val_if_fail (G_IS_TLS_SESSION_CACHE (cache), 0);
+
+  return cache->priv->max_entries;
+}
+
+/**
+ * g_tls_session_cache_get_lifetime:
+ * @cache: a #GTlsSessionCache
+ *
+ * Gets how long @cache keeps sessions.
+ *
+ * Returns: the lifetime in seconds, or 0 for no limit
+ *
+ * Since: 2.34
+ */
+guint
+g_tls_session_cache_get_lifetime (GTlsSessionCache *cache)
+{
+  g_return_val_if_fail (G_IS_TLS_SESSION_CACHE (cache), 0);
+
+  return cache->priv->lifetime;
+}
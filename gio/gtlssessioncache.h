@@ -0,0 +1,77 @@
+/* GIO - GLib Input, Output and Streaming Library
+ *
+ * Copyright © 2012 Red Hat, Inc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined (__GIO_GIO_H_INSIDE__) && !defined (GIO_COMPILATION)
+#error "Only <gio/gio.h> can be included directly."
+#endif
+
+#ifndef __G_TLS_SESSION_CACHE_H__
+#define __G_TLS_SESSION_CACHE_H__
+
+#include <gio/giotypes.h>
+
+G_BEGIN_DECLS
+
+#define G_TYPE_TLS_SESSION_CACHE         (g_tls_session_cache_get_type ())
+#define G_TLS_SESSION_CACHE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), G_TYPE_TLS_SESSION_CACHE, GTlsSessionCache))
+#define G_TLS_SESSION_CACHE_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), G_TYPE_TLS_SESSION_CACHE, GTlsSessionCacheClass))
+#define G_IS_TLS_SESSION_CACHE(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), G_TYPE_TLS_SESSION_CACHE))
+#define G_IS_TLS_SESSION_CACHE_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), G_TYPE_TLS_SESSION_CACHE))
+#define G_TLS_SESSION_CACHE_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), G_TYPE_TLS_SESSION_CACHE, GTlsSessionCacheClass))
+
+typedef struct _GTlsSessionCacheClass   GTlsSessionCacheClass;
+typedef struct _GTlsSessionCachePrivate GTlsSessionCachePrivate;
+
+struct _GTlsSessionCache
+{
+  GObject parent_instance;
+
+  GTlsSessionCachePrivate *priv;
+};
+
+struct _GTlsSessionCacheClass
+{
+  GObjectClass parent_class;
+
+  /*< private >*/
+  /* Padding for future expansion */
+  gpointer padding[8];
+};
+
+GType              g_tls_session_cache_get_type        (void) G_GNUC_CONST;
+
+GTlsSessionCache * g_tls_session_cache_new             (guint               max_entries,
+							guint               lifetime);
+
+GBytes *           g_tls_session_cache_lookup          (GTlsSessionCache   *cache,
+							GSocketConnectable *server_identity);
+void               g_tls_session_cache_store           (GTlsSessionCache   *cache,
+							GSocketConnectable *server_identity,
+							GBytes             *session_data);
+void               g_tls_session_cache_remove          (GTlsSessionCache   *cache,
+							GSocketConnectable *server_identity);
+void               g_tls_session_cache_clear           (GTlsSessionCache   *cache);
+
+guint              g_tls_session_cache_get_max_entries (GTlsSessionCache   *cache);
+guint              g_tls_session_cache_get_lifetime    (GTlsSessionCache   *cache);
+
+G_END_DECLS
+
+#endif /* __G_TLS_SESSION_CACHE_H__ */
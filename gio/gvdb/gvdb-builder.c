@@ -342,6 +342,39 @@ file_builder_allocate_for_hash (FileBuilder            *fb,
   memset (*bloom_filter, 0, n_bloom_words * sizeof (guint32_le));
 }
 
+/* The bloom filter sets two bits per item: bit (hash % 32) and bit
+ * ((hash >> GVDB_BLOOM_SHIFT) % 32) of word ((hash / 32) % n_bloom_words).
+ * With one word per 4 items (8 bits per item) this rejects about 95% of
+ * lookups for absent keys without touching the hash chains.  An odd
+ * number of words makes the word index depend on all the bits of the
+ * hash, so that it is not correlated with the second bit.
+ */
+#define GVDB_BLOOM_SHIFT          10
+#define GVDB_BLOOM_ITEMS_PER_WORD 4
+
+static gsize
+bloom_words_for_items (gsize n_items)
+{
+  if (n_items == 0)
+    return 0;
+
+  return ((n_items + GVDB_BLOOM_ITEMS_PER_WORD - 1) / GVDB_BLOOM_ITEMS_PER_WORD) | 1;
+}
+
+static void
+bloom_filter_add (guint32_le *bloom_filter,
+                  gsize       n_bloom_words,
+                  guint32     hash_value)
+{
+  guint32 word, mask;
+
+  word = (hash_value / 32) % n_bloom_words;
+  mask = 1u << (hash_value & 31);
+  mask |= 1u << ((hash_value >> GVDB_BLOOM_SHIFT) & 31);
+
+  bloom_filter[word] = guint32_to_le (guint32_from_le (bloom_filter[word]) | mask);
+}
+
 static void
 file_builder_add_hash (FileBuilder         *fb,
                        GHashTable          *table,
@@ -351,6 +384,7 @@ file_builder_add_hash (FileBuilder         *fb,
   struct gvdb_hash_item *items;
   HashTable *mytable;
   GvdbItem *item;
+  gsize n_bloom_words;
   guint32 index;
   gint bucket;
 
@@ -362,7 +396,9 @@ file_builder_add_hash (FileBuilder         *fb,
     for (item = mytable->buckets[bucket]; item; item = item->next)
       item->assigned_index = guint32_to_le (index++);
 
-  file_builder_allocate_for_hash (fb, mytable->n_buckets, index, 5, 0,
+  n_bloom_words = bloom_words_for_items (index);
+  file_builder_allocate_for_hash (fb, mytable->n_buckets, index,
+                                  GVDB_BLOOM_SHIFT, n_bloom_words,
                                   &bloom_filter, &buckets, &items, pointer);
 
   index = 0;
@@ -377,6 +413,7 @@ file_builder_add_hash (FileBuilder         *fb,
 
           g_assert (index == guint32_from_le (item->assigned_index));
           entry->hash_value = guint32_to_le (item->hash_value);
+          bloom_filter_add (bloom_filter, n_bloom_words, item->hash_value);
           entry->parent = item_to_index (item->parent);
           entry->unused = 0;
 
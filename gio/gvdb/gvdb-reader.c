@@ -102,6 +102,7 @@ gvdb_table_setup_root (GvdbTable                 *file,
 
   n_bloom_words = guint32_from_le (header->n_bloom_words);
   n_buckets = guint32_from_le (header->n_buckets);
+  file->bloom_shift = n_bloom_words >> 27;
   n_bloom_words &= (1u << 27) - 1;
 
   if G_UNLIKELY (n_bloom_words * sizeof (guint32_le) > size)
@@ -266,8 +267,8 @@ gvdb_table_bloom_filter (GvdbTable *file,
     return TRUE;
 
   word = (hash_value / 32) % file->n_bloom_words;
-  mask = 1 << (hash_value & 31);
-  mask |= 1 << ((hash_value >> file->bloom_shift) & 31);
+  mask = 1u << (hash_value & 31);
+  mask |= 1u << ((hash_value >> file->bloom_shift) & 31);
 
   return (guint32_from_le (file->bloom_words[word]) & mask) == mask;
 }
@@ -440,6 +441,102 @@ gvdb_table_list (GvdbTable   *file,
   return strv;
 }
 
+/**
+ * gvdb_table_get_names:
+ * @table: a #GvdbTable
+ * @length: (allow-none): the number of items returned, or %NULL
+ * @returns: a %NULL-terminated string array
+ *
+ * Gets a list of the full names of all items in @table, in no
+ * particular order.  This includes the names of non-value nodes.
+ *
+ * Items with corrupt names or parents are left out.
+ *
+ * You should call g_strfreev() on the return result when you no longer
+ * require it.
+ **/
+gchar **
+gvdb_table_get_names (GvdbTable *table,
+                      gint      *length)
+{
+  gchar **names;
+  guint n_names;
+  guint filled;
+  guint total;
+  guint i;
+
+  /* Each item only stores its own part of the name and a link to its
+   * parent.  We resolve names in passes: each pass fills in the items
+   * whose parent has been resolved by a previous one, so the number of
+   * passes is bounded by the nesting depth.  We stop as soon as a pass
+   * makes no progress, which also protects us against parent loops.
+   */
+  n_names = table->n_hash_items;
+  names = g_new0 (gchar *, n_names + 1);
+
+  total = 0;
+  do
+    {
+      filled = 0;
+
+      for (i = 0; i < n_names; i++)
+        {
+          const struct gvdb_hash_item *item = &table->hash_items[i];
+          const gchar *name;
+          gsize name_length;
+          guint32 parent;
+
+          if (names[i] != NULL)
+            continue;
+
+          name = gvdb_table_item_get_key (table, item, &name_length);
+          if (name == NULL)
+            continue;
+
+          parent = guint32_from_le (item->parent);
+
+          if (parent == 0xffffffffu)
+            {
+              names[i] = g_strndup (name, name_length);
+              filled++;
+            }
+          else if (parent < n_names && names[parent] != NULL)
+            {
+              gsize parent_length;
+              gchar *fullname;
+
+              parent_length = strlen (names[parent]);
+              fullname = g_malloc (parent_length + name_length + 1);
+              memcpy (fullname, names[parent], parent_length);
+              memcpy (fullname + parent_length, name, name_length);
+              fullname[parent_length + name_length] = '\0';
+              names[i] = fullname;
+              filled++;
+            }
+        }
+
+      total += filled;
+    }
+  while (filled && total < n_names);
+
+  /* Squeeze out the names that could not be resolved */
+  if (total < n_names)
+    {
+      guint j = 0;
+
+      for (i = 0; i < n_names; i++)
+        if (names[i] != NULL)
+          names[j++] = names[i];
+
+      names[j] = NULL;
+    }
+
+  if (length)
+    *length = total;
+
+  return names;
+}
+
 /**
  * gvdb_table_has_value:
  * @file: a #GvdbTable
@@ -0,0 +1,678 @@
+/*
+ * Copyright © 2012 Red Hat, Inc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "gfile.h"
+#include "gfilemonitor.h"
+#include "giomodule.h"
+#include "gsettingsbackendinternal.h"
+#include "gvdb/gvdb-reader.h"
+#include "gvdb/gvdb-builder.h"
+
+/* A settings backend that keeps all keys in a single GVDB database,
+ * shared between all processes of the user.
+ *
+ * Readers map the database and hand out values that point straight into
+ * the mapping.  Next to the database lives a small file holding a change
+ * counter that every process maps shared; a writer replaces the database
+ * (atomically, by renaming a new one into place) and then increments the
+ * counter.  A read therefore only has to compare the counter with the
+ * value it saw when it last opened the database to know whether it is
+ * current, and a write in one process is visible to reads in all others
+ * immediately.
+ *
+ * Reads take no lock.  The open database is published in one of two
+ * slots, and a reader pins the current slot by counting itself in it.
+ * When the counter moves on, the database is reopened into the other
+ * slot (under a lock, but only once per change) and that slot becomes
+ * current; the table it held before is dropped once its last reader has
+ * left.
+ *
+ * Change notification is driven by a file monitor on the database: when
+ * it fires we diff the new database against what we last told our
+ * listeners and emit a single change signal for everything that differs.
+ * Our own writes are signalled directly, and remembered so that the
+ * monitor does not report them a second time.
+ *
+ * Concurrent writers are serialised with a lock on the counter file.
+ * Such locks belong to the whole process, so the threads of one process
+ * (and several backends in it) also take a process-wide mutex.
+ */
+
+#define G_TYPE_GVDB_SETTINGS_BACKEND      (g_gvdb_settings_backend_get_type ())
+#define G_GVDB_SETTINGS_BACKEND(inst)     (G_TYPE_CHECK_INSTANCE_CAST ((inst),      \
+                                           G_TYPE_GVDB_SETTINGS_BACKEND,            \
+                                           GGvdbSettingsBackend))
+
+typedef GSettingsBackendClass GGvdbSettingsBackendClass;
+
+typedef struct
+{
+  GvdbTable         *table;
+  volatile gint      readers;
+} TableSlot;
+
+typedef struct
+{
+  GSettingsBackend   parent_instance;
+
+  gchar             *filename;
+  gint               seq_fd;
+  volatile gint     *seq;
+  gint               private_seq;
+  gboolean           writable;
+
+  TableSlot          slots[2];
+  volatile gint      current_slot;
+  volatile gint      table_seq;
+
+  GMutex             lock;            /* held while reopening the table */
+  GvdbTable         *notified_table;  /* protected by lock */
+  GHashTable        *notified_writes; /* protected by lock */
+
+  GFileMonitor      *monitor;
+} GGvdbSettingsBackend;
+
+/* lockf() locks are per process, so they do not keep two of our own
+ * threads from writing at the same time
+ */
+static GMutex g_gvdb_settings_backend_write_lock;
+
+enum
+{
+  PROP_0,
+  PROP_FILENAME
+};
+
+G_DEFINE_TYPE_WITH_CODE (GGvdbSettingsBackend,
+                         g_gvdb_settings_backend,
+                         G_TYPE_SETTINGS_BACKEND,
+                         g_io_extension_point_implement (G_SETTINGS_BACKEND_EXTENSION_POINT_NAME,
+                                                         g_define_type_id, "gvdb", 5))
+
+static void
+g_gvdb_settings_backend_reopen (GGvdbSettingsBackend *gsb,
+                                gint                  seq)
+{
+  TableSlot *slot;
+  gint next;
+
+  g_mutex_lock (&gsb->lock);
+
+  if (seq != gsb->table_seq)
+    {
+      next = !gsb->current_slot;
+      slot = &gsb->slots[next];
+
+      /* Readers leave the slot as soon as they see that it is not
+       * current, or when they are done with a lookup that started
+       * before it stopped being current.
+       */
+      while (g_atomic_int_get (&slot->readers))
+        g_thread_yield ();
+
+      if (slot->table)
+        gvdb_table_unref (slot->table);
+
+      /* The counter is only bumped after the new database has been
+       * renamed into place, so if we see the new value we also open
+       * the new file.
+       */
+      slot->table = gvdb_table_new (gsb->filename, FALSE, NULL);
+
+      g_atomic_int_set (&gsb->current_slot, next);
+      g_atomic_int_set (&gsb->table_seq, seq);
+    }
+
+  g_mutex_unlock (&gsb->lock);
+}
+
+/* Returns the slot of the current database, which stays valid until
+ * it is given back with g_gvdb_settings_backend_unpin().  Its table is
+ * NULL if the database does not exist (yet).
+ */
+static TableSlot *
+g_gvdb_settings_backend_pin (GGvdbSettingsBackend *gsb)
+{
+  TableSlot *slot;
+  gint seq;
+
+  seq = g_atomic_int_get (gsb->seq);
+  if (seq != g_atomic_int_get (&gsb->table_seq))
+    g_gvdb_settings_backend_reopen (gsb, seq);
+
+  while (TRUE)
+    {
+      slot = &gsb->slots[g_atomic_int_get (&gsb->current_slot)];
+      g_atomic_int_inc (&slot->readers);
+
+      if (slot == &gsb->slots[g_atomic_int_get (&gsb->current_slot)])
+        return slot;
+
+      g_atomic_int_add (&slot->readers, -1);
+    }
+}
+
+static void
+g_gvdb_settings_backend_unpin (TableSlot *slot)
+{
+  g_atomic_int_add (&slot->readers, -1);
+}
+
+/* Returns a reference to the current database, or NULL if it does not
+ * exist (yet).
+ */
+static GvdbTable *
+g_gvdb_settings_backend_get_table (GGvdbSettingsBackend *gsb)
+{
+  GvdbTable *table;
+  TableSlot *slot;
+
+  slot = g_gvdb_settings_backend_pin (gsb);
+  table = slot->table ? gvdb_table_ref (slot->table) : NULL;
+  g_gvdb_settings_backend_unpin (slot);
+
+  return table;
+}
+
+static GVariant *
+g_gvdb_settings_backend_read (GSettingsBackend   *backend,
+                              const gchar        *key,
+                              const GVariantType *expected_type,
+                              gboolean            default_value)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (backend);
+  GVariant *value = NULL;
+  TableSlot *slot;
+
+  if (default_value)
+    return NULL;
+
+  slot = g_gvdb_settings_backend_pin (gsb);
+  if (slot->table != NULL)
+    value = gvdb_table_get_value (slot->table, key);
+  g_gvdb_settings_backend_unpin (slot);
+
+  if (value != NULL && !g_variant_is_of_type (value, expected_type))
+    {
+      g_variant_unref (value);
+      value = NULL;
+    }
+
+  return value;
+}
+
+static gboolean
+g_gvdb_settings_backend_add_change (gpointer key,
+                                    gpointer value,
+                                    gpointer user_data)
+{
+  GHashTable *table = user_data;
+
+  if (value != NULL)
+    gvdb_item_set_value (gvdb_hash_table_insert (table, key), value);
+  else
+    g_hash_table_remove (table, key);
+
+  return FALSE;
+}
+
+static gboolean
+g_gvdb_settings_backend_add_notified (gpointer key,
+                                      gpointer value,
+                                      gpointer user_data)
+{
+  GHashTable *notified_writes = user_data;
+
+  g_hash_table_insert (notified_writes, g_strdup (key),
+                       value ? g_variant_ref (value) : NULL);
+
+  return FALSE;
+}
+
+/* Applies @changes (a tree of keys to values, %NULL meaning reset) to
+ * the database on disk.  The database is re-read under the lock rather
+ * than taken from our cache so that concurrent writes from other
+ * processes are never lost.
+ */
+static gboolean
+g_gvdb_settings_backend_commit (GGvdbSettingsBackend *gsb,
+                                GTree                *changes)
+{
+  GHashTable *table;
+  GvdbTable *old_table;
+  gboolean success;
+
+  if (!gsb->writable)
+    return FALSE;
+
+  g_mutex_lock (&g_gvdb_settings_backend_write_lock);
+
+  if (lockf (gsb->seq_fd, F_LOCK, 0) != 0)
+    {
+      g_mutex_unlock (&g_gvdb_settings_backend_write_lock);
+      return FALSE;
+    }
+
+  table = gvdb_hash_table_new (NULL, NULL);
+
+  old_table = gvdb_table_new (gsb->filename, FALSE, NULL);
+  if (old_table != NULL)
+    {
+      gchar **names;
+      gint n_names, i;
+
+      names = gvdb_table_get_names (old_table, &n_names);
+      for (i = 0; i < n_names; i++)
+        {
+          GVariant *value;
+
+          value = gvdb_table_get_value (old_table, names[i]);
+          if (value != NULL)
+            {
+              gvdb_item_set_value (gvdb_hash_table_insert (table, names[i]), value);
+              g_variant_unref (value);
+            }
+        }
+
+      g_strfreev (names);
+      gvdb_table_unref (old_table);
+    }
+
+  g_tree_foreach (changes, g_gvdb_settings_backend_add_change, table);
+
+  success = gvdb_table_write_contents (table, gsb->filename, FALSE, NULL);
+  g_hash_table_unref (table);
+
+  if (success)
+    {
+      g_atomic_int_inc (gsb->seq);
+
+      /* We emit the signals for our own changes directly; make sure the
+       * file monitor doesn't report them a second time.  The database
+       * we just wrote may also hold changes from other processes that
+       * the monitor has yet to report, so only our own keys count as
+       * notified.
+       */
+      g_mutex_lock (&gsb->lock);
+      g_tree_foreach (changes, g_gvdb_settings_backend_add_notified, gsb->notified_writes);
+      g_mutex_unlock (&gsb->lock);
+    }
+
+  lockf (gsb->seq_fd, F_ULOCK, 0);
+  g_mutex_unlock (&g_gvdb_settings_backend_write_lock);
+
+  return success;
+}
+
+static gboolean
+g_gvdb_settings_backend_write_tree (GSettingsBackend *backend,
+                                    GTree            *tree,
+                                    gpointer          origin_tag)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (backend);
+
+  if (!g_gvdb_settings_backend_commit (gsb, tree))
+    return FALSE;
+
+  g_settings_backend_changed_tree (backend, tree, origin_tag);
+
+  return TRUE;
+}
+
+static gboolean
+g_gvdb_settings_backend_write (GSettingsBackend *backend,
+                               const gchar      *key,
+                               GVariant         *value,
+                               gpointer          origin_tag)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (backend);
+  gboolean success;
+  GTree *tree;
+
+  tree = g_settings_backend_create_tree ();
+  g_tree_insert (tree, g_strdup (key), g_variant_ref_sink (value));
+  success = g_gvdb_settings_backend_commit (gsb, tree);
+  g_tree_unref (tree);
+
+  if (success)
+    g_settings_backend_changed (backend, key, origin_tag);
+
+  return success;
+}
+
+static void
+g_gvdb_settings_backend_reset (GSettingsBackend *backend,
+                               const gchar      *key,
+                               gpointer          origin_tag)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (backend);
+  GTree *tree;
+
+  tree = g_settings_backend_create_tree ();
+  g_tree_insert (tree, g_strdup (key), NULL);
+
+  if (g_gvdb_settings_backend_commit (gsb, tree))
+    g_settings_backend_changed (backend, key, origin_tag);
+
+  g_tree_unref (tree);
+}
+
+static gboolean
+g_gvdb_settings_backend_get_writable (GSettingsBackend *backend,
+                                      const gchar      *name)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (backend);
+
+  return gsb->writable;
+}
+
+static void
+maybe_unref_value (gpointer value)
+{
+  if (value)
+    g_variant_unref (value);
+}
+
+/* Adds @key to @tree if its value in @new_table differs from the one
+ * we last notified about: our own write of it if there was one since
+ * @old_table, and its value in @old_table otherwise.
+ */
+static void
+diff_key (GTree       *tree,
+          const gchar *key,
+          GvdbTable   *old_table,
+          GHashTable  *writes,
+          GvdbTable   *new_table)
+{
+  GVariant *old_value, *new_value;
+  gpointer value;
+
+  if (g_tree_lookup_extended (tree, key, NULL, NULL))
+    return;
+
+  if (g_hash_table_lookup_extended (writes, key, NULL, &value))
+    old_value = value ? g_variant_ref (value) : NULL;
+  else
+    old_value = old_table ? gvdb_table_get_value (old_table, key) : NULL;
+
+  new_value = new_table ? gvdb_table_get_value (new_table, key) : NULL;
+
+  if (old_value == NULL ? new_value != NULL :
+      new_value == NULL || !g_variant_equal (old_value, new_value))
+    g_tree_insert (tree, g_strdup (key), NULL);
+
+  maybe_unref_value (old_value);
+  maybe_unref_value (new_value);
+}
+
+static void
+diff_table_keys (GTree      *tree,
+                 GvdbTable  *table,
+                 GvdbTable  *old_table,
+                 GHashTable *writes,
+                 GvdbTable  *new_table)
+{
+  gchar **names;
+  gint n_names, i;
+
+  if (table == NULL)
+    return;
+
+  names = gvdb_table_get_names (table, &n_names);
+  for (i = 0; i < n_names; i++)
+    diff_key (tree, names[i], old_table, writes, new_table);
+  g_strfreev (names);
+}
+
+static void
+file_changed (GFileMonitor      *monitor,
+              GFile             *file,
+              GFile             *other_file,
+              GFileMonitorEvent  event_type,
+              gpointer           user_data)
+{
+  GGvdbSettingsBackend *gsb = user_data;
+  GvdbTable *old_table, *new_table;
+  GHashTable *writes;
+  GHashTableIter iter;
+  gpointer key;
+  GTree *tree;
+
+  /* Without a shared counter, the monitor is our only way to notice */
+  if (gsb->seq == &gsb->private_seq)
+    g_atomic_int_inc (gsb->seq);
+
+  new_table = g_gvdb_settings_backend_get_table (gsb);
+
+  g_mutex_lock (&gsb->lock);
+  old_table = gsb->notified_table;
+  gsb->notified_table = new_table;
+  writes = gsb->notified_writes;
+  gsb->notified_writes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, maybe_unref_value);
+  g_mutex_unlock (&gsb->lock);
+
+  tree = g_tree_new_full ((GCompareDataFunc) strcmp, NULL, g_free, NULL);
+
+  if (old_table != new_table)
+    {
+      diff_table_keys (tree, old_table, old_table, writes, new_table);
+      diff_table_keys (tree, new_table, old_table, writes, new_table);
+    }
+
+  g_hash_table_iter_init (&iter, writes);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    diff_key (tree, key, old_table, writes, new_table);
+
+  if (g_tree_nnodes (tree) > 0)
+    g_settings_backend_changed_tree (G_SETTINGS_BACKEND (gsb), tree, NULL);
+
+  g_tree_unref (tree);
+  g_hash_table_unref (writes);
+
+  if (old_table)
+    gvdb_table_unref (old_table);
+}
+
+static void
+g_gvdb_settings_backend_open_seq (GGvdbSettingsBackend *gsb)
+{
+  gchar *seq_filename;
+  struct stat buf;
+  gpointer map;
+
+  gsb->seq = &gsb->private_seq;
+
+  seq_filename = g_strconcat (gsb->filename, ".seq", NULL);
+  gsb->seq_fd = g_open (seq_filename, O_RDWR | O_CREAT, 0600);
+  g_free (seq_filename);
+
+  if (gsb->seq_fd < 0)
+    return;
+
+  if (fstat (gsb->seq_fd, &buf) != 0 ||
+      (buf.st_size < sizeof (gint) && ftruncate (gsb->seq_fd, sizeof (gint)) != 0))
+    return;
+
+  map = mmap (NULL, sizeof (gint), PROT_READ | PROT_WRITE, MAP_SHARED, gsb->seq_fd, 0);
+  if (map == MAP_FAILED)
+    return;
+
+  gsb->seq = map;
+}
+
+static void
+g_gvdb_settings_backend_constructed (GObject *object)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (object);
+  gchar *dirname;
+  GFile *file;
+
+  if (gsb->filename == NULL)
+    gsb->filename = g_build_filename (g_get_user_config_dir (),
+                                      "glib-2.0", "settings", "settings.gvdb",
+                                      NULL);
+
+  dirname = g_path_get_dirname (gsb->filename);
+  g_mkdir_with_parents (dirname, 0700);
+  g_gvdb_settings_backend_open_seq (gsb);
+
+  /* Lets readers that cache values notice changes from other
+   * processes before the file monitor reports them
+   */
+  g_settings_backend_set_serial_location (G_SETTINGS_BACKEND (gsb), gsb->seq);
+
+  /* We can only take part in the protocol if we share the counter */
+  gsb->writable = gsb->seq != &gsb->private_seq &&
+                  g_access (dirname, W_OK | X_OK) == 0;
+  g_free (dirname);
+
+  /* Make sure that the first read opens the database */
+  gsb->table_seq = g_atomic_int_get (gsb->seq) - 1;
+  gsb->notified_table = g_gvdb_settings_backend_get_table (gsb);
+  gsb->notified_writes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, maybe_unref_value);
+
+  file = g_file_new_for_path (gsb->filename);
+  gsb->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+  g_object_unref (file);
+
+  if (gsb->monitor)
+    g_signal_connect (gsb->monitor, "changed", G_CALLBACK (file_changed), gsb);
+
+  G_OBJECT_CLASS (g_gvdb_settings_backend_parent_class)->constructed (object);
+}
+
+static void
+g_gvdb_settings_backend_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (object);
+
+  switch (prop_id)
+    {
+    case PROP_FILENAME:
+      gsb->filename = g_value_dup_string (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+g_gvdb_settings_backend_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (object);
+
+  switch (prop_id)
+    {
+    case PROP_FILENAME:
+      g_value_set_string (value, gsb->filename);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+g_gvdb_settings_backend_finalize (GObject *object)
+{
+  GGvdbSettingsBackend *gsb = G_GVDB_SETTINGS_BACKEND (object);
+
+  if (gsb->monitor)
+    {
+      g_signal_handlers_disconnect_by_func (gsb->monitor, file_changed, gsb);
+      g_file_monitor_cancel (gsb->monitor);
+      g_object_unref (gsb->monitor);
+    }
+
+  if (gsb->seq != &gsb->private_seq)
+    munmap ((gpointer) gsb->seq, sizeof (gint));
+
+  if (gsb->seq_fd >= 0)
+    close (gsb->seq_fd);
+
+  if (gsb->slots[0].table)
+    gvdb_table_unref (gsb->slots[0].table);
+
+  if (gsb->slots[1].table)
+    gvdb_table_unref (gsb->slots[1].table);
+
+  if (gsb->notified_table)
+    gvdb_table_unref (gsb->notified_table);
+
+  g_hash_table_unref (gsb->notified_writes);
+
+  g_mutex_clear (&gsb->lock);
+  g_free (gsb->filename);
+
+  G_OBJECT_CLASS (g_gvdb_settings_backend_parent_class)
+    ->finalize (object);
+}
+
+static void
+g_gvdb_settings_backend_init (GGvdbSettingsBackend *gsb)
+{
+  gsb->seq_fd = -1;
+  g_mutex_init (&gsb->lock);
+}
+
+static void
+g_gvdb_settings_backend_class_init (GGvdbSettingsBackendClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->constructed = g_gvdb_settings_backend_constructed;
+  object_class->set_property = g_gvdb_settings_backend_set_property;
+  object_class->get_property = g_gvdb_settings_backend_get_property;
+  object_class->finalize = g_gvdb_settings_backend_finalize;
+
+  class->read = g_gvdb_settings_backend_read;
+  class->write = g_gvdb_settings_backend_write;
+  class->write_tree = g_gvdb_settings_backend_write_tree;
+  class->reset = g_gvdb_settings_backend_reset;
+  class->get_writable = g_gvdb_settings_backend_get_writable;
+
+  g_object_class_install_property (object_class, PROP_FILENAME,
+    g_param_spec_string ("filename", "Filename",
+                         "The location of the settings database",
+                         NULL,
+                         G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                         G_PARAM_STATIC_STRINGS));
+}
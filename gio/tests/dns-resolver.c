@@ -0,0 +1,811 @@
+/* GLib testing framework examples and tests
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+/* private, but exported for tests */
+GType g_dns_resolver_get_type (void);
+
+#define T_A     1
+#define T_CNAME 5
+#define T_PTR   12
+#define T_AAAA  28
+#define T_SRV   33
+
+/* A stand-in DNS server, answering from the table below on its own
+ * thread. Queries for names starting with "tcp." get a truncated
+ * reply over UDP, so they have to be asked again over TCP. CNAMEs
+ * are followed, and a record with an owner is answered under that
+ * name instead of its own, like a spoofed reply would be.
+ */
+typedef struct {
+  const gchar *name;
+  guint16 type;
+  const gchar *data;
+  const gchar *owner;
+} Record;
+
+static const Record records[] = {
+  { "www.example.com", T_AAAA, "2001:db8::1" },
+  { "www.example.com", T_A, "192.0.2.1" },
+  { "v4.example.com", T_A, "192.0.2.2" },
+  { "host.search.test", T_A, "192.0.2.3" },
+  { "tcp.example.com", T_A, "192.0.2.4" },
+  { "tcp.example.com", T_A, "192.0.2.5" },
+  { "1.2.0.192.in-addr.arpa", T_PTR, "www.example.com" },
+  { "_http._tcp.example.com", T_SRV, "www.example.com" },
+  { "alias.example.com", T_CNAME, "alias2.example.com" },
+  { "alias2.example.com", T_CNAME, "v4.example.com" },
+  { "stray.example.com", T_A, "192.0.2.6", "v4.example.com" },
+};
+
+typedef struct {
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GSocket *udp;
+  GSocket *tcp;
+  GSocket *dead;
+  guint16 port;
+  guint16 dead_port;
+  volatile gint udp_queries;
+  volatile gint tcp_queries;
+} Server;
+
+static Server server;
+static gchar *resolv_conf;
+static gchar *hosts_file;
+
+static void
+put_uint16 (GByteArray *array,
+            guint16     value)
+{
+  guint8 bytes[2] = { value >> 8, value & 0xff };
+
+  g_byte_array_append (array, bytes, 2);
+}
+
+static void
+put_name (GByteArray  *array,
+          const gchar *name)
+{
+  gchar **labels;
+  gint i;
+
+  labels = g_strsplit (name, ".", -1);
+  for (i = 0; labels[i]; i++)
+    {
+      guint8 label_len = strlen (labels[i]);
+
+      g_byte_array_append (array, &label_len, 1);
+      g_byte_array_append (array, (guint8 *) labels[i], label_len);
+    }
+  g_byte_array_append (array, (guint8 *) "", 1);
+  g_strfreev (labels);
+}
+
+static GByteArray *
+build_reply (const guchar *query,
+             gsize         len,
+             gboolean      tcp)
+{
+  GByteArray *reply;
+  GString *name;
+  const Record *answers[G_N_ELEMENTS (records)];
+  const gchar *current, *next;
+  guint n_answers = 0;
+  gsize pos = 12;
+  guint16 type;
+  gboolean known = FALSE, truncate;
+  guint i;
+
+  name = g_string_new (NULL);
+  while (pos < len && query[pos])
+    {
+      if (name->len)
+        g_string_append_c (name, '.');
+      g_string_append_len (name, (const gchar *) query + pos + 1, query[pos]);
+      pos += query[pos] + 1;
+    }
+  pos++;
+  g_assert_cmpuint (pos + 4, <=, len);
+  type = (query[pos] << 8) | query[pos + 1];
+  pos += 4;
+
+  for (current = name->str; current; current = next)
+    {
+      next = NULL;
+      for (i = 0; i < G_N_ELEMENTS (records); i++)
+        {
+          if (g_ascii_strcasecmp (records[i].name, current) != 0)
+            continue;
+          known = TRUE;
+          if (records[i].type == type)
+            answers[n_answers++] = &records[i];
+          else if (records[i].type == T_CNAME)
+            {
+              answers[n_answers++] = &records[i];
+              next = records[i].data;
+            }
+        }
+    }
+
+  truncate = !tcp && g_str_has_prefix (name->str, "tcp.");
+  if (truncate)
+    n_answers = 0;
+
+  reply = g_byte_array_new ();
+  g_byte_array_append (reply, query, 2);
+  put_uint16 (reply, 0x8180 | (truncate ? 0x0200 : 0) | (known ? 0 : 3));
+  put_uint16 (reply, 1);
+  put_uint16 (reply, n_answers);
+  put_uint16 (reply, 0);
+  put_uint16 (reply, 0);
+  g_byte_array_append (reply, query + 12, pos - 12);
+
+  for (i = 0; i < n_answers; i++)
+    {
+      GInetAddress *address;
+      gsize rdlength_pos;
+
+      if (answers[i]->owner)
+        put_name (reply, answers[i]->owner);
+      else if (g_ascii_strcasecmp (answers[i]->name, name->str) != 0)
+        put_name (reply, answers[i]->name);
+      else
+        {
+          /* compressed pointer to the question name */
+          put_uint16 (reply, 0xc00c);
+        }
+      put_uint16 (reply, answers[i]->type);
+      put_uint16 (reply, 1);
+      put_uint16 (reply, 0);
+      put_uint16 (reply, 300);
+      rdlength_pos = reply->len;
+      put_uint16 (reply, 0);
+
+      switch (answers[i]->type)
+        {
+        case T_A:
+        case T_AAAA:
+          address = g_inet_address_new_from_string (answers[i]->data);
+          g_byte_array_append (reply, g_inet_address_to_bytes (address),
+                               g_inet_address_get_native_size (address));
+          g_object_unref (address);
+          break;
+
+        case T_SRV:
+          put_uint16 (reply, 10);
+          put_uint16 (reply, 5);
+          put_uint16 (reply, 8080);
+          /* fall through */
+
+        case T_PTR:
+        case T_CNAME:
+          put_name (reply, answers[i]->data);
+          break;
+        }
+
+      reply->data[rdlength_pos] = (reply->len - rdlength_pos - 2) >> 8;
+      reply->data[rdlength_pos + 1] = (reply->len - rdlength_pos - 2) & 0xff;
+    }
+
+  g_string_free (name, TRUE);
+  return reply;
+}
+
+static gboolean
+udp_query (GSocket      *socket,
+           GIOCondition  condition,
+           gpointer      user_data)
+{
+  GSocketAddress *from;
+  GByteArray *reply;
+  gchar query[512];
+  gssize len;
+
+  len = g_socket_receive_from (socket, &from, query, sizeof (query), NULL, NULL);
+  if (len <= 0)
+    return TRUE;
+
+  g_atomic_int_inc (&server.udp_queries);
+  reply = build_reply ((guchar *) query, len, FALSE);
+  g_socket_send_to (socket, from, (gchar *) reply->data, reply->len, NULL, NULL);
+  g_byte_array_unref (reply);
+  g_object_unref (from);
+
+  return TRUE;
+}
+
+static gpointer
+tcp_thread (gpointer data)
+{
+  GSocket *client = data;
+  GByteArray *reply;
+  guchar query[514];
+  gsize len = 0;
+  gssize n;
+
+  g_socket_set_blocking (client, TRUE);
+  while (len < 2 || len < 2 + ((query[0] << 8) | query[1]))
+    {
+      n = g_socket_receive (client, (gchar *) query + len, sizeof (query) - len, NULL, NULL);
+      if (n <= 0)
+        goto out;
+      len += n;
+    }
+
+  g_atomic_int_inc (&server.tcp_queries);
+  reply = build_reply (query + 2, len - 2, TRUE);
+  g_byte_array_prepend (reply, (guint8 *) "\0\0", 2);
+  reply->data[0] = (reply->len - 2) >> 8;
+  reply->data[1] = (reply->len - 2) & 0xff;
+  g_socket_send (client, (gchar *) reply->data, reply->len, NULL, NULL);
+  g_byte_array_unref (reply);
+
+ out:
+  g_object_unref (client);
+  return NULL;
+}
+
+static gboolean
+tcp_connection (GSocket      *socket,
+                GIOCondition  condition,
+                gpointer      user_data)
+{
+  GSocket *client;
+
+  client = g_socket_accept (socket, NULL, NULL);
+  if (client)
+    g_thread_unref (g_thread_new ("tcp", tcp_thread, client));
+
+  return TRUE;
+}
+
+static gpointer
+server_thread (gpointer data)
+{
+  g_main_context_push_thread_default (server.context);
+  g_main_loop_run (server.loop);
+  g_main_context_pop_thread_default (server.context);
+
+  return NULL;
+}
+
+static GSocket *
+bind_socket (GSocketType      type,
+             GSocketProtocol  protocol,
+             guint16         *port)
+{
+  GInetAddress *loopback;
+  GSocketAddress *address;
+  GSocket *socket;
+  GError *error = NULL;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, type, protocol, &error);
+  g_assert_no_error (error);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, *port);
+  g_socket_bind (socket, address, TRUE, &error);
+  g_assert_no_error (error);
+  g_object_unref (address);
+  g_object_unref (loopback);
+
+  address = g_socket_get_local_address (socket, &error);
+  g_assert_no_error (error);
+  *port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address));
+  g_object_unref (address);
+
+  return socket;
+}
+
+static void
+attach_source (GSocket          *socket,
+               GSocketSourceFunc func)
+{
+  GSource *source;
+
+  source = g_socket_create_source (socket, G_IO_IN, NULL);
+  g_source_set_callback (source, (GSourceFunc) func, NULL, NULL);
+  g_source_attach (source, server.context);
+  g_source_unref (source);
+}
+
+static void
+start_server (void)
+{
+  GError *error = NULL;
+
+  server.port = 0;
+  server.tcp = bind_socket (G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, &server.port);
+  g_socket_listen (server.tcp, &error);
+  g_assert_no_error (error);
+  server.udp = bind_socket (G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &server.port);
+
+  /* never answers */
+  server.dead_port = 0;
+  server.dead = bind_socket (G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &server.dead_port);
+
+  server.context = g_main_context_new ();
+  server.loop = g_main_loop_new (server.context, FALSE);
+  attach_source (server.udp, udp_query);
+  attach_source (server.tcp, tcp_connection);
+  server.thread = g_thread_new ("dns-server", server_thread, NULL);
+}
+
+static void
+stop_server (void)
+{
+  g_main_loop_quit (server.loop);
+  g_thread_join (server.thread);
+  g_main_loop_unref (server.loop);
+  g_main_context_unref (server.context);
+  g_object_unref (server.udp);
+  g_object_unref (server.tcp);
+  g_object_unref (server.dead);
+}
+
+static GResolver *
+new_resolver (const gchar *config)
+{
+  GError *error = NULL;
+
+  g_file_set_contents (resolv_conf, config, -1, &error);
+  g_assert_no_error (error);
+
+  return g_object_new (g_dns_resolver_get_type (),
+                       "resolv-conf", resolv_conf,
+                       "hosts-file", hosts_file,
+                       NULL);
+}
+
+static GResolver *
+new_default_resolver (void)
+{
+  GResolver *resolver;
+  gchar *config;
+
+  config = g_strdup_printf ("nameserver 127.0.0.1#%u\n"
+                            "search search.test\n"
+                            "options timeout:1 attempts:1\n",
+                            server.port);
+  resolver = new_resolver (config);
+  g_free (config);
+
+  return resolver;
+}
+
+static void
+assert_addresses (GList       *addresses,
+                  const gchar *first,
+                  ...)
+{
+  const gchar *expected;
+  va_list ap;
+  GList *l;
+
+  va_start (ap, first);
+  for (l = addresses, expected = first; expected; l = l->next, expected = va_arg (ap, const gchar *))
+    {
+      gchar *str;
+
+      g_assert (l != NULL);
+      str = g_inet_address_to_string (l->data);
+      g_assert_cmpstr (str, ==, expected);
+      g_free (str);
+    }
+  va_end (ap);
+
+  g_assert (l == NULL);
+}
+
+static void
+lookup_by_name_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  GAsyncResult **ret = user_data;
+
+  *ret = g_object_ref (result);
+}
+
+static GList *
+lookup_by_name_async (GResolver     *resolver,
+                      const gchar   *hostname,
+                      GCancellable  *cancellable,
+                      GError       **error)
+{
+  GAsyncResult *result = NULL;
+  GList *addresses;
+
+  g_resolver_lookup_by_name_async (resolver, hostname, cancellable, lookup_by_name_cb, &result);
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  addresses = g_resolver_lookup_by_name_finish (resolver, result, error);
+  g_object_unref (result);
+
+  return addresses;
+}
+
+static void
+test_by_name (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GError *error = NULL;
+
+  resolver = new_default_resolver ();
+
+  /* A and AAAA are both asked for; AAAA answers come first */
+  addresses = lookup_by_name_async (resolver, "www.example.com", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "2001:db8::1", "192.0.2.1", NULL);
+  g_resolver_free_addresses (addresses);
+
+  addresses = g_resolver_lookup_by_name (resolver, "v4.example.com.", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.2", NULL);
+  g_resolver_free_addresses (addresses);
+
+  addresses = lookup_by_name_async (resolver, "nowhere.example.com", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+
+  addresses = g_resolver_lookup_by_name (resolver, "nowhere.example.com", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_hosts (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GInetAddress *address;
+  GError *error = NULL;
+  gint queries;
+  gchar *name;
+
+  resolver = new_default_resolver ();
+  queries = g_atomic_int_get (&server.udp_queries);
+
+  addresses = lookup_by_name_async (resolver, "Static.Example.Com", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.100", "2001:db8::100", NULL);
+  g_resolver_free_addresses (addresses);
+
+  address = g_inet_address_new_from_string ("192.0.2.100");
+  name = g_resolver_lookup_by_address (resolver, address, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (name, ==, "static.example.com");
+  g_free (name);
+  g_object_unref (address);
+
+  /* the first line for an address wins, however a later one spells it */
+  address = g_inet_address_new_from_string ("2001:db8::100");
+  name = g_resolver_lookup_by_address (resolver, address, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (name, ==, "static.example.com");
+  g_free (name);
+  g_object_unref (address);
+
+  g_assert_cmpint (g_atomic_int_get (&server.udp_queries), ==, queries);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_aliases (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GError *error = NULL;
+
+  resolver = new_default_resolver ();
+
+  addresses = lookup_by_name_async (resolver, "alias.example.com", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.2", NULL);
+  g_resolver_free_addresses (addresses);
+
+  /* an address for a name that was not asked about is not used */
+  addresses = lookup_by_name_async (resolver, "stray.example.com", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_search (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GError *error = NULL;
+
+  resolver = new_default_resolver ();
+
+  addresses = g_resolver_lookup_by_name (resolver, "host", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.3", NULL);
+  g_resolver_free_addresses (addresses);
+
+  /* with a trailing dot the search list is not used */
+  addresses = g_resolver_lookup_by_name (resolver, "host.", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_by_address (void)
+{
+  GResolver *resolver;
+  GInetAddress *address;
+  GError *error = NULL;
+  gchar *name;
+
+  resolver = new_default_resolver ();
+
+  address = g_inet_address_new_from_string ("192.0.2.1");
+  name = g_resolver_lookup_by_address (resolver, address, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (name, ==, "www.example.com");
+  g_free (name);
+  g_object_unref (address);
+
+  address = g_inet_address_new_from_string ("192.0.2.99");
+  name = g_resolver_lookup_by_address (resolver, address, NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (name == NULL);
+  g_clear_error (&error);
+  g_object_unref (address);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_service (void)
+{
+  GResolver *resolver;
+  GSrvTarget *target;
+  GList *targets;
+  GError *error = NULL;
+
+  resolver = new_default_resolver ();
+
+  targets = g_resolver_lookup_service (resolver, "http", "tcp", "example.com", NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_list_length (targets), ==, 1);
+  target = targets->data;
+  g_assert_cmpstr (g_srv_target_get_hostname (target), ==, "www.example.com");
+  g_assert_cmpint (g_srv_target_get_port (target), ==, 8080);
+  g_assert_cmpint (g_srv_target_get_priority (target), ==, 10);
+  g_assert_cmpint (g_srv_target_get_weight (target), ==, 5);
+  g_resolver_free_targets (targets);
+
+  targets = g_resolver_lookup_service (resolver, "ldap", "tcp", "example.com", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_NOT_FOUND);
+  g_assert (targets == NULL);
+  g_clear_error (&error);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_tcp_fallback (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GError *error = NULL;
+  gint queries;
+
+  resolver = new_default_resolver ();
+  queries = g_atomic_int_get (&server.tcp_queries);
+
+  addresses = lookup_by_name_async (resolver, "tcp.example.com", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.4", "192.0.2.5", NULL);
+  g_resolver_free_addresses (addresses);
+
+  /* the AAAA query came back truncated too */
+  g_assert_cmpint (g_atomic_int_get (&server.tcp_queries), ==, queries + 2);
+
+  g_object_unref (resolver);
+}
+
+static void
+test_retry (void)
+{
+  GResolver *resolver;
+  GList *addresses;
+  GError *error = NULL;
+  gchar *config;
+
+  config = g_strdup_printf ("nameserver 127.0.0.1#%u\n"
+                            "nameserver 127.0.0.1#%u\n"
+                            "options timeout:1 attempts:1\n",
+                            server.dead_port, server.port);
+  resolver = new_resolver (config);
+  g_free (config);
+
+  addresses = g_resolver_lookup_by_name (resolver, "v4.example.com", NULL, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "192.0.2.2", NULL);
+  g_resolver_free_addresses (addresses);
+  g_object_unref (resolver);
+
+  config = g_strdup_printf ("nameserver 127.0.0.1#%u\n"
+                            "options timeout:1 attempts:1\n",
+                            server.dead_port);
+  resolver = new_resolver (config);
+  g_free (config);
+
+  addresses = lookup_by_name_async (resolver, "v4.example.com", NULL, &error);
+  g_assert_error (error, G_RESOLVER_ERROR, G_RESOLVER_ERROR_TEMPORARY_FAILURE);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+  g_object_unref (resolver);
+}
+
+static gboolean
+cancel_cb (gpointer user_data)
+{
+  g_cancellable_cancel (user_data);
+  return FALSE;
+}
+
+static void
+test_cancel (void)
+{
+  GResolver *resolver;
+  GCancellable *cancellable;
+  GList *addresses;
+  GError *error = NULL;
+  GThread *thread;
+  gchar *config;
+  gint64 start;
+
+  config = g_strdup_printf ("nameserver 127.0.0.1#%u\n"
+                            "options timeout:30 attempts:1\n",
+                            server.dead_port);
+  resolver = new_resolver (config);
+  g_free (config);
+
+  cancellable = g_cancellable_new ();
+  g_timeout_add (100, cancel_cb, cancellable);
+
+  start = g_get_monotonic_time ();
+  addresses = lookup_by_name_async (resolver, "v4.example.com", cancellable, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+
+  /* cancelling a synchronous lookup from another thread */
+  g_cancellable_reset (cancellable);
+  thread = g_thread_new ("cancel", (GThreadFunc) cancel_cb, cancellable);
+  addresses = g_resolver_lookup_by_name (resolver, "v4.example.com", cancellable, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert (addresses == NULL);
+  g_clear_error (&error);
+  g_thread_join (thread);
+
+  g_assert_cmpint (g_get_monotonic_time () - start, <, 10 * G_USEC_PER_SEC);
+
+  g_object_unref (cancellable);
+  g_object_unref (resolver);
+}
+
+#define N_PARALLEL 200
+
+static void
+parallel_cb (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  gint *pending = user_data;
+  GList *addresses;
+  GError *error = NULL;
+
+  addresses = g_resolver_lookup_by_name_finish (G_RESOLVER (source), result, &error);
+  g_assert_no_error (error);
+  assert_addresses (addresses, "2001:db8::1", "192.0.2.1", NULL);
+  g_resolver_free_addresses (addresses);
+
+  (*pending)--;
+}
+
+static void
+test_parallel (void)
+{
+  GResolver *resolver;
+  gint pending = N_PARALLEL;
+  gint i;
+
+  resolver = new_default_resolver ();
+
+  for (i = 0; i < N_PARALLEL; i++)
+    g_resolver_lookup_by_name_async (resolver, "www.example.com", NULL, parallel_cb, &pending);
+
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (resolver);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *dir;
+  gint ret;
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  dir = g_dir_make_tmp ("dns-resolver-XXXXXX", NULL);
+  g_assert (dir != NULL);
+  resolv_conf = g_build_filename (dir, "resolv.conf", NULL);
+  hosts_file = g_build_filename (dir, "hosts", NULL);
+  g_file_set_contents (hosts_file,
+                       "# static entries\n"
+                       "192.0.2.100\tstatic.example.com static\n"
+                       "2001:db8::100 static.example.com\n"
+                       "2001:DB8:0::100 other.example.com\n",
+                       -1, NULL);
+
+  start_server ();
+
+  g_test_add_func ("/dns-resolver/by-name", test_by_name);
+  g_test_add_func ("/dns-resolver/hosts", test_hosts);
+  g_test_add_func ("/dns-resolver/aliases", test_aliases);
+  g_test_add_func ("/dns-resolver/search", test_search);
+  g_test_add_func ("/dns-resolver/by-address", test_by_address);
+  g_test_add_func ("/dns-resolver/service", test_service);
+  g_test_add_func ("/dns-resolver/tcp-fallback", test_tcp_fallback);
+  g_test_add_func ("/dns-resolver/retry", test_retry);
+  g_test_add_func ("/dns-resolver/cancel", test_cancel);
+  g_test_add_func ("/dns-resolver/parallel", test_parallel);
+
+  ret = g_test_run ();
+
+  stop_server ();
+
+  g_unlink (resolv_conf);
+  g_unlink (hosts_file);
+  g_rmdir (dir);
+  g_free (resolv_conf);
+  g_free (hosts_file);
+  g_free (dir);
+
+  return ret;
+}
@@ -0,0 +1,275 @@
+/* C10K-style load generator for echo-server.
+ *
+ * Opens --clients connections to the echo server, keeps all of them
+ * open at the same time and then has every client do --rounds
+ * request/reply round trips concurrently, printing how long it took.
+ *
+ * Run "echo-server --threads 4" for the asynchronous service, or
+ * plain "echo-server" for the thread-per-connection one (which can
+ * only serve as many clients at once as it has threads). Both ends
+ * need "ulimit -n" to be above the number of clients.
+ */
+
+#include <gio/gio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#define MESSAGE "Welcome to the echo service!\n"
+#define PING "ping\n"
+
+static char *host = "127.0.0.1";
+static int port = 7777;
+static int n_clients = 10000;
+static int rounds = 10;
+static int concurrency = 64;
+static int timeout = 120;
+static GOptionEntry cmd_entries[] = {
+  {"host", 'H', 0, G_OPTION_ARG_STRING, &host,
+   "Address of the echo server", NULL},
+  {"port", 'p', 0, G_OPTION_ARG_INT, &port,
+   "Port of the echo server", NULL},
+  {"clients", 'c', 0, G_OPTION_ARG_INT, &n_clients,
+   "Number of simultaneous clients", NULL},
+  {"rounds", 'r', 0, G_OPTION_ARG_INT, &rounds,
+   "Round trips done by each client", NULL},
+  {"concurrency", 'n', 0, G_OPTION_ARG_INT, &concurrency,
+   "Connection attempts in flight at once", NULL},
+  {"timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+   "Give up after this many seconds", NULL},
+  {NULL}
+};
+
+typedef struct {
+  GSocketConnection *connection;
+  char buffer[64];
+  gsize expected;
+  gsize received;
+  gboolean welcomed;
+  int rounds_left;
+} Client;
+
+static GMainLoop *loop;
+static GSocketClient *socket_client;
+static GSocketAddress *address;
+static Client *clients;
+static int next_client, connecting, n_welcomed, n_finished, failed;
+
+static void client_read (Client *client);
+static void client_expect (Client *client, gsize expected);
+static void connect_next (void);
+
+static void
+client_fail (Client *client,
+             GError *error)
+{
+  g_printerr ("client %d: %s\n", (int) (client - clients), error->message);
+  g_error_free (error);
+  failed++;
+  g_main_loop_quit (loop);
+}
+
+static void
+client_sent (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  Client *client = user_data;
+  GError *error = NULL;
+
+  if (g_output_stream_write_finish (G_OUTPUT_STREAM (source), result, &error) < 0)
+    client_fail (client, error);
+  else
+    client_expect (client, strlen (PING));
+}
+
+static void
+client_send (Client *client)
+{
+  GOutputStream *out;
+
+  out = g_io_stream_get_output_stream (G_IO_STREAM (client->connection));
+  g_output_stream_write_async (out, PING, strlen (PING), G_PRIORITY_DEFAULT,
+                               NULL, client_sent, client);
+}
+
+static void
+client_received (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  Client *client = user_data;
+  GError *error = NULL;
+  gssize size;
+
+  size = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
+  if (size <= 0)
+    {
+      if (size == 0)
+        error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CLOSED,
+                                     "Connection closed by the server");
+      client_fail (client, error);
+      return;
+    }
+
+  client->received += size;
+  if (client->received < client->expected)
+    client_read (client);
+  else if (!client->welcomed)
+    {
+      /* Wait for all the others before starting the round trips */
+      client->welcomed = TRUE;
+      if (++n_welcomed == n_clients)
+        g_main_loop_quit (loop);
+    }
+  else if (--client->rounds_left > 0)
+    client_send (client);
+  else if (++n_finished == n_clients)
+    g_main_loop_quit (loop);
+}
+
+static void
+client_expect (Client *client,
+               gsize   expected)
+{
+  client->expected = expected;
+  client->received = 0;
+  client_read (client);
+}
+
+static void
+client_read (Client *client)
+{
+  GInputStream *in;
+
+  in = g_io_stream_get_input_stream (G_IO_STREAM (client->connection));
+  g_input_stream_read_async (in, client->buffer + client->received,
+                             client->expected - client->received,
+                             G_PRIORITY_DEFAULT, NULL,
+                             client_received, client);
+}
+
+static void
+client_connected (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  Client *client = user_data;
+  GError *error = NULL;
+
+  connecting--;
+  client->connection = g_socket_client_connect_finish (socket_client, result, &error);
+  if (client->connection == NULL)
+    {
+      client_fail (client, error);
+      return;
+    }
+
+  client_expect (client, strlen (MESSAGE));
+  connect_next ();
+}
+
+static void
+connect_next (void)
+{
+  while (connecting < concurrency && next_client < n_clients)
+    {
+      connecting++;
+      g_socket_client_connect_async (socket_client,
+                                     G_SOCKET_CONNECTABLE (address), NULL,
+                                     client_connected, &clients[next_client++]);
+    }
+}
+
+static gboolean
+timed_out (gpointer user_data)
+{
+  g_printerr ("Timed out with %d clients welcomed and %d finished\n",
+              n_welcomed, n_finished);
+  failed++;
+  g_main_loop_quit (loop);
+  return FALSE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  GInetAddress *inet_address;
+  GError *error = NULL;
+  gint64 start, connected, end;
+  int i;
+
+  g_type_init ();
+
+  context = g_option_context_new (" - Load test the echo server");
+  g_option_context_add_main_entries (context, cmd_entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s: %s\n", argv[0], error->message);
+      return 1;
+    }
+  rounds = MAX (rounds, 1);
+
+#ifdef G_OS_UNIX
+  {
+    struct rlimit rl;
+
+    if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+      {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit (RLIMIT_NOFILE, &rl);
+      }
+  }
+#endif
+
+  inet_address = g_inet_address_new_from_string (host);
+  if (inet_address == NULL)
+    {
+      g_printerr ("%s: %s is not an IP address\n", argv[0], host);
+      return 1;
+    }
+  address = g_inet_socket_address_new (inet_address, port);
+  g_object_unref (inet_address);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  socket_client = g_socket_client_new ();
+  clients = g_new0 (Client, n_clients);
+  g_timeout_add_seconds (timeout, timed_out, NULL);
+
+  start = g_get_monotonic_time ();
+  connect_next ();
+  g_main_loop_run (loop);
+  connected = g_get_monotonic_time ();
+
+  if (!failed)
+    {
+      g_print ("%d clients connected and welcomed in %.3f s\n",
+               n_clients, (connected - start) / 1000000.);
+
+      for (i = 0; i < n_clients; i++)
+        {
+          clients[i].rounds_left = rounds;
+          client_send (&clients[i]);
+        }
+      g_main_loop_run (loop);
+      end = g_get_monotonic_time ();
+
+      if (!failed)
+        g_print ("%d round trips in %.3f s (%.0f/s)\n",
+                 n_clients * rounds, (end - connected) / 1000000.,
+                 n_clients * rounds / ((end - connected) / 1000000.));
+    }
+
+  for (i = 0; i < n_clients; i++)
+    if (clients[i].connection)
+      g_object_unref (clients[i].connection);
+  g_free (clients);
+  g_object_unref (socket_client);
+  g_object_unref (address);
+  g_main_loop_unref (loop);
+
+  return failed ? 1 : 0;
+}
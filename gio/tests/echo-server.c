@@ -4,9 +4,15 @@
 #define MESSAGE "Welcome to the echo service!\n"
 
 int port = 7777;
+int threads = 0;
+int max_connections = -1;
 static GOptionEntry cmd_entries[] = {
   {"port", 'p', 0, G_OPTION_ARG_INT, &port,
    "Local port to bind to", NULL},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &threads,
+   "Handle clients asynchronously in this many threads", NULL},
+  {"max-connections", 'm', 0, G_OPTION_ARG_INT, &max_connections,
+   "Maximum number of clients served at once (with --threads)", NULL},
   {NULL}
 };
 
@@ -35,6 +41,103 @@ handler (GThreadedSocketService *service,
   return TRUE;
 }
 
+typedef struct {
+  GSocketConnection *connection;
+  char buffer[1024];
+  gsize size;
+  gsize written;
+} EchoData;
+
+static void echo_read (EchoData *data);
+static void echo_write (EchoData *data);
+
+static void
+echo_written (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  EchoData *data = user_data;
+  gssize size;
+
+  size = g_output_stream_write_finish (G_OUTPUT_STREAM (source), result, NULL);
+  if (size <= 0)
+    {
+      g_object_unref (data->connection);
+      g_slice_free (EchoData, data);
+      return;
+    }
+
+  /* Echo all of it before reading more */
+  data->written += size;
+  if (data->written < data->size)
+    echo_write (data);
+  else
+    echo_read (data);
+}
+
+static void
+echo_write (EchoData *data)
+{
+  GOutputStream *out;
+
+  out = g_io_stream_get_output_stream (G_IO_STREAM (data->connection));
+  g_output_stream_write_async (out, data->buffer + data->written,
+                               data->size - data->written, G_PRIORITY_DEFAULT,
+                               NULL, echo_written, data);
+}
+
+static void
+echo_received (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  EchoData *data = user_data;
+  gssize size;
+
+  size = g_input_stream_read_finish (G_INPUT_STREAM (source), result, NULL);
+  if (size <= 0)
+    {
+      g_object_unref (data->connection);
+      g_slice_free (EchoData, data);
+      return;
+    }
+
+  data->size = size;
+  data->written = 0;
+  echo_write (data);
+}
+
+static void
+echo_read (EchoData *data)
+{
+  GInputStream *in;
+
+  in = g_io_stream_get_input_stream (G_IO_STREAM (data->connection));
+  g_input_stream_read_async (in, data->buffer, sizeof data->buffer,
+                             G_PRIORITY_DEFAULT, NULL, echo_received, data);
+}
+
+static gboolean
+async_handler (GAsyncSocketService *service,
+               GSocketConnection   *connection,
+               GSocketListener     *listener,
+               gpointer             user_data)
+{
+  EchoData *data;
+  GOutputStream *out;
+
+  data = g_slice_new (EchoData);
+  data->connection = g_object_ref (connection);
+
+  /* Short enough not to block on a fresh connection */
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  g_output_stream_write (out, MESSAGE, strlen (MESSAGE), NULL, NULL);
+
+  echo_read (data);
+
+  return TRUE;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -52,7 +155,14 @@ main (int argc, char *argv[])
       return 1;
     }
 
-  service = g_threaded_socket_service_new (10);
+  if (threads > 0)
+    {
+      service = g_async_socket_service_new (threads, max_connections);
+      /* Clients connecting in bursts must not overflow the accept queue */
+      g_socket_listener_set_backlog (G_SOCKET_LISTENER (service), 1024);
+    }
+  else
+    service = g_threaded_socket_service_new (10);
 
   if (!g_socket_listener_add_inet_port (G_SOCKET_LISTENER (service),
 					port,
@@ -65,7 +175,10 @@ main (int argc, char *argv[])
 
   g_print ("Echo service listening on port %d\n", port);
 
-  g_signal_connect (service, "run", G_CALLBACK (handler), NULL);
+  if (threads > 0)
+    g_signal_connect (service, "run", G_CALLBACK (async_handler), NULL);
+  else
+    g_signal_connect (service, "run", G_CALLBACK (handler), NULL);
 
   g_main_loop_run (g_main_loop_new (NULL, FALSE));
   g_assert_not_reached ();
@@ -877,6 +877,177 @@ test_wellknown_noauto (void)
   g_object_unref (proxy);
 }
 
+/* ---------------------------------------------------------------------------------------------------- */
+/* Test that G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE avoids GetAll() and that invalidated properties
+ * are fetched in one go
+ */
+/* ---------------------------------------------------------------------------------------------------- */
+
+static const gchar *shared_interface_xml =
+  "<node>"
+  "  <interface name='com.example.Shared'>"
+  "    <property type='i' name='Foo' access='read'/>"
+  "    <property type='i' name='Bar' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+static gint shared_value = 1;
+static gint shared_get_property_count = 0;
+
+static GVariant *
+shared_get_property (GDBusConnection  *connection,
+                     const gchar      *sender,
+                     const gchar      *object_path,
+                     const gchar      *interface_name,
+                     const gchar      *property_name,
+                     GError          **error,
+                     gpointer          user_data)
+{
+  shared_get_property_count++;
+  return g_variant_new_int32 (shared_value);
+}
+
+static const GDBusInterfaceVTable shared_vtable =
+{
+  NULL,
+  shared_get_property,
+  NULL
+};
+
+static void
+on_shared_properties_changed (GDBusProxy          *proxy,
+                              GVariant            *changed_properties,
+                              const gchar* const  *invalidated_properties,
+                              gpointer             user_data)
+{
+  gint *count = user_data;
+
+  g_assert_cmpint (g_variant_n_children (changed_properties), ==, 2);
+  g_assert_cmpint (g_strv_length ((gchar **) invalidated_properties), ==, 0);
+  (*count)++;
+
+  g_main_loop_quit (loop);
+}
+
+static void
+shared_proxy_ready (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  GDBusProxy **proxy = user_data;
+  GError *error = NULL;
+
+  *proxy = g_dbus_proxy_new_finish (result, &error);
+  g_assert_no_error (error);
+
+  g_main_loop_quit (loop);
+}
+
+/* the object is exported in this thread, so the proxy has to be
+ * constructed asynchronously for the calls to it to be answered
+ */
+static GDBusProxy *
+make_shared_proxy (GDBusConnection *connection,
+                   GDBusProxyFlags  flags)
+{
+  GDBusProxy *proxy = NULL;
+
+  g_dbus_proxy_new (connection,
+                    flags,
+                    NULL,                      /* GDBusInterfaceInfo */
+                    g_dbus_connection_get_unique_name (connection),
+                    "/com/example/Shared",     /* object path */
+                    "com.example.Shared",      /* interface */
+                    NULL, /* GCancellable */
+                    shared_proxy_ready,
+                    &proxy);
+  g_main_loop_run (loop);
+  g_assert (proxy != NULL);
+
+  return proxy;
+}
+
+static gint
+get_cached_int (GDBusProxy  *proxy,
+                const gchar *name)
+{
+  GVariant *value;
+  gint ret;
+
+  value = g_dbus_proxy_get_cached_property (proxy, name);
+  g_assert (value != NULL);
+  ret = g_variant_get_int32 (value);
+  g_variant_unref (value);
+
+  return ret;
+}
+
+static void
+test_shared_properties (void)
+{
+  GDBusConnection *connection;
+  GDBusNodeInfo *info;
+  GDBusProxy *proxy1, *proxy2, *proxy3;
+  const gchar *invalidated[] = { "Foo", "Bar", NULL };
+  GError *error = NULL;
+  gint changed_count = 0;
+  guint id;
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  g_assert_no_error (error);
+
+  info = g_dbus_node_info_new_for_xml (shared_interface_xml, &error);
+  g_assert_no_error (error);
+  id = g_dbus_connection_register_object (connection,
+                                          "/com/example/Shared",
+                                          info->interfaces[0],
+                                          &shared_vtable,
+                                          NULL, NULL,
+                                          &error);
+  g_assert_no_error (error);
+
+  /* the first proxy has to load the properties */
+  proxy1 = make_shared_proxy (connection, G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE |
+                                          G_DBUS_PROXY_FLAGS_GET_INVALIDATED_PROPERTIES);
+  g_assert_cmpint (shared_get_property_count, ==, 2);
+  g_assert_cmpint (get_cached_int (proxy1, "Foo"), ==, 1);
+
+  /* the second one takes them from the first one */
+  proxy2 = make_shared_proxy (connection, G_DBUS_PROXY_FLAGS_SHARE_PROPERTY_CACHE);
+  g_assert_cmpint (shared_get_property_count, ==, 2);
+  g_assert_cmpint (get_cached_int (proxy2, "Foo"), ==, 1);
+  g_assert_cmpint (get_cached_int (proxy2, "Bar"), ==, 1);
+
+  /* ...but proxies without the flag still talk to the object */
+  proxy3 = make_shared_proxy (connection, G_DBUS_PROXY_FLAGS_NONE);
+  g_assert_cmpint (shared_get_property_count, ==, 4);
+
+  /* invalidating two properties results in a single update */
+  shared_value = 2;
+  g_signal_connect (proxy1, "g-properties-changed",
+                    G_CALLBACK (on_shared_properties_changed), &changed_count);
+  g_dbus_connection_emit_signal (connection,
+                                 NULL,
+                                 "/com/example/Shared",
+                                 "org.freedesktop.DBus.Properties",
+                                 "PropertiesChanged",
+                                 g_variant_new ("(sa{sv}^as)", "com.example.Shared", NULL, invalidated),
+                                 &error);
+  g_assert_no_error (error);
+  g_main_loop_run (loop);
+
+  g_assert_cmpint (changed_count, ==, 1);
+  g_assert_cmpint (get_cached_int (proxy1, "Foo"), ==, 2);
+  g_assert_cmpint (get_cached_int (proxy1, "Bar"), ==, 2);
+
+  g_object_unref (proxy1);
+  g_object_unref (proxy2);
+  g_object_unref (proxy3);
+  g_dbus_connection_unregister_object (connection, id);
+  g_dbus_node_info_unref (info);
+  g_object_unref (connection);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -904,6 +1075,7 @@ main (int   argc,
   g_test_add_func ("/gdbus/proxy/no-properties", test_no_properties);
   g_test_add_func ("/gdbus/proxy/wellknown-noauto", test_wellknown_noauto);
   g_test_add_func ("/gdbus/proxy/async", test_async);
+  g_test_add_func ("/gdbus/proxy/shared-properties", test_shared_properties);
 
   ret = g_test_run();
 
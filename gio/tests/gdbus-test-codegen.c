@@ -2254,6 +2254,327 @@ test_object_manager (void)
   g_main_loop_unref (loop);
 }
 
+/* ---------------------------------------------------------------------------------------------------- */
+/* Checks how fast GDBusObjectManagerClient builds proxies for a large number of objects */
+
+#define N_MANAGED_OBJECTS 5000
+
+static void
+test_object_manager_perf (void)
+{
+  GDBusObjectManagerServer *manager;
+  GDBusObjectManager *pm;
+  GDBusConnection *c;
+  GMainLoop *loop;
+  GError *error = NULL;
+  GList *objects;
+  gint64 start_time;
+  gdouble elapsed;
+  guint n;
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  c = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  g_assert_no_error (error);
+
+  manager = g_dbus_object_manager_server_new ("/perf");
+  for (n = 0; n < N_MANAGED_OBJECTS; n++)
+    {
+      FooiGenObjectSkeleton *o;
+      FooiGenBar *i;
+      gchar *path;
+
+      path = g_strdup_printf ("/perf/object%d", n);
+      o = foo_igen_object_skeleton_new (path);
+      i = foo_igen_bar_skeleton_new ();
+      foo_igen_bar_set_i (i, n);
+      foo_igen_object_skeleton_set_bar (o, i);
+      g_dbus_object_manager_server_export (manager, G_DBUS_OBJECT_SKELETON (o));
+      g_object_unref (i);
+      g_object_unref (o);
+      g_free (path);
+    }
+  g_dbus_object_manager_server_set_connection (manager, c);
+
+  /* the client has to be created asynchronously since the server is
+   * served from this thread
+   */
+  start_time = g_get_monotonic_time ();
+  foo_igen_object_manager_client_new (c,
+                                      G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+                                      g_dbus_connection_get_unique_name (c),
+                                      "/perf",
+                                      NULL, /* GCancellable */
+                                      (GAsyncReadyCallback) om_pm_start_cb,
+                                      loop);
+  g_main_loop_run (loop);
+  pm = foo_igen_object_manager_client_new_finish (om_res, &error);
+  elapsed = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+  g_object_unref (om_res);
+  g_assert_no_error (error);
+  g_assert (pm != NULL);
+  objects = g_dbus_object_manager_get_objects (pm);
+  g_assert_cmpint (g_list_length (objects), ==, N_MANAGED_OBJECTS);
+  g_list_free_full (objects, g_object_unref);
+
+  g_test_minimized_result (elapsed, "%d object proxies built in %.3f seconds",
+                           N_MANAGED_OBJECTS, elapsed);
+
+  g_object_unref (pm);
+  g_object_unref (manager);
+  g_object_unref (c);
+  g_main_loop_unref (loop);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* Checks G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL */
+
+typedef struct
+{
+  gboolean check;
+  gulong handler_usec;
+  volatile gint busy;
+  guint32 last_serial;
+} PoolObject;
+
+/* the message bus limits the number of pending replies per connection */
+#define POOL_MAX_PENDING_CALLS 64
+
+typedef struct
+{
+  GDBusConnection *connection;
+  GMainLoop *loop;
+  guint num_objects;
+  guint num_to_send;
+  guint num_sent;
+  guint num_pending;
+  gint64 total_latency;
+} PoolCalls;
+
+typedef struct
+{
+  PoolCalls *calls;
+  gint64 start_time;
+} PoolCall;
+
+static GThread *pool_main_thread = NULL;
+static volatile gint pool_concurrency = 0;
+static volatile gint pool_max_concurrency = 0;
+
+static gboolean
+on_pool_handle_get_self (FooiGenMethodThreads   *object,
+                         GDBusMethodInvocation  *invocation,
+                         gpointer                user_data)
+{
+  PoolObject *po = user_data;
+  gint concurrency, max_concurrency;
+
+  if (po->check)
+    {
+      guint32 serial;
+
+      /* handled in a worker, never overlapping with another invocation
+       * on the same skeleton, and in the order the calls were made
+       */
+      g_assert (g_thread_self () != pool_main_thread);
+      g_assert (g_atomic_int_compare_and_exchange (&po->busy, 0, 1));
+      serial = g_dbus_message_get_serial (g_dbus_method_invocation_get_message (invocation));
+      g_assert_cmpuint (serial, >, po->last_serial);
+      po->last_serial = serial;
+    }
+
+  concurrency = g_atomic_int_add (&pool_concurrency, 1) + 1;
+  do
+    max_concurrency = g_atomic_int_get (&pool_max_concurrency);
+  while (concurrency > max_concurrency &&
+         !g_atomic_int_compare_and_exchange (&pool_max_concurrency, max_concurrency, concurrency));
+
+  if (po->handler_usec > 0)
+    g_usleep (po->handler_usec);
+
+  g_atomic_int_add (&pool_concurrency, -1);
+  if (po->check)
+    g_atomic_int_set (&po->busy, 0);
+
+  foo_igen_method_threads_complete_get_self (object, invocation, "");
+  return TRUE;
+}
+
+static void pool_call_cb (GObject      *source_object,
+                          GAsyncResult *res,
+                          gpointer      user_data);
+
+static void
+pool_send_call (PoolCalls *calls)
+{
+  PoolCall *call;
+  gchar *path;
+
+  call = g_new0 (PoolCall, 1);
+  call->calls = calls;
+  call->start_time = g_get_monotonic_time ();
+
+  /* round-robin over the objects */
+  path = g_strdup_printf ("/pool/%u", calls->num_sent % calls->num_objects);
+  g_dbus_connection_call (calls->connection,
+                          g_dbus_connection_get_unique_name (calls->connection),
+                          path,
+                          "org.project.MethodThreads",
+                          "GetSelf",
+                          NULL,
+                          G_VARIANT_TYPE ("(s)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          pool_call_cb,
+                          call);
+  g_free (path);
+
+  calls->num_sent++;
+  calls->num_pending++;
+}
+
+static void
+pool_call_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  PoolCall *call = user_data;
+  GError *error = NULL;
+  GVariant *result;
+
+  result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+  g_assert_no_error (error);
+  g_variant_unref (result);
+
+  call->calls->total_latency += g_get_monotonic_time () - call->start_time;
+  call->calls->num_pending--;
+  if (call->calls->num_sent < call->calls->num_to_send)
+    pool_send_call (call->calls);
+  else if (call->calls->num_pending == 0)
+    g_main_loop_quit (call->calls->loop);
+  g_free (call);
+}
+
+/* Exports @num_objects skeletons with @flags, makes @num_calls calls to
+ * each of them and returns the number of calls completed per second;
+ * @latency is set to the average time a call took, in seconds
+ */
+static gdouble
+run_pool_calls (GDBusInterfaceSkeletonFlags  flags,
+                guint                        num_objects,
+                guint                        num_calls,
+                gulong                       handler_usec,
+                gboolean                     check,
+                gdouble                     *latency)
+{
+  FooiGenMethodThreads **skeletons;
+  PoolObject *objects;
+  GDBusConnection *c;
+  GError *error = NULL;
+  PoolCalls calls;
+  gint64 start_time;
+  gdouble elapsed;
+  guint n;
+
+  c = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  g_assert_no_error (error);
+
+  pool_main_thread = g_thread_self ();
+  pool_max_concurrency = 0;
+
+  skeletons = g_new0 (FooiGenMethodThreads *, num_objects);
+  objects = g_new0 (PoolObject, num_objects);
+  for (n = 0; n < num_objects; n++)
+    {
+      gchar *path;
+
+      objects[n].check = check;
+      objects[n].handler_usec = handler_usec;
+
+      path = g_strdup_printf ("/pool/%u", n);
+      skeletons[n] = foo_igen_method_threads_skeleton_new ();
+      g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (skeletons[n]), flags);
+      g_signal_connect (skeletons[n], "handle-get-self",
+                        G_CALLBACK (on_pool_handle_get_self), &objects[n]);
+      g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (skeletons[n]), c, path, &error);
+      g_assert_no_error (error);
+      g_free (path);
+    }
+
+  calls.connection = c;
+  calls.loop = g_main_loop_new (NULL, FALSE);
+  calls.num_objects = num_objects;
+  calls.num_to_send = num_objects * num_calls;
+  calls.num_sent = 0;
+  calls.num_pending = 0;
+  calls.total_latency = 0;
+
+  start_time = g_get_monotonic_time ();
+  while (calls.num_sent < calls.num_to_send && calls.num_pending < POOL_MAX_PENDING_CALLS)
+    pool_send_call (&calls);
+  g_main_loop_run (calls.loop);
+  elapsed = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+
+  if (latency != NULL)
+    *latency = calls.total_latency / (gdouble) G_USEC_PER_SEC / (num_objects * num_calls);
+
+  for (n = 0; n < num_objects; n++)
+    {
+      g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (skeletons[n]));
+      g_object_unref (skeletons[n]);
+    }
+  g_free (skeletons);
+  g_free (objects);
+  g_main_loop_unref (calls.loop);
+  g_object_unref (c);
+
+  return num_objects * num_calls / elapsed;
+}
+
+static void
+test_worker_pool (void)
+{
+  run_pool_calls (G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL,
+                  4,     /* objects */
+                  20,    /* calls per object */
+                  5000,  /* handler takes 5ms */
+                  TRUE,
+                  NULL);
+
+  /* slow handlers for different objects ran at the same time */
+  g_assert_cmpint (pool_max_concurrency, >, 1);
+}
+
+static void
+test_worker_pool_perf (void)
+{
+  struct {
+    GDBusInterfaceSkeletonFlags flags;
+    const gchar *name;
+  } modes[] = {
+    { G_DBUS_INTERFACE_SKELETON_FLAGS_NONE, "main context" },
+    { G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD, "thread per call" },
+    { G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL, "worker pool" }
+  };
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (modes); n++)
+    {
+      gdouble rate, latency;
+
+      rate = run_pool_calls (modes[n].flags, 16, 200, 0, FALSE, &latency);
+      g_test_message ("%s, fast handlers: %.0f calls/s, %.3f ms average latency",
+                      modes[n].name, rate, latency * 1000);
+
+      rate = run_pool_calls (modes[n].flags, 16, 20, 2000, FALSE, &latency);
+      g_test_message ("%s, 2ms handlers: %.0f calls/s, %.3f ms average latency",
+                      modes[n].name, rate, latency * 1000);
+      if (modes[n].flags == G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_WORKER_POOL)
+        g_test_maximized_result (rate, "%.0f calls/s with 2ms handlers in the worker pool", rate);
+    }
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 /* This checks that forcing names via org.gtk.GDBus.Name works (see test-codegen.xml) */
 
@@ -2320,6 +2641,13 @@ main (int   argc,
   g_test_add_func ("/gdbus/codegen/annotations", test_annotations);
   g_test_add_func ("/gdbus/codegen/interface_stability", test_interface_stability);
   g_test_add_func ("/gdbus/codegen/object-manager", test_object_manager);
+  g_test_add_func ("/gdbus/codegen/worker-pool", test_worker_pool);
+
+  if (g_test_perf ())
+    {
+      g_test_add_func ("/gdbus/codegen/perf/object-manager", test_object_manager_perf);
+      g_test_add_func ("/gdbus/codegen/perf/worker-pool", test_worker_pool_perf);
+    }
 
   ret = g_test_run();
 
@@ -123,6 +123,115 @@ static const SchemaTest tests[] = {
   { "cdata",                        NULL, NULL                                                  }
 };
 
+/* Runs the compiler on @dir with the options given after it, up to
+ * a %NULL.
+ */
+static gint
+run_compiler (const gchar *dir,
+              ...)
+{
+  GPtrArray *argv;
+  const gchar *option;
+  GError *error = NULL;
+  gint status;
+  va_list ap;
+
+  argv = g_ptr_array_new ();
+  g_ptr_array_add (argv, "../glib-compile-schemas");
+  g_ptr_array_add (argv, (gchar *) dir);
+  va_start (ap, dir);
+  while ((option = va_arg (ap, const gchar *)) != NULL)
+    g_ptr_array_add (argv, (gchar *) option);
+  va_end (ap);
+  g_ptr_array_add (argv, NULL);
+
+  g_spawn_sync (NULL, (gchar **) argv->pdata, NULL,
+                G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
+                NULL, NULL, NULL, NULL, &status, &error);
+  g_assert_no_error (error);
+  g_ptr_array_free (argv, TRUE);
+
+  return status;
+}
+
+static void
+write_schema (const gchar *dir,
+              const gchar *default_value)
+{
+  gchar *filename;
+  gchar *contents;
+
+  filename = g_build_filename (dir, "org.gtk.test.incremental.gschema.xml", NULL);
+  contents = g_strdup_printf ("<schemalist>"
+                              "  <schema id='org.gtk.test.incremental' path='/tests/incremental/'>"
+                              "    <key name='foo' type='i'><default>%s</default></key>"
+                              "  </schema>"
+                              "</schemalist>", default_value);
+  g_assert (g_file_set_contents (filename, contents, -1, NULL));
+  g_free (contents);
+  g_free (filename);
+}
+
+/* Test that an unchanged directory is not compiled again, and that
+ * --verify-only notices changes
+ */
+static void
+test_incremental (void)
+{
+  gchar *dir;
+  gchar *target;
+  gchar *stamp;
+  gchar *schema;
+
+  dir = g_dir_make_tmp ("gschema-compile-XXXXXX", NULL);
+  g_assert (dir != NULL);
+  target = g_build_filename (dir, "gschemas.compiled", NULL);
+  stamp = g_build_filename (dir, "gschemas.compiled.stamp", NULL);
+
+  write_schema (dir, "1");
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), !=, 0);
+  g_assert_cmpint (run_compiler (dir, NULL), ==, 0);
+  g_assert (g_file_test (target, G_FILE_TEST_EXISTS));
+  g_assert (g_file_test (stamp, G_FILE_TEST_EXISTS));
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), ==, 0);
+
+  /* rewriting identical contents doesn't count as a change */
+  write_schema (dir, "1");
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), ==, 0);
+
+  /* --dry-run doesn't keep --verify-only from checking the stamp */
+  g_assert_cmpint (run_compiler (dir, "--verify-only", "--dry-run", NULL), ==, 0);
+
+  write_schema (dir, "2");
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), !=, 0);
+  g_assert_cmpint (run_compiler (dir, NULL), ==, 0);
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), ==, 0);
+
+  /* a removed output is noticed */
+  g_unlink (target);
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), !=, 0);
+  g_assert_cmpint (run_compiler (dir, NULL), ==, 0);
+  g_assert (g_file_test (target, G_FILE_TEST_EXISTS));
+
+  /* without any schemas, the output is out of date until it has been
+   * removed, but --verify-only must not remove it
+   */
+  schema = g_build_filename (dir, "org.gtk.test.incremental.gschema.xml", NULL);
+  g_unlink (schema);
+  g_free (schema);
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), !=, 0);
+  g_assert (g_file_test (target, G_FILE_TEST_EXISTS));
+  g_assert (g_file_test (stamp, G_FILE_TEST_EXISTS));
+  g_assert_cmpint (run_compiler (dir, NULL), ==, 0);
+  g_assert (!g_file_test (target, G_FILE_TEST_EXISTS));
+  g_assert (!g_file_test (stamp, G_FILE_TEST_EXISTS));
+  g_assert_cmpint (run_compiler (dir, "--verify-only", NULL), ==, 0);
+
+  g_free (target);
+  g_free (stamp);
+  g_rmdir (dir);
+  g_free (dir);
+}
 
 int
 main (int argc, char *argv[])
@@ -141,5 +250,7 @@ main (int argc, char *argv[])
       g_free (name);
     }
 
+  g_test_add_func ("/gschema/incremental", test_incremental);
+
   return g_test_run ();
 }
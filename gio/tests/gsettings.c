@@ -397,6 +397,54 @@ test_changes (void)
   g_object_unref (settings);
 }
 
+/* Test that values read through the typed getters are not served
+ * stale after a change made through another instance, and that a
+ * reset brings back the default.
+ */
+static void
+test_cached_values (void)
+{
+  GSettings *settings;
+  GSettings *settings2;
+  gint i;
+
+  settings = g_settings_new ("org.gtk.test.basic-types");
+  settings2 = g_settings_new ("org.gtk.test.basic-types");
+
+  for (i = 0; i < 3; i++)
+    {
+      g_settings_set_int (settings2, "test-int32", i);
+      g_settings_set_boolean (settings2, "test-boolean", i % 2);
+      g_settings_set_uint (settings2, "test-uint32", i * 2);
+
+      /* twice, so that the second read comes from the cache */
+      g_assert_cmpint (g_settings_get_int (settings, "test-int32"), ==, i);
+      g_assert_cmpint (g_settings_get_int (settings, "test-int32"), ==, i);
+      g_assert_cmpint (g_settings_get_boolean (settings, "test-boolean"), ==, i % 2);
+      g_assert_cmpint (g_settings_get_boolean (settings, "test-boolean"), ==, i % 2);
+      g_assert_cmpuint (g_settings_get_uint (settings, "test-uint32"), ==, i * 2);
+      g_assert_cmpuint (g_settings_get_uint (settings, "test-uint32"), ==, i * 2);
+    }
+
+  g_settings_reset (settings2, "test-int32");
+  g_assert_cmpint (g_settings_get_int (settings, "test-int32"), ==, -123456);
+
+  /* delay-apply mode must see its own unapplied changes */
+  g_settings_delay (settings);
+  g_settings_set_int (settings, "test-int32", 42);
+  g_assert_cmpint (g_settings_get_int (settings, "test-int32"), ==, 42);
+  g_assert_cmpint (g_settings_get_int (settings2, "test-int32"), ==, -123456);
+  g_settings_apply (settings);
+  g_assert_cmpint (g_settings_get_int (settings2, "test-int32"), ==, 42);
+
+  g_settings_reset (settings2, "test-int32");
+  g_settings_reset (settings2, "test-boolean");
+  g_settings_reset (settings2, "test-uint32");
+
+  g_object_unref (settings2);
+  g_object_unref (settings);
+}
+
 static gboolean changed_cb_called2;
 
 static void
@@ -1483,6 +1531,237 @@ test_keyfile (void)
   g_object_unref (settings);
 }
 
+static gboolean
+fail_on_timeout (gpointer data)
+{
+  g_assert_not_reached ();
+
+  return FALSE;
+}
+
+static gboolean
+keyfile_change_event (GSettings *settings,
+                      GQuark    *keys,
+                      gint       n_keys,
+                      gpointer   data)
+{
+  GQuark *changed = data;
+
+  g_assert_cmpint (n_keys, ==, 1);
+  *changed = keys[0];
+
+  return FALSE;
+}
+
+/* Test that an external modification of the keyfile is reported as
+ * one change event, covering only the keys that were modified
+ */
+static void
+test_keyfile_reload (void)
+{
+  GSettingsBackend *kf_backend;
+  GSettings *settings;
+  GKeyFile *keyfile;
+  GQuark changed = 0;
+  guint timeout_id;
+  gchar *contents;
+  gchar *str;
+
+  g_remove ("gsettings.store");
+
+  kf_backend = g_keyfile_settings_backend_new ("gsettings.store", "/", "root");
+  settings = g_settings_new_with_backend ("org.gtk.test", kf_backend);
+  g_object_unref (kf_backend);
+
+  g_settings_set (settings, "greeting", "s", "before");
+  g_settings_set (settings, "farewell", "s", "unchanged");
+
+  g_signal_connect (settings, "change-event",
+                    G_CALLBACK (keyfile_change_event), &changed);
+
+  keyfile = g_key_file_new ();
+  g_assert (g_key_file_load_from_file (keyfile, "gsettings.store", 0, NULL));
+  g_key_file_set_string (keyfile, "tests", "greeting", "'after'");
+  contents = g_key_file_to_data (keyfile, NULL, NULL);
+  g_assert (g_file_set_contents ("gsettings.store", contents, -1, NULL));
+  g_free (contents);
+  g_key_file_free (keyfile);
+
+  timeout_id = g_timeout_add_seconds (10, fail_on_timeout, NULL);
+  while (changed == 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+
+  g_assert_cmpstr (g_quark_to_string (changed), ==, "greeting");
+
+  str = g_settings_get_string (settings, "greeting");
+  g_assert_cmpstr (str, ==, "after");
+  g_free (str);
+
+  g_object_unref (settings);
+}
+
+#ifdef G_OS_UNIX
+static GSettingsBackend *
+new_gvdb_backend (const gchar *filename)
+{
+  GIOExtensionPoint *ep;
+  GIOExtension *extension;
+
+  ep = g_io_extension_point_lookup (G_SETTINGS_BACKEND_EXTENSION_POINT_NAME);
+  extension = g_io_extension_point_get_extension_by_name (ep, "gvdb");
+  g_assert (extension != NULL);
+
+  return g_object_new (g_io_extension_get_type (extension),
+                       "filename", filename,
+                       NULL);
+}
+
+static void
+gvdb_changed (GSettings   *settings,
+              const gchar *key,
+              gpointer     data)
+{
+  gint *changes = data;
+
+  if (g_strcmp0 (key, "greeting") == 0)
+    (*changes)++;
+}
+
+/* Test that the gvdb backend shares its database between instances,
+ * and that changes made through one are reported by the other
+ */
+static void
+test_gvdb_backend (void)
+{
+  GSettingsBackend *backend1, *backend2;
+  GSettings *settings1, *settings2;
+  gint changes = 0;
+  guint timeout_id;
+  gchar *str;
+
+  g_remove ("gsettings.gvdb");
+  g_remove ("gsettings.gvdb.seq");
+
+  /* make sure the built-in backends are registered */
+  g_settings_backend_get_default ();
+
+  backend1 = new_gvdb_backend ("gsettings.gvdb");
+  backend2 = new_gvdb_backend ("gsettings.gvdb");
+  settings1 = g_settings_new_with_backend ("org.gtk.test", backend1);
+  settings2 = g_settings_new_with_backend ("org.gtk.test", backend2);
+  g_object_unref (backend1);
+
+  str = g_settings_get_string (settings2, "greeting");
+  g_assert_cmpstr (str, ==, "Hello, earthlings");
+  g_free (str);
+
+  g_signal_connect (settings2, "changed", G_CALLBACK (gvdb_changed), &changes);
+
+  g_assert (g_settings_is_writable (settings1, "greeting"));
+  g_settings_set (settings1, "greeting", "s", "shared");
+
+  /* writing through the other backend before its file monitor has
+   * fired must not swallow the notification of the first write
+   */
+  g_settings_set (settings2, "farewell", "s", "Goodbye");
+
+  /* visible through the other backend right away, without waiting
+   * for the notification
+   */
+  str = g_settings_get_string (settings2, "greeting");
+  g_assert_cmpstr (str, ==, "shared");
+  g_free (str);
+
+  timeout_id = g_timeout_add_seconds (10, fail_on_timeout, NULL);
+  while (changes == 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+
+  str = g_settings_get_string (settings2, "greeting");
+  g_assert_cmpstr (str, ==, "shared");
+  g_free (str);
+
+  g_settings_reset (settings2, "greeting");
+  str = g_settings_get_string (settings1, "greeting");
+  g_assert_cmpstr (str, ==, "Hello, earthlings");
+  g_free (str);
+
+  g_object_unref (settings1);
+  g_object_unref (settings2);
+  g_object_unref (backend2);
+
+  g_remove ("gsettings.gvdb");
+  g_remove ("gsettings.gvdb.seq");
+}
+
+#define GVDB_WRITES 200
+
+static gpointer
+gvdb_writer_thread (gpointer data)
+{
+  const gchar *key = data;
+  GSettingsBackend *backend;
+  GSettings *settings;
+  gchar *value, *str;
+  gint i;
+
+  backend = new_gvdb_backend ("gsettings.gvdb");
+  settings = g_settings_new_with_backend ("org.gtk.test", backend);
+  g_object_unref (backend);
+
+  for (i = 0; i < GVDB_WRITES; i++)
+    {
+      value = g_strdup_printf ("%s %d", key, i);
+      g_settings_set_string (settings, key, value);
+      str = g_settings_get_string (settings, key);
+      g_assert_cmpstr (str, ==, value);
+      g_free (str);
+      g_free (value);
+    }
+
+  g_object_unref (settings);
+
+  return NULL;
+}
+
+/* Test that concurrent writes from threads of the same process do not
+ * lose each other's changes
+ */
+static void
+test_gvdb_backend_threads (void)
+{
+  GSettingsBackend *backend;
+  GSettings *settings;
+  GThread *threads[2];
+  gchar *str;
+
+  g_remove ("gsettings.gvdb");
+  g_remove ("gsettings.gvdb.seq");
+
+  g_settings_backend_get_default ();
+
+  threads[0] = g_thread_new ("writer", gvdb_writer_thread, "greeting");
+  threads[1] = g_thread_new ("writer", gvdb_writer_thread, "farewell");
+  g_thread_join (threads[0]);
+  g_thread_join (threads[1]);
+
+  backend = new_gvdb_backend ("gsettings.gvdb");
+  settings = g_settings_new_with_backend ("org.gtk.test", backend);
+  str = g_settings_get_string (settings, "greeting");
+  g_assert_cmpstr (str, ==, "greeting 199");
+  g_free (str);
+  str = g_settings_get_string (settings, "farewell");
+  g_assert_cmpstr (str, ==, "farewell 199");
+  g_free (str);
+  g_object_unref (settings);
+  g_object_unref (backend);
+
+  g_remove ("gsettings.gvdb");
+  g_remove ("gsettings.gvdb.seq");
+}
+#endif
+
 /* Test that getting child schemas works
  */
 static void
@@ -2106,6 +2385,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/gsettings/basic-types", test_basic_types);
   g_test_add_func ("/gsettings/complex-types", test_complex_types);
   g_test_add_func ("/gsettings/changes", test_changes);
+  g_test_add_func ("/gsettings/cached-values", test_cached_values);
 
   if (glib_translations_work ())
     {
@@ -2132,6 +2412,11 @@ main (int argc, char *argv[])
     }
 
   g_test_add_func ("/gsettings/keyfile", test_keyfile);
+  g_test_add_func ("/gsettings/keyfile-reload", test_keyfile_reload);
+#ifdef G_OS_UNIX
+  g_test_add_func ("/gsettings/gvdb-backend", test_gvdb_backend);
+  g_test_add_func ("/gsettings/gvdb-backend-threads", test_gvdb_backend_threads);
+#endif
   g_test_add_func ("/gsettings/child-schema", test_child_schema);
   g_test_add_func ("/gsettings/strinfo", test_strinfo);
   g_test_add_func ("/gsettings/enums", test_enums);
@@ -21,9 +21,12 @@
 #include "gtesttlsbackend.h"
 
 #include <glib.h>
+#include <string.h>
 
 static GType _g_test_tls_certificate_get_type (void);
 static GType _g_test_tls_connection_get_type (void);
+static GType _g_test_tls_client_connection_get_type (void);
+static GType _g_test_tls_server_connection_get_type (void);
 
 struct _GTestTlsBackend {
   GObject parent_instance;
@@ -57,8 +60,8 @@ static void
 g_test_tls_backend_iface_init (GTlsBackendInterface *iface)
 {
   iface->get_certificate_type = _g_test_tls_certificate_get_type;
-  iface->get_client_connection_type = _g_test_tls_connection_get_type;
-  iface->get_server_connection_type = _g_test_tls_connection_get_type;
+  iface->get_client_connection_type = _g_test_tls_client_connection_get_type;
+  iface->get_server_connection_type = _g_test_tls_server_connection_get_type;
 }
 
 /* Test certificate type */
@@ -187,9 +190,15 @@ g_test_tls_certificate_initable_iface_init (GInitableIface  *iface)
   iface->init = g_test_tls_certificate_initable_init;
 }
 
-/* Dummy connection type; since GTlsClientConnection and
- * GTlsServerConnection are just interfaces, we can implement them
- * both on a single object.
+/* Test connection types. These don't encrypt anything; the handshake
+ * is a one-line exchange over the base stream that only lets a
+ * client resume a "session" whose ticket the server handed out
+ * earlier, which is enough to test session caching. After the
+ * handshake, reads and writes go straight to the base stream, and
+ * the handshake must be done explicitly before using it.
+ *
+ *   client: "HELLO\n" or "RESUME <ticket>\n"
+ *   server: "FULL <new ticket>\n" or "RESUMED\n"
  */
 
 typedef struct _GTestTlsConnection      GTestTlsConnection;
@@ -197,10 +206,23 @@ typedef struct _GTestTlsConnectionClass GTestTlsConnectionClass;
 
 struct _GTestTlsConnection {
   GTlsConnection parent_instance;
+
+  GIOStream *base_io_stream;
+  GTlsCertificate *certificate;
+  GSocketConnectable *server_identity;
+  GTlsCertificateFlags validation_flags;
+  GTlsRehandshakeMode rehandshake_mode;
+  GTlsAuthenticationMode authentication_mode;
+  gboolean require_close_notify;
+  gboolean resumed;
 };
 
 struct _GTestTlsConnectionClass {
   GTlsConnectionClass parent_class;
+
+  gboolean (*handshake_line) (GTestTlsConnection  *conn,
+			      GCancellable        *cancellable,
+			      GError             **error);
 };
 
 enum
@@ -224,11 +246,16 @@ enum
 static void g_test_tls_connection_initable_iface_init (GInitableIface *iface);
 
 #define g_test_tls_connection_get_type _g_test_tls_connection_get_type
-G_DEFINE_TYPE_WITH_CODE (GTestTlsConnection, g_test_tls_connection, G_TYPE_TLS_CONNECTION,
-			 G_IMPLEMENT_INTERFACE (G_TYPE_TLS_CLIENT_CONNECTION, NULL);
-			 G_IMPLEMENT_INTERFACE (G_TYPE_TLS_SERVER_CONNECTION, NULL);
-			 G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
-						g_test_tls_connection_initable_iface_init);)
+G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GTestTlsConnection, g_test_tls_connection, G_TYPE_TLS_CONNECTION,
+				  G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
+							 g_test_tls_connection_initable_iface_init);)
+
+#define G_TEST_TLS_CONNECTION_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), _g_test_tls_connection_get_type (), GTestTlsConnectionClass))
+
+/* Tickets handed out by all test servers in this process */
+G_LOCK_DEFINE_STATIC (tickets);
+static GHashTable *tickets;
+static guint next_ticket;
 
 static void
 g_test_tls_connection_get_property (GObject    *object,
@@ -236,6 +263,35 @@ g_test_tls_connection_get_property (GObject    *object,
 				     GValue     *value,
 				     GParamSpec *pspec)
 {
+  GTestTlsConnection *conn = (GTestTlsConnection *) object;
+
+  switch (prop_id)
+    {
+    case PROP_CONN_BASE_IO_STREAM:
+      g_value_set_object (value, conn->base_io_stream);
+      break;
+    case PROP_CONN_REQUIRE_CLOSE_NOTIFY:
+      g_value_set_boolean (value, conn->require_close_notify);
+      break;
+    case PROP_CONN_REHANDSHAKE_MODE:
+      g_value_set_enum (value, conn->rehandshake_mode);
+      break;
+    case PROP_CONN_CERTIFICATE:
+      g_value_set_object (value, conn->certificate);
+      break;
+    case PROP_CONN_VALIDATION_FLAGS:
+      g_value_set_flags (value, conn->validation_flags);
+      break;
+    case PROP_CONN_SERVER_IDENTITY:
+      g_value_set_object (value, conn->server_identity);
+      break;
+    case PROP_CONN_AUTHENTICATION_MODE:
+      g_value_set_enum (value, conn->authentication_mode);
+      break;
+    default:
+      /* the rest are left at their defaults */
+      break;
+    }
 }
 
 static void
@@ -244,6 +300,66 @@ g_test_tls_connection_set_property (GObject      *object,
 				     const GValue *value,
 				     GParamSpec   *pspec)
 {
+  GTestTlsConnection *conn = (GTestTlsConnection *) object;
+
+  switch (prop_id)
+    {
+    case PROP_CONN_BASE_IO_STREAM:
+      conn->base_io_stream = g_value_dup_object (value);
+      break;
+    case PROP_CONN_REQUIRE_CLOSE_NOTIFY:
+      conn->require_close_notify = g_value_get_boolean (value);
+      break;
+    case PROP_CONN_REHANDSHAKE_MODE:
+      conn->rehandshake_mode = g_value_get_enum (value);
+      break;
+    case PROP_CONN_CERTIFICATE:
+      if (conn->certificate)
+	g_object_unref (conn->certificate);
+      conn->certificate = g_value_dup_object (value);
+      break;
+    case PROP_CONN_VALIDATION_FLAGS:
+      conn->validation_flags = g_value_get_flags (value);
+      break;
+    case PROP_CONN_SERVER_IDENTITY:
+      if (conn->server_identity)
+	g_object_unref (conn->server_identity);
+      conn->server_identity = g_value_dup_object (value);
+      break;
+    case PROP_CONN_AUTHENTICATION_MODE:
+      conn->authentication_mode = g_value_get_enum (value);
+      break;
+    default:
+      /* ignore */
+      break;
+    }
+}
+
+static void
+g_test_tls_connection_finalize (GObject *object)
+{
+  GTestTlsConnection *conn = (GTestTlsConnection *) object;
+
+  if (conn->base_io_stream)
+    g_object_unref (conn->base_io_stream);
+  if (conn->certificate)
+    g_object_unref (conn->certificate);
+  if (conn->server_identity)
+    g_object_unref (conn->server_identity);
+
+  G_OBJECT_CLASS (g_test_tls_connection_parent_class)->finalize (object);
+}
+
+static GInputStream *
+g_test_tls_connection_get_input_stream (GIOStream *stream)
+{
+  return g_io_stream_get_input_stream (((GTestTlsConnection *) stream)->base_io_stream);
+}
+
+static GOutputStream *
+g_test_tls_connection_get_output_stream (GIOStream *stream)
+{
+  return g_io_stream_get_output_stream (((GTestTlsConnection *) stream)->base_io_stream);
 }
 
 static gboolean
@@ -251,7 +367,106 @@ g_test_tls_connection_close (GIOStream     *stream,
 			      GCancellable  *cancellable,
 			      GError       **error)
 {
-  return TRUE;
+  return g_io_stream_close (((GTestTlsConnection *) stream)->base_io_stream,
+			    cancellable, error);
+}
+
+static gchar *
+read_line (GTestTlsConnection  *conn,
+	   GCancellable        *cancellable,
+	   GError             **error)
+{
+  GInputStream *in;
+  GString *line;
+  gssize nread;
+  gchar c;
+
+  in = g_io_stream_get_input_stream (conn->base_io_stream);
+  line = g_string_new (NULL);
+  do
+    {
+      nread = g_input_stream_read (in, &c, 1, cancellable, error);
+      if (nread <= 0)
+	{
+	  if (nread == 0)
+	    g_set_error_literal (error, G_TLS_ERROR, G_TLS_ERROR_EOF,
+				 "Connection closed during handshake");
+	  g_string_free (line, TRUE);
+	  return NULL;
+	}
+      g_string_append_c (line, c);
+    }
+  while (c != '\n');
+
+  g_string_truncate (line, line->len - 1);
+  return g_string_free (line, FALSE);
+}
+
+static gboolean
+write_line (GTestTlsConnection  *conn,
+	    const gchar         *line,
+	    GCancellable        *cancellable,
+	    GError             **error)
+{
+  GOutputStream *out;
+  gchar *data;
+  gboolean ret;
+
+  out = g_io_stream_get_output_stream (conn->base_io_stream);
+  data = g_strconcat (line, "\n", NULL);
+  ret = g_output_stream_write_all (out, data, strlen (data), NULL,
+				   cancellable, error);
+  g_free (data);
+  return ret;
+}
+
+static gboolean
+g_test_tls_connection_handshake (GTlsConnection  *tls,
+				  GCancellable    *cancellable,
+				  GError         **error)
+{
+  GTestTlsConnection *conn = (GTestTlsConnection *) tls;
+
+  conn->resumed = FALSE;
+  return G_TEST_TLS_CONNECTION_GET_CLASS (conn)->handshake_line (conn, cancellable, error);
+}
+
+static void
+handshake_thread (GSimpleAsyncResult *simple,
+		  GObject            *object,
+		  GCancellable       *cancellable)
+{
+  GError *error = NULL;
+
+  if (!g_test_tls_connection_handshake (G_TLS_CONNECTION (object),
+					cancellable, &error))
+    g_simple_async_result_take_error (simple, error);
+}
+
+static void
+g_test_tls_connection_handshake_async (GTlsConnection      *tls,
+					int                  io_priority,
+					GCancellable        *cancellable,
+					GAsyncReadyCallback  callback,
+					gpointer             user_data)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = g_simple_async_result_new (G_OBJECT (tls), callback, user_data,
+				      g_test_tls_connection_handshake_async);
+  g_simple_async_result_run_in_thread (simple, handshake_thread,
+				       io_priority, cancellable);
+  g_object_unref (simple);
+}
+
+static gboolean
+g_test_tls_connection_handshake_finish (GTlsConnection  *tls,
+					 GAsyncResult    *result,
+					 GError         **error)
+{
+  g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (tls), g_test_tls_connection_handshake_async), FALSE);
+
+  return !g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), error);
 }
 
 static void
@@ -259,17 +474,20 @@ g_test_tls_connection_class_init (GTestTlsConnectionClass *connection_class)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (connection_class);
   GIOStreamClass *io_stream_class = G_IO_STREAM_CLASS (connection_class);
+  GTlsConnectionClass *tls_class = G_TLS_CONNECTION_CLASS (connection_class);
 
   gobject_class->get_property = g_test_tls_connection_get_property;
   gobject_class->set_property = g_test_tls_connection_set_property;
+  gobject_class->finalize = g_test_tls_connection_finalize;
 
-  /* Need to override this because when initable_init fails it will
-   * dispose the connection, which will close it, which would
-   * otherwise try to close its input/output streams, which don't
-   * exist.
-   */
+  io_stream_class->get_input_stream = g_test_tls_connection_get_input_stream;
+  io_stream_class->get_output_stream = g_test_tls_connection_get_output_stream;
   io_stream_class->close_fn = g_test_tls_connection_close;
 
+  tls_class->handshake = g_test_tls_connection_handshake;
+  tls_class->handshake_async = g_test_tls_connection_handshake_async;
+  tls_class->handshake_finish = g_test_tls_connection_handshake_finish;
+
   g_object_class_override_property (gobject_class, PROP_CONN_BASE_IO_STREAM, "base-io-stream");
   g_object_class_override_property (gobject_class, PROP_CONN_USE_SYSTEM_CERTDB, "use-system-certdb");
   g_object_class_override_property (gobject_class, PROP_CONN_REQUIRE_CLOSE_NOTIFY, "require-close-notify");
@@ -277,11 +495,6 @@ g_test_tls_connection_class_init (GTestTlsConnectionClass *connection_class)
   g_object_class_override_property (gobject_class, PROP_CONN_CERTIFICATE, "certificate");
   g_object_class_override_property (gobject_class, PROP_CONN_PEER_CERTIFICATE, "peer-certificate");
   g_object_class_override_property (gobject_class, PROP_CONN_PEER_CERTIFICATE_ERRORS, "peer-certificate-errors");
-  g_object_class_override_property (gobject_class, PROP_CONN_VALIDATION_FLAGS, "validation-flags");
-  g_object_class_override_property (gobject_class, PROP_CONN_SERVER_IDENTITY, "server-identity");
-  g_object_class_override_property (gobject_class, PROP_CONN_USE_SSL3, "use-ssl3");
-  g_object_class_override_property (gobject_class, PROP_CONN_ACCEPTED_CAS, "accepted-cas");
-  g_object_class_override_property (gobject_class, PROP_CONN_AUTHENTICATION_MODE, "authentication-mode");
 }
 
 static void
@@ -294,9 +507,7 @@ g_test_tls_connection_initable_init (GInitable       *initable,
 				      GCancellable    *cancellable,
 				      GError         **error)
 {
-  g_set_error_literal (error, G_TLS_ERROR, G_TLS_ERROR_UNAVAILABLE,
-		       "TLS Connection support is not available");
-  return FALSE;
+  return TRUE;
 }
 
 static void
@@ -305,8 +516,164 @@ g_test_tls_connection_initable_iface_init (GInitableIface  *iface)
   iface->init = g_test_tls_connection_initable_init;
 }
 
+/* Client side */
+
+typedef GTestTlsConnection      GTestTlsClientConnection;
+typedef GTestTlsConnectionClass GTestTlsClientConnectionClass;
+
+#define g_test_tls_client_connection_get_type _g_test_tls_client_connection_get_type
+G_DEFINE_TYPE_WITH_CODE (GTestTlsClientConnection, g_test_tls_client_connection, _g_test_tls_connection_get_type (),
+			 G_IMPLEMENT_INTERFACE (G_TYPE_TLS_CLIENT_CONNECTION, NULL);)
+
+static gboolean
+g_test_tls_client_connection_handshake_line (GTestTlsConnection  *conn,
+					      GCancellable        *cancellable,
+					      GError             **error)
+{
+  GTlsSessionCache *cache = NULL;
+  GBytes *session = NULL;
+  gchar *hello, *reply;
+  gboolean ret = TRUE;
+
+  if (conn->server_identity)
+    cache = g_tls_client_connection_get_session_cache (G_TLS_CLIENT_CONNECTION (conn));
+  if (cache)
+    session = g_tls_session_cache_lookup (cache, conn->server_identity);
+
+  if (session)
+    {
+      hello = g_strdup_printf ("RESUME %.*s",
+			       (int) g_bytes_get_size (session),
+			       (const gchar *) g_bytes_get_data (session, NULL));
+      g_bytes_unref (session);
+    }
+  else
+    hello = g_strdup ("HELLO");
+
+  if (!write_line (conn, hello, cancellable, error))
+    {
+      g_free (hello);
+      return FALSE;
+    }
+  g_free (hello);
+
+  reply = read_line (conn, cancellable, error);
+  if (reply == NULL)
+    return FALSE;
+
+  if (strcmp (reply, "RESUMED") == 0)
+    conn->resumed = TRUE;
+  else if (g_str_has_prefix (reply, "FULL "))
+    {
+      if (cache)
+	{
+	  session = g_bytes_new (reply + 5, strlen (reply + 5));
+	  g_tls_session_cache_store (cache, conn->server_identity, session);
+	  g_bytes_unref (session);
+	}
+    }
+  else
+    {
+      g_set_error (error, G_TLS_ERROR, G_TLS_ERROR_NOT_TLS,
+		   "Unexpected server handshake \"%s\"", reply);
+      ret = FALSE;
+    }
+
+  g_free (reply);
+  return ret;
+}
+
+static void
+g_test_tls_client_connection_class_init (GTestTlsClientConnectionClass *connection_class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (connection_class);
+
+  gobject_class->get_property = g_test_tls_connection_get_property;
+  gobject_class->set_property = g_test_tls_connection_set_property;
+
+  connection_class->handshake_line = g_test_tls_client_connection_handshake_line;
+
+  g_object_class_override_property (gobject_class, PROP_CONN_VALIDATION_FLAGS, "validation-flags");
+  g_object_class_override_property (gobject_class, PROP_CONN_SERVER_IDENTITY, "server-identity");
+  g_object_class_override_property (gobject_class, PROP_CONN_USE_SSL3, "use-ssl3");
+  g_object_class_override_property (gobject_class, PROP_CONN_ACCEPTED_CAS, "accepted-cas");
+}
+
+static void
+g_test_tls_client_connection_init (GTestTlsClientConnection *connection)
+{
+}
+
+/* Server side */
+
+typedef GTestTlsConnection      GTestTlsServerConnection;
+typedef GTestTlsConnectionClass GTestTlsServerConnectionClass;
+
+#define g_test_tls_server_connection_get_type _g_test_tls_server_connection_get_type
+G_DEFINE_TYPE_WITH_CODE (GTestTlsServerConnection, g_test_tls_server_connection, _g_test_tls_connection_get_type (),
+			 G_IMPLEMENT_INTERFACE (G_TYPE_TLS_SERVER_CONNECTION, NULL);)
+
+static gboolean
+g_test_tls_server_connection_handshake_line (GTestTlsConnection  *conn,
+					      GCancellable        *cancellable,
+					      GError             **error)
+{
+  gchar *hello, *reply;
+  gboolean ret;
+
+  hello = read_line (conn, cancellable, error);
+  if (hello == NULL)
+    return FALSE;
+
+  G_LOCK (tickets);
+  if (!tickets)
+    tickets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  if (g_str_has_prefix (hello, "RESUME ") &&
+      g_hash_table_lookup_extended (tickets, hello + 7, NULL, NULL))
+    {
+      conn->resumed = TRUE;
+      reply = g_strdup ("RESUMED");
+    }
+  else
+    {
+      reply = g_strdup_printf ("FULL ticket-%u", ++next_ticket);
+      g_hash_table_add (tickets, g_strdup (reply + 5));
+    }
+  G_UNLOCK (tickets);
+
+  ret = write_line (conn, reply, cancellable, error);
+  g_free (reply);
+  g_free (hello);
+  return ret;
+}
+
+static void
+g_test_tls_server_connection_class_init (GTestTlsServerConnectionClass *connection_class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (connection_class);
+
+  gobject_class->get_property = g_test_tls_connection_get_property;
+  gobject_class->set_property = g_test_tls_connection_set_property;
+
+  connection_class->handshake_line = g_test_tls_server_connection_handshake_line;
+
+  g_object_class_override_property (gobject_class, PROP_CONN_AUTHENTICATION_MODE, "authentication-mode");
+}
+
+static void
+g_test_tls_server_connection_init (GTestTlsServerConnection *connection)
+{
+}
+
 const gchar *
 g_test_tls_connection_get_private_key_pem (GTlsCertificate *cert)
 {
   return ((GTestTlsCertificate *)cert)->key_pem;
 }
+
+gboolean
+g_test_tls_connection_get_resumed (GTlsConnection *conn)
+{
+  return ((GTestTlsConnection *)conn)->resumed;
+}
@@ -42,6 +42,7 @@ struct _GTestTlsBackendClass {
 GType _g_test_tls_backend_get_type       (void);
 
 const gchar *g_test_tls_connection_get_private_key_pem (GTlsCertificate *cert);
+gboolean     g_test_tls_connection_get_resumed         (GTlsConnection  *conn);
 
 
 G_END_DECLS
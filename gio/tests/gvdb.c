@@ -0,0 +1,341 @@
+/* GLib testing framework examples and tests
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This work is provided "as is"; redistribution and modification
+ * in whole or in part, in any medium, physical or electronic is
+ * permitted without restriction.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * In no event shall the authors or contributors be liable for any
+ * direct, indirect, incidental, special, exemplary, or consequential
+ * damages (including, but not limited to, procurement of substitute
+ * goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether
+ * in contract, strict liability, or tort (including negligence or
+ * otherwise) arising in any way out of the use of this software, even
+ * if advised of the possibility of such damage.
+ */
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gvdb/gvdb-builder.h"
+#include "gvdb/gvdb-format.h"
+#include "gvdb/gvdb-reader.h"
+
+#define N_KEYS    20000
+#define N_LOOKUPS 1000000
+
+static gchar *
+key_name (const gchar *prefix,
+          gint         i)
+{
+  return g_strdup_printf ("/org/gtk/test/%s/key%d", prefix, i);
+}
+
+/* Writes a flat table with N_KEYS "present" keys and returns it */
+static GvdbTable *
+make_table (gchar **filename)
+{
+  GHashTable *table;
+  GvdbTable *gvdb;
+  GError *error = NULL;
+  gint fd;
+  gint i;
+
+  fd = g_file_open_tmp ("gvdb-test-XXXXXX", filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  table = gvdb_hash_table_new (NULL, NULL);
+  for (i = 0; i < N_KEYS; i++)
+    {
+      gchar *key = key_name ("present", i);
+      GvdbItem *item;
+
+      item = gvdb_hash_table_insert (table, key);
+      gvdb_item_set_value (item, g_variant_new_int32 (i));
+      g_free (key);
+    }
+
+  gvdb_table_write_contents (table, *filename, FALSE, &error);
+  g_assert_no_error (error);
+  g_hash_table_unref (table);
+
+  gvdb = gvdb_table_new (*filename, TRUE, &error);
+  g_assert_no_error (error);
+
+  return gvdb;
+}
+
+static void
+test_lookup (void)
+{
+  GvdbTable *table;
+  gchar *filename;
+  gint i;
+
+  table = make_table (&filename);
+
+  for (i = 0; i < N_KEYS; i++)
+    {
+      gchar *key;
+      GVariant *value;
+
+      key = key_name ("present", i);
+      value = gvdb_table_get_value (table, key);
+      g_assert (value != NULL);
+      g_assert_cmpint (g_variant_get_int32 (value), ==, i);
+      g_variant_unref (value);
+      g_free (key);
+
+      key = key_name ("absent", i);
+      g_assert (!gvdb_table_has_value (table, key));
+      g_free (key);
+    }
+
+  gvdb_table_unref (table);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static guint32
+key_hash (const gchar *key)
+{
+  guint32 hash_value = 5381;
+
+  while (*key)
+    hash_value = (hash_value * 33) + *(signed char *) key++;
+
+  return hash_value;
+}
+
+/* Finds the bloom filter of the root table in the file @contents */
+static guint32_le *
+find_bloom_filter (gchar   *contents,
+                   gsize    length,
+                   guint32 *n_words,
+                   guint   *shift)
+{
+  struct gvdb_header *header;
+  struct gvdb_hash_header *hash_header;
+  guint32 start, value;
+
+  g_assert_cmpuint (length, >=, sizeof *header);
+  header = (struct gvdb_header *) contents;
+  start = guint32_from_le (header->root.start);
+  g_assert_cmpuint (start + sizeof *hash_header, <=, length);
+
+  hash_header = (struct gvdb_hash_header *) (contents + start);
+  value = guint32_from_le (hash_header->n_bloom_words);
+  *shift = value >> 27;
+  *n_words = value & ((1u << 27) - 1);
+  g_assert_cmpuint (start + sizeof *hash_header + *n_words * 4, <=, length);
+
+  return (guint32_le *) (hash_header + 1);
+}
+
+static gboolean
+bloom_filter_contains (guint32_le *words,
+                       guint32     n_words,
+                       guint       shift,
+                       guint32     hash_value)
+{
+  guint32 mask;
+
+  mask = 1u << (hash_value & 31);
+  mask |= 1u << ((hash_value >> shift) & 31);
+
+  return (guint32_from_le (words[(hash_value / 32) % n_words]) & mask) == mask;
+}
+
+static void
+test_bloom (void)
+{
+  GvdbTable *table;
+  GError *error = NULL;
+  guint32_le *words;
+  gchar *filename;
+  gchar *contents;
+  gsize length;
+  guint32 n_words;
+  guint32 hash_value;
+  guint shift;
+  gint rejected;
+  gint i;
+
+  table = make_table (&filename);
+  gvdb_table_unref (table);
+
+  g_file_get_contents (filename, &contents, &length, &error);
+  g_assert_no_error (error);
+
+  /* The writer emits a filter with every present key in it, and it
+   * keeps out the vast majority of absent ones.
+   */
+  words = find_bloom_filter (contents, length, &n_words, &shift);
+  g_assert_cmpuint (n_words, >=, N_KEYS / 4);
+  g_assert_cmpuint (shift, !=, 0);
+
+  rejected = 0;
+  for (i = 0; i < N_KEYS; i++)
+    {
+      gchar *key;
+
+      key = key_name ("present", i);
+      g_assert (bloom_filter_contains (words, n_words, shift, key_hash (key)));
+      g_free (key);
+
+      key = key_name ("absent", i);
+      if (!bloom_filter_contains (words, n_words, shift, key_hash (key)))
+        rejected++;
+      g_free (key);
+    }
+  g_assert_cmpint (rejected, >, N_KEYS * 9 / 10);
+
+  /* The reader must check both bits: leave only the first bit of a
+   * present key set in its word, and that key is no longer found even
+   * though its hash item is still there.
+   */
+  for (i = 0; i < N_KEYS; i++)
+    {
+      gchar *key;
+
+      key = key_name ("present", i);
+      hash_value = key_hash (key);
+      if ((hash_value & 31) != ((hash_value >> shift) & 31))
+        {
+          words[(hash_value / 32) % n_words] = guint32_to_le (1u << (hash_value & 31));
+
+          table = gvdb_table_new_from_data (contents, length, TRUE,
+                                            NULL, NULL, NULL, &error);
+          g_assert_no_error (error);
+          g_assert (!gvdb_table_has_value (table, key));
+          gvdb_table_unref (table);
+          g_free (key);
+          break;
+        }
+      g_free (key);
+    }
+  g_assert_cmpint (i, <, N_KEYS);
+
+  g_free (contents);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static gboolean
+strv_contains (gchar       **strv,
+               const gchar  *str)
+{
+  for (; *strv; strv++)
+    if (strcmp (*strv, str) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+test_names (void)
+{
+  GHashTable *table;
+  GvdbTable *gvdb;
+  GvdbItem *dir, *item;
+  GError *error = NULL;
+  gchar *filename;
+  gchar **names;
+  gint n_names;
+  gint fd;
+
+  fd = g_file_open_tmp ("gvdb-test-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  table = gvdb_hash_table_new (NULL, NULL);
+  dir = gvdb_hash_table_insert (table, "/dir/");
+  item = gvdb_hash_table_insert (table, "/dir/a");
+  gvdb_item_set_value (item, g_variant_new_boolean (TRUE));
+  gvdb_item_set_parent (item, dir);
+  item = gvdb_hash_table_insert (table, "/dir/b");
+  gvdb_item_set_value (item, g_variant_new_boolean (FALSE));
+  gvdb_item_set_parent (item, dir);
+  gvdb_hash_table_insert_string (table, "/c", "c");
+
+  gvdb_table_write_contents (table, filename, FALSE, &error);
+  g_assert_no_error (error);
+  g_hash_table_unref (table);
+
+  gvdb = gvdb_table_new (filename, TRUE, &error);
+  g_assert_no_error (error);
+
+  names = gvdb_table_get_names (gvdb, &n_names);
+  g_assert_cmpint (n_names, ==, 4);
+  g_assert_cmpint (g_strv_length (names), ==, 4);
+  g_assert (strv_contains (names, "/dir/"));
+  g_assert (strv_contains (names, "/dir/a"));
+  g_assert (strv_contains (names, "/dir/b"));
+  g_assert (strv_contains (names, "/c"));
+  g_strfreev (names);
+
+  g_assert (gvdb_table_has_value (gvdb, "/dir/a"));
+  g_assert (!gvdb_table_has_value (gvdb, "/dir/"));
+
+  gvdb_table_unref (gvdb);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_lookup_perf (gconstpointer data)
+{
+  const gchar *prefix = data;
+  GvdbTable *table;
+  gchar *filename;
+  gchar **keys;
+  gint64 start_time;
+  gdouble rate;
+  gint i;
+
+  table = make_table (&filename);
+
+  keys = g_new (gchar *, N_KEYS + 1);
+  for (i = 0; i < N_KEYS; i++)
+    keys[i] = key_name (prefix, i);
+  keys[i] = NULL;
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < N_LOOKUPS; i++)
+    gvdb_table_has_value (table, keys[i % N_KEYS]);
+  rate = N_LOOKUPS / ((g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
+
+  g_test_maximized_result (rate, "%.0f %s lookups/s in %d keys", rate, prefix, N_KEYS);
+
+  g_strfreev (keys);
+  gvdb_table_unref (table);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gvdb/lookup", test_lookup);
+  g_test_add_func ("/gvdb/names", test_names);
+  g_test_add_func ("/gvdb/bloom", test_bloom);
+
+  if (g_test_perf ())
+    {
+      g_test_add_data_func ("/gvdb/perf/lookup-present", "present", test_lookup_perf);
+      g_test_add_data_func ("/gvdb/perf/lookup-absent", "absent", test_lookup_perf);
+    }
+
+  return g_test_run ();
+}
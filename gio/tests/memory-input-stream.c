@@ -132,6 +132,74 @@ test_async (void)
   g_main_loop_unref (loop);
 }
 
+static void
+async_read_bytes (GObject      *object,
+		  GAsyncResult *result,
+		  gpointer      user_data)
+{
+  GBytes **bytes = user_data;
+  GError *error = NULL;
+
+  *bytes = g_input_stream_read_bytes_finish (G_INPUT_STREAM (object),
+					     result, &error);
+  g_assert_no_error (error);
+
+  g_main_loop_quit (loop);
+}
+
+static void
+test_read_bytes (void)
+{
+  const char *data1 = "abcdefghijklmnopqrstuvwxyz";
+  const char *data2 = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  const char *result = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  GPtrArray *chunks;
+  GInputStream *stream;
+  GError *error = NULL;
+  GBytes *bytes;
+  GString *str;
+  guint i;
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  stream = g_memory_input_stream_new ();
+  g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (stream),
+                                  data1, -1, NULL);
+  g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (stream),
+                                  data2, -1, NULL);
+
+  /* Keep every chunk alive until the end so that reusing a buffer
+   * too early would show.
+   */
+  chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  do
+    {
+      if (chunks->len % 2)
+        bytes = g_input_stream_read_bytes (stream, 5, NULL, &error);
+      else
+        {
+          g_input_stream_read_bytes_async (stream, 5, G_PRIORITY_DEFAULT,
+                                           NULL, async_read_bytes, &bytes);
+          g_main_loop_run (loop);
+        }
+      g_assert_no_error (error);
+      g_assert_cmpint (g_bytes_get_size (bytes), <=, 5);
+      g_ptr_array_add (chunks, bytes);
+    }
+  while (g_bytes_get_size (bytes) > 0);
+
+  str = g_string_new (NULL);
+  for (i = 0; i < chunks->len; i++)
+    g_string_append_len (str, g_bytes_get_data (chunks->pdata[i], NULL),
+                         g_bytes_get_size (chunks->pdata[i]));
+  g_assert_cmpstr (str->str, ==, result);
+
+  g_string_free (str, TRUE);
+  g_ptr_array_unref (chunks);
+  g_object_unref (stream);
+  g_main_loop_unref (loop);
+}
+
 static void
 test_seek (void)
 {
@@ -203,6 +271,7 @@ main (int   argc,
 
   g_test_add_func ("/memory-input-stream/read-chunks", test_read_chunks);
   g_test_add_func ("/memory-input-stream/async", test_async);
+  g_test_add_func ("/memory-input-stream/read-bytes", test_read_bytes);
   g_test_add_func ("/memory-input-stream/seek", test_seek);
   g_test_add_func ("/memory-input-stream/truncate", test_truncate);
 
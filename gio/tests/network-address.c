@@ -1,5 +1,9 @@
 #include <gio/gio.h>
 
+/* hack */
+#define GIO_COMPILATION
+#include "gthreadedresolver.h"
+
 static void
 test_basic (void)
 {
@@ -104,6 +108,219 @@ test_parse (gconstpointer d)
     g_error_free (error);
 }
 
+#define N_LOOKUPS 10000
+
+static void
+lookup_async_cb (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+  GList **addresses = user_data;
+  GError *error = NULL;
+
+  *addresses = g_resolver_lookup_by_name_finish (G_RESOLVER (source), result, &error);
+  g_assert_no_error (error);
+}
+
+static gboolean
+addresses_equal (GList *a,
+                 GList *b)
+{
+  for (; a != NULL && b != NULL; a = a->next, b = b->next)
+    if (!g_inet_address_equal (a->data, b->data))
+      return FALSE;
+
+  return a == NULL && b == NULL;
+}
+
+/* A resolver that counts the lookups that get past its cache, and
+ * can hold them up until the test lets them go
+ */
+typedef GThreadedResolver CountingResolver;
+typedef GThreadedResolverClass CountingResolverClass;
+
+static GType counting_resolver_get_type (void);
+G_DEFINE_TYPE (CountingResolver, counting_resolver, G_TYPE_THREADED_RESOLVER)
+
+static GMutex counting_lock;
+static GCond counting_cond;
+static gint n_resolved;
+static gboolean resolving_blocked;
+
+static GList *
+counting_resolver_resolve_name (const gchar  *hostname,
+                                GError      **error)
+{
+  GThreadedResolverClass *parent_class;
+
+  g_mutex_lock (&counting_lock);
+  n_resolved++;
+  g_cond_broadcast (&counting_cond);
+  while (resolving_blocked)
+    g_cond_wait (&counting_cond, &counting_lock);
+  g_mutex_unlock (&counting_lock);
+
+  parent_class = G_THREADED_RESOLVER_CLASS (counting_resolver_parent_class);
+
+  return parent_class->resolve_name (hostname, error);
+}
+
+static void
+counting_resolver_init (CountingResolver *resolver)
+{
+}
+
+static void
+counting_resolver_class_init (CountingResolverClass *class)
+{
+  class->resolve_name = counting_resolver_resolve_name;
+}
+
+static gint
+get_n_resolved (void)
+{
+  gint n;
+
+  g_mutex_lock (&counting_lock);
+  n = n_resolved;
+  g_mutex_unlock (&counting_lock);
+
+  return n;
+}
+
+/* G_RESOLVER_CACHE_TTL is set in main(), so repeated lookups are
+ * answered from the cache
+ */
+static void
+test_resolver_cache (void)
+{
+  GResolver *resolver;
+  GList *first, *second, *async = NULL;
+  GError *error = NULL;
+
+  resolver = g_object_new (counting_resolver_get_type (), NULL);
+  n_resolved = 0;
+
+  first = g_resolver_lookup_by_name (resolver, "localhost", NULL, &error);
+  g_assert_no_error (error);
+  g_assert (first != NULL);
+  g_assert_cmpint (get_n_resolved (), ==, 1);
+
+  second = g_resolver_lookup_by_name (resolver, "localhost", NULL, &error);
+  g_assert_no_error (error);
+  g_assert (addresses_equal (first, second));
+  g_assert_cmpint (get_n_resolved (), ==, 1);
+
+  g_resolver_lookup_by_name_async (resolver, "localhost", NULL, lookup_async_cb, &async);
+  while (async == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (addresses_equal (first, async));
+  g_assert_cmpint (get_n_resolved (), ==, 1);
+  g_resolver_free_addresses (async);
+  async = NULL;
+
+  /* a configuration change drops the cached results */
+  g_signal_emit_by_name (resolver, "reload");
+  g_resolver_free_addresses (second);
+  second = g_resolver_lookup_by_name (resolver, "localhost", NULL, &error);
+  g_assert_no_error (error);
+  g_assert (addresses_equal (first, second));
+  g_assert_cmpint (get_n_resolved (), ==, 2);
+
+  g_resolver_free_addresses (first);
+  g_resolver_free_addresses (second);
+  g_object_unref (resolver);
+}
+
+#define N_COALESCED 4
+
+static gpointer
+lookup_thread (gpointer data)
+{
+  GResolver *resolver = data;
+  GError *error = NULL;
+  GList *addresses;
+
+  addresses = g_resolver_lookup_by_name (resolver, "localhost", NULL, &error);
+  g_assert_no_error (error);
+
+  return addresses;
+}
+
+/* Test that lookups of a name that is being resolved wait for that
+ * lookup instead of resolving it again
+ */
+static void
+test_resolver_coalesce (void)
+{
+  GResolver *resolver;
+  GThread *threads[N_COALESCED];
+  GList *addresses[N_COALESCED];
+  gint64 end_time;
+  gint i;
+
+  resolver = g_object_new (counting_resolver_get_type (), NULL);
+  n_resolved = 0;
+  resolving_blocked = TRUE;
+
+  for (i = 0; i < N_COALESCED; i++)
+    threads[i] = g_thread_new ("lookup", lookup_thread, resolver);
+
+  /* Hold up the first lookup for a while, to give the others time to
+   * pile up behind it.  If they don't wait for it, they all get here
+   * and there is no point in waiting any longer.
+   */
+  end_time = g_get_monotonic_time () + G_USEC_PER_SEC / 2;
+  g_mutex_lock (&counting_lock);
+  while (n_resolved < N_COALESCED &&
+         g_cond_wait_until (&counting_cond, &counting_lock, end_time))
+    ;
+  resolving_blocked = FALSE;
+  g_cond_broadcast (&counting_cond);
+  g_mutex_unlock (&counting_lock);
+
+  for (i = 0; i < N_COALESCED; i++)
+    {
+      addresses[i] = g_thread_join (threads[i]);
+      g_assert (addresses[i] != NULL);
+      g_assert (addresses_equal (addresses[0], addresses[i]));
+    }
+
+  g_assert_cmpint (get_n_resolved (), ==, 1);
+
+  for (i = 0; i < N_COALESCED; i++)
+    g_resolver_free_addresses (addresses[i]);
+  g_object_unref (resolver);
+}
+
+static void
+test_resolver_cache_perf (void)
+{
+  GResolver *resolver;
+  gint64 start_time;
+  gdouble rate;
+  gint i;
+
+  resolver = g_resolver_get_default ();
+
+  start_time = g_get_monotonic_time ();
+  for (i = 0; i < N_LOOKUPS; i++)
+    {
+      GList *addresses;
+      GError *error = NULL;
+
+      addresses = g_resolver_lookup_by_name (resolver, "localhost", NULL, &error);
+      g_assert_no_error (error);
+      g_resolver_free_addresses (addresses);
+    }
+  rate = N_LOOKUPS / ((g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
+
+  g_test_maximized_result (rate, "%.0f lookups/s with G_RESOLVER_CACHE_TTL=%s",
+                           rate, g_getenv ("G_RESOLVER_CACHE_TTL"));
+
+  g_object_unref (resolver);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -114,6 +331,10 @@ main (int argc, char *argv[])
 
   g_test_init (&argc, &argv, NULL);
 
+  /* must be set before the default resolver gets created */
+  if (g_getenv ("G_RESOLVER_CACHE_TTL") == NULL)
+    g_setenv ("G_RESOLVER_CACHE_TTL", "60", TRUE);
+
   g_test_add_func ("/network-address/basic", test_basic);
   g_test_add_func ("/network-address/parse/uri", test_parse_uri);
 
@@ -124,5 +345,10 @@ main (int argc, char *argv[])
       g_free (path);
     }
 
+  g_test_add_func ("/network-address/resolver-cache", test_resolver_cache);
+  g_test_add_func ("/network-address/resolver-coalesce", test_resolver_coalesce);
+  if (g_test_perf ())
+    g_test_add_func ("/network-address/perf/resolver-cache", test_resolver_cache_perf);
+
   return g_test_run ();
 }
@@ -181,6 +181,61 @@ test_resource_data (void)
   g_resource_unref (resource);
 }
 
+static void
+test_resource_data_cache (void)
+{
+  GResource *resource;
+  GError *error = NULL;
+  GBytes *data1, *data2;
+  GInputStream *in;
+  char buffer[128];
+  gsize size;
+
+  resource = g_resource_load ("test.gresource", &error);
+  g_assert (resource != NULL);
+  g_assert_no_error (error);
+
+  /* Decompressed data is cached, so the second lookup shares the first's */
+  data1 = g_resource_lookup_data (resource, "/test1.txt",
+                                  G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
+  g_assert_no_error (error);
+  data2 = g_resource_lookup_data (resource, "/test1.txt",
+                                  G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
+  g_assert_no_error (error);
+  g_assert (g_bytes_get_data (data1, NULL) == g_bytes_get_data (data2, NULL));
+  g_assert_cmpstr (g_bytes_get_data (data2, NULL), ==, "test1\n");
+  g_bytes_unref (data1);
+
+  in = g_resource_open_stream (resource, "/test1.txt",
+                               G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
+  g_assert_no_error (error);
+  g_input_stream_read_all (in, buffer, sizeof (buffer) - 1, &size, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (size, ==, 6);
+  buffer[size] = 0;
+  g_assert_cmpstr (buffer, ==, "test1\n");
+
+  /* Cached data outlives the resource */
+  g_resource_unref (resource);
+  g_assert_cmpstr (g_bytes_get_data (data2, NULL), ==, "test1\n");
+  g_bytes_unref (data2);
+
+  g_input_stream_read_all (in, buffer, sizeof (buffer) - 1, &size, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (size, ==, 0);
+  g_object_unref (in);
+
+  /* A new resource never sees the old one's entries */
+  resource = g_resource_load ("test.gresource", &error);
+  g_assert_no_error (error);
+  data1 = g_resource_lookup_data (resource, "/test1.txt",
+                                  G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (g_bytes_get_data (data1, NULL), ==, "test1\n");
+  g_bytes_unref (data1);
+  g_resource_unref (resource);
+}
+
 static void
 test_resource_registred (void)
 {
@@ -303,6 +358,53 @@ test_resource_registred (void)
   g_clear_error (&error);
 }
 
+static void
+test_resource_registred_overlapping (void)
+{
+  GResource *resource1, *resource2;
+  GError *error = NULL;
+  gboolean found;
+  GBytes *data;
+
+  resource1 = g_resource_load ("test.gresource", &error);
+  g_assert_no_error (error);
+  resource2 = g_resource_load ("test.gresource", &error);
+  g_assert_no_error (error);
+
+  g_resources_register (resource1);
+  g_resources_register (resource2);
+
+  /* Dropping the resource that shadows a path uncovers the other one */
+  g_resources_unregister (resource2);
+
+  data = g_resources_lookup_data ("/a_prefix/test2.txt",
+                                  G_RESOURCE_LOOKUP_FLAGS_NONE,
+                                  &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (g_bytes_get_data (data, NULL), ==, "test2\n");
+  g_bytes_unref (data);
+
+  /* Directories are not files */
+  found = g_resources_get_info ("/a_prefix",
+                                G_RESOURCE_LOOKUP_FLAGS_NONE,
+                                NULL, NULL, &error);
+  g_assert (!found);
+  g_assert_error (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND);
+  g_clear_error (&error);
+
+  g_resources_unregister (resource1);
+
+  found = g_resources_get_info ("/a_prefix/test2.txt",
+                                G_RESOURCE_LOOKUP_FLAGS_NONE,
+                                NULL, NULL, &error);
+  g_assert (!found);
+  g_assert_error (error, G_RESOURCE_ERROR, G_RESOURCE_ERROR_NOT_FOUND);
+  g_clear_error (&error);
+
+  g_resource_unref (resource1);
+  g_resource_unref (resource2);
+}
+
 static void
 test_resource_automatic (void)
 {
@@ -472,7 +574,9 @@ main (int   argc,
 
   g_test_add_func ("/resource/file", test_resource_file);
   g_test_add_func ("/resource/data", test_resource_data);
+  g_test_add_func ("/resource/data-cache", test_resource_data_cache);
   g_test_add_func ("/resource/registred", test_resource_registred);
+  g_test_add_func ("/resource/registred-overlapping", test_resource_registred_overlapping);
   g_test_add_func ("/resource/manual", test_resource_manual);
 #ifdef G_HAS_CONSTRUCTORS
   g_test_add_func ("/resource/automatic", test_resource_automatic);
@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
 #include <gio/gunixconnection.h>
@@ -424,252 +425,1726 @@ test_ipv6_sync (void)
   test_ip_sync (G_SOCKET_FAMILY_IPV6);
 }
 
+static void
+test_receive_bytes (void)
+{
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client;
+  GSocketAddress *addr;
+  GBytes *bytes[3];
+  gssize len;
+  int i;
+
+  data = create_server (G_SOCKET_FAMILY_IPV4, echo_server_thread, FALSE);
+  addr = g_socket_get_local_address (data->server, &error);
+  g_assert_no_error (error);
+
+  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+  g_socket_set_timeout (client, 1);
+  g_socket_connect (client, addr, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (addr);
+
+  /* The last one is too large to share a buffer with the others;
+   * all of them must stay intact while the next ones are received.
+   */
+  for (i = 0; i < G_N_ELEMENTS (bytes); i++)
+    {
+      len = g_socket_send (client, testbuf + i, strlen (testbuf) - i, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (len, ==, strlen (testbuf) - i);
+
+      bytes[i] = g_socket_receive_bytes (client, i < 2 ? 128 : 65536, NULL, &error);
+      g_assert_no_error (error);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (bytes); i++)
+    {
+      g_assert_cmpint (g_bytes_get_size (bytes[i]), ==, strlen (testbuf) - i);
+      g_assert (memcmp (g_bytes_get_data (bytes[i], NULL), testbuf + i,
+			strlen (testbuf) - i) == 0);
+      g_bytes_unref (bytes[i]);
+    }
+
+  g_socket_shutdown (client, FALSE, TRUE, &error);
+  g_assert_no_error (error);
+  g_thread_join (data->thread);
+
+  bytes[0] = g_socket_receive_bytes (client, 128, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_bytes_get_size (bytes[0]), ==, 0);
+  g_bytes_unref (bytes[0]);
+
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+  g_assert (g_socket_receive_bytes (client, 128, NULL, &error) == NULL);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+  g_clear_error (&error);
+
+  g_socket_close (data->server, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (data->server);
+  g_object_unref (client);
+
+  g_slice_free (IPTestData, data);
+}
+
+#define ZEROCOPY_SIZE (256 * 1024)
+
 static gpointer
-graceful_server_thread (gpointer user_data)
+zerocopy_server_thread (gpointer user_data)
+{
+  IPTestData *data = user_data;
+  GSocket *sock;
+  GError *error = NULL;
+  gchar buf[4096];
+  gsize received = 0;
+  gssize nread, i;
+
+  sock = g_socket_accept (data->server, NULL, &error);
+  g_assert_no_error (error);
+
+  while ((nread = g_socket_receive (sock, buf, sizeof (buf), NULL, &error)) > 0)
+    {
+      for (i = 0; i < nread; i++)
+	g_assert_cmpint ((guchar) buf[i], ==, (received + i) % 251);
+      received += nread;
+    }
+  g_assert_no_error (error);
+  g_assert_cmpint (received, ==, 2 * ZEROCOPY_SIZE);
+
+  g_socket_close (sock, &error);
+  g_assert_no_error (error);
+  g_object_unref (sock);
+  return NULL;
+}
+
+static void
+zerocopy_freed (gpointer user_data)
+{
+  gboolean *freed = user_data;
+
+  *freed = TRUE;
+}
+
+static void
+zerocopy_written (GObject      *source,
+		  GAsyncResult *result,
+		  gpointer      user_data)
+{
+  gssize *written = user_data;
+  GError *error = NULL;
+
+  *written = g_output_stream_write_bytes_finish (G_OUTPUT_STREAM (source),
+						 result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_zerocopy (void)
+{
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client;
+  GSocketAddress *addr;
+  GSocketConnection *conn;
+  GOutputStream *out;
+  GBytes *bytes, *rest;
+  guchar *buf;
+  gboolean freed = FALSE;
+  gsize offset;
+  gssize written;
+  int i;
+
+  data = create_server (G_SOCKET_FAMILY_IPV4, zerocopy_server_thread, FALSE);
+  addr = g_socket_get_local_address (data->server, &error);
+  g_assert_no_error (error);
+
+  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+  g_socket_connect (client, addr, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (addr);
+
+  g_object_set (client, "zerocopy", TRUE, NULL);
+  if (!g_socket_get_zerocopy (client))
+    g_test_message ("Zero-copy sending not supported; testing the fallback");
+
+  buf = g_malloc (2 * ZEROCOPY_SIZE);
+  for (i = 0; i < 2 * ZEROCOPY_SIZE; i++)
+    buf[i] = i % 251;
+  bytes = g_bytes_new_with_free_func (buf, 2 * ZEROCOPY_SIZE,
+				      zerocopy_freed, &freed);
+
+  /* First half straight on the socket, the rest through the stream */
+  g_socket_cork (client);
+  for (offset = 0; offset < ZEROCOPY_SIZE; offset += written)
+    {
+      rest = g_bytes_new_from_bytes (bytes, offset, ZEROCOPY_SIZE - offset);
+      written = g_socket_send_bytes (client, rest, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (written, >, 0);
+      g_bytes_unref (rest);
+    }
+  g_socket_uncork (client);
+
+  conn = g_socket_connection_factory_create_connection (client);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (conn));
+  while (offset < 2 * ZEROCOPY_SIZE)
+    {
+      rest = g_bytes_new_from_bytes (bytes, offset, 2 * ZEROCOPY_SIZE - offset);
+      written = -1;
+      g_output_stream_write_bytes_async (out, rest, G_PRIORITY_DEFAULT,
+					 NULL, zerocopy_written, &written);
+      g_bytes_unref (rest);
+      while (written == -1)
+	g_main_context_iteration (NULL, TRUE);
+      g_assert_cmpint (written, >, 0);
+      offset += written;
+    }
+  g_bytes_unref (bytes);
+
+  g_socket_shutdown (client, FALSE, TRUE, &error);
+  g_assert_no_error (error);
+  g_thread_join (data->thread);
+
+  /* Waiting on the socket collects the kernel's completions */
+  for (i = 0; i < 50 && !freed; i++)
+    g_socket_condition_timed_wait (client, G_IO_PRI, 20000, NULL, NULL);
+  g_assert (freed);
+
+  g_object_unref (conn);
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+  g_socket_close (data->server, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (data->server);
+  g_object_unref (client);
+
+  g_slice_free (IPTestData, data);
+}
+
+#define ZEROCOPY_CLOSE_SIZE (8 * 1024 * 1024)
+
+static gpointer
+zerocopy_close_server_thread (gpointer user_data)
+{
+  IPTestData *data = user_data;
+  GSocket *sock;
+  GError *error = NULL;
+  gchar buf[65536];
+  gsize received = 0;
+  gssize nread, i;
+
+  sock = g_socket_accept (data->server, NULL, &error);
+  g_assert_no_error (error);
+
+  /* Let the client's sends back up in the kernel */
+  g_usleep (100000);
+
+  while ((nread = g_socket_receive (sock, buf, sizeof (buf), NULL, &error)) > 0)
+    {
+      for (i = 0; i < nread; i++)
+	g_assert_cmpint ((guchar) buf[i], ==, (received + i) % 251);
+      received += nread;
+    }
+  g_assert_no_error (error);
+  g_assert_cmpint (received, ==, ZEROCOPY_CLOSE_SIZE);
+
+  g_object_unref (sock);
+  return NULL;
+}
+
+static void
+zerocopy_scribble (gpointer user_data)
+{
+  memset (user_data, 0, ZEROCOPY_CLOSE_SIZE);
+  g_free (user_data);
+}
+
+/* Closing straight after the last send must not let the buffers go
+ * while the kernel is still sending from them.
+ */
+static void
+test_zerocopy_close (void)
+{
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client;
+  GSocketAddress *addr;
+  GBytes *bytes, *rest;
+  guchar *buf;
+  gsize offset;
+  gssize written;
+  int i;
+
+  data = create_server (G_SOCKET_FAMILY_IPV4, zerocopy_close_server_thread, FALSE);
+  addr = g_socket_get_local_address (data->server, &error);
+  g_assert_no_error (error);
+
+  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+  g_socket_connect (client, addr, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (addr);
+
+  g_object_set (client, "zerocopy", TRUE, NULL);
+  if (!g_socket_get_zerocopy (client))
+    g_test_message ("Zero-copy sending not supported; testing the fallback");
+
+  buf = g_malloc (ZEROCOPY_CLOSE_SIZE);
+  for (i = 0; i < ZEROCOPY_CLOSE_SIZE; i++)
+    buf[i] = i % 251;
+  bytes = g_bytes_new_with_free_func (buf, ZEROCOPY_CLOSE_SIZE,
+				      zerocopy_scribble, buf);
+
+  for (offset = 0; offset < ZEROCOPY_CLOSE_SIZE; offset += written)
+    {
+      rest = g_bytes_new_from_bytes (bytes, offset, ZEROCOPY_CLOSE_SIZE - offset);
+      written = g_socket_send_bytes (client, rest, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (written, >, 0);
+      g_bytes_unref (rest);
+    }
+  g_bytes_unref (bytes);
+
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+  g_object_unref (client);
+
+  g_thread_join (data->thread);
+
+  g_socket_close (data->server, &error);
+  g_assert_no_error (error);
+  g_object_unref (data->server);
+
+  g_slice_free (IPTestData, data);
+}
+
+static void
+test_options (void)
+{
+  GSocket *socket;
+  GSocketConnection *conn;
+  GError *error = NULL;
+  gint value;
+  guint size;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+
+  g_assert (g_socket_set_option (socket, SOL_SOCKET, SO_KEEPALIVE, TRUE, &error));
+  g_assert_no_error (error);
+  g_assert (g_socket_get_option (socket, SOL_SOCKET, SO_KEEPALIVE, &value, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (value, !=, 0);
+
+  g_assert (!g_socket_get_option (socket, SOL_SOCKET, -1, &value, &error));
+  g_assert (error != NULL);
+  g_clear_error (&error);
+
+  /* The platform may round or double buffer sizes */
+  g_socket_set_receive_buffer_size (socket, 65536);
+  g_assert_cmpuint (g_socket_get_receive_buffer_size (socket), >=, 65536);
+  g_object_set (socket, "send-buffer-size", 65536, NULL);
+  g_object_get (socket, "send-buffer-size", &size, NULL);
+  g_assert_cmpuint (size, >=, 65536);
+
+#ifdef TCP_NOTSENT_LOWAT
+  g_socket_set_notsent_lowat (socket, 16384);
+  g_assert_cmpuint (g_socket_get_notsent_lowat (socket), ==, 16384);
+#endif
+
+  g_assert (!g_socket_get_fast_open (socket));
+  g_socket_set_fast_open (socket, TRUE);
+  g_assert (g_socket_get_fast_open (socket));
+
+  conn = g_socket_connection_factory_create_connection (socket);
+  g_assert (G_IS_TCP_CONNECTION (conn));
+  g_assert (!g_tcp_connection_get_no_delay (G_TCP_CONNECTION (conn)));
+  g_object_set (conn, "no-delay", TRUE, NULL);
+  g_assert (g_tcp_connection_get_no_delay (G_TCP_CONNECTION (conn)));
+  g_assert (g_socket_get_option (socket, IPPROTO_TCP, TCP_NODELAY, &value, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (value, !=, 0);
+
+  g_object_unref (conn);
+  g_object_unref (socket);
+}
+
+static gpointer
+fast_open_server_thread (gpointer user_data)
+{
+  GSocketListener *listener = user_data;
+  GSocketConnection *conn;
+  GError *error = NULL;
+  gchar buf[128];
+  gssize len;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      conn = g_socket_listener_accept (listener, NULL, NULL, &error);
+      g_assert_no_error (error);
+
+      len = g_input_stream_read (g_io_stream_get_input_stream (G_IO_STREAM (conn)),
+				 buf, sizeof (buf), NULL, &error);
+      g_assert_no_error (error);
+      g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (conn)),
+				 buf, len, NULL, NULL, &error);
+      g_assert_no_error (error);
+
+      g_io_stream_close (G_IO_STREAM (conn), NULL, &error);
+      g_assert_no_error (error);
+      g_object_unref (conn);
+    }
+
+  return NULL;
+}
+
+static void
+test_fast_open (void)
+{
+  GSocketListener *listener;
+  GSocketClient *client;
+  GSocketConnection *conn;
+  GSocketAddress *addr;
+  GInetAddress *iaddr;
+  GThread *thread;
+  GError *error = NULL;
+  gchar buf[128];
+  guint16 port;
+  gsize len;
+  int i;
+
+  listener = g_socket_listener_new ();
+  g_socket_listener_set_fast_open (listener, TRUE);
+  port = g_socket_listener_add_any_inet_port (listener, NULL, &error);
+  g_assert_no_error (error);
+  thread = g_thread_new ("server", fast_open_server_thread, listener);
+
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, port);
+  g_object_unref (iaddr);
+
+  client = g_socket_client_new ();
+  g_object_set (client, "fast-open", TRUE, NULL);
+  g_assert (g_socket_client_get_fast_open (client));
+
+  /* The second connection can put its data in the SYN, if the
+   * system allows it; either way the data must get through.
+   */
+  for (i = 0; i < 2; i++)
+    {
+      conn = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr),
+				      NULL, &error);
+      g_assert_no_error (error);
+      g_assert (g_socket_get_fast_open (g_socket_connection_get_socket (conn)));
+
+      g_output_stream_write_all (g_io_stream_get_output_stream (G_IO_STREAM (conn)),
+				 testbuf, strlen (testbuf) + 1, &len, NULL, &error);
+      g_assert_no_error (error);
+      g_input_stream_read_all (g_io_stream_get_input_stream (G_IO_STREAM (conn)),
+			       buf, strlen (testbuf) + 1, &len, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (len, ==, strlen (testbuf) + 1);
+      g_assert_cmpstr (buf, ==, testbuf);
+
+      g_object_unref (conn);
+    }
+
+  g_thread_join (thread);
+  g_socket_listener_close (listener);
+  g_object_unref (listener);
+  g_object_unref (client);
+  g_object_unref (addr);
+}
+
+static gpointer
+graceful_server_thread (gpointer user_data)
+{
+  IPTestData *data = user_data;
+  GSocket *sock;
+  GError *error = NULL;
+  gssize len;
+
+  sock = g_socket_accept (data->server, NULL, &error);
+  g_assert_no_error (error);
+
+  len = g_socket_send (sock, testbuf, strlen (testbuf) + 1, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (len, ==, strlen (testbuf) + 1);
+
+  return sock;
+}
+
+static void
+test_close_graceful (void)
+{
+  GSocketFamily family = G_SOCKET_FAMILY_IPV4;
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client, *server;
+  GSocketAddress *addr;
+  gssize len;
+  gchar buf[128];
+
+  data = create_server (family, graceful_server_thread, FALSE);
+  addr = g_socket_get_local_address (data->server, &error);
+
+  client = g_socket_new (family,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_socket_get_family (client), ==, family);
+  g_assert_cmpint (g_socket_get_socket_type (client), ==, G_SOCKET_TYPE_STREAM);
+  g_assert_cmpint (g_socket_get_protocol (client), ==, G_SOCKET_PROTOCOL_DEFAULT);
+
+  g_socket_set_blocking (client, TRUE);
+  g_socket_set_timeout (client, 1);
+
+  g_socket_connect (client, addr, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (g_socket_is_connected (client));
+  g_object_unref (addr);
+
+  server = g_thread_join (data->thread);
+
+  /* similar to g_tcp_connection_set_graceful_disconnect(), but explicit */
+  g_socket_shutdown (server, FALSE, TRUE, &error);
+  g_assert_no_error (error);
+
+  /* we must timeout */
+  g_socket_condition_wait (client, G_IO_HUP, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_clear_error (&error);
+
+  /* check that the remaining data is received */
+  len = g_socket_receive (client, buf, strlen (testbuf) + 1, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (len, ==, strlen (testbuf) + 1);
+
+  /* and only then the connection is closed */
+  len = g_socket_receive (client, buf, sizeof (buf), NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (len, ==, 0);
+
+  g_socket_close (server, &error);
+  g_assert_no_error (error);
+
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (server);
+  g_object_unref (data->server);
+  g_object_unref (client);
+
+  g_slice_free (IPTestData, data);
+}
+
+#if defined (IPPROTO_IPV6) && defined (IPV6_V6ONLY)
+static gpointer
+v4mapped_server_thread (gpointer user_data)
+{
+  IPTestData *data = user_data;
+  GSocket *sock;
+  GError *error = NULL;
+  GSocketAddress *addr;
+
+  sock = g_socket_accept (data->server, NULL, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_socket_get_family (sock), ==, G_SOCKET_FAMILY_IPV6);
+
+  addr = g_socket_get_local_address (sock, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_socket_address_get_family (addr), ==, G_SOCKET_FAMILY_IPV4);
+  g_object_unref (addr);
+
+  addr = g_socket_get_remote_address (sock, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (g_socket_address_get_family (addr), ==, G_SOCKET_FAMILY_IPV4);
+  g_object_unref (addr);
+
+  g_socket_close (sock, &error);
+  g_assert_no_error (error);
+  g_object_unref (sock);
+  return NULL;
+}
+
+static void
+test_ipv6_v4mapped (void)
+{
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client;
+  GSocketAddress *addr, *v4addr;
+  GInetAddress *iaddr;
+
+  data = create_server (G_SOCKET_FAMILY_IPV6, v4mapped_server_thread, TRUE);
+
+  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+
+  g_socket_set_blocking (client, TRUE);
+  g_socket_set_timeout (client, 1);
+
+  addr = g_socket_get_local_address (data->server, &error);
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  v4addr = g_inet_socket_address_new (iaddr, g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr)));
+  g_object_unref (iaddr);
+  g_object_unref (addr);
+
+  g_socket_connect (client, v4addr, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (g_socket_is_connected (client));
+
+  g_thread_join (data->thread);
+
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+  g_socket_close (data->server, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (data->server);
+  g_object_unref (client);
+  g_object_unref (v4addr);
+
+  g_slice_free (IPTestData, data);
+}
+#endif
+
+static void
+test_timed_wait (void)
+{
+  IPTestData *data;
+  GError *error = NULL;
+  GSocket *client;
+  GSocketAddress *addr;
+  gint64 start_time;
+  gint poll_duration;
+
+  data = create_server (G_SOCKET_FAMILY_IPV4, echo_server_thread, FALSE);
+  addr = g_socket_get_local_address (data->server, &error);
+
+  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+			 G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT,
+			 &error);
+  g_assert_no_error (error);
+
+  g_socket_set_blocking (client, TRUE);
+  g_socket_set_timeout (client, 1);
+
+  g_socket_connect (client, addr, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (addr);
+
+  start_time = g_get_monotonic_time ();
+  g_socket_condition_timed_wait (client, G_IO_IN, 100000 /* 100 ms */,
+				 NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_clear_error (&error);
+  poll_duration = g_get_monotonic_time () - start_time;
+
+  g_assert_cmpint (poll_duration, >=, 98000);
+  g_assert_cmpint (poll_duration, <, 110000);
+
+  g_socket_close (client, &error);
+  g_assert_no_error (error);
+
+  g_thread_join (data->thread);
+
+  g_socket_close (data->server, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (data->server);
+  g_object_unref (client);
+
+  g_slice_free (IPTestData, data);
+}
+
+static void
+test_sockaddr (void)
+{
+  struct sockaddr_in6 sin6, gsin6;
+  GSocketAddress *saddr;
+  GInetSocketAddress *isaddr;
+  GInetAddress *iaddr;
+  GError *error = NULL;
+
+  memset (&sin6, 0, sizeof (sin6));
+  sin6.sin6_family = AF_INET6;
+  sin6.sin6_addr = in6addr_loopback;
+  sin6.sin6_port = g_htons (42);
+  sin6.sin6_scope_id = g_htonl (17);
+  sin6.sin6_flowinfo = g_htonl (1729);
+
+  saddr = g_socket_address_new_from_native (&sin6, sizeof (sin6));
+  g_assert (G_IS_INET_SOCKET_ADDRESS (saddr));
+
+  isaddr = G_INET_SOCKET_ADDRESS (saddr);
+  iaddr = g_inet_socket_address_get_address (isaddr);
+  g_assert_cmpint (g_inet_address_get_family (iaddr), ==, G_SOCKET_FAMILY_IPV6);
+  g_assert (g_inet_address_get_is_loopback (iaddr));
+
+  g_assert_cmpint (g_inet_socket_address_get_port (isaddr), ==, 42);
+  g_assert_cmpint (g_inet_socket_address_get_scope_id (isaddr), ==, 17);
+  g_assert_cmpint (g_inet_socket_address_get_flowinfo (isaddr), ==, 1729);
+
+  g_socket_address_to_native (saddr, &gsin6, sizeof (gsin6), &error);
+  g_assert_no_error (error);
+
+  g_assert (memcmp (&sin6.sin6_addr, &gsin6.sin6_addr, sizeof (struct in6_addr)) == 0);
+  g_assert_cmpint (sin6.sin6_port, ==, gsin6.sin6_port);
+  g_assert_cmpint (sin6.sin6_scope_id, ==, gsin6.sin6_scope_id);
+  g_assert_cmpint (sin6.sin6_flowinfo, ==, gsin6.sin6_flowinfo);
+
+  g_object_unref (saddr);
+}
+
+/* A #GSocketConnectable that returns a fixed list of addresses */
+typedef struct {
+  GSocketAddressEnumerator parent_instance;
+  GList *addresses;
+} TestEnumerator;
+typedef GSocketAddressEnumeratorClass TestEnumeratorClass;
+
+static GType test_enumerator_get_type (void);
+G_DEFINE_TYPE (TestEnumerator, test_enumerator, G_TYPE_SOCKET_ADDRESS_ENUMERATOR)
+
+static void
+test_enumerator_init (TestEnumerator *enumerator)
+{
+}
+
+static void
+test_enumerator_finalize (GObject *object)
+{
+  TestEnumerator *enumerator = (TestEnumerator *) object;
+
+  g_list_free_full (enumerator->addresses, g_object_unref);
+
+  G_OBJECT_CLASS (test_enumerator_parent_class)->finalize (object);
+}
+
+static GSocketAddress *
+test_enumerator_next (GSocketAddressEnumerator  *enumerator,
+		      GCancellable              *cancellable,
+		      GError                   **error)
+{
+  TestEnumerator *self = (TestEnumerator *) enumerator;
+  GSocketAddress *address;
+
+  if (self->addresses == NULL)
+    return NULL;
+
+  address = self->addresses->data;
+  self->addresses = g_list_delete_link (self->addresses, self->addresses);
+
+  return address;
+}
+
+static void
+test_enumerator_class_init (TestEnumeratorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = test_enumerator_finalize;
+  klass->next = test_enumerator_next;
+}
+
+typedef struct {
+  GObject parent_instance;
+  GList *addresses;
+} TestConnectable;
+typedef GObjectClass TestConnectableClass;
+
+static GType test_connectable_get_type (void);
+static void test_connectable_iface_init (GSocketConnectableIface *iface);
+G_DEFINE_TYPE_WITH_CODE (TestConnectable, test_connectable, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_SOCKET_CONNECTABLE,
+						test_connectable_iface_init))
+
+static void
+test_connectable_init (TestConnectable *connectable)
+{
+}
+
+static void
+test_connectable_finalize (GObject *object)
+{
+  TestConnectable *connectable = (TestConnectable *) object;
+
+  g_list_free_full (connectable->addresses, g_object_unref);
+
+  G_OBJECT_CLASS (test_connectable_parent_class)->finalize (object);
+}
+
+static void
+test_connectable_class_init (TestConnectableClass *klass)
+{
+  klass->finalize = test_connectable_finalize;
+}
+
+static GSocketAddressEnumerator *
+test_connectable_enumerate (GSocketConnectable *connectable)
+{
+  TestConnectable *self = (TestConnectable *) connectable;
+  TestEnumerator *enumerator;
+  GList *l;
+
+  enumerator = g_object_new (test_enumerator_get_type (), NULL);
+  for (l = self->addresses; l; l = l->next)
+    enumerator->addresses = g_list_append (enumerator->addresses,
+					   g_object_ref (l->data));
+
+  return G_SOCKET_ADDRESS_ENUMERATOR (enumerator);
+}
+
+static void
+test_connectable_iface_init (GSocketConnectableIface *iface)
+{
+  iface->enumerate = test_connectable_enumerate;
+}
+
+static GSocketConnectable *
+test_connectable_new (GSocketAddress *first_address,
+		      ...)
+{
+  TestConnectable *connectable;
+  GSocketAddress *address;
+  va_list ap;
+
+  connectable = g_object_new (test_connectable_get_type (), NULL);
+
+  va_start (ap, first_address);
+  for (address = first_address; address; address = va_arg (ap, GSocketAddress *))
+    connectable->addresses = g_list_append (connectable->addresses,
+					    g_object_ref (address));
+  va_end (ap);
+
+  return G_SOCKET_CONNECTABLE (connectable);
+}
+
+static GSocket *
+create_listener (GSocketFamily family,
+		 gint          backlog)
+{
+  GSocket *server;
+  GSocketAddress *addr;
+  GInetAddress *iaddr;
+  GError *error = NULL;
+
+  server = g_socket_new (family, G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT, &error);
+  if (server == NULL)
+    {
+      g_error_free (error);
+      return NULL;
+    }
+
+  iaddr = g_inet_address_new_loopback (family);
+  addr = g_inet_socket_address_new (iaddr, 0);
+  g_object_unref (iaddr);
+  if (!g_socket_bind (server, addr, TRUE, &error))
+    {
+      g_error_free (error);
+      g_object_unref (addr);
+      g_object_unref (server);
+      return NULL;
+    }
+  g_object_unref (addr);
+
+  g_socket_set_listen_backlog (server, backlog);
+  g_socket_listen (server, &error);
+  g_assert_no_error (error);
+
+  return server;
+}
+
+/* A listener whose accept queue is full, so that further connection
+ * attempts to it hang instead of succeeding or failing.
+ */
+typedef struct {
+  GSocket *server;
+  GSocket *filler;
+  GSocketAddress *address;
+} Blackhole;
+
+static Blackhole *
+create_blackhole (GSocketFamily family)
+{
+  Blackhole *blackhole;
+  GSocket *server;
+  GError *error = NULL;
+
+  server = create_listener (family, 0);
+  if (server == NULL)
+    return NULL;
+
+  blackhole = g_slice_new (Blackhole);
+  blackhole->server = server;
+  blackhole->address = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  blackhole->filler = g_socket_new (family, G_SOCKET_TYPE_STREAM,
+				    G_SOCKET_PROTOCOL_DEFAULT, &error);
+  g_assert_no_error (error);
+  g_socket_connect (blackhole->filler, blackhole->address, NULL, &error);
+  g_assert_no_error (error);
+
+  return blackhole;
+}
+
+static void
+blackhole_free (Blackhole *blackhole)
+{
+  g_object_unref (blackhole->filler);
+  g_object_unref (blackhole->address);
+  g_object_unref (blackhole->server);
+  g_slice_free (Blackhole, blackhole);
+}
+
+static GSocketAddress *
+create_refusing_address (void)
+{
+  GSocket *server;
+  GSocketAddress *address;
+  GError *error = NULL;
+
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 1);
+  address = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+  g_object_unref (server);
+
+  return address;
+}
+
+static void
+count_connecting (GSocketClient      *client,
+		  GSocketClientEvent  event,
+		  GSocketConnectable *connectable,
+		  GIOStream          *connection,
+		  gpointer            user_data)
+{
+  gint *n_connecting = user_data;
+
+  if (event == G_SOCKET_CLIENT_CONNECTING)
+    (*n_connecting)++;
+}
+
+static void
+assert_connected_to (GSocketConnection *connection,
+		     GSocket           *server)
+{
+  GSocketAddress *remote, *local;
+  GError *error = NULL;
+
+  g_assert (G_IS_TCP_CONNECTION (connection));
+
+  remote = g_socket_connection_get_remote_address (connection, &error);
+  g_assert_no_error (error);
+  local = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (remote)), ==,
+		   g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local)));
+
+  g_object_unref (remote);
+  g_object_unref (local);
+}
+
+static void
+test_client_race_sync (void)
+{
+  Blackhole *blackhole;
+  GSocket *server;
+  GSocketAddress *addr;
+  GSocketConnectable *connectable;
+  GSocketClient *client;
+  GSocketConnection *connection;
+  GError *error = NULL;
+  gint n_connecting = 0;
+
+  blackhole = create_blackhole (G_SOCKET_FAMILY_IPV4);
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  addr = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  connectable = test_connectable_new (blackhole->address, addr, NULL);
+
+  /* Without racing, the first address would hold us up until the
+   * kernel gives up on it.
+   */
+  client = g_socket_client_new ();
+  g_assert_cmpuint (g_socket_client_get_connection_attempt_delay (client), ==, 250);
+  g_socket_client_set_connection_attempt_delay (client, 50);
+  g_signal_connect (client, "event", G_CALLBACK (count_connecting), &n_connecting);
+
+  connection = g_socket_client_connect (client, connectable, NULL, &error);
+  g_assert_no_error (error);
+  assert_connected_to (connection, server);
+  g_assert_cmpint (n_connecting, ==, 2);
+
+  g_object_unref (connection);
+  g_object_unref (client);
+  g_object_unref (connectable);
+  g_object_unref (addr);
+  g_object_unref (server);
+  blackhole_free (blackhole);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GSocketConnection *connection;
+  GError *error;
+} RaceData;
+
+static void
+race_connected (GObject      *source,
+		GAsyncResult *result,
+		gpointer      user_data)
+{
+  RaceData *data = user_data;
+
+  data->connection = g_socket_client_connect_finish (G_SOCKET_CLIENT (source),
+						     result, &data->error);
+  g_main_loop_quit (data->loop);
+}
+
+static void
+test_client_race_async (void)
+{
+  Blackhole *blackhole;
+  GSocket *server;
+  GSocketAddress *addr;
+  GSocketConnectable *connectable;
+  GSocketClient *client;
+  RaceData data = { NULL, NULL, NULL };
+  GError *error = NULL;
+  gint n_connecting = 0;
+
+  blackhole = create_blackhole (G_SOCKET_FAMILY_IPV4);
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  addr = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  connectable = test_connectable_new (blackhole->address, blackhole->address,
+				      addr, NULL);
+
+  client = g_socket_client_new ();
+  g_socket_client_set_connection_attempt_delay (client, 50);
+  g_signal_connect (client, "event", G_CALLBACK (count_connecting), &n_connecting);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  g_socket_client_connect_async (client, connectable, NULL,
+				 race_connected, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_no_error (data.error);
+  assert_connected_to (data.connection, server);
+  g_assert_cmpint (n_connecting, ==, 3);
+
+  g_object_unref (data.connection);
+  g_main_loop_unref (data.loop);
+  g_object_unref (client);
+  g_object_unref (connectable);
+  g_object_unref (addr);
+  g_object_unref (server);
+  blackhole_free (blackhole);
+}
+
+static void
+test_client_race_families (void)
+{
+  Blackhole *blackhole;
+  GSocket *server;
+  GSocketAddress *addr;
+  GSocketConnectable *connectable;
+  GSocketClient *client;
+  GSocketConnection *connection;
+  GError *error = NULL;
+  gint n_connecting = 0;
+
+  blackhole = create_blackhole (G_SOCKET_FAMILY_IPV6);
+  if (blackhole == NULL)
+    {
+      g_test_message ("No IPv6 loopback; skipping");
+      return;
+    }
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  addr = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  /* The IPv4 address is tried second, not third */
+  connectable = test_connectable_new (blackhole->address, blackhole->address,
+				      addr, NULL);
+
+  client = g_socket_client_new ();
+  g_socket_client_set_connection_attempt_delay (client, 50);
+  g_signal_connect (client, "event", G_CALLBACK (count_connecting), &n_connecting);
+
+  connection = g_socket_client_connect (client, connectable, NULL, &error);
+  g_assert_no_error (error);
+  assert_connected_to (connection, server);
+  g_assert_cmpint (n_connecting, ==, 2);
+
+  g_object_unref (connection);
+  g_object_unref (client);
+  g_object_unref (connectable);
+  g_object_unref (addr);
+  g_object_unref (server);
+  blackhole_free (blackhole);
+}
+
+static void
+test_client_sequential (void)
+{
+  GSocket *server;
+  GSocketAddress *refusing, *addr;
+  GSocketConnectable *connectable;
+  GSocketClient *client;
+  GSocketConnection *connection;
+  GError *error = NULL;
+  gint n_connecting = 0;
+
+  refusing = create_refusing_address ();
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  addr = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
+
+  client = g_socket_client_new ();
+  g_socket_client_set_connection_attempt_delay (client, 0);
+  g_signal_connect (client, "event", G_CALLBACK (count_connecting), &n_connecting);
+
+  connectable = test_connectable_new (refusing, addr, NULL);
+  connection = g_socket_client_connect (client, connectable, NULL, &error);
+  g_assert_no_error (error);
+  assert_connected_to (connection, server);
+  g_assert_cmpint (n_connecting, ==, 2);
+  g_object_unref (connection);
+  g_object_unref (connectable);
+
+  /* Every attempt failing reports the last error */
+  connectable = test_connectable_new (refusing, refusing, NULL);
+  connection = g_socket_client_connect (client, connectable, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED);
+  g_assert (connection == NULL);
+  g_clear_error (&error);
+
+  g_socket_client_set_connection_attempt_delay (client, 50);
+  connection = g_socket_client_connect (client, connectable, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED);
+  g_assert (connection == NULL);
+  g_clear_error (&error);
+  g_object_unref (connectable);
+
+  g_object_unref (client);
+  g_object_unref (addr);
+  g_object_unref (refusing);
+  g_object_unref (server);
+}
+
+static gboolean
+cancel_race (gpointer user_data)
+{
+  g_cancellable_cancel (user_data);
+  return FALSE;
+}
+
+static void
+test_client_race_cancel (void)
+{
+  Blackhole *blackhole;
+  GSocketConnectable *connectable;
+  GSocketClient *client;
+  GCancellable *cancellable;
+  RaceData data = { NULL, NULL, NULL };
+
+  blackhole = create_blackhole (G_SOCKET_FAMILY_IPV4);
+  connectable = test_connectable_new (blackhole->address, blackhole->address,
+				      NULL);
+
+  client = g_socket_client_new ();
+  g_socket_client_set_connection_attempt_delay (client, 20);
+  cancellable = g_cancellable_new ();
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  g_socket_client_connect_async (client, connectable, cancellable,
+				 race_connected, &data);
+  g_timeout_add (100, cancel_race, cancellable);
+  g_main_loop_run (data.loop);
+
+  g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert (data.connection == NULL);
+  g_clear_error (&data.error);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (cancellable);
+  g_object_unref (client);
+  g_object_unref (connectable);
+  blackhole_free (blackhole);
+}
+
+static GSocket *
+accept_pending (GSocket *server)
+{
+  GSocket *sock;
+  GError *error = NULL;
+
+  sock = g_socket_accept (server, NULL, &error);
+  g_assert_no_error (error);
+
+  return sock;
+}
+
+static void
+assert_nothing_pending (GSocket *server)
+{
+  GSocket *sock;
+  GError *error = NULL;
+
+  sock = g_socket_accept (server, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+  g_assert (sock == NULL);
+  g_clear_error (&error);
+}
+
+static void
+close_server_side (GSocket           *sock,
+		   GSocketConnection *connection)
 {
-  IPTestData *data = user_data;
-  GSocket *sock;
   GError *error = NULL;
-  gssize len;
 
-  sock = g_socket_accept (data->server, NULL, &error);
+  g_socket_close (sock, &error);
   g_assert_no_error (error);
+  g_object_unref (sock);
 
-  len = g_socket_send (sock, testbuf, strlen (testbuf) + 1, NULL, &error);
+  /* Wait for the client side to see it */
+  g_socket_condition_wait (g_socket_connection_get_socket (connection),
+			   G_IO_IN, NULL, &error);
   g_assert_no_error (error);
-  g_assert_cmpint (len, ==, strlen (testbuf) + 1);
-
-  return sock;
 }
 
 static void
-test_close_graceful (void)
+test_client_pool (void)
 {
-  GSocketFamily family = G_SOCKET_FAMILY_IPV4;
-  IPTestData *data;
-  GError *error = NULL;
-  GSocket *client, *server;
+  GSocket *server, *s1, *s2, *s3;
   GSocketAddress *addr;
-  gssize len;
-  gchar buf[128];
+  GSocketClient *client;
+  GSocketConnection *c1, *c2, *c3;
+  RaceData data = { NULL, NULL, NULL };
+  GError *error = NULL;
 
-  data = create_server (family, graceful_server_thread, FALSE);
-  addr = g_socket_get_local_address (data->server, &error);
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  g_socket_set_blocking (server, FALSE);
+  addr = g_socket_get_local_address (server, &error);
+  g_assert_no_error (error);
 
-  client = g_socket_new (family,
-			 G_SOCKET_TYPE_STREAM,
-			 G_SOCKET_PROTOCOL_DEFAULT,
-			 &error);
+  client = g_socket_client_new ();
+  g_assert_cmpuint (g_socket_client_get_pool_max_connections (client), ==, 0);
+  g_socket_client_set_pool_max_connections (client, 2);
+
+  c1 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
   g_assert_no_error (error);
+  s1 = accept_pending (server);
 
-  g_assert_cmpint (g_socket_get_family (client), ==, family);
-  g_assert_cmpint (g_socket_get_socket_type (client), ==, G_SOCKET_TYPE_STREAM);
-  g_assert_cmpint (g_socket_get_protocol (client), ==, G_SOCKET_PROTOCOL_DEFAULT);
+  /* A released connection is handed out again */
+  g_socket_client_release_connection (client, c1);
+  c2 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
+  g_assert_no_error (error);
+  g_assert (c2 == c1);
+  g_object_unref (c2);
+  assert_nothing_pending (server);
+
+  g_socket_client_release_connection (client, c1);
+  data.loop = g_main_loop_new (NULL, FALSE);
+  g_socket_client_connect_async (client, G_SOCKET_CONNECTABLE (addr), NULL,
+				 race_connected, &data);
+  g_main_loop_run (data.loop);
+  g_assert_no_error (data.error);
+  g_assert (data.connection == c1);
+  g_object_unref (data.connection);
+  assert_nothing_pending (server);
+
+  /* A connection the server has closed is not kept... */
+  close_server_side (s1, c1);
+  g_socket_client_release_connection (client, c1);
+  g_assert (g_io_stream_is_closed (G_IO_STREAM (c1)));
+  g_object_unref (c1);
+
+  c1 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
+  g_assert_no_error (error);
+  s1 = accept_pending (server);
 
-  g_socket_set_blocking (client, TRUE);
-  g_socket_set_timeout (client, 1);
+  /* ...nor handed out if it got closed while in the pool */
+  g_socket_client_release_connection (client, c1);
+  close_server_side (s1, c1);
+  c2 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
+  g_assert_no_error (error);
+  g_assert (c2 != c1);
+  g_assert (g_io_stream_is_closed (G_IO_STREAM (c1)));
+  g_object_unref (c1);
+  s2 = accept_pending (server);
 
-  g_socket_connect (client, addr, NULL, &error);
+  /* Only so many idle connections are kept */
+  c3 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
   g_assert_no_error (error);
-  g_assert (g_socket_is_connected (client));
+  s3 = accept_pending (server);
+  g_socket_client_set_pool_max_connections (client, 1);
+  g_socket_client_release_connection (client, c2);
+  g_socket_client_release_connection (client, c3);
+  g_assert (g_io_stream_is_closed (G_IO_STREAM (c2)));
+  g_assert (!g_io_stream_is_closed (G_IO_STREAM (c3)));
+
+  /* Idle connections expire */
+  g_socket_client_set_pool_idle_timeout (client, 1);
+  g_usleep (1100000);
+  c1 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
+  g_assert_no_error (error);
+  g_assert (c1 != c3);
+  g_assert (g_io_stream_is_closed (G_IO_STREAM (c3)));
+  g_object_unref (s3);
+  s3 = accept_pending (server);
+
+  /* Disabling the pool closes what is in it */
+  g_socket_client_release_connection (client, c1);
+  g_assert (!g_io_stream_is_closed (G_IO_STREAM (c1)));
+  g_socket_client_set_pool_max_connections (client, 0);
+  g_assert (g_io_stream_is_closed (G_IO_STREAM (c1)));
+
+  g_object_unref (c1);
+  g_object_unref (c2);
+  g_object_unref (c3);
+  g_object_unref (s2);
+  g_object_unref (s3);
+  g_main_loop_unref (data.loop);
+  g_object_unref (client);
   g_object_unref (addr);
+  g_object_unref (server);
+}
 
-  server = g_thread_join (data->thread);
+/* Completions of zero-copy sends make the socket poll G_IO_ERR, which
+ * must not get a healthy idle connection thrown out of the pool.
+ */
+static void
+test_client_pool_zerocopy (void)
+{
+  static gchar zeros[ZEROCOPY_SIZE / 4];
+  GSocket *server, *sock, *client_sock;
+  GSocketAddress *addr;
+  GSocketClient *client;
+  GSocketConnection *c1, *c2;
+  GBytes *bytes;
+  GPollFD pfd;
+  gboolean freed = FALSE;
+  gchar buf[4096];
+  gssize sent, received, nread;
+  GError *error = NULL;
 
-  /* similar to g_tcp_connection_set_graceful_disconnect(), but explicit */
-  g_socket_shutdown (server, FALSE, TRUE, &error);
+  server = create_listener (G_SOCKET_FAMILY_IPV4, 10);
+  g_socket_set_blocking (server, FALSE);
+  addr = g_socket_get_local_address (server, &error);
   g_assert_no_error (error);
 
-  /* we must timeout */
-  g_socket_condition_wait (client, G_IO_HUP, NULL, &error);
-  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
-  g_clear_error (&error);
+  client = g_socket_client_new ();
+  g_socket_client_set_pool_max_connections (client, 1);
 
-  /* check that the remaining data is received */
-  len = g_socket_receive (client, buf, strlen (testbuf) + 1, NULL, &error);
+  c1 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
   g_assert_no_error (error);
-  g_assert_cmpint (len, ==, strlen (testbuf) + 1);
+  sock = accept_pending (server);
 
-  /* and only then the connection is closed */
-  len = g_socket_receive (client, buf, sizeof (buf), NULL, &error);
-  g_assert_no_error (error);
-  g_assert_cmpint (len, ==, 0);
+  client_sock = g_socket_connection_get_socket (c1);
+  g_object_set (client_sock, "zerocopy", TRUE, NULL);
+  if (!g_socket_get_zerocopy (client_sock))
+    g_test_message ("Zero-copy sending not supported; testing the fallback");
 
-  g_socket_close (server, &error);
+  bytes = g_bytes_new_with_free_func (zeros, sizeof (zeros), zerocopy_freed, &freed);
+  sent = g_socket_send_bytes (client_sock, bytes, NULL, &error);
   g_assert_no_error (error);
+  g_assert_cmpint (sent, >, 0);
+  g_bytes_unref (bytes);
 
-  g_socket_close (client, &error);
+  for (received = 0; received < sent; received += nread)
+    {
+      nread = g_socket_receive (sock, buf, sizeof (buf), NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpint (nread, >, 0);
+    }
+
+  /* Give the kernel's completion time to arrive */
+  pfd.fd = g_socket_get_fd (client_sock);
+  pfd.events = 0;
+  g_poll (&pfd, 1, 100);
+
+  g_socket_client_release_connection (client, c1);
+  c2 = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
   g_assert_no_error (error);
+  g_assert (c2 == c1);
+  g_assert (freed);
+  assert_nothing_pending (server);
 
-  g_object_unref (server);
-  g_object_unref (data->server);
+  g_object_unref (c2);
+  g_object_unref (c1);
+  g_object_unref (sock);
   g_object_unref (client);
-
-  g_slice_free (IPTestData, data);
+  g_object_unref (addr);
+  g_object_unref (server);
 }
 
-#if defined (IPPROTO_IPV6) && defined (IPV6_V6ONLY)
-static gpointer
-v4mapped_server_thread (gpointer user_data)
+typedef struct {
+  GMutex lock;
+  GHashTable *threads;
+  GThread *main_thread;
+  GObject *source_object;
+  gint incoming;
+} ServiceData;
+
+static gboolean
+service_incoming (GSocketService    *service,
+		  GSocketConnection *connection,
+		  GObject           *source_object,
+		  gpointer           user_data)
 {
-  IPTestData *data = user_data;
-  GSocket *sock;
+  ServiceData *data = user_data;
+  GOutputStream *out;
   GError *error = NULL;
-  GSocketAddress *addr;
-
-  sock = g_socket_accept (data->server, NULL, &error);
-  g_assert_no_error (error);
 
-  g_assert_cmpint (g_socket_get_family (sock), ==, G_SOCKET_FAMILY_IPV6);
+  g_assert (g_thread_self () != data->main_thread);
+  g_assert (g_main_context_get_thread_default () != NULL);
+  g_assert (source_object == data->source_object);
+#ifdef G_OS_UNIX
+  g_assert (fcntl (g_socket_get_fd (g_socket_connection_get_socket (connection)),
+		   F_GETFD) & FD_CLOEXEC);
+#endif
 
-  addr = g_socket_get_local_address (sock, &error);
-  g_assert_no_error (error);
-  g_assert_cmpint (g_socket_address_get_family (addr), ==, G_SOCKET_FAMILY_IPV4);
-  g_object_unref (addr);
+  g_mutex_lock (&data->lock);
+  g_hash_table_insert (data->threads, g_thread_self (), g_thread_self ());
+  data->incoming++;
+  g_mutex_unlock (&data->lock);
 
-  addr = g_socket_get_remote_address (sock, &error);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  g_output_stream_write (out, "x", 1, NULL, &error);
   g_assert_no_error (error);
-  g_assert_cmpint (g_socket_address_get_family (addr), ==, G_SOCKET_FAMILY_IPV4);
-  g_object_unref (addr);
 
-  g_socket_close (sock, &error);
-  g_assert_no_error (error);
-  g_object_unref (sock);
-  return NULL;
+  return FALSE;
 }
 
 static void
-test_ipv6_v4mapped (void)
+assert_served (GSocketConnection *connection)
 {
-  IPTestData *data;
+  GInputStream *in;
   GError *error = NULL;
-  GSocket *client;
-  GSocketAddress *addr, *v4addr;
-  GInetAddress *iaddr;
-
-  data = create_server (G_SOCKET_FAMILY_IPV6, v4mapped_server_thread, TRUE);
+  gchar buf[1];
 
-  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
-			 G_SOCKET_TYPE_STREAM,
-			 G_SOCKET_PROTOCOL_DEFAULT,
-			 &error);
+  in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  g_assert_cmpint (g_input_stream_read (in, buf, 1, NULL, &error), ==, 1);
   g_assert_no_error (error);
+  g_assert_cmpint (buf[0], ==, 'x');
+}
 
-  g_socket_set_blocking (client, TRUE);
-  g_socket_set_timeout (client, 1);
+#define N_SERVICE_CLIENTS 32
+
+static void
+test_service_accept_threads (void)
+{
+  GSocketService *service;
+  GSocketClient *client;
+  GSocketConnection *connections[N_SERVICE_CLIENTS + 1];
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  ServiceData data;
+  guint16 port;
+  guint threads;
+  GError *error = NULL;
+  gint i;
+
+  g_mutex_init (&data.lock);
+  data.threads = g_hash_table_new (NULL, NULL);
+  data.main_thread = g_thread_self ();
+  data.source_object = g_object_new (G_TYPE_OBJECT, NULL);
+  data.incoming = 0;
+
+  service = g_object_new (G_TYPE_SOCKET_SERVICE, "accept-threads", 4, NULL);
+  g_object_get (service, "accept-threads", &threads, NULL);
+  g_assert_cmpuint (threads, ==, 4);
+  g_signal_connect (service, "incoming", G_CALLBACK (service_incoming), &data);
+  port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service),
+					      data.source_object, &error);
+  g_assert_no_error (error);
 
-  addr = g_socket_get_local_address (data->server, &error);
   iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
-  v4addr = g_inet_socket_address_new (iaddr, g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr)));
+  addr = g_inet_socket_address_new (iaddr, port);
   g_object_unref (iaddr);
-  g_object_unref (addr);
 
-  g_socket_connect (client, v4addr, NULL, &error);
+  /* The main context is never run: the service threads do all the work */
+  client = g_socket_client_new ();
+  for (i = 0; i < N_SERVICE_CLIENTS; i++)
+    {
+      connections[i] = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr),
+						NULL, &error);
+      g_assert_no_error (error);
+    }
+  for (i = 0; i < N_SERVICE_CLIENTS; i++)
+    assert_served (connections[i]);
+
+  g_mutex_lock (&data.lock);
+  g_assert_cmpint (data.incoming, ==, N_SERVICE_CLIENTS);
+  g_assert_cmpuint (g_hash_table_size (data.threads), >=, 1);
+  g_assert_cmpuint (g_hash_table_size (data.threads), <=, 4);
+  g_mutex_unlock (&data.lock);
+
+  /* Connections queue up while the service is stopped */
+  g_socket_service_stop (service);
+  connections[N_SERVICE_CLIENTS] =
+    g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr), NULL, &error);
   g_assert_no_error (error);
-  g_assert (g_socket_is_connected (client));
+  g_usleep (100000);
+  g_mutex_lock (&data.lock);
+  g_assert_cmpint (data.incoming, ==, N_SERVICE_CLIENTS);
+  g_mutex_unlock (&data.lock);
+
+  g_socket_service_start (service);
+  assert_served (connections[N_SERVICE_CLIENTS]);
+
+  /* Closing the listener lets go of the service */
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+  g_object_add_weak_pointer (G_OBJECT (service), (gpointer *) &service);
+  g_object_unref (service);
+  g_assert (service == NULL);
+
+  for (i = 0; i <= N_SERVICE_CLIENTS; i++)
+    g_object_unref (connections[i]);
+  g_object_unref (client);
+  g_object_unref (addr);
+  g_object_unref (data.source_object);
+  g_hash_table_unref (data.threads);
+  g_mutex_clear (&data.lock);
+}
 
-  g_thread_join (data->thread);
+#ifdef SO_REUSEPORT
+static void
+test_service_accept_threads_port_taken (void)
+{
+  GSocketService *service;
+  GSocket *socket;
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  guint16 port;
+  int value = 1;
+  GError *error = NULL;
 
-  g_socket_close (client, &error);
+  /* Something else of ours already listens on the port, with
+   * SO_REUSEPORT set.  A sharded service must not end up sharing
+   * the port with it.
+   */
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_STREAM,
+			 G_SOCKET_PROTOCOL_DEFAULT, &error);
   g_assert_no_error (error);
-  g_socket_close (data->server, &error);
+  g_assert_cmpint (setsockopt (g_socket_get_fd (socket), SOL_SOCKET,
+			       SO_REUSEPORT, &value, sizeof (value)), ==, 0);
+
+  iaddr = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, 0);
+  g_object_unref (iaddr);
+  g_socket_bind (socket, addr, TRUE, &error);
+  g_assert_no_error (error);
+  g_object_unref (addr);
+  g_socket_listen (socket, &error);
   g_assert_no_error (error);
 
-  g_object_unref (data->server);
-  g_object_unref (client);
-  g_object_unref (v4addr);
+  addr = g_socket_get_local_address (socket, &error);
+  g_assert_no_error (error);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
 
-  g_slice_free (IPTestData, data);
+  service = g_object_new (G_TYPE_SOCKET_SERVICE, "accept-threads", 4, NULL);
+  g_assert (!g_socket_listener_add_inet_port (G_SOCKET_LISTENER (service),
+					      port, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE);
+  g_clear_error (&error);
+
+  g_object_unref (service);
+  g_object_unref (socket);
 }
 #endif
 
+typedef struct {
+  GSocketConnection *connection;
+  GThread *thread;
+  gchar buf[16];
+} AsyncEchoData;
+
 static void
-test_timed_wait (void)
+async_echo_read (GObject      *source,
+		 GAsyncResult *result,
+		 gpointer      user_data)
 {
-  IPTestData *data;
+  AsyncEchoData *data = user_data;
+  GOutputStream *out;
   GError *error = NULL;
-  GSocket *client;
-  GSocketAddress *addr;
-  gint64 start_time;
-  gint poll_duration;
+  gssize size;
 
-  data = create_server (G_SOCKET_FAMILY_IPV4, echo_server_thread, FALSE);
-  addr = g_socket_get_local_address (data->server, &error);
+  g_assert (g_thread_self () == data->thread);
 
-  client = g_socket_new (G_SOCKET_FAMILY_IPV4,
-			 G_SOCKET_TYPE_STREAM,
-			 G_SOCKET_PROTOCOL_DEFAULT,
-			 &error);
+  size = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
   g_assert_no_error (error);
+  if (size == 0)
+    {
+      /* Releases the connection */
+      g_object_unref (data->connection);
+      g_slice_free (AsyncEchoData, data);
+      return;
+    }
 
-  g_socket_set_blocking (client, TRUE);
-  g_socket_set_timeout (client, 1);
-
-  g_socket_connect (client, addr, NULL, &error);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (data->connection));
+  g_output_stream_write (out, data->buf, size, NULL, &error);
   g_assert_no_error (error);
-  g_object_unref (addr);
 
-  start_time = g_get_monotonic_time ();
-  g_socket_condition_timed_wait (client, G_IO_IN, 100000 /* 100 ms */,
-				 NULL, &error);
-  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
-  g_clear_error (&error);
-  poll_duration = g_get_monotonic_time () - start_time;
+  g_input_stream_read_async (G_INPUT_STREAM (source), data->buf, sizeof data->buf,
+			     G_PRIORITY_DEFAULT, NULL, async_echo_read, data);
+}
 
-  g_assert_cmpint (poll_duration, >=, 98000);
-  g_assert_cmpint (poll_duration, <, 110000);
+static gboolean
+async_service_run (GAsyncSocketService *service,
+		   GSocketConnection   *connection,
+		   GObject             *source_object,
+		   gpointer             user_data)
+{
+  GThread *main_thread = user_data;
+  AsyncEchoData *data;
+  GOutputStream *out;
+  GInputStream *in;
+  GError *error = NULL;
 
-  g_socket_close (client, &error);
-  g_assert_no_error (error);
+  g_assert (g_thread_self () != main_thread);
 
-  g_thread_join (data->thread);
+  data = g_slice_new (AsyncEchoData);
+  data->connection = g_object_ref (connection);
+  data->thread = g_thread_self ();
 
-  g_socket_close (data->server, &error);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  g_output_stream_write (out, "x", 1, NULL, &error);
   g_assert_no_error (error);
 
-  g_object_unref (data->server);
-  g_object_unref (client);
+  in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  g_input_stream_read_async (in, data->buf, sizeof data->buf,
+			     G_PRIORITY_DEFAULT, NULL, async_echo_read, data);
 
-  g_slice_free (IPTestData, data);
+  return TRUE;
 }
 
 static void
-test_sockaddr (void)
+assert_echoed (GSocketConnection *connection)
 {
-  struct sockaddr_in6 sin6, gsin6;
-  GSocketAddress *saddr;
-  GInetSocketAddress *isaddr;
-  GInetAddress *iaddr;
+  GInputStream *in;
+  GOutputStream *out;
   GError *error = NULL;
+  gchar buf[4];
 
-  memset (&sin6, 0, sizeof (sin6));
-  sin6.sin6_family = AF_INET6;
-  sin6.sin6_addr = in6addr_loopback;
-  sin6.sin6_port = g_htons (42);
-  sin6.sin6_scope_id = g_htonl (17);
-  sin6.sin6_flowinfo = g_htonl (1729);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  g_output_stream_write (out, "abc", 3, NULL, &error);
+  g_assert_no_error (error);
 
-  saddr = g_socket_address_new_from_native (&sin6, sizeof (sin6));
-  g_assert (G_IS_INET_SOCKET_ADDRESS (saddr));
+  in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  g_assert_cmpint (g_input_stream_read (in, buf, 3, NULL, &error), ==, 3);
+  g_assert_no_error (error);
+  g_assert (memcmp (buf, "abc", 3) == 0);
+}
 
-  isaddr = G_INET_SOCKET_ADDRESS (saddr);
-  iaddr = g_inet_socket_address_get_address (isaddr);
-  g_assert_cmpint (g_inet_address_get_family (iaddr), ==, G_SOCKET_FAMILY_IPV6);
-  g_assert (g_inet_address_get_is_loopback (iaddr));
+static void
+test_service_async (void)
+{
+  GSocketService *service;
+  GSocketClient *client;
+  GSocketConnection *connections[4];
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+  guint16 port;
+  gint max_connections;
+  GError *error = NULL;
+  gint i;
+
+  service = g_async_socket_service_new (2, 3);
+  g_assert (G_IS_ASYNC_SOCKET_SERVICE (service));
+  g_object_get (service, "max-connections", &max_connections, NULL);
+  g_assert_cmpint (max_connections, ==, 3);
+  g_signal_connect (service, "run", G_CALLBACK (async_service_run), g_thread_self ());
+  port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service), NULL, &error);
+  g_assert_no_error (error);
 
-  g_assert_cmpint (g_inet_socket_address_get_port (isaddr), ==, 42);
-  g_assert_cmpint (g_inet_socket_address_get_scope_id (isaddr), ==, 17);
-  g_assert_cmpint (g_inet_socket_address_get_flowinfo (isaddr), ==, 1729);
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, port);
+  g_object_unref (iaddr);
 
-  g_socket_address_to_native (saddr, &gsin6, sizeof (gsin6), &error);
+  /* Connect one at a time: the shards' sockets may accept in any
+   * order, so otherwise the fourth client could be served first.
+   */
+  client = g_socket_client_new ();
+  for (i = 0; i < 4; i++)
+    {
+      connections[i] = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (addr),
+						NULL, &error);
+      g_assert_no_error (error);
+      if (i < 3)
+	{
+	  assert_served (connections[i]);
+	  assert_echoed (connections[i]);
+	}
+    }
+
+  /* The fourth client waits for one of the others to go away */
+  g_assert (!g_socket_condition_timed_wait (g_socket_connection_get_socket (connections[3]),
+					    G_IO_IN, 200000, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_clear_error (&error);
+
+  g_io_stream_close (G_IO_STREAM (connections[0]), NULL, &error);
   g_assert_no_error (error);
+  assert_served (connections[3]);
+  assert_echoed (connections[3]);
 
-  g_assert (memcmp (&sin6.sin6_addr, &gsin6.sin6_addr, sizeof (struct in6_addr)) == 0);
-  g_assert_cmpint (sin6.sin6_port, ==, gsin6.sin6_port);
-  g_assert_cmpint (sin6.sin6_scope_id, ==, gsin6.sin6_scope_id);
-  g_assert_cmpint (sin6.sin6_flowinfo, ==, gsin6.sin6_flowinfo);
+  for (i = 1; i < 4; i++)
+    {
+      g_io_stream_close (G_IO_STREAM (connections[i]), NULL, &error);
+      g_assert_no_error (error);
+    }
 
-  g_object_unref (saddr);
+  g_socket_service_stop (service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+
+  for (i = 0; i < 4; i++)
+    g_object_unref (connections[i]);
+  g_object_unref (client);
+  g_object_unref (addr);
+
+  /* Released once its last connection is */
+  g_object_add_weak_pointer (G_OBJECT (service), (gpointer *) &service);
+  g_object_unref (service);
+  while (service != NULL)
+    g_usleep (1000);
 }
 
 #ifdef G_OS_UNIX
@@ -824,12 +2299,30 @@ main (int   argc,
   g_test_add_func ("/socket/ipv4_async", test_ipv4_async);
   g_test_add_func ("/socket/ipv6_sync", test_ipv6_sync);
   g_test_add_func ("/socket/ipv6_async", test_ipv6_async);
+  g_test_add_func ("/socket/receive_bytes", test_receive_bytes);
+  g_test_add_func ("/socket/zerocopy", test_zerocopy);
+  g_test_add_func ("/socket/zerocopy-close", test_zerocopy_close);
+  g_test_add_func ("/socket/options", test_options);
+  g_test_add_func ("/socket/fast-open", test_fast_open);
 #if defined (IPPROTO_IPV6) && defined (IPV6_V6ONLY)
   g_test_add_func ("/socket/ipv6_v4mapped", test_ipv6_v4mapped);
 #endif
   g_test_add_func ("/socket/close_graceful", test_close_graceful);
   g_test_add_func ("/socket/timed_wait", test_timed_wait);
   g_test_add_func ("/socket/address", test_sockaddr);
+  g_test_add_func ("/socket/client/race-sync", test_client_race_sync);
+  g_test_add_func ("/socket/client/race-async", test_client_race_async);
+  g_test_add_func ("/socket/client/race-families", test_client_race_families);
+  g_test_add_func ("/socket/client/race-cancel", test_client_race_cancel);
+  g_test_add_func ("/socket/client/sequential", test_client_sequential);
+  g_test_add_func ("/socket/client/pool", test_client_pool);
+  g_test_add_func ("/socket/client/pool-zerocopy", test_client_pool_zerocopy);
+  g_test_add_func ("/socket/service/accept-threads", test_service_accept_threads);
+#ifdef SO_REUSEPORT
+  g_test_add_func ("/socket/service/accept-threads-port-taken",
+		   test_service_accept_threads_port_taken);
+#endif
+  g_test_add_func ("/socket/service/async", test_service_async);
 #ifdef G_OS_UNIX
   g_test_add_func ("/socket/unix-from-fd", test_unix_from_fd);
   g_test_add_func ("/socket/unix-connection", test_unix_connection);
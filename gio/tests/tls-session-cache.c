@@ -0,0 +1,297 @@
+/* GLib testing framework examples and tests
+ *
+ * Copyright (C) 2012 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <sys/socket.h>
+#endif
+
+#include "gtesttlsbackend.h"
+
+static void
+assert_session (GTlsSessionCache   *cache,
+		GSocketConnectable *identity,
+		const gchar        *expected)
+{
+  GBytes *session;
+
+  session = g_tls_session_cache_lookup (cache, identity);
+  if (expected == NULL)
+    {
+      g_assert (session == NULL);
+      return;
+    }
+
+  g_assert (session != NULL);
+  g_assert_cmpint (g_bytes_get_size (session), ==, strlen (expected));
+  g_assert (memcmp (g_bytes_get_data (session, NULL), expected, strlen (expected)) == 0);
+  g_bytes_unref (session);
+}
+
+static void
+store_session (GTlsSessionCache   *cache,
+	       GSocketConnectable *identity,
+	       const gchar        *data)
+{
+  GBytes *session;
+
+  session = g_bytes_new (data, strlen (data));
+  g_tls_session_cache_store (cache, identity, session);
+  g_bytes_unref (session);
+}
+
+static void
+test_cache (void)
+{
+  GTlsSessionCache *cache;
+  GSocketConnectable *a, *a2, *b, *c, *ip, *ip2;
+  GInetAddress *iaddr;
+
+  cache = g_tls_session_cache_new (2, 0);
+  g_assert_cmpuint (g_tls_session_cache_get_max_entries (cache), ==, 2);
+  g_assert_cmpuint (g_tls_session_cache_get_lifetime (cache), ==, 0);
+
+  a = g_network_address_new ("a.example.com", 443);
+  a2 = g_network_address_parse ("a.example.com:443", 80, NULL);
+  b = g_network_address_new ("b.example.com", 443);
+  c = g_network_address_new ("a.example.com", 8443);
+  iaddr = g_inet_address_new_from_string ("127.0.0.1");
+  ip = G_SOCKET_CONNECTABLE (g_inet_socket_address_new (iaddr, 443));
+  ip2 = G_SOCKET_CONNECTABLE (g_inet_socket_address_new (iaddr, 443));
+  g_object_unref (iaddr);
+
+  assert_session (cache, a, NULL);
+
+  /* Equal identities share an entry; a different port does not */
+  store_session (cache, a, "one");
+  assert_session (cache, a, "one");
+  assert_session (cache, a2, "one");
+  assert_session (cache, c, NULL);
+
+  store_session (cache, a2, "two");
+  assert_session (cache, a, "two");
+
+  store_session (cache, ip, "three");
+  assert_session (cache, ip2, "three");
+
+  /* Least recently used goes first: "a" was looked up after "ip" was
+   * stored, so storing "b" evicts "ip".
+   */
+  assert_session (cache, a, "two");
+  store_session (cache, b, "four");
+  assert_session (cache, ip, NULL);
+  assert_session (cache, a, "two");
+  assert_session (cache, b, "four");
+
+  g_tls_session_cache_remove (cache, a2);
+  assert_session (cache, a, NULL);
+  assert_session (cache, b, "four");
+
+  store_session (cache, a, "five");
+  g_tls_session_cache_clear (cache);
+  assert_session (cache, a, NULL);
+  assert_session (cache, b, NULL);
+
+  g_object_unref (a);
+  g_object_unref (a2);
+  g_object_unref (b);
+  g_object_unref (c);
+  g_object_unref (ip);
+  g_object_unref (ip2);
+  g_object_unref (cache);
+}
+
+static void
+test_default_cache (void)
+{
+  GTlsBackend *backend;
+  GTlsSessionCache *cache;
+
+  backend = g_tls_backend_get_default ();
+  cache = g_tls_backend_get_default_session_cache (backend);
+  g_assert (G_IS_TLS_SESSION_CACHE (cache));
+  g_assert (g_tls_backend_get_default_session_cache (backend) == cache);
+  g_assert_cmpuint (g_tls_session_cache_get_max_entries (cache), >, 0);
+}
+
+#ifdef G_OS_UNIX
+
+static gpointer
+server_thread (gpointer user_data)
+{
+  GTlsConnection *server = user_data;
+  GError *error = NULL;
+
+  g_tls_connection_handshake (server, NULL, &error);
+  g_assert_no_error (error);
+
+  return NULL;
+}
+
+static void
+handshake_done (GObject      *source,
+		GAsyncResult *result,
+		gpointer      user_data)
+{
+  GError *error = NULL;
+
+  g_tls_connection_handshake_finish (G_TLS_CONNECTION (source), result, &error);
+  g_assert_no_error (error);
+  g_main_loop_quit (user_data);
+}
+
+/* Connects to a fresh test server and returns whether the client
+ * resumed a session; @cache is the client's session cache, or
+ * %NULL to leave it at the backend's default.
+ */
+static gboolean
+connect_once (GSocketConnectable *identity,
+	      gboolean            set_cache,
+	      GTlsSessionCache   *cache,
+	      gboolean            async)
+{
+  GSocket *sockets[2];
+  GSocketConnection *conns[2];
+  GIOStream *client, *server;
+  GTlsCertificate *cert;
+  GThread *thread;
+  GError *error = NULL;
+  gboolean resumed;
+  int fds[2], i;
+
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+  for (i = 0; i < 2; i++)
+    {
+      sockets[i] = g_socket_new_from_fd (fds[i], &error);
+      g_assert_no_error (error);
+      conns[i] = g_socket_connection_factory_create_connection (sockets[i]);
+    }
+
+  client = g_tls_client_connection_new (G_IO_STREAM (conns[0]), identity, &error);
+  g_assert_no_error (error);
+  if (set_cache)
+    g_tls_client_connection_set_session_cache (G_TLS_CLIENT_CONNECTION (client), cache);
+
+  cert = g_tls_certificate_new_from_file (SRCDIR "/cert1.pem", &error);
+  g_assert_no_error (error);
+  server = g_tls_server_connection_new (G_IO_STREAM (conns[1]), cert, &error);
+  g_assert_no_error (error);
+  g_object_unref (cert);
+
+  thread = g_thread_new ("tls-server", server_thread, server);
+
+  if (async)
+    {
+      GMainLoop *loop;
+
+      loop = g_main_loop_new (NULL, FALSE);
+      g_tls_connection_handshake_async (G_TLS_CONNECTION (client),
+					G_PRIORITY_DEFAULT, NULL,
+					handshake_done, loop);
+      g_main_loop_run (loop);
+      g_main_loop_unref (loop);
+    }
+  else
+    {
+      g_tls_connection_handshake (G_TLS_CONNECTION (client), NULL, &error);
+      g_assert_no_error (error);
+    }
+
+  g_thread_join (thread);
+
+  resumed = g_test_tls_connection_get_resumed (G_TLS_CONNECTION (client));
+  g_assert_cmpint (resumed, ==,
+		   g_test_tls_connection_get_resumed (G_TLS_CONNECTION (server)));
+
+  g_io_stream_close (client, NULL, &error);
+  g_assert_no_error (error);
+  g_io_stream_close (server, NULL, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (client);
+  g_object_unref (server);
+  for (i = 0; i < 2; i++)
+    {
+      g_object_unref (conns[i]);
+      g_object_unref (sockets[i]);
+    }
+
+  return resumed;
+}
+
+static void
+test_resumption (void)
+{
+  GSocketConnectable *identity, *other;
+  GTlsSessionCache *cache;
+
+  identity = g_network_address_new ("resume.example.com", 443);
+  other = g_network_address_new ("other.example.com", 443);
+
+  /* The backend's default cache is shared by all connections */
+  g_assert (!connect_once (identity, FALSE, NULL, FALSE));
+  g_assert (connect_once (identity, FALSE, NULL, FALSE));
+  g_assert (connect_once (identity, FALSE, NULL, TRUE));
+  g_assert (!connect_once (other, FALSE, NULL, TRUE));
+
+  /* A private cache starts out empty */
+  cache = g_tls_session_cache_new (16, 0);
+  g_assert (!connect_once (identity, TRUE, cache, FALSE));
+  g_assert (connect_once (identity, TRUE, cache, FALSE));
+  g_object_unref (cache);
+
+  /* NULL turns resumption off */
+  g_assert (!connect_once (identity, TRUE, NULL, FALSE));
+  g_assert (!connect_once (identity, TRUE, NULL, FALSE));
+
+  /* A session the server does not know falls back to a full handshake */
+  cache = g_tls_session_cache_new (16, 0);
+  store_session (cache, identity, "bogus");
+  g_assert (!connect_once (identity, TRUE, cache, FALSE));
+  g_assert (connect_once (identity, TRUE, cache, FALSE));
+  g_object_unref (cache);
+
+  g_object_unref (identity);
+  g_object_unref (other);
+}
+
+#endif /* G_OS_UNIX */
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  _g_test_tls_backend_get_type ();
+
+  g_test_add_func ("/tls-session-cache/cache", test_cache);
+  g_test_add_func ("/tls-session-cache/default", test_default_cache);
+#ifdef G_OS_UNIX
+  g_test_add_func ("/tls-session-cache/resumption", test_resumption);
+#endif
+
+  return g_test_run ();
+}
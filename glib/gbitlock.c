@@ -31,13 +31,8 @@
 #include "gthreadprivate.h"
 #include "config.h"
 
-#undef HAVE_FUTEX
 #ifdef G_BIT_LOCK_FORCE_FUTEX_EMULATION
-#endif
-
-#ifndef HAVE_FUTEX
-static GMutex g_futex_mutex;
-static GSList *g_futex_address_list = NULL;
+#undef HAVE_FUTEX
 #endif
 
 #ifdef HAVE_FUTEX
@@ -96,7 +91,12 @@ g_futex_wake (const volatile gint *address)
 
 #else
 
-/* emulate futex(2) */
+/* emulate futex(2)
+ *
+ * Waiters are kept in a table of wait queues hashed by address, so
+ * that threads waiting on unrelated locks don't all serialise on a
+ * single mutex and walk one list of every address being waited on.
+ */
 typedef struct
 {
   const volatile gint *address;
@@ -104,12 +104,29 @@ typedef struct
   GCond                wait_queue;
 } WaitAddress;
 
+typedef struct
+{
+  GMutex  mutex;
+  GSList *addresses;
+} WaitBucket;
+
+#define WAIT_BUCKETS 64
+static WaitBucket g_futex_buckets[WAIT_BUCKETS];
+
+static WaitBucket *
+g_futex_bucket (const volatile gint *address)
+{
+  /* the low bits are the same for all the ints in a structure */
+  return &g_futex_buckets[(((gsize) address) >> 4) % WAIT_BUCKETS];
+}
+
 static WaitAddress *
-g_futex_find_address (const volatile gint *address)
+g_futex_find_address (WaitBucket          *bucket,
+                      const volatile gint *address)
 {
   GSList *node;
 
-  for (node = g_futex_address_list; node; node = node->next)
+  for (node = bucket->addresses; node; node = node->next)
     {
       WaitAddress *waiter = node->data;
 
@@ -124,38 +141,39 @@ static void
 g_futex_wait (const volatile gint *address,
               gint                 value)
 {
-  g_mutex_lock (&g_futex_mutex);
+  WaitBucket *bucket = g_futex_bucket (address);
+
+  g_mutex_lock (&bucket->mutex);
   if G_LIKELY (g_atomic_int_get (address) == value)
     {
       WaitAddress *waiter;
 
-      if ((waiter = g_futex_find_address (address)) == NULL)
+      if ((waiter = g_futex_find_address (bucket, address)) == NULL)
         {
           waiter = g_slice_new (WaitAddress);
           waiter->address = address;
           g_cond_init (&waiter->wait_queue);
           waiter->ref_count = 0;
-          g_futex_address_list =
-            g_slist_prepend (g_futex_address_list, waiter);
+          bucket->addresses = g_slist_prepend (bucket->addresses, waiter);
         }
 
       waiter->ref_count++;
-      g_cond_wait (&waiter->wait_queue, &g_futex_mutex);
+      g_cond_wait (&waiter->wait_queue, &bucket->mutex);
 
       if (!--waiter->ref_count)
         {
-          g_futex_address_list =
-            g_slist_remove (g_futex_address_list, waiter);
+          bucket->addresses = g_slist_remove (bucket->addresses, waiter);
           g_cond_clear (&waiter->wait_queue);
           g_slice_free (WaitAddress, waiter);
         }
     }
-  g_mutex_unlock (&g_futex_mutex);
+  g_mutex_unlock (&bucket->mutex);
 }
 
 static void
 g_futex_wake (const volatile gint *address)
 {
+  WaitBucket *bucket = g_futex_bucket (address);
   WaitAddress *waiter;
 
   /* need to lock here for two reasons:
@@ -164,10 +182,10 @@ g_futex_wake (const volatile gint *address)
    *   2) need to -stay- locked until the end to ensure a wake()
    *      in another thread doesn't cause 'waiter' to stop existing
    */
-  g_mutex_lock (&g_futex_mutex);
-  if ((waiter = g_futex_find_address (address)))
+  g_mutex_lock (&bucket->mutex);
+  if ((waiter = g_futex_find_address (bucket, address)))
     g_cond_signal (&waiter->wait_queue);
-  g_mutex_unlock (&g_futex_mutex);
+  g_mutex_unlock (&bucket->mutex);
 }
 #endif
 
@@ -180,6 +198,57 @@ static volatile gint g_bit_lock_contended[CONTENTION_CLASSES];
   #endif
 #endif
 
+/* Bit locks protect short critical sections, so a thread finding one
+ * taken spins for a while before going to sleep: the owner will often
+ * have released it by then, which saves both system calls. How long
+ * to spin is adapted per contention class, the way glibc does for its
+ * adaptive mutexes: towards the number of spins that were needed
+ * recently, up to twice that plus a bit, but never more than
+ * MAX_SPINS.
+ */
+#define MAX_SPINS 100
+static volatile gint g_bit_lock_spins[CONTENTION_CLASSES];
+
+static inline void
+g_bit_lock_relax (void)
+{
+#if defined (__GNUC__) && (defined (i386) || defined (__amd64__))
+  __asm__ __volatile__ ("pause" ::: "memory");
+#endif
+}
+
+/* Waits until @mask looks clear in @address, spinning first and then
+ * sleeping; the caller then tries to take the lock again.
+ */
+static void
+g_bit_lock_wait (const volatile gint *address,
+                 guint                mask,
+                 guint                class)
+{
+  gint spins = g_atomic_int_get (&g_bit_lock_spins[class]);
+  gint max_spins = MIN (MAX_SPINS, spins * 2 + 10);
+  guint v;
+  gint i;
+
+  for (i = 0; i < max_spins; i++)
+    {
+      g_bit_lock_relax ();
+
+      if (!(g_atomic_int_get (address) & mask))
+        break;
+    }
+
+  g_atomic_int_set (&g_bit_lock_spins[class], spins + (i - spins) / 8);
+
+  v = g_atomic_int_get (address);
+  if (v & mask)
+    {
+      g_atomic_int_add (&g_bit_lock_contended[class], +1);
+      g_futex_wait (address, v);
+      g_atomic_int_add (&g_bit_lock_contended[class], -1);
+    }
+}
+
 /**
  * g_bit_lock:
  * @address: a pointer to an integer
@@ -217,18 +286,9 @@ g_bit_lock (volatile gint *address,
 
  contended:
   {
-    guint mask = 1u << lock_bit;
-    guint v;
-
-    v = g_atomic_int_get (address);
-    if (v & mask)
-      {
-        guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
-
-        g_atomic_int_add (&g_bit_lock_contended[class], +1);
-        g_futex_wait (address, v);
-        g_atomic_int_add (&g_bit_lock_contended[class], -1);
-      }
+    guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
+
+    g_bit_lock_wait (address, 1u << lock_bit, class);
   }
   goto retry;
 #else
@@ -242,9 +302,7 @@ g_bit_lock (volatile gint *address,
     {
       guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
 
-      g_atomic_int_add (&g_bit_lock_contended[class], +1);
-      g_futex_wait (address, v);
-      g_atomic_int_add (&g_bit_lock_contended[class], -1);
+      g_bit_lock_wait (address, mask, class);
 
       goto retry;
     }
@@ -411,19 +469,9 @@ void
 
  contended:
     {
-      volatile gsize *pointer_address = address;
-      gsize mask = 1u << lock_bit;
-      gsize v;
-
-      v = (gsize) g_atomic_pointer_get (pointer_address);
-      if (v & mask)
-        {
-          guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
+      guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
 
-          g_atomic_int_add (&g_bit_lock_contended[class], +1);
-          g_futex_wait (g_futex_int_address (address), v);
-          g_atomic_int_add (&g_bit_lock_contended[class], -1);
-        }
+      g_bit_lock_wait (g_futex_int_address (address), 1u << lock_bit, class);
     }
     goto retry;
 #else
@@ -438,9 +486,7 @@ void
     {
       guint class = ((gsize) address) % G_N_ELEMENTS (g_bit_lock_contended);
 
-      g_atomic_int_add (&g_bit_lock_contended[class], +1);
-      g_futex_wait (g_futex_int_address (address), (guint) v);
-      g_atomic_int_add (&g_bit_lock_contended[class], -1);
+      g_bit_lock_wait (g_futex_int_address (address), mask, class);
 
       goto retry;
     }
@@ -627,12 +627,157 @@ close_converter (GIConv converter)
 
 #else  /* !NEED_ICONV_CACHE */
 
+/* Opening a converter means loading and looking up an iconv module,
+ * which costs a lot more than converting a short string with it. So
+ * each thread keeps the converters it used last around, and a
+ * converter that is in use is never shared, which keeps this lockless.
+ */
+#define CONVERTER_CACHE_SIZE 8
+
+typedef struct
+{
+  gchar   *to_codeset;
+  gchar   *from_codeset;
+  GIConv   cd;
+  gboolean in_use;
+} CachedConverter;
+
+typedef struct
+{
+  /* most recently used first */
+  CachedConverter converters[CONVERTER_CACHE_SIZE];
+  gint n_converters;
+} ConverterCache;
+
+static void
+converter_cache_free (gpointer data)
+{
+  ConverterCache *cache = data;
+  gint i;
+
+  for (i = 0; i < cache->n_converters; i++)
+    {
+      g_free (cache->converters[i].to_codeset);
+      g_free (cache->converters[i].from_codeset);
+      g_iconv_close (cache->converters[i].cd);
+    }
+
+  g_free (cache);
+}
+
+static ConverterCache *
+converter_cache_get (void)
+{
+  static GPrivate cache_private = G_PRIVATE_INIT (converter_cache_free);
+  ConverterCache *cache = g_private_get (&cache_private);
+
+  if (!cache)
+    {
+      cache = g_new0 (ConverterCache, 1);
+      g_private_set (&cache_private, cache);
+    }
+
+  return cache;
+}
+
+/* Moves the converter at @i to the front, where it will be found
+ * first and evicted last.
+ */
+static void
+converter_cache_promote (ConverterCache *cache,
+                         gint            i)
+{
+  CachedConverter converter = cache->converters[i];
+
+  memmove (&cache->converters[1], &cache->converters[0],
+           i * sizeof (CachedConverter));
+  cache->converters[0] = converter;
+}
+
+static void
+converter_cache_add (ConverterCache *cache,
+                     const gchar    *to_codeset,
+                     const gchar    *from_codeset,
+                     GIConv          cd)
+{
+  gint i;
+
+  if (cache->n_converters == CONVERTER_CACHE_SIZE)
+    {
+      /* evict the least recently used converter that is not in use */
+      for (i = cache->n_converters - 1; i >= 0; i--)
+        if (!cache->converters[i].in_use)
+          break;
+
+      /* all of them are; @cd will simply be closed after use */
+      if (i < 0)
+        return;
+
+      g_free (cache->converters[i].to_codeset);
+      g_free (cache->converters[i].from_codeset);
+      g_iconv_close (cache->converters[i].cd);
+    }
+  else
+    i = cache->n_converters++;
+
+  cache->converters[i].to_codeset = g_strdup (to_codeset);
+  cache->converters[i].from_codeset = g_strdup (from_codeset);
+  cache->converters[i].cd = cd;
+  cache->converters[i].in_use = TRUE;
+  converter_cache_promote (cache, i);
+}
+
+/* The byte order of UTF-16 and friends without an explicit one is
+ * taken from the byte order mark on first use, and glibc keeps it
+ * across resets, so those converters can't be used twice.
+ */
+static gboolean
+converter_is_reusable (const gchar *codeset)
+{
+  static const gchar * const unmarked[] = {
+    "UTF-16", "UTF16", "UTF-32", "UTF32",
+    "UCS-2", "UCS2", "UCS-4", "UCS4", "UNICODE"
+  };
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (unmarked); i++)
+    if (g_ascii_strcasecmp (codeset, unmarked[i]) == 0)
+      return FALSE;
+
+  return TRUE;
+}
+
 static GIConv
 open_converter (const gchar *to_codeset,
 		const gchar *from_codeset,
 		GError     **error)
 {
+  ConverterCache *cache;
+  gboolean reusable;
   GIConv cd;
+  gint i;
+
+  reusable = converter_is_reusable (to_codeset) && converter_is_reusable (from_codeset);
+  cache = reusable ? converter_cache_get () : NULL;
+
+  for (i = 0; cache && i < cache->n_converters; i++)
+    {
+      CachedConverter *converter = &cache->converters[i];
+
+      if (!converter->in_use &&
+          strcmp (converter->to_codeset, to_codeset) == 0 &&
+          strcmp (converter->from_codeset, from_codeset) == 0)
+        {
+          cd = converter->cd;
+          converter->in_use = TRUE;
+          converter_cache_promote (cache, i);
+
+          /* reset the shift state left over from the last use */
+          g_iconv (cd, NULL, NULL, NULL, NULL);
+
+          return cd;
+        }
+    }
 
   cd = g_iconv_open (to_codeset, from_codeset);
 
@@ -651,6 +796,8 @@ open_converter (const gchar *to_codeset,
 			 from_codeset, to_codeset);
 	}
     }
+  else if (cache)
+    converter_cache_add (cache, to_codeset, from_codeset, cd);
   
   return cd;
 }
@@ -658,8 +805,19 @@ open_converter (const gchar *to_codeset,
 static int
 close_converter (GIConv cd)
 {
+  ConverterCache *cache;
+  gint i;
+
   if (cd == (GIConv) -1)
     return 0;
+
+  cache = converter_cache_get ();
+  for (i = 0; i < cache->n_converters; i++)
+    if (cache->converters[i].cd == cd)
+      {
+        cache->converters[i].in_use = FALSE;
+        return 0;
+      }
   
   return g_iconv_close (cd);  
 }
@@ -822,6 +980,346 @@ g_convert_with_iconv (const gchar *str,
     return dest;
 }
 
+/* Built-in converters
+ *
+ * Conversions between UTF-8, ISO-8859-1, ASCII and UTF-16 are common
+ * enough, and simple enough, that g_convert() does them itself rather
+ * than going through iconv. They behave like the glibc converters,
+ * with the same errors and @bytes_read for invalid, unrepresentable
+ * and partial input.
+ */
+
+/* Returns the length of the character at @p, 0 if it is incomplete
+ * or -1 if it is invalid.
+ */
+typedef gint (* DecodeFunc) (const guchar *p,
+                             gsize         len,
+                             gunichar     *ch);
+
+/* Returns the number of bytes written, or -1 if @ch can't be
+ * represented.
+ */
+typedef gint (* EncodeFunc) (gunichar      ch,
+                             guchar       *out);
+
+typedef struct
+{
+  const gchar *names;     /* nul-separated aliases */
+  DecodeFunc   decode;
+  EncodeFunc   encode;
+} BuiltinCharset;
+
+static gint
+decode_utf8 (const guchar *p,
+             gsize         len,
+             gunichar     *ch)
+{
+  gunichar c = p[0];
+  gunichar min;
+  gint n, i;
+
+  if (c < 0x80)
+    {
+      *ch = c;
+      return 1;
+    }
+  else if (c < 0xc2)
+    return -1;
+  else if (c < 0xe0)
+    {
+      n = 2;
+      c &= 0x1f;
+      min = 0x80;
+    }
+  else if (c < 0xf0)
+    {
+      n = 3;
+      c &= 0x0f;
+      min = 0x800;
+    }
+  else if (c < 0xf8)
+    {
+      n = 4;
+      c &= 0x07;
+      min = 0x10000;
+    }
+  else if (c < 0xfc)
+    {
+      n = 5;
+      c &= 0x03;
+      min = 0x200000;
+    }
+  else if (c < 0xfe)
+    {
+      n = 6;
+      c &= 0x01;
+      min = 0x4000000;
+    }
+  else
+    return -1;
+
+  for (i = 1; i < n; i++)
+    {
+      if (i == len)
+        return 0;
+
+      if ((p[i] & 0xc0) != 0x80)
+        return -1;
+
+      c = (c << 6) | (p[i] & 0x3f);
+    }
+
+  /* like glibc, this accepts the old five and six byte forms and
+   * leaves values above U+10FFFF to the encoder
+   */
+  if (c < min || (c >= 0xd800 && c <= 0xdfff))
+    return -1;
+
+  *ch = c;
+
+  return n;
+}
+
+static gint
+encode_utf8 (gunichar  ch,
+             guchar   *out)
+{
+  return g_unichar_to_utf8 (ch, (gchar *) out);
+}
+
+static gint
+decode_latin1 (const guchar *p,
+               gsize         len,
+               gunichar     *ch)
+{
+  *ch = p[0];
+
+  return 1;
+}
+
+static gint
+encode_latin1 (gunichar  ch,
+               guchar   *out)
+{
+  if (ch > 0xff)
+    return -1;
+
+  out[0] = ch;
+
+  return 1;
+}
+
+static gint
+decode_ascii (const guchar *p,
+              gsize         len,
+              gunichar     *ch)
+{
+  if (p[0] > 0x7f)
+    return -1;
+
+  *ch = p[0];
+
+  return 1;
+}
+
+static gint
+encode_ascii (gunichar  ch,
+              guchar   *out)
+{
+  if (ch > 0x7f)
+    return -1;
+
+  out[0] = ch;
+
+  return 1;
+}
+
+static inline gint
+decode_utf16 (const guchar *p,
+              gsize         len,
+              gunichar     *ch,
+              gboolean      big_endian)
+{
+  gunichar c, c2;
+
+#define UNIT(q) (big_endian ? ((q)[0] << 8) | (q)[1] : ((q)[1] << 8) | (q)[0])
+  if (len < 2)
+    return 0;
+
+  c = UNIT (p);
+  if (c < 0xd800 || c > 0xdfff)
+    {
+      *ch = c;
+      return 2;
+    }
+  else if (c > 0xdbff)
+    return -1;
+
+  if (len < 4)
+    return 0;
+
+  c2 = UNIT (p + 2);
+  if (c2 < 0xdc00 || c2 > 0xdfff)
+    return -1;
+#undef UNIT
+
+  *ch = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+
+  return 4;
+}
+
+static inline gint
+encode_utf16 (gunichar  ch,
+              guchar   *out,
+              gboolean  big_endian)
+{
+  gunichar2 units[2];
+  gint n, i;
+
+  if (ch > 0x10ffff)
+    return -1;
+  else if (ch < 0x10000)
+    {
+      units[0] = ch;
+      n = 1;
+    }
+  else
+    {
+      units[0] = 0xd800 + ((ch - 0x10000) >> 10);
+      units[1] = 0xdc00 + ((ch - 0x10000) & 0x3ff);
+      n = 2;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      out[2 * i + (big_endian ? 0 : 1)] = units[i] >> 8;
+      out[2 * i + (big_endian ? 1 : 0)] = units[i] & 0xff;
+    }
+
+  return 2 * n;
+}
+
+static gint
+decode_utf16le (const guchar *p,
+                gsize         len,
+                gunichar     *ch)
+{
+  return decode_utf16 (p, len, ch, FALSE);
+}
+
+static gint
+encode_utf16le (gunichar  ch,
+                guchar   *out)
+{
+  return encode_utf16 (ch, out, FALSE);
+}
+
+static gint
+decode_utf16be (const guchar *p,
+                gsize         len,
+                gunichar     *ch)
+{
+  return decode_utf16 (p, len, ch, TRUE);
+}
+
+static gint
+encode_utf16be (gunichar  ch,
+                guchar   *out)
+{
+  return encode_utf16 (ch, out, TRUE);
+}
+
+static const BuiltinCharset builtin_charsets[] = {
+  { "UTF-8\0UTF8\0", decode_utf8, encode_utf8 },
+  { "ISO-8859-1\0ISO8859-1\0ISO_8859-1\0LATIN1\0L1\0", decode_latin1, encode_latin1 },
+  { "ASCII\0US-ASCII\0ANSI_X3.4-1968\0", decode_ascii, encode_ascii },
+  { "UTF-16LE\0UTF16LE\0", decode_utf16le, encode_utf16le },
+  { "UTF-16BE\0UTF16BE\0", decode_utf16be, encode_utf16be }
+};
+
+static const BuiltinCharset *
+find_builtin_charset (const gchar *codeset)
+{
+  const gchar *name;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (builtin_charsets); i++)
+    for (name = builtin_charsets[i].names; *name; name += strlen (name) + 1)
+      if (g_ascii_strcasecmp (name, codeset) == 0)
+        return &builtin_charsets[i];
+
+  return NULL;
+}
+
+/* Same as g_convert_with_iconv(), using built-in converters */
+static gchar *
+convert_builtin (const gchar          *str,
+                 gssize                len,
+                 const BuiltinCharset *to,
+                 const BuiltinCharset *from,
+                 gsize                *bytes_read,
+                 gsize                *bytes_written,
+                 GError              **error)
+{
+  const guchar *p, *end;
+  guchar *dest, *outp;
+  gboolean have_error = FALSE;
+
+  if (len < 0)
+    len = strlen (str);
+
+  p = (const guchar *) str;
+  end = p + len;
+
+  /* no character grows by more than a factor of two in any of these */
+  outp = dest = g_malloc (2 * len + NUL_TERMINATOR_LENGTH);
+
+  while (p < end)
+    {
+      gunichar ch;
+      gint n, m;
+
+      n = from->decode (p, end - p, &ch);
+
+      /* Incomplete text, do not report an error */
+      if (n == 0)
+        break;
+
+      if (n < 0 || (m = to->encode (ch, outp)) < 0)
+        {
+          g_set_error_literal (error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                               _("Invalid byte sequence in conversion input"));
+          have_error = TRUE;
+          break;
+        }
+
+      p += n;
+      outp += m;
+    }
+
+  memset (outp, 0, NUL_TERMINATOR_LENGTH);
+
+  if (bytes_read)
+    *bytes_read = p - (const guchar *) str;
+  else if (p != end && !have_error)
+    {
+      g_set_error_literal (error, G_CONVERT_ERROR, G_CONVERT_ERROR_PARTIAL_INPUT,
+                           _("Partial character sequence at end of input"));
+      have_error = TRUE;
+    }
+
+  if (bytes_written)
+    *bytes_written = outp - dest;	/* Doesn't include '\0' */
+
+  if (have_error)
+    {
+      g_free (dest);
+      return NULL;
+    }
+  else
+    return (gchar *) dest;
+}
+
 /**
  * g_convert:
  * @str:           the string to convert
@@ -866,12 +1364,18 @@ g_convert (const gchar *str,
 	   gsize       *bytes_written, 
 	   GError     **error)
 {
+  const BuiltinCharset *to, *from;
   gchar *res;
   GIConv cd;
 
   g_return_val_if_fail (str != NULL, NULL);
   g_return_val_if_fail (to_codeset != NULL, NULL);
   g_return_val_if_fail (from_codeset != NULL, NULL);
+
+  if ((to = find_builtin_charset (to_codeset)) &&
+      (from = find_builtin_charset (from_codeset)))
+    return convert_builtin (str, len, to, from,
+                            bytes_read, bytes_written, error);
   
   cd = open_converter (to_codeset, from_codeset, error);
 
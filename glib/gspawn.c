@@ -41,6 +41,26 @@
 #include <sys/resource.h>
 #endif /* HAVE_SYS_RESOURCE_H */
 
+#ifdef __linux__
+#include <sys/syscall.h>  /* for close_range */
+#endif
+
+/* glibc implements posix_spawn() with clone(CLONE_VM | CLONE_VFORK)
+ * and reports exec() failures to the caller since 2.24; older
+ * versions, and many other libcs, fork() anyway or lose the error.
+ */
+#if defined(__GLIBC__) && __GLIBC_PREREQ (2, 24)
+#define POSIX_SPAWN_AVAILABLE
+#include <spawn.h>
+#if __GLIBC_PREREQ (2, 34)
+#define HAVE_POSIX_SPAWN_CLOSEFROM
+#endif
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
 #include "gspawn.h"
 
 #include "genviron.h"
@@ -996,6 +1016,21 @@ fdwalk (int (*cb)(void *data, int fd), void *data)
 }
 #endif
 
+/* Marks all descriptors from @lowfd up close-on-exec. close_range()
+ * does that in a single system call on Linux 5.11 and later, whatever
+ * the descriptor limit is; otherwise we have to walk them.
+ */
+static void
+set_cloexec_from (gint lowfd)
+{
+#if defined(__linux__) && defined(SYS_close_range)
+  if (syscall (SYS_close_range, lowfd, ~0U, CLOSE_RANGE_CLOEXEC) == 0)
+    return;
+#endif
+
+  fdwalk (set_cloexec, GINT_TO_POINTER (lowfd));
+}
+
 static gint
 sane_dup2 (gint fd1, gint fd2)
 {
@@ -1058,7 +1093,7 @@ do_exec (gint                  child_err_report_fd,
    */
   if (close_descriptors)
     {
-      fdwalk (set_cloexec, GINT_TO_POINTER(3));
+      set_cloexec_from (3);
     }
   else
     {
@@ -1140,6 +1175,133 @@ do_exec (gint                  child_err_report_fd,
                       CHILD_EXEC_FAILED);
 }
 
+#ifdef POSIX_SPAWN_AVAILABLE
+/* Starts the child with posix_spawn() instead of fork() and
+ * do_exec(). Since the child shares the parent's memory until it
+ * execs, the page tables of the parent don't have to be copied, which
+ * makes this much faster for processes with a large address space.
+ * It cannot do everything do_exec() does, so the caller only uses it
+ * when there is no working directory or child setup function.
+ *
+ * Returns 0 on success, or an errno value.
+ */
+static gint
+do_posix_spawn (gchar     **argv,
+                gchar     **envp,
+                gboolean    close_descriptors,
+                gboolean    search_path,
+                gboolean    stdout_to_null,
+                gboolean    stderr_to_null,
+                gboolean    child_inherits_stdin,
+                gboolean    file_and_argv_zero,
+                GPid       *child_pid,
+                gint        stdin_pipe[2],
+                gint        stdout_pipe[2],
+                gint        stderr_pipe[2])
+{
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_t file_actions;
+  sigset_t defaults;
+  gchar **child_argv;
+  GPid pid;
+  gint i, r;
+
+  r = posix_spawnattr_init (&attr);
+  if (r != 0)
+    return r;
+
+  r = posix_spawn_file_actions_init (&file_actions);
+  if (r != 0)
+    {
+      posix_spawnattr_destroy (&attr);
+      return r;
+    }
+
+  /* Reset the same signal handlers as fork_exec_with_pipes() */
+  sigemptyset (&defaults);
+  sigaddset (&defaults, SIGCHLD);
+  sigaddset (&defaults, SIGINT);
+  sigaddset (&defaults, SIGTERM);
+  sigaddset (&defaults, SIGHUP);
+  sigaddset (&defaults, SIGPIPE);
+
+  r = posix_spawnattr_setsigdefault (&attr, &defaults);
+  if (r != 0)
+    goto out;
+
+  r = posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGDEF);
+  if (r != 0)
+    goto out;
+
+  /* Redirect pipes as required, as in do_exec() */
+  if (stdin_pipe[0] >= 0)
+    r = posix_spawn_file_actions_adddup2 (&file_actions, stdin_pipe[0], 0);
+  else if (!child_inherits_stdin)
+    r = posix_spawn_file_actions_addopen (&file_actions, 0, "/dev/null", O_RDONLY, 0);
+  if (r != 0)
+    goto out;
+
+  if (stdout_pipe[1] >= 0)
+    r = posix_spawn_file_actions_adddup2 (&file_actions, stdout_pipe[1], 1);
+  else if (stdout_to_null)
+    r = posix_spawn_file_actions_addopen (&file_actions, 1, "/dev/null", O_WRONLY, 0);
+  if (r != 0)
+    goto out;
+
+  if (stderr_pipe[1] >= 0)
+    r = posix_spawn_file_actions_adddup2 (&file_actions, stderr_pipe[1], 2);
+  else if (stderr_to_null)
+    r = posix_spawn_file_actions_addopen (&file_actions, 2, "/dev/null", O_WRONLY, 0);
+  if (r != 0)
+    goto out;
+
+  if (close_descriptors)
+    {
+#ifdef HAVE_POSIX_SPAWN_CLOSEFROM
+      /* Uses close_range() where the kernel has it */
+      r = posix_spawn_file_actions_addclosefrom_np (&file_actions, 3);
+#else
+      g_assert_not_reached ();
+#endif
+    }
+  else
+    {
+      /* Close both ends of the pipes; do_exec() gets the parent's
+       * ends closed by fork_exec_with_pipes() before it runs.
+       */
+      gint *pipes[] = { stdin_pipe, stdout_pipe, stderr_pipe };
+
+      for (i = 0; i < G_N_ELEMENTS (pipes) && r == 0; i++)
+        {
+          if (pipes[i][0] >= 0)
+            r = posix_spawn_file_actions_addclose (&file_actions, pipes[i][0]);
+          if (r == 0 && pipes[i][1] >= 0)
+            r = posix_spawn_file_actions_addclose (&file_actions, pipes[i][1]);
+        }
+    }
+  if (r != 0)
+    goto out;
+
+  child_argv = file_and_argv_zero ? argv + 1 : argv;
+  if (envp == NULL)
+    envp = environ;
+
+  if (search_path)
+    r = posix_spawnp (&pid, argv[0], &file_actions, &attr, child_argv, envp);
+  else
+    r = posix_spawn (&pid, argv[0], &file_actions, &attr, child_argv, envp);
+
+  if (r == 0)
+    *child_pid = pid;
+
+ out:
+  posix_spawn_file_actions_destroy (&file_actions);
+  posix_spawnattr_destroy (&attr);
+
+  return r;
+}
+#endif /* POSIX_SPAWN_AVAILABLE */
+
 static gboolean
 read_ints (int      fd,
            gint*    buf,
@@ -1216,12 +1378,6 @@ fork_exec_with_pipes (gboolean              intermediate_child,
   gint child_pid_report_pipe[2] = { -1, -1 };
   gint status;
   
-  if (!make_pipe (child_err_report_pipe, error))
-    return FALSE;
-
-  if (intermediate_child && !make_pipe (child_pid_report_pipe, error))
-    goto cleanup_and_fail;
-  
   if (standard_input && !make_pipe (stdin_pipe, error))
     goto cleanup_and_fail;
   
@@ -1231,6 +1387,71 @@ fork_exec_with_pipes (gboolean              intermediate_child,
   if (standard_error && !make_pipe (stderr_pipe, error))
     goto cleanup_and_fail;
 
+#ifdef POSIX_SPAWN_AVAILABLE
+  /* Take the fast path when posix_spawn() can do all that is asked.
+   * It can't run a function in the child or fork twice, and when
+   * PATH is unset posix_spawnp() searches a different default path
+   * than g_execute().
+   */
+  if (!intermediate_child && working_directory == NULL && child_setup == NULL &&
+#ifndef HAVE_POSIX_SPAWN_CLOSEFROM
+      !close_descriptors &&
+#endif
+      (!search_path || g_getenv ("PATH") != NULL))
+    {
+      status = do_posix_spawn (argv,
+                               envp,
+                               close_descriptors,
+                               search_path,
+                               stdout_to_null,
+                               stderr_to_null,
+                               child_inherits_stdin,
+                               file_and_argv_zero,
+                               &pid,
+                               stdin_pipe,
+                               stdout_pipe,
+                               stderr_pipe);
+      if (status == 0)
+        {
+          close_and_invalidate (&stdin_pipe[0]);
+          close_and_invalidate (&stdout_pipe[1]);
+          close_and_invalidate (&stderr_pipe[1]);
+
+          if (child_pid)
+            *child_pid = pid;
+
+          if (standard_input)
+            *standard_input = stdin_pipe[1];
+          if (standard_output)
+            *standard_output = stdout_pipe[0];
+          if (standard_error)
+            *standard_error = stderr_pipe[0];
+
+          return TRUE;
+        }
+
+      /* posix_spawn() doesn't run scripts without a "#!" line through
+       * /bin/sh like g_execute() does, so leave those to the code below.
+       */
+      if (status != ENOEXEC)
+        {
+          g_set_error (error,
+                       G_SPAWN_ERROR,
+                       exec_err_to_g_error (status),
+                       _("Failed to execute child process \"%s\" (%s)"),
+                       argv[0],
+                       g_strerror (status));
+          goto cleanup_and_fail;
+        }
+    }
+#endif
+
+  if (!make_pipe (child_err_report_pipe, error))
+    goto cleanup_and_fail;
+
+  if (intermediate_child && !make_pipe (child_pid_report_pipe, error))
+    goto cleanup_and_fail;
+
   pid = fork ();
 
   if (pid < 0)
@@ -67,6 +67,15 @@
 #include <sys/prctl.h>
 #endif
 
+/* On Linux, the locks and GCond keep their state inline and use
+ * futexes directly; see the end of this file.
+ */
+#if defined(HAVE_FUTEX) && defined(__linux__)
+#define USE_NATIVE_MUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 static void
 g_thread_abort (gint         status,
                 const gchar *function)
@@ -76,6 +85,8 @@ g_thread_abort (gint         status,
   abort ();
 }
 
+#if !defined(USE_NATIVE_MUTEX)
+
 /* {{{1 GMutex */
 
 static pthread_mutex_t *
@@ -861,6 +872,8 @@ g_cond_wait_until (GCond  *cond,
   return FALSE;
 }
 
+#endif /* !USE_NATIVE_MUTEX */
+
 /* {{{1 GPrivate */
 
 /**
@@ -1176,5 +1189,423 @@ g_system_thread_set_name (const gchar *name)
 #endif
 }
 
+/* {{{1 Linux futex implementation */
+
+#ifdef USE_NATIVE_MUTEX
+
+/* GMutex, GRecMutex, GRWLock and GCond keep their whole state in the
+ * structures of the API, which are zero-initialised when unlocked, so
+ * there is nothing to allocate on first use and no pointer to follow
+ * on every operation. They only enter the kernel when a thread
+ * actually has to wait. GCond has to follow GMutex here, as
+ * pthread_cond_wait() only works with a pthread mutex.
+ *
+ * As with the rest of this file, they must not call other parts of
+ * GLib; the atomic operations are compiler builtins.
+ */
+
+#ifndef FUTEX_WAIT_PRIVATE
+#define FUTEX_WAIT_PRIVATE FUTEX_WAIT
+#define FUTEX_WAKE_PRIVATE FUTEX_WAKE
+#endif
+
+#ifndef FUTEX_WAIT_BITSET_PRIVATE
+#define FUTEX_WAIT_BITSET_PRIVATE FUTEX_WAIT_BITSET
+#endif
+
+#ifndef FUTEX_BITSET_MATCH_ANY
+#define FUTEX_BITSET_MATCH_ANY 0xffffffff
+#endif
+
+static inline void
+g_futex_wait_private (guint *address,
+                      guint  value)
+{
+  syscall (__NR_futex, address, (gsize) FUTEX_WAIT_PRIVATE, (gsize) value, NULL);
+}
+
+static inline void
+g_futex_wake_private (guint *address,
+                      gint   n_waiters)
+{
+  syscall (__NR_futex, address, (gsize) FUTEX_WAKE_PRIVATE, (gsize) n_waiters, NULL);
+}
+
+static void G_GNUC_NORETURN
+g_lock_abort (const gchar *message)
+{
+  fprintf (stderr, "GLib (gthread-posix.c): %s.  Aborting.\n", message);
+  abort ();
+}
+
+/* {{{2 GMutex */
+
+/* The state of a mutex is i[0]:
+ *
+ *  0: unlocked
+ *  1: locked, nobody waiting
+ *  2: locked, maybe with threads waiting in the kernel
+ *
+ * A thread that has to wait sets it to 2 before sleeping, and the
+ * owner only makes the system call to wake one of them up if it finds
+ * a 2 when unlocking.
+ */
+enum
+{
+  MUTEX_UNLOCKED,
+  MUTEX_LOCKED,
+  MUTEX_CONTENDED
+};
+
+static void __attribute__((noinline))
+g_futex_mutex_lock_slowpath (guint *state)
+{
+  /* If it was 0, we just took the lock (marking it contended to be
+   * safe); otherwise sleep for as long as it stays contended.
+   */
+  while (__sync_lock_test_and_set (state, MUTEX_CONTENDED) != MUTEX_UNLOCKED)
+    g_futex_wait_private (state, MUTEX_CONTENDED);
+}
+
+static void __attribute__((noinline))
+g_futex_mutex_unlock_slowpath (guint *state)
+{
+  if G_UNLIKELY (g_atomic_int_get (state) == MUTEX_UNLOCKED)
+    g_lock_abort ("Attempt to unlock a mutex that is not locked");
+
+  g_atomic_int_set (state, MUTEX_UNLOCKED);
+  g_futex_wake_private (state, 1);
+}
+
+static inline void
+g_futex_mutex_lock (guint *state)
+{
+  if G_UNLIKELY (!g_atomic_int_compare_and_exchange (state, MUTEX_UNLOCKED, MUTEX_LOCKED))
+    g_futex_mutex_lock_slowpath (state);
+}
+
+static inline void
+g_futex_mutex_unlock (guint *state)
+{
+  if G_UNLIKELY (!g_atomic_int_compare_and_exchange (state, MUTEX_LOCKED, MUTEX_UNLOCKED))
+    g_futex_mutex_unlock_slowpath (state);
+}
+
+static inline gboolean
+g_futex_mutex_trylock (guint *state)
+{
+  return g_atomic_int_compare_and_exchange (state, MUTEX_UNLOCKED, MUTEX_LOCKED);
+}
+
+void
+g_mutex_init (GMutex *mutex)
+{
+  mutex->i[0] = MUTEX_UNLOCKED;
+}
+
+void
+g_mutex_clear (GMutex *mutex)
+{
+  if G_UNLIKELY (mutex->i[0] != MUTEX_UNLOCKED)
+    g_lock_abort ("g_mutex_clear() called on a locked mutex");
+}
+
+void
+g_mutex_lock (GMutex *mutex)
+{
+  g_futex_mutex_lock (&mutex->i[0]);
+}
+
+void
+g_mutex_unlock (GMutex *mutex)
+{
+  g_futex_mutex_unlock (&mutex->i[0]);
+}
+
+gboolean
+g_mutex_trylock (GMutex *mutex)
+{
+  return g_futex_mutex_trylock (&mutex->i[0]);
+}
+
+/* {{{2 GRecMutex */
+
+/* i[0] is a lock like that of GMutex, p the thread holding it and
+ * i[1] how many times that thread has locked it. A thread only ever
+ * finds itself in p if it put itself there, so checking for a
+ * recursive lock needs no barrier.
+ */
+
+static inline gpointer
+g_rec_mutex_self (void)
+{
+  return (gpointer) (gsize) pthread_self ();
+}
+
+void
+g_rec_mutex_init (GRecMutex *rec_mutex)
+{
+  rec_mutex->p = NULL;
+  rec_mutex->i[0] = MUTEX_UNLOCKED;
+  rec_mutex->i[1] = 0;
+}
+
+void
+g_rec_mutex_clear (GRecMutex *rec_mutex)
+{
+  if G_UNLIKELY (rec_mutex->i[0] != MUTEX_UNLOCKED)
+    g_lock_abort ("g_rec_mutex_clear() called on a locked mutex");
+}
+
+void
+g_rec_mutex_lock (GRecMutex *rec_mutex)
+{
+  gpointer self = g_rec_mutex_self ();
+
+  if (rec_mutex->p != self)
+    {
+      g_futex_mutex_lock (&rec_mutex->i[0]);
+      rec_mutex->p = self;
+    }
+
+  rec_mutex->i[1]++;
+}
+
+void
+g_rec_mutex_unlock (GRecMutex *rec_mutex)
+{
+  if G_UNLIKELY (rec_mutex->p != g_rec_mutex_self ())
+    g_lock_abort ("Attempt to unlock a recursive mutex that is not held by the current thread");
+
+  if (--rec_mutex->i[1] == 0)
+    {
+      rec_mutex->p = NULL;
+      g_futex_mutex_unlock (&rec_mutex->i[0]);
+    }
+}
+
+gboolean
+g_rec_mutex_trylock (GRecMutex *rec_mutex)
+{
+  gpointer self = g_rec_mutex_self ();
+
+  if (rec_mutex->p != self)
+    {
+      if (!g_futex_mutex_trylock (&rec_mutex->i[0]))
+        return FALSE;
+      rec_mutex->p = self;
+    }
+
+  rec_mutex->i[1]++;
+
+  return TRUE;
+}
+
+/* {{{2 GRWLock */
+
+/* i[0] is the number of readers holding the lock, or RW_LOCK_WRITER
+ * while a writer has it, with RW_LOCK_WAITERS set once a thread has
+ * gone to sleep on it. i[1] counts the threads between deciding to
+ * sleep and waking up again: a woken writer takes the lock without
+ * putting the flag back, so the unlock that follows must still know
+ * to wake the others.
+ *
+ * Like the pthread rwlock it replaces, readers get the lock whenever
+ * no writer holds it, so read locks can be taken recursively.
+ */
+#define RW_LOCK_WRITER  0x7fffffffu
+#define RW_LOCK_WAITERS 0x80000000u
+
+static inline gboolean
+g_rw_lock_try_read (guint *state)
+{
+  guint val;
+
+  do
+    {
+      val = *(volatile guint *) state;
+      if ((val & ~RW_LOCK_WAITERS) >= RW_LOCK_WRITER - 1)
+        return FALSE;
+    }
+  while (!g_atomic_int_compare_and_exchange (state, val, val + 1));
+
+  return TRUE;
+}
+
+static void __attribute__((noinline))
+g_rw_lock_wait (GRWLock *rw_lock,
+                guint    val)
+{
+  g_atomic_int_inc (&rw_lock->i[1]);
+  g_atomic_int_compare_and_exchange (&rw_lock->i[0], val, val | RW_LOCK_WAITERS);
+  g_futex_wait_private (&rw_lock->i[0], val | RW_LOCK_WAITERS);
+  g_atomic_int_add (&rw_lock->i[1], -1);
+}
+
+static void
+g_rw_lock_unlock (GRWLock *rw_lock)
+{
+  guint val, holders, waiters, new;
+
+  do
+    {
+      val = *(volatile guint *) &rw_lock->i[0];
+      holders = val & ~RW_LOCK_WAITERS;
+      waiters = *(volatile guint *) &rw_lock->i[1];
+
+      if G_UNLIKELY (holders == 0)
+        g_lock_abort ("Attempt to unlock a GRWLock that is not locked");
+
+      new = (holders == RW_LOCK_WRITER || holders == 1) ? 0 : val - 1;
+    }
+  while (!g_atomic_int_compare_and_exchange (&rw_lock->i[0], val, new));
+
+  /* Sleepers are woken all at once when a writer leaves; when the last
+   * reader does, they can only be writers, and just one gets to go.
+   */
+  if (new == 0 && (waiters || (val & RW_LOCK_WAITERS)))
+    g_futex_wake_private (&rw_lock->i[0], holders == RW_LOCK_WRITER ? G_MAXINT : 1);
+}
+
+void
+g_rw_lock_init (GRWLock *rw_lock)
+{
+  rw_lock->p = NULL;
+  rw_lock->i[0] = 0;
+  rw_lock->i[1] = 0;
+}
+
+void
+g_rw_lock_clear (GRWLock *rw_lock)
+{
+  if G_UNLIKELY (rw_lock->i[0] != 0)
+    g_lock_abort ("g_rw_lock_clear() called on a locked GRWLock");
+}
+
+void
+g_rw_lock_writer_lock (GRWLock *rw_lock)
+{
+  guint val;
+
+  while (!g_atomic_int_compare_and_exchange (&rw_lock->i[0], 0, RW_LOCK_WRITER))
+    {
+      val = *(volatile guint *) &rw_lock->i[0];
+      if (val != 0)
+        g_rw_lock_wait (rw_lock, val);
+    }
+}
+
+gboolean
+g_rw_lock_writer_trylock (GRWLock *rw_lock)
+{
+  return g_atomic_int_compare_and_exchange (&rw_lock->i[0], 0, RW_LOCK_WRITER);
+}
+
+void
+g_rw_lock_writer_unlock (GRWLock *rw_lock)
+{
+  g_rw_lock_unlock (rw_lock);
+}
+
+void
+g_rw_lock_reader_lock (GRWLock *rw_lock)
+{
+  guint val;
+
+  while (!g_rw_lock_try_read (&rw_lock->i[0]))
+    {
+      val = *(volatile guint *) &rw_lock->i[0];
+      if ((val & ~RW_LOCK_WAITERS) == RW_LOCK_WRITER)
+        g_rw_lock_wait (rw_lock, val);
+    }
+}
+
+gboolean
+g_rw_lock_reader_trylock (GRWLock *rw_lock)
+{
+  return g_rw_lock_try_read (&rw_lock->i[0]);
+}
+
+void
+g_rw_lock_reader_unlock (GRWLock *rw_lock)
+{
+  g_rw_lock_unlock (rw_lock);
+}
+
+/* {{{2 GCond */
+
+/* i[0] is a sequence number bumped by every signal. A waiter samples
+ * it before releasing the mutex and the kernel only puts it to sleep
+ * if it hasn't changed since, so a signal can't get lost in between.
+ */
+
+void
+g_cond_init (GCond *cond)
+{
+  cond->i[0] = 0;
+}
+
+void
+g_cond_clear (GCond *cond)
+{
+}
+
+void
+g_cond_wait (GCond  *cond,
+             GMutex *mutex)
+{
+  guint sampled = g_atomic_int_get (&cond->i[0]);
+
+  g_mutex_unlock (mutex);
+  g_futex_wait_private (&cond->i[0], sampled);
+  g_mutex_lock (mutex);
+}
+
+void
+g_cond_signal (GCond *cond)
+{
+  g_atomic_int_inc (&cond->i[0]);
+  g_futex_wake_private (&cond->i[0], 1);
+}
+
+void
+g_cond_broadcast (GCond *cond)
+{
+  g_atomic_int_inc (&cond->i[0]);
+  g_futex_wake_private (&cond->i[0], G_MAXINT);
+}
+
+gboolean
+g_cond_wait_until (GCond  *cond,
+                   GMutex *mutex,
+                   gint64  end_time)
+{
+  struct timespec ts;
+  guint sampled;
+  gboolean success;
+  gint res;
+
+  if (end_time < 0)
+    return FALSE;
+
+  /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC time, the
+   * same clock as g_get_monotonic_time().
+   */
+  ts.tv_sec = end_time / 1000000;
+  ts.tv_nsec = (end_time % 1000000) * 1000;
+
+  sampled = g_atomic_int_get (&cond->i[0]);
+  g_mutex_unlock (mutex);
+  res = syscall (__NR_futex, &cond->i[0], (gsize) FUTEX_WAIT_BITSET_PRIVATE,
+                 (gsize) sampled, &ts, NULL, (gsize) FUTEX_BITSET_MATCH_ANY);
+  /* before g_mutex_lock(), which may enter the kernel too */
+  success = !(res < 0 && errno == ETIMEDOUT);
+  g_mutex_lock (mutex);
+
+  return success;
+}
+
+#endif /* USE_NATIVE_MUTEX */
+
 /* {{{1 Epilogue */
 /* vim:set foldmethod=marker: */
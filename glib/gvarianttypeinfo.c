@@ -29,6 +29,8 @@
 #include <glib/gslice.h>
 #include <glib/ghash.h>
 
+#include <string.h>
+
 /* < private >
  * GVariantTypeInfo:
  *
@@ -49,6 +51,11 @@
  * container GVariantTypeInfo structures will exist for "(asv)" and
  * for "as" (note that "s" and "v" always exist in the static array).
  *
+ * The exception are a few very common container types, like "as" and
+ * "a{sv}".  Their GVariantTypeInfo structures are created on first use
+ * and then kept forever, so that they can be found without any locking
+ * and without touching a reference count.
+ *
  * The trickiest part of GVariantTypeInfo (and in fact, the major reason
  * for its existence) is the storage of somewhat magical constants that
  * allow for O(1) lookups of items in tuples.  This is described below.
@@ -81,6 +88,9 @@ typedef struct
   gint ref_count;
 } ContainerInfo;
 
+/* The reference count of the containers that are never freed */
+#define STATIC_REF_COUNT (-1)
+
 /* For 'array' and 'maybe' types, we store some extra information on the
  * end of the GVariantTypeInfo struct -- the element type (ie: "s" for
  * "as").  The container GVariantTypeInfo structure holds a reference to
@@ -169,7 +179,8 @@ g_variant_type_info_check (const GVariantTypeInfo *info,
       ContainerInfo *container = (ContainerInfo *) info;
 
       /* extra checks for containers */
-      g_assert_cmpint (container->ref_count, >, 0);
+      g_assert (container->ref_count > 0 ||
+                container->ref_count == STATIC_REF_COUNT);
       g_assert (container->type_string != NULL);
     }
   else
@@ -709,9 +720,96 @@ g_variant_type_info_member_info (GVariantTypeInfo *info,
 }
 
 /* == new/ref/unref == */
-static GRecMutex g_variant_type_info_lock;
+static GRWLock g_variant_type_info_lock;
 static GHashTable *g_variant_type_info_table;
 
+/* The container types that are never freed.  Each of them holds
+ * references on its subtypes forever, so those must be in this list
+ * too (or be base types).
+ */
+static const struct
+{
+  gchar string[16];
+  gsize length;
+} g_variant_type_info_static_strings[] = {
+#define STATIC_TYPE(s) { s, sizeof s - 1 }
+  STATIC_TYPE ("ay"), STATIC_TYPE ("ab"), STATIC_TYPE ("ai"),
+  STATIC_TYPE ("au"), STATIC_TYPE ("ax"), STATIC_TYPE ("at"),
+  STATIC_TYPE ("ad"), STATIC_TYPE ("as"), STATIC_TYPE ("ao"),
+  STATIC_TYPE ("ag"), STATIC_TYPE ("av"), STATIC_TYPE ("aay"),
+  STATIC_TYPE ("{sv}"), STATIC_TYPE ("a{sv}"),
+  STATIC_TYPE ("{ss}"), STATIC_TYPE ("a{ss}"),
+  STATIC_TYPE ("{sa{sv}}"), STATIC_TYPE ("a{sa{sv}}"),
+  STATIC_TYPE ("(s)"), STATIC_TYPE ("(o)"), STATIC_TYPE ("(u)"),
+  STATIC_TYPE ("(b)"), STATIC_TYPE ("(v)"), STATIC_TYPE ("(ss)"),
+  STATIC_TYPE ("(as)"), STATIC_TYPE ("(a{sv})"),
+  STATIC_TYPE ("(sa{sv}as)"), STATIC_TYPE ("(oas)"),
+  STATIC_TYPE ("(oa{sa{sv}})")
+#undef STATIC_TYPE
+};
+static ContainerInfo *g_variant_type_info_static[G_N_ELEMENTS (g_variant_type_info_static_strings)];
+
+static gint
+g_variant_type_info_static_index (const GVariantType *type)
+{
+  const gchar *type_string;
+  gsize length;
+  gint i;
+
+  type_string = g_variant_type_peek_string (type);
+  length = g_variant_type_get_string_length (type);
+
+  /* all container type strings are at least two characters long */
+  for (i = 0; i < G_N_ELEMENTS (g_variant_type_info_static_strings); i++)
+    if (g_variant_type_info_static_strings[i].length == length &&
+        g_variant_type_info_static_strings[i].string[1] == type_string[1] &&
+        memcmp (g_variant_type_info_static_strings[i].string, type_string, length) == 0)
+      return i;
+
+  return -1;
+}
+
+static ContainerInfo *
+container_info_new (const GVariantType *type)
+{
+  ContainerInfo *container;
+  char type_char;
+
+  type_char = g_variant_type_peek_string (type)[0];
+
+  if (type_char == G_VARIANT_TYPE_INFO_CHAR_MAYBE ||
+      type_char == G_VARIANT_TYPE_INFO_CHAR_ARRAY)
+    {
+      container = array_info_new (type);
+    }
+  else /* tuple or dict entry */
+    {
+      container = tuple_info_new (type);
+    }
+
+  container->type_string = g_variant_type_dup_string (type);
+  container->ref_count = 1;
+
+  return container;
+}
+
+static void
+container_info_free (ContainerInfo *container)
+{
+  GVariantTypeInfo *info = (GVariantTypeInfo *) container;
+
+  g_free (container->type_string);
+
+  if (info->container_class == GV_ARRAY_INFO_CLASS)
+    array_info_free (info);
+
+  else if (info->container_class == GV_TUPLE_INFO_CLASS)
+    tuple_info_free (info);
+
+  else
+    g_assert_not_reached ();
+}
+
 /* < private >
  * g_variant_type_info_get:
  * @type: a #GVariantType
@@ -737,43 +835,87 @@ g_variant_type_info_get (const GVariantType *type)
       type_char == G_VARIANT_TYPE_INFO_CHAR_TUPLE ||
       type_char == G_VARIANT_TYPE_INFO_CHAR_DICT_ENTRY)
     {
+      ContainerInfo *container;
       GVariantTypeInfo *info;
       gchar *type_string;
+      gint index;
+
+      index = g_variant_type_info_static_index (type);
+
+      if (index >= 0)
+        {
+          ContainerInfo **slot = &g_variant_type_info_static[index];
+
+          container = g_atomic_pointer_get (slot);
+
+          if (container == NULL)
+            {
+              /* if another thread beats us to it, use its copy */
+              container = container_info_new (type);
+              container->ref_count = STATIC_REF_COUNT;
+
+              if (!g_atomic_pointer_compare_and_exchange (slot, NULL, container))
+                {
+                  container_info_free (container);
+                  container = g_atomic_pointer_get (slot);
+                }
+            }
+
+          info = (GVariantTypeInfo *) container;
+          g_variant_type_info_check (info, 0);
+
+          return info;
+        }
 
       type_string = g_variant_type_dup_string (type);
 
-      g_rec_mutex_lock (&g_variant_type_info_lock);
+      /* an info in the table has a reference count of at least one
+       * for as long as the lock is held, so readers can take a
+       * reference without further ado
+       */
+      g_rw_lock_reader_lock (&g_variant_type_info_lock);
+
+      if (g_variant_type_info_table != NULL)
+        info = g_hash_table_lookup (g_variant_type_info_table, type_string);
+      else
+        info = NULL;
+
+      if (info != NULL)
+        g_atomic_int_inc (&((ContainerInfo *) info)->ref_count);
 
-      if (g_variant_type_info_table == NULL)
-        g_variant_type_info_table = g_hash_table_new (g_str_hash,
-                                                      g_str_equal);
-      info = g_hash_table_lookup (g_variant_type_info_table, type_string);
+      g_rw_lock_reader_unlock (&g_variant_type_info_lock);
 
       if (info == NULL)
         {
-          ContainerInfo *container;
+          /* this gets the infos of the subtypes, so it can't be done
+           * with the lock held
+           */
+          container = container_info_new (type);
 
-          if (type_char == G_VARIANT_TYPE_INFO_CHAR_MAYBE ||
-              type_char == G_VARIANT_TYPE_INFO_CHAR_ARRAY)
-            {
-              container = array_info_new (type);
-            }
-          else /* tuple or dict entry */
+          g_rw_lock_writer_lock (&g_variant_type_info_lock);
+
+          if (g_variant_type_info_table == NULL)
+            g_variant_type_info_table = g_hash_table_new (g_str_hash,
+                                                          g_str_equal);
+          info = g_hash_table_lookup (g_variant_type_info_table, type_string);
+
+          if (info == NULL)
             {
-              container = tuple_info_new (type);
+              info = (GVariantTypeInfo *) container;
+              g_hash_table_insert (g_variant_type_info_table,
+                                   container->type_string, info);
+              container = NULL;
             }
+          else
+            g_atomic_int_inc (&((ContainerInfo *) info)->ref_count);
 
-          info = (GVariantTypeInfo *) container;
-          container->type_string = type_string;
-          container->ref_count = 1;
+          g_rw_lock_writer_unlock (&g_variant_type_info_lock);
 
-          g_hash_table_insert (g_variant_type_info_table, type_string, info);
-          type_string = NULL;
+          /* somebody else added one in the meantime */
+          if (container != NULL)
+            container_info_free (container);
         }
-      else
-        g_variant_type_info_ref (info);
 
-      g_rec_mutex_unlock (&g_variant_type_info_lock);
       g_variant_type_info_check (info, 0);
       g_free (type_string);
 
@@ -811,6 +953,9 @@ g_variant_type_info_ref (GVariantTypeInfo *info)
     {
       ContainerInfo *container = (ContainerInfo *) info;
 
+      if (container->ref_count == STATIC_REF_COUNT)
+        return info;
+
       g_assert_cmpint (container->ref_count, >, 0);
       g_atomic_int_inc (&container->ref_count);
     }
@@ -833,8 +978,27 @@ g_variant_type_info_unref (GVariantTypeInfo *info)
   if (info->container_class)
     {
       ContainerInfo *container = (ContainerInfo *) info;
+      gint ref_count;
+
+      if (container->ref_count == STATIC_REF_COUNT)
+        return;
 
-      g_rec_mutex_lock (&g_variant_type_info_lock);
+      /* only dropping the last reference needs the lock, so that
+       * nobody can find the info in the table while it goes away
+       */
+      do
+        {
+          ref_count = g_atomic_int_get (&container->ref_count);
+          if (ref_count == 1)
+            break;
+        }
+      while (!g_atomic_int_compare_and_exchange (&container->ref_count,
+                                                 ref_count, ref_count - 1));
+
+      if (ref_count > 1)
+        return;
+
+      g_rw_lock_writer_lock (&g_variant_type_info_lock);
       if (g_atomic_int_dec_and_test (&container->ref_count))
         {
           g_hash_table_remove (g_variant_type_info_table,
@@ -844,21 +1008,12 @@ g_variant_type_info_unref (GVariantTypeInfo *info)
               g_hash_table_unref (g_variant_type_info_table);
               g_variant_type_info_table = NULL;
             }
-          g_rec_mutex_unlock (&g_variant_type_info_lock);
+          g_rw_lock_writer_unlock (&g_variant_type_info_lock);
 
-          g_free (container->type_string);
-
-          if (info->container_class == GV_ARRAY_INFO_CLASS)
-            array_info_free (info);
-
-          else if (info->container_class == GV_TUPLE_INFO_CLASS)
-            tuple_info_free (info);
-
-          else
-            g_assert_not_reached ();
+          container_info_free (container);
         }
       else
-        g_rec_mutex_unlock (&g_variant_type_info_lock);
+        g_rw_lock_writer_unlock (&g_variant_type_info_lock);
     }
 }
 
@@ -121,9 +121,10 @@ testcase (gconstpointer data)
   #define SUFFIX "-emufutex"
 
   /* ensure that we are using the emulated futex by checking
-   * (at compile-time) for the existance of 'g_futex_address_list'
+   * (at compile-time) for the existance of 'g_futex_buckets'
    */
-  g_assert (g_futex_address_list == NULL);
+  for (i = 0; i < G_N_ELEMENTS (g_futex_buckets); i++)
+    g_assert (g_futex_buckets[i].addresses == NULL);
 #else
   #define SUFFIX ""
 #endif
@@ -1,6 +1,10 @@
 #include <glib.h>
 
+#include <stdio.h>
+
 #define ITERATIONS 100000000
+#define CONTENDED_ITERATIONS 10000000
+#define THREADS 8
 
 static void
 test_bitlocks (void)
@@ -23,7 +27,63 @@ test_bitlocks (void)
     elapsed /= 1000000;
     rate = ITERATIONS / elapsed;
 
-    g_test_maximized_result (rate, "iterations per second");
+    g_test_maximized_result (rate, "%f iterations per second", rate);
+  }
+}
+
+/* the pointer is a counter shifted past the lock bit, so that the
+ * critical section is short and its result can be checked
+ */
+static gpointer shared_pointer;
+
+static gpointer
+pointer_thread (gpointer data)
+{
+  gint iterations = GPOINTER_TO_INT (data);
+  gint i;
+
+  for (i = 0; i < iterations; i++)
+    {
+      gsize value;
+
+      g_pointer_bit_lock (&shared_pointer, 0);
+      value = (gsize) g_atomic_pointer_get (&shared_pointer);
+      g_atomic_pointer_set (&shared_pointer, (gpointer) (value + 2));
+      g_pointer_bit_unlock (&shared_pointer, 0);
+    }
+
+  return NULL;
+}
+
+static void
+test_pointer_bitlocks (gconstpointer data)
+{
+  gint n_threads = GPOINTER_TO_INT (data);
+  gint iterations = CONTENDED_ITERATIONS / n_threads;
+  GThread *threads[THREADS];
+  guint64 start;
+  gint i;
+
+  shared_pointer = NULL;
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_new ("bitlock", pointer_thread, GINT_TO_POINTER (iterations));
+
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+
+  g_assert_cmpuint ((gsize) shared_pointer, ==, (gsize) iterations * n_threads * 2);
+
+  {
+    gdouble elapsed;
+    gdouble rate;
+
+    elapsed = g_get_monotonic_time () - start;
+    elapsed /= 1000000;
+    rate = iterations * n_threads / elapsed;
+
+    g_test_maximized_result (rate, "%f iterations per second", rate);
   }
 }
 
@@ -33,7 +93,18 @@ main (int argc, char **argv)
   g_test_init (&argc, &argv, NULL);
 
   if (g_test_perf ())
-    g_test_add_func ("/bitlock/performance/uncontended", test_bitlocks);
+    {
+      gint i;
+
+      g_test_add_func ("/bitlock/performance/uncontended", test_bitlocks);
+
+      for (i = 1; i <= THREADS; i *= 2)
+        {
+          gchar name[80];
+          sprintf (name, "/bitlock/performance/pointer/contended/%d", i);
+          g_test_add_data_func (name, GINT_TO_POINTER (i), test_pointer_bitlocks);
+        }
+    }
 
   return g_test_run ();
 }
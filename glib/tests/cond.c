@@ -222,6 +222,50 @@ test_cond2 (void)
   g_assert_cmpint (g_atomic_int_get (&check), ==, 10);
 }
 
+static gpointer
+wait_until_signal (gpointer data)
+{
+  GCond *c = data;
+
+  g_mutex_lock (&mutex);
+  g_atomic_int_set (&next, 1);
+  g_cond_signal (c);
+  g_mutex_unlock (&mutex);
+
+  return NULL;
+}
+
+static void
+test_wait_until (void)
+{
+  GCond c;
+  GThread *thread;
+  gint64 until;
+  gboolean signalled;
+
+  g_cond_init (&c);
+  g_mutex_lock (&mutex);
+
+  until = g_get_monotonic_time () + 50000;
+  g_assert (!g_cond_wait_until (&c, &mutex, until));
+  g_assert_cmpint (g_get_monotonic_time (), >=, until);
+
+  /* already in the past */
+  g_assert (!g_cond_wait_until (&c, &mutex, until));
+
+  g_atomic_int_set (&next, 0);
+  thread = g_thread_new ("signal", wait_until_signal, &c);
+  until = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+  signalled = TRUE;
+  while (signalled && !g_atomic_int_get (&next))
+    signalled = g_cond_wait_until (&c, &mutex, until);
+  g_assert (signalled);
+
+  g_mutex_unlock (&mutex);
+  g_thread_join (thread);
+  g_cond_clear (&c);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -229,6 +273,7 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/thread/cond1", test_cond1);
   g_test_add_func ("/thread/cond2", test_cond2);
+  g_test_add_func ("/thread/cond/wait-until", test_wait_until);
 
   return g_test_run ();
 }
@@ -701,6 +701,155 @@ test_no_conv (void)
   g_assert (error && error->domain == G_CONVERT_ERROR);
 }
 
+/* The built-in converters must behave exactly like iconv does */
+static void
+test_builtin (void)
+{
+  const gchar *charsets[] = {
+    "UTF-8", "ISO-8859-1", "ASCII", "UTF-16LE", "UTF-16BE"
+  };
+  const struct {
+    const gchar *bytes;
+    gsize len;
+  } inputs[] = {
+    { "abc", 3 },
+    { "", 0 },
+    { "a\0b", 3 },
+    { "\xc2\xbd", 2 },                  /* one half */
+    { "x\xe2\x82\xac", 4 },             /* euro sign */
+    { "\xf0\x9f\x98\x80", 4 },          /* outside the BMP */
+    { "abc\xe2\x82", 5 },               /* partial */
+    { "ab\xc0\x80", 4 },                /* overlong */
+    { "\xed\xa0\x80", 3 },              /* surrogate */
+    { "\xf4\x90\x80\x80", 4 },          /* above U+10FFFF */
+    { "\xf7\xbf\xbf\xbf", 4 },
+    { "\xf8\x88\x80\x80\x80", 5 },      /* five bytes */
+    { "a\xe0\x80", 3 },                  /* partial and overlong */
+    { "a\xe0\xa0", 3 },                  /* partial */
+    { "\xef\xbf\xbf\xee\x80\x80", 6 },  /* U+FFFF, U+E000 */
+    { "\x3d\xd8\x00\xde", 4 },          /* surrogate pair */
+    { "a\0\x3d\xd8", 4 },               /* partial pair */
+    { "\x00\xdc" "a\0", 4 },            /* lone low surrogate */
+    { "\x3d\xd8" "a\0", 4 },            /* high surrogate without low */
+    { "a\0b", 3 },                      /* odd length */
+    { "\x80\xff\xfe", 3 }
+  };
+  gint i, j, k;
+
+  for (i = 0; i < G_N_ELEMENTS (charsets); i++)
+    for (j = 0; j < G_N_ELEMENTS (charsets); j++)
+      for (k = 0; k < G_N_ELEMENTS (inputs); k++)
+        {
+          GIConv cd;
+          gsize read, written, read_iconv, written_iconv;
+          GError *error = NULL, *error_iconv = NULL;
+          gchar *out, *out_iconv;
+
+          cd = g_iconv_open (charsets[i], charsets[j]);
+          g_assert (cd != (GIConv) -1);
+
+          out = g_convert (inputs[k].bytes, inputs[k].len,
+                           charsets[i], charsets[j],
+                           &read, &written, &error);
+          out_iconv = g_convert_with_iconv (inputs[k].bytes, inputs[k].len, cd,
+                                            &read_iconv, &written_iconv, &error_iconv);
+
+          if (g_test_verbose ())
+            g_print ("%s -> %s, input %d\n", charsets[j], charsets[i], k);
+
+          g_assert_cmpuint (read, ==, read_iconv);
+          if (error_iconv)
+            g_assert_error (error, error_iconv->domain, error_iconv->code);
+          else
+            {
+              g_assert_no_error (error);
+              g_assert_cmpuint (written, ==, written_iconv);
+              g_assert (memcmp (out, out_iconv, written + 1) == 0);
+            }
+
+          g_clear_error (&error);
+          g_clear_error (&error_iconv);
+          g_free (out);
+          g_free (out_iconv);
+
+          /* without bytes_read, partial input is an error */
+          g_iconv (cd, NULL, NULL, NULL, NULL);
+          out = g_convert (inputs[k].bytes, inputs[k].len,
+                           charsets[i], charsets[j],
+                           NULL, NULL, &error);
+          out_iconv = g_convert_with_iconv (inputs[k].bytes, inputs[k].len, cd,
+                                            NULL, NULL, &error_iconv);
+          if (error_iconv)
+            g_assert_error (error, error_iconv->domain, error_iconv->code);
+          else
+            g_assert_no_error (error);
+
+          g_clear_error (&error);
+          g_clear_error (&error_iconv);
+          g_free (out);
+          g_free (out_iconv);
+
+          g_iconv_close (cd);
+        }
+}
+
+/* Converters are reused, so they must not carry anything over from
+ * one conversion to the next
+ */
+static void
+test_reuse (void)
+{
+  const gchar *charsets[] = {
+    "ISO-8859-2", "ISO-8859-3", "ISO-8859-4", "ISO-8859-5", "ISO-8859-7",
+    "ISO-8859-9", "ISO-8859-13", "ISO-8859-14", "ISO-8859-15", "KOI8-R"
+  };
+  gint i, j;
+
+  for (i = 0; i < 3; i++)
+    {
+      test_iconv_state ();
+      test_one_half ();
+      test_byte_order ();
+    }
+
+  /* more than fit in the cache, twice over */
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < G_N_ELEMENTS (charsets); j++)
+      {
+        GError *error = NULL;
+        gchar *out;
+
+        out = g_convert ("abc", -1, charsets[j], "UTF-8", NULL, NULL, &error);
+        g_assert_no_error (error);
+        g_assert_cmpstr (out, ==, "abc");
+        g_free (out);
+      }
+}
+
+static void
+test_convert_perf (gconstpointer data)
+{
+  const gchar *charset = data;
+  const gchar *line = "2012-06-01 12:00:00 caf\xe9 cr\xe8me br\xfbl\xe9" "e, na\xefve";
+  gint64 start;
+  gdouble rate;
+  gint i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < 1000000; i++)
+    {
+      gchar *out;
+
+      out = g_convert (line, -1, "UTF-8", charset, NULL, NULL, NULL);
+      g_assert (out != NULL);
+      g_free (out);
+    }
+
+  rate = i / ((g_get_monotonic_time () - start) / 1000000.);
+  g_test_maximized_result (rate, "%.0f conversions per second", rate);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -713,6 +862,15 @@ main (int argc, char *argv[])
   g_test_add_func ("/conversion/unicode", test_unicode_conversions);
   g_test_add_func ("/conversion/filename-utf8", test_filename_utf8);
   g_test_add_func ("/conversion/filename-display", test_filename_display);
+  g_test_add_func ("/conversion/builtin", test_builtin);
+  g_test_add_func ("/conversion/reuse", test_reuse);
+
+  if (g_test_perf ())
+    {
+      /* built in, and through a cached iconv descriptor */
+      g_test_add_data_func ("/conversion/perf/latin1", "ISO-8859-1", test_convert_perf);
+      g_test_add_data_func ("/conversion/perf/latin9", "ISO-8859-15", test_convert_perf);
+    }
 
   return g_test_run ();
 }
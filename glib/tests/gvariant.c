@@ -1039,6 +1039,89 @@ test_gvarianttypeinfo (void)
   g_variant_type_info_assert_no_infos ();
 }
 
+/* the most common container types are looked up without locking and
+ * are never freed; everything else must still go away in the end, even
+ * if the infos are created and destroyed in several threads at once
+ */
+static const gchar *typeinfo_thread_types[] = {
+  "a{sv}", "(sa{sv}as)", "a{sx}", "(iaay)", "maa{ss}", "(i(u))"
+};
+
+static gpointer
+typeinfo_thread (gpointer data)
+{
+  gint n_iterations = GPOINTER_TO_INT (data);
+  gint i, j;
+
+  for (i = 0; i < n_iterations; i++)
+    for (j = 0; j < G_N_ELEMENTS (typeinfo_thread_types); j++)
+      {
+        GVariantTypeInfo *info;
+
+        info = g_variant_type_info_get (G_VARIANT_TYPE (typeinfo_thread_types[j]));
+        g_assert_cmpstr (g_variant_type_info_get_type_string (info), ==,
+                         typeinfo_thread_types[j]);
+        g_variant_type_info_unref (info);
+      }
+
+  return NULL;
+}
+
+static void
+test_gvarianttypeinfo_threaded (void)
+{
+  GVariantTypeInfo *info, *info2;
+  GThread *threads[4];
+  gint i;
+
+  info = g_variant_type_info_get (G_VARIANT_TYPE ("a{sv}"));
+  info2 = g_variant_type_info_get (G_VARIANT_TYPE ("a{sv}"));
+  g_assert (info == info2);
+  g_assert_cmpstr (g_variant_type_info_get_type_string (g_variant_type_info_element (info)), ==, "{sv}");
+  g_variant_type_info_unref (info);
+  g_variant_type_info_unref (info2);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    threads[i] = g_thread_new ("typeinfo", typeinfo_thread, GINT_TO_POINTER (10000));
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    g_thread_join (threads[i]);
+
+  g_variant_type_info_assert_no_infos ();
+}
+
+static void
+test_gvarianttypeinfo_perf (gconstpointer data)
+{
+  gint n_threads = GPOINTER_TO_INT (data);
+  GThread *threads[8];
+  GVariantTypeInfo *infos[G_N_ELEMENTS (typeinfo_thread_types)];
+  gint n_iterations = 1000000 / n_threads;
+  gint64 start;
+  gdouble rate;
+  gint i;
+
+  /* measure lookups, not creating the infos over and over */
+  for (i = 0; i < G_N_ELEMENTS (infos); i++)
+    infos[i] = g_variant_type_info_get (G_VARIANT_TYPE (typeinfo_thread_types[i]));
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_new ("typeinfo", typeinfo_thread, GINT_TO_POINTER (n_iterations));
+
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+
+  rate = n_iterations * n_threads * G_N_ELEMENTS (typeinfo_thread_types) /
+         ((g_get_monotonic_time () - start) / 1000000.);
+
+  for (i = 0; i < G_N_ELEMENTS (infos); i++)
+    g_variant_type_info_unref (infos[i]);
+
+  g_test_maximized_result (rate, "%.0f lookups per second", rate);
+}
+
 #define MAX_FIXED_MULTIPLIER    256
 #define MAX_INSTANCE_SIZE       1024
 #define MAX_ARRAY_CHILDREN      128
@@ -4126,6 +4209,7 @@ main (int argc, char **argv)
 
   g_test_add_func ("/gvariant/type", test_gvarianttype);
   g_test_add_func ("/gvariant/typeinfo", test_gvarianttypeinfo);
+  g_test_add_func ("/gvariant/typeinfo/threaded", test_gvarianttypeinfo_threaded);
   g_test_add_func ("/gvariant/serialiser/maybe", test_maybes);
   g_test_add_func ("/gvariant/serialiser/array", test_arrays);
   g_test_add_func ("/gvariant/serialiser/tuple", test_tuples);
@@ -4162,5 +4246,16 @@ main (int argc, char **argv)
   g_test_add_func ("/gvariant/compare", test_compare);
   g_test_add_func ("/gvariant/fixed-array", test_fixed_array);
 
+  if (g_test_perf ())
+    for (i = 1; i <= 8; i *= 2)
+      {
+        char *testname;
+
+        testname = g_strdup_printf ("/gvariant/perf/typeinfo/%d", i);
+        g_test_add_data_func (testname, GINT_TO_POINTER (i),
+                              test_gvarianttypeinfo_perf);
+        g_free (testname);
+      }
+
   return g_test_run ();
 }
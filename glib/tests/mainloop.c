@@ -145,6 +145,17 @@ count_calls (gpointer data)
   return TRUE;
 }
 
+/* g_main_loop_quit() returns nothing, so it can't be used as a
+ * #GSourceFunc directly without leaving the source's fate to chance.
+ */
+static gboolean
+quit_loop (gpointer data)
+{
+  g_main_loop_quit (data);
+
+  return FALSE;
+}
+
 static void
 test_timeouts (void)
 {
@@ -173,7 +184,7 @@ test_timeouts (void)
   g_source_unref (source);
 
   source = g_timeout_source_new (1050);
-  g_source_set_callback (source, (GSourceFunc)g_main_loop_quit, loop, NULL);
+  g_source_set_callback (source, quit_loop, loop, NULL);
   g_source_attach (source, ctx);
   g_source_unref (source);
 
@@ -326,7 +337,7 @@ run_inner_loop (gpointer user_data)
 
   inner = g_main_loop_new (ctx, FALSE);
   timeout = g_timeout_source_new (100);
-  g_source_set_callback (timeout, (GSourceFunc)g_main_loop_quit, inner, NULL);
+  g_source_set_callback (timeout, quit_loop, inner, NULL);
   g_source_attach (timeout, ctx);
 
   g_main_loop_run (inner);
@@ -371,7 +382,7 @@ test_child_sources (void)
   g_assert_cmpint (g_source_get_priority (child_c), ==, G_PRIORITY_DEFAULT);
 
   end = g_timeout_source_new (1050);
-  g_source_set_callback (end, (GSourceFunc)g_main_loop_quit, loop, NULL);
+  g_source_set_callback (end, quit_loop, loop, NULL);
   g_source_attach (end, ctx);
   g_source_unref (end);
 
@@ -438,7 +449,7 @@ test_recursive_child_sources (void)
   g_source_attach (parent, ctx);
 
   end = g_timeout_source_new (2010);
-  g_source_set_callback (end, (GSourceFunc)g_main_loop_quit, loop, NULL);
+  g_source_set_callback (end, quit_loop, loop, NULL);
   g_source_attach (end, ctx);
   g_source_unref (end);
 
@@ -27,6 +27,10 @@
 
 #include <stdio.h>
 
+#ifdef G_OS_UNIX
+#include <pthread.h>
+#endif
+
 static void
 test_mutex1 (void)
 {
@@ -173,9 +177,38 @@ do_addition (gint *value)
   return more;
 }
 
+#ifdef G_OS_UNIX
+/* the same with a plain pthread mutex, to compare GMutex against */
+static gboolean
+do_addition_pthread (gint *value)
+{
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  gboolean more;
+
+  pthread_mutex_lock (&lock);
+  if ((more = *value != COUNT_TO))
+    if (*value != -1)
+      (*value)++;
+  pthread_mutex_unlock (&lock);
+
+  return more;
+}
+#endif
+
+static gboolean use_pthread;
+
 static gpointer
 addition_thread (gpointer value)
 {
+#ifdef G_OS_UNIX
+  if (use_pthread)
+    {
+      while (do_addition_pthread (value));
+
+      return NULL;
+    }
+#endif
+
   while (do_addition (value));
 
   return NULL;
@@ -208,6 +241,16 @@ test_mutex_perf (gconstpointer data)
   g_test_maximized_result (rate, "%f mips", rate);
 }
 
+#ifdef G_OS_UNIX
+static void
+test_mutex_perf_pthread (gconstpointer data)
+{
+  use_pthread = TRUE;
+  test_mutex_perf (data);
+  use_pthread = FALSE;
+}
+#endif
+
 int
 main (int argc, char *argv[])
 {
@@ -231,6 +274,17 @@ main (int argc, char *argv[])
           sprintf (name, "/thread/mutex/perf/contended/%d", i);
           g_test_add_data_func (name, GINT_TO_POINTER (i), test_mutex_perf);
         }
+
+#ifdef G_OS_UNIX
+      g_test_add_data_func ("/thread/mutex/perf/pthread/uncontended", NULL, test_mutex_perf_pthread);
+
+      for (i = 1; i <= 10; i++)
+        {
+          gchar name[80];
+          sprintf (name, "/thread/mutex/perf/pthread/contended/%d", i);
+          g_test_add_data_func (name, GINT_TO_POINTER (i), test_mutex_perf_pthread);
+        }
+#endif
     }
 
   return g_test_run ();
@@ -26,6 +26,10 @@
 #include <glib.h>
 #include <string.h>
 
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#endif
+
 static char *echo_prog_path;
 static char *echo_script_path;
 
@@ -184,6 +188,72 @@ test_spawn_script (void)
   g_ptr_array_free (argv, TRUE);
 }
 
+#define PERF_ITERATIONS 200
+#define PERF_HEAP_SIZE (256 * 1024 * 1024)
+#define PERF_N_FDS 1000
+
+enum {
+  PERF_CLOSE_DESCRIPTORS,
+  PERF_LEAVE_DESCRIPTORS_OPEN,
+  PERF_CHILD_SETUP
+};
+
+static void
+child_setup_nop (gpointer user_data)
+{
+}
+
+static void
+test_spawn_perf (gconstpointer data)
+{
+  gint mode = GPOINTER_TO_INT (data);
+  GSpawnFlags flags = 0;
+  GSpawnChildSetupFunc child_setup = NULL;
+  GError *error = NULL;
+  gchar *argv[] = { echo_prog_path, "x", NULL };
+  gchar *stdout_str;
+  gchar *heap;
+  gint fds[PERF_N_FDS];
+  gint64 start;
+  gdouble elapsed;
+  gint i;
+
+  /* Look like a big application: fork() has to copy the page tables
+   * of the heap, and there are many descriptors to close.
+   */
+  heap = g_malloc (PERF_HEAP_SIZE);
+  memset (heap, 1, PERF_HEAP_SIZE);
+#ifdef G_OS_UNIX
+  for (i = 0; i < PERF_N_FDS; i++)
+    fds[i] = dup (2);
+#endif
+
+  if (mode == PERF_LEAVE_DESCRIPTORS_OPEN)
+    flags |= G_SPAWN_LEAVE_DESCRIPTORS_OPEN;
+  else if (mode == PERF_CHILD_SETUP)
+    child_setup = child_setup_nop; /* always needs fork() */
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < PERF_ITERATIONS; i++)
+    {
+      g_spawn_sync (NULL, argv, NULL, flags, child_setup, NULL, &stdout_str, NULL, NULL, &error);
+      g_assert_no_error (error);
+      g_assert_cmpstr (stdout_str, ==, "x");
+      g_free (stdout_str);
+    }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_test_minimized_result (elapsed / PERF_ITERATIONS,
+                           "%.1f microseconds per spawn",
+                           elapsed / PERF_ITERATIONS);
+
+#ifdef G_OS_UNIX
+  for (i = 0; i < PERF_N_FDS; i++)
+    close (fds[i]);
+#endif
+  g_free (heap);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -221,5 +291,18 @@ main (int   argc,
   g_test_add_func ("/gthread/spawn-single-async", test_spawn_async);
   g_test_add_func ("/gthread/spawn-script", test_spawn_script);
 
+  if (g_test_perf ())
+    {
+      g_test_add_data_func ("/gthread/spawn-perf/close-descriptors",
+                            GINT_TO_POINTER (PERF_CLOSE_DESCRIPTORS),
+                            test_spawn_perf);
+      g_test_add_data_func ("/gthread/spawn-perf/leave-descriptors-open",
+                            GINT_TO_POINTER (PERF_LEAVE_DESCRIPTORS_OPEN),
+                            test_spawn_perf);
+      g_test_add_data_func ("/gthread/spawn-perf/child-setup",
+                            GINT_TO_POINTER (PERF_CHILD_SETUP),
+                            test_spawn_perf);
+    }
+
   return g_test_run();
 }